@@ -16,6 +16,11 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include "gdal.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "ogr_srs_api.h"
+
 //For some reason these directives are not working
 // and the code will not compile unless netCDF_lock
 // is explicitely created
@@ -385,6 +390,155 @@ void checkOutputWritingMethods()
 
 }
 
+void checkInMemoryOutputMethods()
+{
+    const double * data;
+    int nRows, nCols, nLayers;
+    double adfGeoTransform[6];
+
+    errval = NinjaSetFileOutFlag( ninja, 0, FALSE );
+    assert( errval == NINJA_SUCCESS );
+
+    errval = NinjaSetFileOutFlag( NULL, 0, FALSE );
+    assert( errval == NINJA_E_NULL_PTR );
+
+    errval = NinjaSetOutputGridsInMemory( ninja, 0, TRUE, TRUE );
+    assert( errval == NINJA_SUCCESS );
+
+    errval = NinjaSetOutputGridsInMemory( ninja, 1, TRUE, TRUE );
+    assert( errval == NINJA_E_INVALID );
+
+    //nothing has been solved yet
+    data = NinjaGetOutputGrid( ninja, 0, "speed", &nRows, &nCols,
+                               adfGeoTransform, NULL );
+    assert( NULL == data );
+
+    data = NinjaGetOutputGrid( ninja, 0, "x", &nRows, &nCols, NULL, NULL );
+    assert( NULL == data );
+
+    data = NinjaGetOutputField3D( ninja, 0, "u", &nRows, &nCols, &nLayers );
+    assert( NULL == data );
+
+    errval = NinjaReleaseOutputGrids( ninja, 0 );
+    assert( errval == NINJA_SUCCESS );
+
+    errval = NinjaReleaseOutputGrids( NULL, 0 );
+    assert( errval == NINJA_E_NULL_PTR );
+
+    errval = NinjaSetFileOutFlag( ninja, 0, TRUE );
+    assert( errval == NINJA_SUCCESS );
+}
+
+/*
+** Solve a small in-memory domain with no file output and read the results
+** back through the in-memory output methods.
+*/
+void checkInMemoryOutputRun()
+{
+    NinjaH * memNinja = NULL;
+    OGRSpatialReferenceH hSRS;
+    char * pszWkt = NULL;
+    char ** papszBefore, ** papszAfter;
+    const double * data;
+    double elevation[20 * 20];
+    double adfDemGeoTransform[6] = { 500000.0, 100.0, 0.0, 4800000.0, 0.0, -100.0 };
+    double adfGeoTransform[6];
+    double noData;
+    int nRows, nCols, nLayers, i, j;
+
+    GDALAllRegister();
+
+    //pyramid, 1000 m at the edges
+    for( i = 0; i < 20; i++ )
+        for( j = 0; j < 20; j++ )
+            elevation[i * 20 + j] = 1000.0 +
+                10.0 * ( ( i < 19 - i ? i : 19 - i ) + ( j < 19 - j ? j : 19 - j ) );
+
+    hSRS = OSRNewSpatialReference( NULL );
+    OSRSetWellKnownGeogCS( hSRS, "WGS84" );
+    OSRSetUTM( hSRS, 12, TRUE );
+    OSRExportToWkt( hSRS, &pszWkt );
+
+    memNinja = NinjaCreateArmy( 1, NULL );
+    assert( NULL != memNinja );
+
+    errval = NinjaSetMemoryDEM( memNinja, 0, elevation, 20, 20,
+                                adfDemGeoTransform, pszWkt, -9999.0 );
+    assert( errval == NINJA_SUCCESS );
+
+    errval = NinjaSetInitializationMethod( memNinja, 0, "domain" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetNumberCPUs( memNinja, 0, 1 );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetInputSpeed( memNinja, 0, 5.0, "mps" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetInputDirection( memNinja, 0, 270.0 );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetInputWindHeight( memNinja, 0, 10.0, "m" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetOutputWindHeight( memNinja, 0, 10.0, "m" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetOutputSpeedUnits( memNinja, 0, "mps" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetDiurnalWinds( memNinja, 0, FALSE );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetUniVegetation( memNinja, 0, "grass" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetMeshResolution( memNinja, 0, 200.0, "m" );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetFileOutFlag( memNinja, 0, FALSE );
+    assert( errval == NINJA_SUCCESS );
+    errval = NinjaSetOutputGridsInMemory( memNinja, 0, TRUE, TRUE );
+    assert( errval == NINJA_SUCCESS );
+
+    papszBefore = VSIReadDir( "." );
+    errval = NinjaStartRuns( memNinja, 1 );
+    assert( errval == NINJA_SUCCESS );
+    papszAfter = VSIReadDir( "." );
+    //no output files were written
+    assert( CSLCount( papszBefore ) == CSLCount( papszAfter ) );
+    CSLDestroy( papszBefore );
+    CSLDestroy( papszAfter );
+
+    data = NinjaGetOutputGrid( memNinja, 0, "speed", &nRows, &nCols,
+                               adfGeoTransform, &noData );
+    assert( NULL != data );
+    assert( nRows == 20 && nCols == 20 );
+    //rows start at the south edge
+    assert( adfGeoTransform[0] == 500000.0 );
+    assert( adfGeoTransform[1] == 100.0 );
+    assert( adfGeoTransform[3] == 4800000.0 - 20 * 100.0 );
+    assert( adfGeoTransform[5] == 100.0 );
+    for( i = 0; i < nRows * nCols; i++ )
+        assert( data[i] != noData && data[i] > 0.0 && data[i] < 50.0 );
+
+    data = NinjaGetOutputGrid( memNinja, 0, "direction", &nRows, &nCols,
+                               NULL, NULL );
+    assert( NULL != data );
+    assert( nRows == 20 && nCols == 20 );
+
+    data = NinjaGetOutputField3D( memNinja, 0, "u", &nRows, &nCols, &nLayers );
+    assert( NULL != data );
+    assert( nRows > 0 && nCols > 0 && nLayers > 0 );
+
+    //released results are gone
+    errval = NinjaReleaseOutputGrids( memNinja, 0 );
+    assert( errval == NINJA_SUCCESS );
+
+    data = NinjaGetOutputGrid( memNinja, 0, "speed", &nRows, &nCols,
+                               NULL, NULL );
+    assert( NULL == data );
+
+    data = NinjaGetOutputField3D( memNinja, 0, "u", &nRows, &nCols, &nLayers );
+    assert( NULL == data );
+
+    errval = NinjaDestroyArmy( memNinja );
+    assert( errval == NINJA_SUCCESS );
+
+    CPLFree( pszWkt );
+    OSRDestroySpatialReference( hSRS );
+}
+
 int main()
 {
     //Create an army
@@ -397,6 +551,8 @@ int main()
     checkEnvironmentMethods();
     checkMeshResolution();
     checkOutputWritingMethods();
+    checkInMemoryOutputMethods();
+    checkInMemoryOutputRun();
    
     errval =  NinjaDestroyArmy( ninja );
     assert( errval == NINJA_SUCCESS );
@@ -0,0 +1,136 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test the command line interface
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <cstring>
+#include <string>
+
+#include "cli.h"
+#include "ninja_conv.h"
+#include "ninja_init.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "CLI" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       cli/domain_average
+*       cli/value_lists
+******************************************************************************/
+
+/* domain average runs on mackay_small.tif, written to a temporary path */
+struct CliRun
+{
+    CliRun()
+    {
+        CPLSetConfigOption( "NINJA_DISABLE_THREDDS_UPDATE", "YES" );
+        CPLSetConfigOption( "NINJA_DISABLE_CALL_HOME", "ON" );
+        NinjaInitialize();
+        pszTmpPath = CPLStrdup( CPLGenerateTempFilename( "NINJA_CLI" ) );
+        VSIMkdir( pszTmpPath, 0777 );
+    }
+    ~CliRun()
+    {
+        NinjaUnlinkTree( pszTmpPath );
+        CPLFree( pszTmpPath );
+    }
+
+    /* write a config file with the wind options appended and run it */
+    int Run( std::string const &osWind )
+    {
+        std::string osCfg = CPLFormFilename( pszTmpPath, "run", ".cfg" );
+        std::string osDem = FindDataPath( "mackay_small.tif" );
+        VSILFILE *fout = VSIFOpenL( osCfg.c_str(), "w" );
+        if( fout == NULL )
+            return -1;
+        VSIFPrintfL( fout, "num_threads = 1\n" );
+        VSIFPrintfL( fout, "elevation_file = %s\n", osDem.c_str() );
+        VSIFPrintfL( fout, "initialization_method = domainAverageInitialization\n" );
+        VSIFPrintfL( fout, "input_speed_units = mps\n" );
+        VSIFPrintfL( fout, "input_wind_height = 10.0\n" );
+        VSIFPrintfL( fout, "units_input_wind_height = m\n" );
+        VSIFPrintfL( fout, "output_wind_height = 10.0\n" );
+        VSIFPrintfL( fout, "units_output_wind_height = m\n" );
+        VSIFPrintfL( fout, "vegetation = grass\n" );
+        VSIFPrintfL( fout, "mesh_choice = coarse\n" );
+        VSIFPrintfL( fout, "write_ascii_output = true\n" );
+        VSIFPrintfL( fout, "output_path = %s\n", pszTmpPath );
+        VSIFPrintfL( fout, "%s", osWind.c_str() );
+        VSIFCloseL( fout );
+
+        char *apszArgv[] = { (char*)"WindNinja_cli", (char*)osCfg.c_str() };
+        return windNinjaCLI( 2, apszArgv );
+    }
+
+    /* number of files in the output path ending with pszSuffix */
+    int CountOutputs( const char *pszSuffix )
+    {
+        int nCount = 0;
+        int nSuffix = strlen( pszSuffix );
+        char **papszFiles = VSIReadDir( pszTmpPath );
+        for( int i = 0; papszFiles != NULL && papszFiles[i] != NULL; i++ )
+        {
+            int nLen = strlen( papszFiles[i] );
+            if( nLen >= nSuffix && EQUAL( papszFiles[i] + nLen - nSuffix, pszSuffix ) )
+                nCount++;
+        }
+        CSLDestroy( papszFiles );
+        return nCount;
+    }
+
+    char *pszTmpPath;
+};
+
+BOOST_FIXTURE_TEST_SUITE( cli, CliRun )
+
+/**
+* A plain domain average config, with none of the optional run modes set,
+* goes through the option parser and solves.
+*/
+BOOST_AUTO_TEST_CASE( domain_average )
+{
+    BOOST_REQUIRE_EQUAL( Run( "input_speed = 5.0\ninput_direction = 270.0\n" ), 0 );
+    BOOST_CHECK_EQUAL( CountOutputs( "_vel.asc" ), 1 );
+}
+
+/**
+* Lists of speeds and directions make one run for each combination.
+*/
+BOOST_AUTO_TEST_CASE( value_lists )
+{
+    BOOST_REQUIRE_EQUAL( Run( "input_speed = 5,10\ninput_direction = 225:45:270\n" ), 0 );
+    BOOST_CHECK_EQUAL( CountOutputs( "_vel.asc" ), 4 );
+    //a bad list is reported, not solved
+    BOOST_CHECK( Run( "input_speed = 5,x\ninput_direction = 270\n" ) != 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "CLI" BOOST TEST SUITE
+*****************************************************************************/
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test the WindNinja command server
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <sstream>
+#include <string>
+
+#include "cli_server.h"
+#include "cpl_conv.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "CLI_SERVER" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       cli_server/requests
+******************************************************************************/
+
+BOOST_AUTO_TEST_SUITE( cli_server )
+
+/**
+* Check the replies to the requests that do not start a run.
+*/
+BOOST_AUTO_TEST_CASE( requests )
+{
+    CPLSetConfigOption( "NINJA_GRID_CACHE_DIR", NULL );
+    {
+        NinjaServer server;
+        BOOST_CHECK_EQUAL( CPLGetConfigOption( "NINJA_GRID_CACHE_DIR", "" ),
+                           std::string( NinjaServer::DEFAULT_CACHE_DIR ) );
+
+        std::ostringstream reply;
+        BOOST_CHECK( server.HandleRequest( "", reply ) );
+        BOOST_CHECK_EQUAL( reply.str(), "" );
+
+        reply.str( "" );
+        BOOST_CHECK( server.HandleRequest( "ping", reply ) );
+        BOOST_CHECK_EQUAL( reply.str(), "OK ping\n" );
+
+        reply.str( "" );
+        BOOST_CHECK( server.HandleRequest( "run", reply ) );
+        BOOST_CHECK_EQUAL( reply.str().substr( 0, 5 ), "ERROR" );
+
+        reply.str( "" );
+        BOOST_CHECK( server.HandleRequest( "bogus", reply ) );
+        BOOST_CHECK_EQUAL( reply.str().substr( 0, 5 ), "ERROR" );
+
+        reply.str( "" );
+        BOOST_CHECK( server.HandleRequest( "clear", reply ) );
+        BOOST_CHECK_EQUAL( reply.str(), "OK clear\n" );
+
+        reply.str( "" );
+        BOOST_CHECK( !server.HandleRequest( "quit", reply ) );
+        BOOST_CHECK_EQUAL( reply.str(), "OK quit\n" );
+    }
+    BOOST_CHECK( CPLGetConfigOption( "NINJA_GRID_CACHE_DIR", NULL ) == NULL );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "CLI_SERVER" BOOST TEST SUITE
+*****************************************************************************/
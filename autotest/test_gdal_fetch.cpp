@@ -33,6 +33,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <string>
+#include <vector>
 
 #include "fetch_factory.h"
 #include "ninja.h"
@@ -88,6 +89,7 @@ struct GdalTestData
 *       srtm/world_point
 *       srtm/world_box
 *       srtm/gdal
+*       gdal_fetch/tile_cache
 ******************************************************************************/
 
 BOOST_FIXTURE_TEST_SUITE( gdal_fetch, GdalTestData )
@@ -136,6 +138,92 @@ BOOST_AUTO_TEST_CASE( us_box )
     poDS  = NULL;
 }
 
+/**
+* Fetch through the tile cache from a local VRT standing in for a remote
+* source and check the result matches an uncached fetch.
+*/
+BOOST_AUTO_TEST_CASE( tile_cache )
+{
+    adfBbox[0] =  44.0249023401036 - 0.05;
+    adfBbox[1] = -113.463446144564 - 0.05;
+    adfBbox[2] =  43.7832152227745 + 0.05;
+    adfBbox[3] = -113.749693430469 + 0.05;
+
+    std::string oPath = FindDataPath( "mackay.tif" );
+    BOOST_REQUIRE( !oPath.empty() );
+    std::string osVrt = CPLFormFilename( NULL, CPLGenerateTempFilename( "GDAL_TEST" ),
+                                         ".vrt" );
+    GDALDatasetH hSrcDS = GDALOpen( oPath.c_str(), GA_ReadOnly );
+    BOOST_REQUIRE( hSrcDS != NULL );
+    GDALClose( GDALCreateCopy( GDALGetDriverByName( "VRT" ), osVrt.c_str(),
+                               hSrcDS, FALSE, NULL, NULL, NULL ) );
+    GDALClose( hSrcDS );
+
+    std::string osUncached = CPLFormFilename( NULL, CPLGenerateTempFilename( "GDAL_TEST" ),
+                                              ".tif" );
+    fetch = FetchFactory::GetSurfaceFetch( FetchFactory::CUSTOM_GDAL, osVrt );
+    BOOST_REQUIRE( fetch != NULL );
+    int rcDirect = fetch->FetchBoundingBox( adfBbox, 30.0, osUncached.c_str(), NULL );
+    BOOST_REQUIRE( rcDirect >= 0 );
+
+    char *pszCacheDir = CPLStrdup( CPLGenerateTempFilename( "SURF_FETCH_CACHE" ) );
+    VSIMkdir( pszCacheDir, 0777 );
+    CPLSetConfigOption( "SURF_FETCH_CACHE_DIR", pszCacheDir );
+    CPLSetConfigOption( "SURF_FETCH_CACHE_TILE_SIZE", "64" );
+
+    /* first fetch fills the cache, the second is served from it */
+    int rc = 0;
+    int nTiles = 0;
+    for( int i = 0; i < 2; i++ )
+    {
+        rc = fetch->FetchBoundingBox( adfBbox, 30.0, pszFilename.c_str(), NULL );
+        BOOST_REQUIRE_EQUAL( rc, rcDirect );
+        char **papszTiles = VSIReadDir( pszCacheDir );
+        int nCount = 0;
+        for( int j = 0; j < CSLCount( papszTiles ); j++ )
+        {
+            if( EQUAL( CPLGetExtension( papszTiles[j] ), "tif" ) )
+                nCount++;
+        }
+        CSLDestroy( papszTiles );
+        if( i == 0 )
+            nTiles = nCount;
+        else
+            BOOST_CHECK_EQUAL( nCount, nTiles );
+    }
+    BOOST_CHECK( nTiles > 2 );
+
+    GDALDatasetH hDirectDS = GDALOpen( osUncached.c_str(), GA_ReadOnly );
+    GDALDatasetH hCachedDS = GDALOpen( pszFilename.c_str(), GA_ReadOnly );
+    BOOST_REQUIRE( hDirectDS != NULL && hCachedDS != NULL );
+    int nXSize = GDALGetRasterXSize( hDirectDS );
+    int nYSize = GDALGetRasterYSize( hDirectDS );
+    BOOST_REQUIRE_EQUAL( GDALGetRasterXSize( hCachedDS ), nXSize );
+    BOOST_REQUIRE_EQUAL( GDALGetRasterYSize( hCachedDS ), nYSize );
+    std::vector<float> afDirect( nXSize * nYSize ), afCached( nXSize * nYSize );
+    GDALRasterIO( GDALGetRasterBand( hDirectDS, 1 ), GF_Read, 0, 0, nXSize, nYSize,
+                  &afDirect[0], nXSize, nYSize, GDT_Float32, 0, 0 );
+    GDALRasterIO( GDALGetRasterBand( hCachedDS, 1 ), GF_Read, 0, 0, nXSize, nYSize,
+                  &afCached[0], nXSize, nYSize, GDT_Float32, 0, 0 );
+    BOOST_CHECK( afDirect == afCached );
+    GDALClose( hDirectDS );
+    GDALClose( hCachedDS );
+
+    CPLSetConfigOption( "SURF_FETCH_CACHE_DIR", NULL );
+    CPLSetConfigOption( "SURF_FETCH_CACHE_TILE_SIZE", NULL );
+    char **papszTiles = VSIReadDir( pszCacheDir );
+    for( int i = 0; i < CSLCount( papszTiles ); i++ )
+    {
+        if( EQUAL( CPLGetExtension( papszTiles[i] ), "tif" ) )
+            VSIUnlink( CPLFormFilename( pszCacheDir, papszTiles[i], NULL ) );
+    }
+    CSLDestroy( papszTiles );
+    VSIRmdir( pszCacheDir );
+    CPLFree( pszCacheDir );
+    VSIUnlink( osUncached.c_str() );
+    VSIUnlink( osVrt.c_str() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #endif /* WIN32 */
@@ -0,0 +1,117 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test the preprocessed input grid cache
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <string>
+
+#include "ninja_grid_cache.h"
+#include "ninja_conv.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "GRID_CACHE" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       grid_cache/round_trip
+******************************************************************************/
+
+BOOST_AUTO_TEST_SUITE( grid_cache )
+
+/**
+* Write the grids for a dem to the cache, read them back and check that a
+* different mesh resolution misses.
+*/
+BOOST_AUTO_TEST_CASE( round_trip )
+{
+    GDALAllRegister();
+    std::string oPath = FindDataPath("mackay.tif");
+    char *pszTmpPath = CPLStrdup( CPLGenerateTempFilename( "NINJA_GRID_CACHE" ) );
+    VSIMkdir( pszTmpPath, 0777 );
+    CPLSetConfigOption( "NINJA_GRID_CACHE_DIR", pszTmpPath );
+
+    Elevation dem;
+    dem.GDALReadGrid(oPath, 1);
+    dem.elevationUnits = Elevation::meters;
+    surfProperties surface;
+    surface.Roughness.set_headerData(dem);
+    surface.Roughness = 0.43;
+    surface.Rough_h.set_headerData(dem);
+    surface.Rough_h = 2.3;
+    surface.Rough_d.set_headerData(dem);
+    surface.Rough_d = 1.8;
+    surface.Albedo.set_headerData(dem);
+    surface.Albedo = 0.25;
+    surface.Bowen.set_headerData(dem);
+    surface.Bowen = 1.0;
+    surface.Cg.set_headerData(dem);
+    surface.Cg = 0.15;
+    surface.Anthropogenic.set_headerData(dem);
+    surface.Anthropogenic = 0.0;
+
+    std::string key = NinjaGridCache::FormKey(oPath, 100.0, 0, 1);
+    BOOST_REQUIRE( NinjaGridCache::Write(key, dem, surface, 100.0) );
+
+    Elevation cachedDem;
+    surfProperties cachedSurface;
+    double meshResolution = -1.0;
+    BOOST_REQUIRE( NinjaGridCache::Read(key, cachedDem, cachedSurface,
+                                        &meshResolution) );
+    BOOST_CHECK_EQUAL( meshResolution, 100.0 );
+    BOOST_REQUIRE( cachedDem.get_nCols() == dem.get_nCols() );
+    BOOST_REQUIRE( cachedDem.get_nRows() == dem.get_nRows() );
+    BOOST_CHECK_EQUAL( cachedDem.get_xllCorner(), dem.get_xllCorner() );
+    BOOST_CHECK_EQUAL( cachedDem.get_yllCorner(), dem.get_yllCorner() );
+    BOOST_CHECK_EQUAL( cachedDem.get_cellSize(), dem.get_cellSize() );
+    BOOST_CHECK( cachedDem.prjString == dem.prjString );
+    int nFailures = 0;
+    for(int i = 0; i < dem.get_nRows(); i++)
+    {
+        for(int j = 0; j < dem.get_nCols(); j++)
+        {
+            if(cachedDem(i, j) != dem(i, j) ||
+               cachedSurface.Rough_h(i, j) != 2.3 ||
+               cachedSurface.Cg(i, j) != 0.15)
+                nFailures++;
+        }
+    }
+    BOOST_CHECK_EQUAL( nFailures, 0 );
+
+    key = NinjaGridCache::FormKey(oPath, 200.0, 0, 1);
+    BOOST_CHECK( !NinjaGridCache::Read(key, cachedDem, cachedSurface,
+                                       &meshResolution) );
+
+    CPLSetConfigOption( "NINJA_GRID_CACHE_DIR", NULL );
+    NinjaUnlinkTree( pszTmpPath );
+    CPLFree( pszTmpPath );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "GRID_CACHE" BOOST TEST SUITE
+*****************************************************************************/
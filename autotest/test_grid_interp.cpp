@@ -30,6 +30,8 @@
 #include <string>
 
 #include "ascii_grid.h"
+#include "GridResamplePlan.h"
+#include "PointInterpolationPlan.h"
 #include "ninja_conv.h"
 #include "omp_guard.h"
 
@@ -40,6 +42,8 @@
 *******************************************************************************
 *   Tests:
 *       grid_interp/order
+*       grid_interp/plan
+*       grid_interp/point_plan
 ******************************************************************************/
 
 BOOST_AUTO_TEST_SUITE( grid_interp )
@@ -63,6 +67,91 @@ BOOST_AUTO_TEST_CASE( order )
 }
 
 
+/**
+* Test that a resampling plan gives the same answer as interpolateFromGrid
+*/
+BOOST_AUTO_TEST_CASE( plan )
+{
+    GDALAllRegister();
+    std::string oPath = FindDataPath("mackay.tif");
+    AsciiGrid<double>coarse;
+    coarse.GDALReadGrid(oPath, 1);
+    coarse.resample_Grid_in_place(500.0, AsciiGrid<double>::order0);
+
+    AsciiGrid<double>fine(coarse.get_nCols() * 4 - 4, coarse.get_nRows() * 4 - 4,
+                          coarse.get_xllCorner() + coarse.get_cellSize() / 2.0,
+                          coarse.get_yllCorner() + coarse.get_cellSize() / 2.0,
+                          coarse.get_cellSize() / 4.0, -9999.0, 0.0);
+    AsciiGrid<double>expected(fine);
+    AsciiGrid<double>scaled(coarse);
+    scaled *= 2.0;
+    AsciiGrid<double>expectedScaled(fine);
+    expected.interpolateFromGrid(coarse, AsciiGrid<double>::order1);
+    expectedScaled.interpolateFromGrid(scaled, AsciiGrid<double>::order1);
+
+    boost::shared_ptr<GridResamplePlan> plan = GridResamplePlan::GetPlan(coarse, fine);
+    BOOST_REQUIRE(plan->matches(coarse, fine));
+    BOOST_CHECK(plan == GridResamplePlan::GetPlan(coarse, fine));
+
+    AsciiGrid<double>fineScaled(fine);
+    std::vector<AsciiGrid<double> const *> sources;
+    std::vector<AsciiGrid<double> *> destinations;
+    sources.push_back(&coarse);
+    destinations.push_back(&fine);
+    sources.push_back(&scaled);
+    destinations.push_back(&fineScaled);
+    plan->apply(sources, destinations);
+
+    for(int i = 0; i < fine.get_nRows(); i++)
+    {
+        for(int j = 0; j < fine.get_nCols(); j++)
+        {
+            BOOST_CHECK_CLOSE(fine(i,j), expected(i,j), 1e-9);
+            BOOST_CHECK_CLOSE(fineScaled(i,j), expectedScaled(i,j), 1e-9);
+        }
+    }
+    GridResamplePlan::ClearCache();
+}
+
+/**
+* Test that a point plan gives the same answer as interpolateFromPoints, and
+* that updating one station only touches the cells it reaches
+*/
+BOOST_AUTO_TEST_CASE( point_plan )
+{
+    AsciiGrid<double>grid(40, 30, 0.0, 0.0, 10.0, -9999.0, 0.0);
+    double X[3] = {55.0, 205.0, 350.0};
+    double Y[3] = {45.0, 150.0, 260.0};
+    double radius[3] = {-1.0, 60.0, 500.0};
+    double values[3] = {1.0, 5.0, -2.0};
+
+    AsciiGrid<double>expected(grid);
+    expected.interpolateFromPoints(values, X, Y, radius, 3, 1.0);
+
+    PointInterpolationPlan plan;
+    plan.build(grid, X, Y, radius, 3, 1.0);
+    BOOST_REQUIRE(plan.matches(grid, X, Y, radius, 3, 1.0));
+    plan.apply(values, grid);
+
+    for(int i = 0; i < grid.get_nRows(); i++)
+        for(int j = 0; j < grid.get_nCols(); j++)
+            BOOST_CHECK_EQUAL(grid(i,j), expected(i,j));
+
+    values[1] = 8.0;
+    expected.interpolateFromPoints(values, X, Y, radius, 3, 1.0);
+    std::vector<int> changed(1, 1);
+    int nUpdated = plan.update(values, changed, grid);
+    BOOST_CHECK(nUpdated > 0);
+    BOOST_CHECK(nUpdated < plan.get_nCells());
+
+    for(int i = 0; i < grid.get_nRows(); i++)
+        for(int j = 0; j < grid.get_nCols(); j++)
+            BOOST_CHECK_EQUAL(grid(i,j), expected(i,j));
+
+    X[2] = 300.0;
+    BOOST_CHECK(!plan.matches(grid, X, Y, radius, 3, 1.0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 /******************************************************************************
 *                        END "GRID_INTERP" BOOST TEST SUITE
@@ -14,6 +14,14 @@
 #include "omp_guard.h"
 omp_lock_t netCDF_lock;
 
+/* the library expects the application to set up the NetCDF lock */
+struct NetCDFLockFixture
+{
+    NetCDFLockFixture() { omp_init_lock( &netCDF_lock ); }
+    ~NetCDFLockFixture() { omp_destroy_lock( &netCDF_lock ); }
+};
+BOOST_GLOBAL_FIXTURE( NetCDFLockFixture );
+
 #endif  //NETCDF_LOCK_SET
 
 #endif //_OPENMP
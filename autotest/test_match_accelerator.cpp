@@ -0,0 +1,106 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Unit tests for the accelerated station matching
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninja_match_accelerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "MATCH_ACCELERATOR" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       match_accelerator/linear_response
+******************************************************************************/
+
+/*
+** Run the matching iterations on a linear station response y = M x, the
+** way the outer loop does, and return the number of iterations used.
+*/
+static int MatchLinear( std::vector<double> const &M,
+                        std::vector<double> const &target, int nDepth,
+                        NinjaMatchAccelerator &accelerator )
+{
+    const int n = target.size();
+    const double relax = 0.8;
+    const double tol = 0.22;
+    std::vector<double> x( target );
+    std::vector<double> f( n );
+    accelerator.Reset( nDepth );
+    for( int iter = 1; iter <= 150; iter++ )
+    {
+        double misfit = 0.0;
+        for( int i = 0; i < n; i++ )
+        {
+            double y = 0.0;
+            for( int j = 0; j < n; j++ )
+                y += M[i * n + j] * x[j];
+            f[i] = relax * ( target[i] - y );
+            misfit = std::max( misfit, std::fabs( target[i] - y ) );
+        }
+        if( misfit <= tol )
+            return iter;
+        accelerator.Step( x, f );
+    }
+    return 151;
+}
+
+BOOST_AUTO_TEST_SUITE( match_accelerator )
+
+/**
+* A weak, coupled response takes the plain update dozens of iterations, the
+* accelerated one a handful.
+*/
+BOOST_AUTO_TEST_CASE( linear_response )
+{
+    const int n = 12;
+    std::vector<double> M( n * n );
+    std::vector<double> target( n );
+    for( int i = 0; i < n; i++ )
+    {
+        target[i] = 5.0 * std::sin( 1.7 * i );
+        for( int j = 0; j < n; j++ )
+            M[i * n + j] = ( i == j ? 0.1 : 0.0 ) + 0.02 * std::cos( 0.3 * i * j );
+    }
+
+    NinjaMatchAccelerator plain;
+    NinjaMatchAccelerator accelerated;
+    int nPlain = MatchLinear( M, target, 0, plain );
+    int nAccelerated = MatchLinear( M, target, 10, accelerated );
+
+    BOOST_CHECK( nPlain > 20 );
+    BOOST_CHECK( nPlain <= 150 );
+    BOOST_CHECK( nAccelerated <= 2 * n + 1 );
+    BOOST_CHECK( nAccelerated < nPlain / 2 );
+    BOOST_CHECK( accelerated.EstimatePlainIterations( 0.8 * 0.22, 150 ) > nAccelerated );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
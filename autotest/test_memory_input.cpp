@@ -0,0 +1,240 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test inputs handed over in memory
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <string>
+#include <vector>
+
+#include "memory_input.h"
+#include "wxModelInitializationFactory.h"
+#include "ninjaArmy.h"
+#include "windninja.h"
+#include "ninja_conv.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "MEMORY_INPUT" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       memory_input/forecast
+*       memory_input/dem
+*       memory_input/surface
+*       memory_input/shared
+******************************************************************************/
+
+/* the runs of an army, for checking what the C API handed them */
+class MemoryArmy : public ninjaArmy
+{
+public:
+    ninja * run( int i ) { return ninjas[i]; }
+};
+
+/* projection of the mackay test data */
+static std::string MackayWkt()
+{
+    GDALAllRegister();
+    std::string oPath = FindDataPath("mackay.tif");
+    GDALDatasetH hDS = GDALOpen( oPath.c_str(), GA_ReadOnly );
+    BOOST_REQUIRE( hDS != NULL );
+    std::string oWkt = GDALGetProjectionRef( hDS );
+    GDALClose( hDS );
+    return oWkt;
+}
+
+BOOST_AUTO_TEST_SUITE( memory_input )
+
+/**
+* Copy a two step forecast into memory and read it back through the weather
+* model factory.
+*/
+BOOST_AUTO_TEST_CASE( forecast )
+{
+    GDALAllRegister();
+    std::string oPath = FindDataPath("mackay.tif");
+    GDALDatasetH hDS = GDALOpen( oPath.c_str(), GA_ReadOnly );
+    BOOST_REQUIRE( hDS != NULL );
+    double adfGeoTransform[6];
+    GDALGetGeoTransform( hDS, adfGeoTransform );
+    std::string oWkt = GDALGetProjectionRef( hDS );
+    GDALClose( hDS );
+
+    const int nXSize = 3;
+    const int nYSize = 2;
+    const int nSteps = 2;
+    adfGeoTransform[1] *= 100.0;
+    adfGeoTransform[5] *= 100.0;
+    std::vector<double> adfU( nSteps * nXSize * nYSize, 1.0 );
+    std::vector<double> adfV( nSteps * nXSize * nYSize, 2.0 );
+    std::vector<double> adfAir( nSteps * nXSize * nYSize, 280.0 );
+    std::vector<double> adfCloud( nSteps * nXSize * nYSize, 50.0 );
+    time_t anTimes[2] = { 1500000000, 1500003600 };
+
+    std::string name = NinjaMemoryInput::CreateForecast( nSteps, anTimes,
+            &adfU[0], &adfV[0], &adfAir[0], &adfCloud[0], nXSize, nYSize,
+            adfGeoTransform, oWkt.c_str(), 10.0 );
+    BOOST_REQUIRE( NinjaMemoryInput::IsForecast( name ) );
+
+    wxModelInitialization *model =
+        wxModelInitializationFactory::makeWxInitialization( name );
+    BOOST_CHECK_EQUAL( model->getForecastIdentifier(), "MEMORY" );
+    BOOST_CHECK_EQUAL( model->Get_Wind_Height(), 10.0 );
+    BOOST_CHECK_NO_THROW( model->checkForValidData() );
+
+    blt::time_zone_ptr utc( new blt::posix_time_zone( "UTC" ) );
+    std::vector<blt::local_date_time> times = model->getTimeList( utc );
+    BOOST_REQUIRE_EQUAL( times.size(), 2 );
+    bpt::ptime epoch( boost::gregorian::date( 1970, 1, 1 ) );
+    BOOST_CHECK( times[0].utc_time() == epoch + bpt::seconds( 1500000000 ) );
+    BOOST_CHECK( times[1].utc_time() == epoch + bpt::seconds( 1500003600 ) );
+    delete model;
+
+    NinjaMemoryInput::Release( name );
+    BOOST_CHECK( !NinjaMemoryInput::IsForecast( name ) );
+}
+
+/**
+* A north up DEM handed to NinjaSetMemoryDEM() reads back with its corner
+* and cell size, first row at the north edge.
+*/
+BOOST_AUTO_TEST_CASE( dem )
+{
+    std::string oWkt = MackayWkt();
+    const int nXSize = 4;
+    const int nYSize = 3;
+    double adfGeoTransform[6] = { 300000.0, 30.0, 0.0, 5000000.0, 0.0, -30.0 };
+    std::vector<double> adfElevation( nXSize * nYSize );
+    for( int i = 0; i < nYSize; i++ )
+        for( int j = 0; j < nXSize; j++ )
+            adfElevation[i * nXSize + j] = 1000.0 + 100.0 * i + j;
+
+    MemoryArmy army;
+    NinjaH *ninjaH = reinterpret_cast<NinjaH*>( &army );
+    BOOST_REQUIRE_EQUAL( NinjaSetMemoryDEM( ninjaH, 0, &adfElevation[0],
+                                            nXSize, nYSize, adfGeoTransform,
+                                            oWkt.c_str(), -9999.0 ),
+                         NINJA_SUCCESS );
+    BOOST_CHECK_EQUAL( NinjaSetMemoryDEM( ninjaH, 0, NULL, nXSize, nYSize,
+                                          adfGeoTransform, oWkt.c_str(),
+                                          -9999.0 ),
+                       NINJA_E_INVALID );
+
+    ninja *run = army.run( 0 );
+    BOOST_REQUIRE( NinjaMemoryInput::IsMemoryFile( run->input.dem.fileName ) );
+    run->readInputFile();
+
+    const AsciiGrid<double> &dem = run->input.dem;
+    BOOST_REQUIRE_EQUAL( dem.get_nCols(), nXSize );
+    BOOST_REQUIRE_EQUAL( dem.get_nRows(), nYSize );
+    BOOST_CHECK_CLOSE( dem.get_cellSize(), 30.0, 1e-9 );
+    BOOST_CHECK_CLOSE( dem.get_xllCorner(), 300000.0, 1e-9 );
+    BOOST_CHECK_CLOSE( dem.get_yllCorner(), 5000000.0 - nYSize * 30.0, 1e-9 );
+    //AsciiGrid rows start at the south edge
+    for( int i = 0; i < nYSize; i++ )
+        for( int j = 0; j < nXSize; j++ )
+            BOOST_CHECK_EQUAL( dem( i, j ),
+                               adfElevation[( nYSize - 1 - i ) * nXSize + j] );
+}
+
+/**
+* Surface grids handed to NinjaSetMemorySurface() replace the vegetation
+* roughness, except in no data cells.
+*/
+BOOST_AUTO_TEST_CASE( surface )
+{
+    std::string oWkt = MackayWkt();
+    const int nXSize = 4;
+    const int nYSize = 3;
+    double adfGeoTransform[6] = { 300000.0, 30.0, 0.0, 5000000.0, 0.0, -30.0 };
+    std::vector<double> adfElevation( nXSize * nYSize, 1000.0 );
+    std::vector<double> adfRoughness( nXSize * nYSize, 0.2 );
+    std::vector<double> adfRoughH( nXSize * nYSize, 1.5 );
+    //north row is rougher, north west corner has no data
+    for( int j = 0; j < nXSize; j++ )
+        adfRoughness[j] = 0.5;
+    adfRoughness[0] = -9999.0;
+
+    MemoryArmy army;
+    NinjaH *ninjaH = reinterpret_cast<NinjaH*>( &army );
+    BOOST_REQUIRE_EQUAL( NinjaSetMemoryDEM( ninjaH, 0, &adfElevation[0],
+                                            nXSize, nYSize, adfGeoTransform,
+                                            oWkt.c_str(), -9999.0 ),
+                         NINJA_SUCCESS );
+    BOOST_REQUIRE_EQUAL( NinjaSetMemorySurface( ninjaH, 0, &adfRoughness[0],
+                                                &adfRoughH[0], NULL,
+                                                nXSize, nYSize, adfGeoTransform,
+                                                oWkt.c_str() ),
+                         NINJA_SUCCESS );
+
+    ninja *run = army.run( 0 );
+    run->readInputFile();
+    run->set_uniVegetation( WindNinjaInputs::grass );
+    run->set_uniVegetation();
+    run->importSurfaceGrids();
+
+    const AsciiGrid<double> &roughness = run->input.surface.Roughness;
+    BOOST_REQUIRE_EQUAL( roughness.get_nRows(), nYSize );
+    BOOST_REQUIRE_EQUAL( roughness.get_nCols(), nXSize );
+    //grass roughness is 0.01 m
+    BOOST_CHECK_CLOSE( roughness( nYSize - 1, 0 ), 0.01, 1e-9 );
+    for( int j = 1; j < nXSize; j++ )
+        BOOST_CHECK_CLOSE( roughness( nYSize - 1, j ), 0.5, 1e-9 );
+    for( int i = 0; i < nYSize - 1; i++ )
+        for( int j = 0; j < nXSize; j++ )
+            BOOST_CHECK_CLOSE( roughness( i, j ), 0.2, 1e-9 );
+    BOOST_CHECK_CLOSE( run->input.surface.Rough_h( 0, 0 ), 1.5, 1e-9 );
+    //the missing displacement band keeps the grass value
+    BOOST_CHECK_EQUAL( run->input.surface.Rough_d( 0, 0 ), 0.0 );
+}
+
+/**
+* An in-memory input is freed with the last holder, so copies of an army
+* don't release each other's inputs.
+*/
+BOOST_AUTO_TEST_CASE( shared )
+{
+    std::string oWkt = MackayWkt();
+    double adfGeoTransform[6] = { 300000.0, 30.0, 0.0, 5000000.0, 0.0, -30.0 };
+    std::vector<double> adfElevation( 4, 1000.0 );
+    const double *padfElevation = &adfElevation[0];
+    std::string name = NinjaMemoryInput::CreateGrid( "dem", 1, &padfElevation,
+            2, 2, adfGeoTransform, oWkt.c_str(), -9999.0 );
+
+    VSIStatBufL sStat;
+    NinjaMemoryInput::Ptr poHeld = NinjaMemoryInput::Hold( name );
+    NinjaMemoryInput::Ptr poCopy = poHeld;
+    poHeld.reset();
+    BOOST_CHECK( VSIStatL( name.c_str(), &sStat ) == 0 );
+    poCopy.reset();
+    BOOST_CHECK( VSIStatL( name.c_str(), &sStat ) != 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "MEMORY_INPUT" BOOST TEST SUITE
+*****************************************************************************/
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test the multi-band output dataset pool
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <string>
+
+#include "OutputDatasetPool.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                     "OUTPUT_DATASET_POOL" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       output_dataset_pool/band_order
+*       output_dataset_pool/flush
+******************************************************************************/
+
+BOOST_AUTO_TEST_SUITE( output_dataset_pool )
+
+/**
+* Deposit three runs out of order and check the GeoTIFF has one band per run,
+* ordered by run number, north up, with DT offsets from the first run.
+*/
+BOOST_AUTO_TEST_CASE( band_order )
+{
+    GDALAllRegister();
+
+    int nRows = 4;
+    int nCols = 3;
+    const char *apszTimes[] = {"2026-Jul-01 06:00:00 MDT",
+                               "2026-Jul-01 09:00:00 MDT",
+                               "2026-Jul-01 12:00:00 MDT"};
+    int anOrder[] = {2, 0, 1};
+
+    std::string osFile = CPLGenerateTempFilename( "NINJA_OUTPUT_POOL" );
+    osFile += ".tif";
+
+    OutputDatasetPool pool(3);
+    for(int n = 0; n < 3; n++)
+    {
+        int nRun = anOrder[n];
+        AsciiGrid<double> grid(nCols, nRows, 500000.0, 4800000.0, 100.0, -9999.0, 0.0);
+        for(int i = 0; i < nRows; i++)
+            for(int j = 0; j < nCols; j++)
+                grid(i, j) = nRun * 100 + i * nCols + j;
+        bool bComplete = pool.AddBand("spd", nRun, apszTimes[nRun], grid);
+        BOOST_CHECK_EQUAL( bComplete, n == 2 );
+        if(bComplete)
+            BOOST_REQUIRE( pool.WriteGTiff("spd", osFile) );
+    }
+
+    GDALDatasetH hDS = GDALOpen(osFile.c_str(), GA_ReadOnly);
+    BOOST_REQUIRE( hDS != NULL );
+    BOOST_CHECK_EQUAL( GDALGetRasterCount(hDS), 3 );
+    BOOST_CHECK_EQUAL( GDALGetRasterXSize(hDS), nCols );
+    BOOST_CHECK_EQUAL( GDALGetRasterYSize(hDS), nRows );
+
+    const char *apszDT[] = {"0", "3", "6"};
+    for(int b = 0; b < 3; b++)
+    {
+        GDALRasterBandH hBand = GDALGetRasterBand(hDS, b + 1);
+        BOOST_CHECK_EQUAL( std::string(GDALGetMetadataItem(hBand, "DT", NULL)),
+                           std::string(apszDT[b]) );
+        double dfValue;
+        /* top left pixel is the north west cell, grid row nRows - 1 */
+        GDALRasterIO(hBand, GF_Read, 0, 0, 1, 1, &dfValue, 1, 1, GDT_Float64, 0, 0);
+        BOOST_CHECK_EQUAL( dfValue, b * 100 + (nRows - 1) * nCols );
+    }
+    GDALClose(hDS);
+    VSIUnlink(osFile.c_str());
+}
+
+/**
+* A series missing a run is not written on completion, Flush() writes the
+* bands it has to the file set for it, not the one the runs passed.
+*/
+BOOST_AUTO_TEST_CASE( flush )
+{
+    GDALAllRegister();
+
+    std::string osFile = CPLGenerateTempFilename( "NINJA_OUTPUT_POOL" );
+    osFile += ".tif";
+    std::string osOther = CPLGenerateTempFilename( "NINJA_OUTPUT_POOL" );
+    osOther += ".tif";
+
+    OutputDatasetPool pool(3);
+    pool.SetFilename("spd", osFile);
+    AsciiGrid<double> grid(3, 4, 500000.0, 4800000.0, 100.0, -9999.0, 1.0);
+    BOOST_CHECK( !pool.AddBand("spd", 0, "2026-Jul-01 06:00:00 MDT", grid) );
+    BOOST_CHECK( !pool.AddBand("spd", 2, "2026-Jul-01 12:00:00 MDT", grid) );
+    BOOST_CHECK( !pool.WriteGTiff("spd", osOther) );
+
+    BOOST_REQUIRE( pool.Flush() );
+    VSIStatBufL sStat;
+    BOOST_CHECK( VSIStatL(osOther.c_str(), &sStat) != 0 );
+
+    GDALDatasetH hDS = GDALOpen(osFile.c_str(), GA_ReadOnly);
+    BOOST_REQUIRE( hDS != NULL );
+    BOOST_CHECK_EQUAL( GDALGetRasterCount(hDS), 2 );
+    BOOST_CHECK_EQUAL( std::string(GDALGetMetadataItem(GDALGetRasterBand(hDS, 2), "DT", NULL)),
+                       std::string("6") );
+    GDALClose(hDS);
+    VSIUnlink(osFile.c_str());
+
+    /* the series was released, nothing left to write */
+    BOOST_CHECK( pool.Flush() );
+    BOOST_CHECK( VSIStatL(osFile.c_str(), &sStat) != 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                     END "OUTPUT_DATASET_POOL" BOOST TEST SUITE
+*****************************************************************************/
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test the bulk point shapefile writer
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <string>
+#include <cmath>
+
+#include "ShapeVector.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "SHAPE_VECTOR" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       shape_vector/read_back
+******************************************************************************/
+
+BOOST_AUTO_TEST_SUITE( shape_vector )
+
+/**
+* Write a small speed/direction grid and read every record back through
+* shapelib.
+*/
+BOOST_AUTO_TEST_CASE( read_back )
+{
+    int nRows = 7;
+    int nCols = 5;
+    AsciiGrid<double> spd(nCols, nRows, 500000.0, 4800000.0, 100.0, -9999.0, 0.0);
+    AsciiGrid<double> dir(nCols, nRows, 500000.0, 4800000.0, 100.0, -9999.0, 0.0);
+    for(int i = 0; i < nRows; i++)
+    {
+        for(int j = 0; j < nCols; j++)
+        {
+            spd(i, j) = i * 1.25 + j * 0.5;
+            dir(i, j) = (i * nCols + j) * 10.0;
+        }
+    }
+
+    std::string osBase = CPLGenerateTempFilename( "NINJA_SHAPE_VECTOR" );
+    std::string osShp = osBase + ".shp";
+    std::string osDbf = osBase + ".dbf";
+
+    ShapeVector shapeFiles;
+    shapeFiles.setSpeedGrid(spd);
+    shapeFiles.setDirGrid(dir);
+    shapeFiles.setShapeFileName(osShp);
+    shapeFiles.setDataBaseName(osDbf);
+    BOOST_REQUIRE( shapeFiles.makeShapeFiles() );
+
+    SHPHandle hSHP = SHPOpen(osShp.c_str(), "rb");
+    DBFHandle hDBF = DBFOpen(osDbf.c_str(), "rb");
+    BOOST_REQUIRE( hSHP != NULL );
+    BOOST_REQUIRE( hDBF != NULL );
+
+    int nEntities, nShapeType;
+    double adfMin[4], adfMax[4];
+    SHPGetInfo(hSHP, &nEntities, &nShapeType, adfMin, adfMax);
+    BOOST_CHECK_EQUAL( nEntities, nRows * nCols );
+    BOOST_CHECK_EQUAL( nShapeType, SHPT_POINT );
+    BOOST_CHECK_EQUAL( DBFGetRecordCount(hDBF), nRows * nCols );
+    BOOST_CHECK_EQUAL( DBFGetFieldCount(hDBF), 4 );
+
+    int nFailures = 0;
+    double x, y;
+    for(int i = 0; i < nRows; i++)
+    {
+        for(int j = 0; j < nCols; j++)
+        {
+            int n = i * nCols + j;
+            SHPObject *psShape = SHPReadObject(hSHP, n);
+            spd.get_cellPosition(i, j, &x, &y);
+            if(psShape->padfX[0] != x || psShape->padfY[0] != y)
+                nFailures++;
+            SHPDestroyObject(psShape);
+            if(fabs(DBFReadDoubleAttribute(hDBF, n, 0) - spd(i, j)) > 1e-6 ||
+               DBFReadIntegerAttribute(hDBF, n, 1) != (int)(dir(i, j) + 0.5))
+                nFailures++;
+        }
+    }
+    BOOST_CHECK_EQUAL( nFailures, 0 );
+
+    SHPClose(hSHP);
+    DBFClose(hDBF);
+    VSIUnlink(osShp.c_str());
+    VSIUnlink(CPLResetExtension(osShp.c_str(), "shx"));
+    VSIUnlink(osDbf.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "SHAPE_VECTOR" BOOST TEST SUITE
+*****************************************************************************/
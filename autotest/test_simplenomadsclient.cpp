@@ -32,6 +32,8 @@
 #include "gdal.h"
 #include "nomads.h"
 
+#include <string>
+
 #include <boost/test/unit_test.hpp>
 
 static int CheckBands( const char *pszVsiPath )
@@ -281,6 +283,75 @@ BOOST_AUTO_TEST_CASE( form_name_1 )
 #endif
 }
 
+static int WriteTestFile( const char *pszFilename, const char *pszHead,
+                          const char *pszTail, int nSize )
+{
+    VSILFILE *fout = VSIFOpenL( pszFilename, "wb" );
+    if( !fout )
+        return 1;
+    char *pabyData = (char*)CPLCalloc( nSize, 1 );
+    memcpy( pabyData, pszHead, strlen( pszHead ) );
+    memcpy( pabyData + nSize - strlen( pszTail ), pszTail, strlen( pszTail ) );
+    VSIFWriteL( pabyData, nSize, 1, fout );
+    VSIFCloseL( fout );
+    CPLFree( pabyData );
+    return 0;
+}
+
+static vsi_l_offset FileSize( const char *pszFilename )
+{
+    VSIStatBufL sStat;
+    if( VSIStatL( pszFilename, &sStat ) != 0 )
+        return 0;
+    return sStat.st_size;
+}
+
+/*
+** Fetch through the download engine from a local file url standing in for
+** the server.  The second fetch is served from the cache after the source is
+** gone, and error pages are rejected.
+*/
+BOOST_AUTO_TEST_CASE( fetch_file_1 )
+{
+    char *pszDir = CPLGetCurrentDir();
+    std::string osDir = pszDir;
+    CPLFree( pszDir );
+    std::string osSrc = CPLFormFilename( osDir.c_str(),
+                                         CPLGetFilename( pszVsiPath ), ".grib2" );
+    std::string osDst = CPLFormFilename( NULL, pszVsiPath, "grib2" );
+    std::string osCacheDir = CPLSPrintf( "%s_cache", pszVsiPath );
+    VSIMkdir( osCacheDir.c_str(), 0777 );
+    CPLSetConfigOption( "NOMADS_CACHE_DIR", osCacheDir.c_str() );
+    CPLSetConfigOption( "NOMADS_MAX_RETRIES", "0" );
+
+    BOOST_REQUIRE( WriteTestFile( osSrc.c_str(), "GRIB", "7777", 100000 ) == 0 );
+    std::string osUrl = "file://" + osSrc;
+
+    int rc = NomadsFetchFile( osUrl.c_str(), osDst.c_str() );
+    BOOST_REQUIRE( rc == NOMADS_OK );
+    BOOST_CHECK_EQUAL( FileSize( osDst.c_str() ), 100000 );
+
+    VSIUnlink( osSrc.c_str() );
+    VSIUnlink( osDst.c_str() );
+    rc = NomadsFetchFile( osUrl.c_str(), osDst.c_str() );
+    BOOST_REQUIRE( rc == NOMADS_OK );
+    BOOST_CHECK_EQUAL( FileSize( osDst.c_str() ), 100000 );
+    VSIUnlink( osDst.c_str() );
+
+    std::string osBad = osSrc + ".html";
+    BOOST_REQUIRE( WriteTestFile( osBad.c_str(),
+                                  "<html>data file is not present", "</html>",
+                                  1000 ) == 0 );
+    rc = NomadsFetchFile( ( "file://" + osBad ).c_str(), osDst.c_str() );
+    BOOST_CHECK( rc != NOMADS_OK );
+    BOOST_CHECK_EQUAL( FileSize( osDst.c_str() ), 0 );
+    VSIUnlink( osBad.c_str() );
+
+    CPLSetConfigOption( "NOMADS_CACHE_DIR", NULL );
+    CPLSetConfigOption( "NOMADS_MAX_RETRIES", NULL );
+    CPLUnlinkTree( osCacheDir.c_str() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
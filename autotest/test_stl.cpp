@@ -106,6 +106,56 @@ BOOST_AUTO_TEST_CASE( stl_2 )
         VSIUnlink( "test.stl" );
 }
 
+BOOST_AUTO_TEST_CASE( stl_surfaces_1 )
+{
+    GDALAllRegister();
+    int rc;
+    const char *pszPath = CPLGetConfigOption( "WINDNINJA_DATA", NULL );
+    BOOST_REQUIRE( pszPath );
+    const char *pszFilename = CPLFormFilename( pszPath, "mackay", ".tif" );
+    std::string osGround = CPLFormFilename( NULL, CPLGenerateTempFilename( NULL ), ".stl" );
+    std::string osOut = CPLFormFilename( NULL, CPLGenerateTempFilename( NULL ), ".stl" );
+    std::string osSingle = CPLFormFilename( NULL, CPLGenerateTempFilename( NULL ), ".stl" );
+    const char *apszFiles[] = { osGround.c_str(), osOut.c_str() };
+    double adfOffsets[] = { 0.0, 10.0 };
+    rc = NinjaElevationToStlSurfaces( pszFilename, 1, -1.0, NinjaStlBinary, 2,
+                                      apszFiles, adfOffsets, NULL );
+    BOOST_CHECK( !rc );
+    rc = NinjaElevationToStl( pszFilename, osSingle.c_str(), 1, -1.0,
+                              NinjaStlBinary, 10.0, NULL );
+    BOOST_CHECK( !rc );
+
+    float afGround[12], afOut[12];
+    int nGroundTris = 0, nOutTris = 0;
+    VSILFILE *fin = VSIFOpenL( osGround.c_str(), "rb" );
+    BOOST_REQUIRE( fin );
+    VSIFSeekL( fin, 80, SEEK_SET );
+    VSIFReadL( &nGroundTris, sizeof( int ), 1, fin );
+    VSIFReadL( afGround, sizeof( afGround ), 1, fin );
+    VSIFCloseL( fin );
+    fin = VSIFOpenL( osOut.c_str(), "rb" );
+    BOOST_REQUIRE( fin );
+    VSIFSeekL( fin, 80, SEEK_SET );
+    VSIFReadL( &nOutTris, sizeof( int ), 1, fin );
+    VSIFReadL( afOut, sizeof( afOut ), 1, fin );
+    VSIFCloseL( fin );
+
+    // same triangles, z coords (5, 8 and 11) raised by the offset
+    BOOST_CHECK_EQUAL( nGroundTris, nOutTris );
+    BOOST_CHECK( CPLIsEqual( afOut[3], afGround[3] ) );
+    BOOST_CHECK( fabs( afOut[5] - afGround[5] - 10.0 ) < 1e-3 );
+    BOOST_CHECK( fabs( afOut[11] - afGround[11] - 10.0 ) < 1e-3 );
+
+    // one surface from the set matches a single surface with the same offset
+    VSIStatBufL sOutStat, sSingleStat;
+    BOOST_REQUIRE( VSIStatL( osOut.c_str(), &sOutStat ) == 0 );
+    BOOST_REQUIRE( VSIStatL( osSingle.c_str(), &sSingleStat ) == 0 );
+    BOOST_CHECK_EQUAL( sOutStat.st_size, sSingleStat.st_size );
+
+    VSIUnlink( osGround.c_str() );
+    VSIUnlink( osOut.c_str() );
+    VSIUnlink( osSingle.c_str() );
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,106 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test domain-average sweeps
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <stdexcept>
+#include <vector>
+
+#include "ninja_sweep.h"
+#include "cli.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "SWEEP" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       sweep/warm_start
+*       sweep/value_list
+******************************************************************************/
+
+BOOST_AUTO_TEST_SUITE( sweep )
+
+/**
+* Starting guesses are earlier solutions scaled to the new speed.
+*/
+BOOST_AUTO_TEST_CASE( warm_start )
+{
+    NinjaSweep sweep;
+    BOOST_CHECK( !sweep.HasMatrix() );
+
+    /* upper triangle of [[4 1] [1 3]] */
+    double *padfSK = new double[3];
+    int *panColInd = new int[3];
+    int *panRowPtr = new int[3];
+    padfSK[0] = 4.0; padfSK[1] = 1.0; padfSK[2] = 3.0;
+    panColInd[0] = 0; panColInd[1] = 1; panColInd[2] = 1;
+    panRowPtr[0] = 0; panRowPtr[1] = 2; panRowPtr[2] = 3;
+    sweep.SetMatrix( 2, padfSK, panColInd, panRowPtr );
+    BOOST_CHECK( sweep.HasMatrix() );
+    BOOST_CHECK_EQUAL( sweep.GetNumNodes(), 2 );
+
+    double adfPhi[2] = { 0.0, 0.0 };
+    BOOST_CHECK( !sweep.WarmStart( 5.0, 90.0, adfPhi ) );
+
+    double adfSolution[2] = { 1.0, 2.0 };
+    sweep.AddSolution( 10.0, 90.0, adfSolution );
+
+    BOOST_REQUIRE( sweep.WarmStart( 5.0, 90.0, adfPhi ) );
+    BOOST_CHECK_CLOSE( adfPhi[0], 0.5, 1e-10 );
+    BOOST_CHECK_CLOSE( adfPhi[1], 1.0, 1e-10 );
+
+    BOOST_CHECK( sweep.WarmStart( 20.0, 45.0, adfPhi ) );
+    BOOST_CHECK_CLOSE( adfPhi[1], 4.0, 1e-10 );
+
+    BOOST_CHECK( !sweep.WarmStart( 5.0, 270.0, adfPhi ) );
+}
+
+/**
+* Lists and ranges of input speeds and directions.
+*/
+BOOST_AUTO_TEST_CASE( value_list )
+{
+    std::vector<double> values = parse_value_list( "input_speed", "5,10,15" );
+    BOOST_REQUIRE_EQUAL( values.size(), 3 );
+    BOOST_CHECK_EQUAL( values[2], 15.0 );
+
+    values = parse_value_list( "input_direction", "0:45:315" );
+    BOOST_REQUIRE_EQUAL( values.size(), 8 );
+    BOOST_CHECK_EQUAL( values[7], 315.0 );
+
+    values = parse_value_list( "input_speed", "7.5" );
+    BOOST_REQUIRE_EQUAL( values.size(), 1 );
+
+    BOOST_CHECK_THROW( parse_value_list( "input_speed", "5,x" ), std::logic_error );
+    BOOST_CHECK_THROW( parse_value_list( "input_direction", "0:0:90" ), std::logic_error );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "SWEEP" BOOST TEST SUITE
+*****************************************************************************/
@@ -0,0 +1,100 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test the NetCDF-CF time series writer
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <string>
+
+#include "TimeSeriesWriter.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                     "TIME_SERIES_WRITER" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       time_series_writer/slice_order
+******************************************************************************/
+
+BOOST_AUTO_TEST_SUITE( time_series_writer )
+
+/**
+* Add three runs out of order and check they are written as time slices in
+* run order.
+*/
+BOOST_AUTO_TEST_CASE( slice_order )
+{
+    int nRows = 4;
+    int nCols = 3;
+    int anOrder[] = {1, 2, 0};
+
+    std::string osFile = CPLGenerateTempFilename( "NINJA_TIME_SERIES" );
+    osFile += ".nc";
+
+    boost::posix_time::ptime t0(boost::gregorian::date(2026, 7, 1),
+                                boost::posix_time::hours(6));
+    {
+        TimeSeriesWriter series(osFile, velocityUnits::metersPerSecond);
+        for(int n = 0; n < 3; n++)
+        {
+            int nRun = anOrder[n];
+            AsciiGrid<double> spd(nCols, nRows, 500000.0, 4800000.0, 100.0, -9999.0, nRun + 1.0);
+            AsciiGrid<double> dir(nCols, nRows, 500000.0, 4800000.0, 100.0, -9999.0, 270.0);
+            AsciiGrid<double> cld(nCols, nRows, 500000.0, 4800000.0, 100.0, -9999.0, 0.5);
+            series.AddSlice(nRun, t0 + boost::posix_time::hours(3 * nRun), spd, dir, cld);
+            /* nothing can be written until run 0 arrives */
+            BOOST_CHECK_EQUAL( series.get_nSlicesWritten(), n < 2 ? 0 : 3 );
+        }
+        series.Close();
+    }
+
+    int ncid, varid, dimid;
+    size_t nTimes;
+    BOOST_REQUIRE_EQUAL( nc_open(osFile.c_str(), NC_NOWRITE, &ncid), NC_NOERR );
+    BOOST_REQUIRE_EQUAL( nc_inq_dimid(ncid, "time", &dimid), NC_NOERR );
+    nc_inq_dimlen(ncid, dimid, &nTimes);
+    BOOST_CHECK_EQUAL( nTimes, 3 );
+
+    double adfTime[3];
+    nc_inq_varid(ncid, "time", &varid);
+    nc_get_var_double(ncid, varid, adfTime);
+    BOOST_CHECK_CLOSE( adfTime[1] - adfTime[0], 3.0, 1e-9 );
+    BOOST_CHECK_CLOSE( adfTime[2] - adfTime[0], 6.0, 1e-9 );
+
+    std::vector<float> afSpeed(3 * nRows * nCols);
+    nc_inq_varid(ncid, "wind_speed", &varid);
+    nc_get_var_float(ncid, varid, &afSpeed[0]);
+    for(int t = 0; t < 3; t++)
+        BOOST_CHECK_EQUAL( afSpeed[t * nRows * nCols], t + 1.0f );
+    nc_close(ncid);
+    VSIUnlink(osFile.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                     END "TIME_SERIES_WRITER" BOOST TEST SUITE
+*****************************************************************************/
@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Test combining domain-average runs from a wind atlas
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+ 
+#include <algorithm>
+#include <cmath>
+
+#include "ninja.h"
+#include "ninjaArmy.h"
+#include "ninja_conv.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "WIND_ATLAS" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       wind_atlas/check_linear
+*       wind_atlas/combine
+******************************************************************************/
+
+/* a neutral domain average run on mackay_small.tif, kept in memory */
+static void SetupRun( ninjaArmy &army, double speed, double direction )
+{
+    army.setDEM( 0, FindDataPath( "mackay_small.tif" ) );
+    army.setPosition( 0 );
+    army.setInitializationMethod( 0, WindNinjaInputs::domainAverageInitializationFlag );
+    army.setNumberCPUs( 0, 1 );
+    army.setInputSpeed( 0, speed, velocityUnits::metersPerSecond );
+    army.setInputDirection( 0, direction );
+    army.setInputWindHeight( 0, 10.0, lengthUnits::meters );
+    army.setOutputWindHeight( 0, 10.0, lengthUnits::meters );
+    army.setOutputSpeedUnits( 0, velocityUnits::metersPerSecond );
+    army.setDiurnalWinds( 0, false );
+    army.setUniVegetation( 0, WindNinjaInputs::grass );
+    army.setMeshResolutionChoice( 0, Mesh::coarse );
+    army.setNumVertLayers( 0, 20 );
+    army.setFileOutFlag( 0, false );
+    army.setOutputGridsInMemory( 0, true, false );
+}
+
+BOOST_AUTO_TEST_SUITE( wind_atlas )
+
+/**
+* Only runs that scale linearly with the input wind can use the atlas.
+*/
+BOOST_AUTO_TEST_CASE( check_linear )
+{
+    WindNinjaInputs input;
+    BOOST_CHECK( !NinjaWindAtlas::CheckLinear( input ).empty() );
+
+    input.initializationMethod = WindNinjaInputs::domainAverageInitializationFlag;
+    input.diurnalWinds = false;
+    input.stabilityFlag = false;
+    input.matchWxStations = false;
+    BOOST_CHECK( NinjaWindAtlas::CheckLinear( input ).empty() );
+
+    input.diurnalWinds = true;
+    BOOST_CHECK( !NinjaWindAtlas::CheckLinear( input ).empty() );
+
+    input.diurnalWinds = false;
+    input.stabilityFlag = true;
+    BOOST_CHECK( !NinjaWindAtlas::CheckLinear( input ).empty() );
+}
+
+/**
+* A run combined from the atlas matches a run solved directly, for a
+* direction between the two basis directions.
+*/
+BOOST_AUTO_TEST_CASE( combine )
+{
+    GDALAllRegister();
+    NinjaWindAtlas::ClearCache();
+
+    ninjaArmy direct;
+    SetupRun( direct, 6.0, 225.0 );
+    BOOST_REQUIRE( direct.startRuns( 1 ) );
+
+    ninjaArmy atlas;
+    SetupRun( atlas, 6.0, 225.0 );
+    atlas.setWindAtlasFlag( true );
+    BOOST_REQUIRE( atlas.startRuns( 1 ) );
+
+    int nRows, nCols, nAtlasRows, nAtlasCols;
+    const double *padfSpeed = direct.getOutputGrid( 0, "speed", &nRows, &nCols,
+                                                    NULL, NULL );
+    const double *padfDir = direct.getOutputGrid( 0, "direction", &nRows, &nCols,
+                                                  NULL, NULL );
+    const double *padfAtlasSpeed = atlas.getOutputGrid( 0, "speed", &nAtlasRows,
+                                                        &nAtlasCols, NULL, NULL );
+    const double *padfAtlasDir = atlas.getOutputGrid( 0, "direction", &nAtlasRows,
+                                                      &nAtlasCols, NULL, NULL );
+    BOOST_REQUIRE( padfSpeed && padfDir && padfAtlasSpeed && padfAtlasDir );
+    BOOST_REQUIRE_EQUAL( nRows, nAtlasRows );
+    BOOST_REQUIRE_EQUAL( nCols, nAtlasCols );
+
+    //both are converged to the solver tolerance, not to each other exactly
+    double dfMaxSpeedDiff = 0.0, dfMaxDirDiff = 0.0;
+    for( int i = 0; i < nRows * nCols; i++ )
+    {
+        dfMaxSpeedDiff = std::max( dfMaxSpeedDiff,
+                                   std::fabs( padfSpeed[i] - padfAtlasSpeed[i] ) );
+        if( padfSpeed[i] < 0.5 )
+            continue;
+        double dfDirDiff = std::fabs( padfDir[i] - padfAtlasDir[i] );
+        dfMaxDirDiff = std::max( dfMaxDirDiff, std::min( dfDirDiff, 360.0 - dfDirDiff ) );
+    }
+    BOOST_CHECK_SMALL( dfMaxSpeedDiff, 0.1 );
+    BOOST_CHECK_SMALL( dfMaxDirDiff, 2.0 );
+
+    NinjaWindAtlas::ClearCache();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/******************************************************************************
+*                        END "WIND_ATLAS" BOOST TEST SUITE
+*****************************************************************************/
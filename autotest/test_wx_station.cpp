@@ -0,0 +1,221 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Unit tests for station observation times
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include <string>
+#include <vector>
+
+#include "wxStation.h"
+#include "ninjaArmy.h"
+#include "ninja_conv.h"
+#include "ninja_init.h"
+
+#include <boost/test/unit_test.hpp>
+
+/******************************************************************************
+*                        "WX_STATION" BOOST TEST SUITE
+*******************************************************************************
+*   Tests:
+*       wx_station/observation_time
+*       wx_station/time_series
+*       wx_station/time_series_directory
+*       wx_station/duplicate_observation
+*       wx_station/station_army
+******************************************************************************/
+
+/* the runs of an army, for checking what makeStationArmy handed them */
+class StationArmy : public ninjaArmy
+{
+public:
+    ninja * run( int i ) { return ninjas[i]; }
+};
+
+/* station files written to a temporary path */
+struct StationFiles
+{
+    StationFiles()
+    {
+        CPLSetConfigOption( "NINJA_DISABLE_THREDDS_UPDATE", "YES" );
+        CPLSetConfigOption( "NINJA_DISABLE_CALL_HOME", "ON" );
+        NinjaInitialize();
+        osDem = FindDataPath( "mackay.tif" );
+        pszTmpPath = CPLStrdup( CPLGenerateTempFilename( "NINJA_WX_STATION" ) );
+        VSIMkdir( pszTmpPath, 0777 );
+    }
+    ~StationFiles()
+    {
+        NinjaUnlinkTree( pszTmpPath );
+        CPLFree( pszTmpPath );
+    }
+
+    /* write a station file with a Date_Time column holding osRows */
+    std::string Write( const char *pszName, std::string const &osRows )
+    {
+        std::string osFile = CPLFormFilename( pszTmpPath, pszName, "csv" );
+        char **papszHeader = wxStation::getValidHeader();
+        VSILFILE *fout = VSIFOpenL( osFile.c_str(), "w" );
+        BOOST_REQUIRE( fout != NULL );
+        for( int i = 0; i < CSLCount( papszHeader ); i++ )
+            VSIFPrintfL( fout, "\"%s\",", papszHeader[i] );
+        VSIFPrintfL( fout, "\"Date_Time\"\n%s", osRows.c_str() );
+        VSIFCloseL( fout );
+        CSLDestroy( papszHeader );
+        return osFile;
+    }
+
+    std::string osDem;
+    char *pszTmpPath;
+};
+
+static const char *pszStation1At18 =
+    "\"Station 1\",\"GEOGCS\",\"WGS84\",43.94,-113.68,20,\"feet\",10,\"mph\","
+    "270,70,\"F\",0,-1,\"miles\",\"2016-07-14T18:00:00Z\"\n";
+static const char *pszStation1At19 =
+    "\"Station 1\",\"GEOGCS\",\"WGS84\",43.94,-113.68,20,\"feet\",12,\"mph\","
+    "270,72,\"F\",0,-1,\"miles\",\"2016-07-14T19:00:00Z\"\n";
+static const char *pszStation2At18 =
+    "\"Station 2\",\"GEOGCS\",\"WGS84\",43.95,-113.53,20,\"feet\",20,\"mph\","
+    "180,78,\"F\",0,-1,\"miles\",\"2016-07-14T18:00:00Z\"\n";
+static const char *pszStation2At19 =
+    "\"Station 2\",\"GEOGCS\",\"WGS84\",43.95,-113.53,20,\"feet\",22,\"mph\","
+    "180,80,\"F\",0,-1,\"miles\",\"2016-07-14T19:00:00Z\"\n";
+
+static boost::posix_time::ptime At( int nHour )
+{
+    return boost::posix_time::ptime( boost::gregorian::date( 2016, 7, 14 ),
+                                     boost::posix_time::hours( nHour ) );
+}
+
+BOOST_FIXTURE_TEST_SUITE( wx_station, StationFiles )
+
+/**
+* Check the accepted forms of the Date_Time column parse to the same UTC time
+* and that bad values come back as not_a_date_time.
+*/
+BOOST_AUTO_TEST_CASE( observation_time )
+{
+    boost::posix_time::ptime expected( boost::gregorian::date( 2016, 7, 14 ),
+                                       boost::posix_time::hours( 18 ) +
+                                       boost::posix_time::minutes( 30 ) );
+
+    BOOST_CHECK( wxStation::parseObservationTime( "2016-07-14 18:30:00" ) == expected );
+    BOOST_CHECK( wxStation::parseObservationTime( "2016-07-14T18:30:00" ) == expected );
+    BOOST_CHECK( wxStation::parseObservationTime( "2016-07-14T18:30:00Z" ) == expected );
+    BOOST_CHECK( wxStation::parseObservationTime( "not a time" ).is_not_a_date_time() );
+    BOOST_CHECK( wxStation::parseObservationTime( "" ).is_not_a_date_time() );
+}
+
+/**
+* Read a file of two stations at two times, listed out of order.  Each time
+* is one step, in time order, and the stations keep the order they first
+* appear in the file.
+*/
+BOOST_AUTO_TEST_CASE( time_series )
+{
+    std::string osFile = FindDataPath( "mackay_wx_station_series.csv" );
+    std::vector<std::vector<wxStation> > series =
+        wxStation::readStationTimeSeries( osFile, osDem );
+
+    BOOST_REQUIRE_EQUAL( series.size(), 2U );
+    BOOST_REQUIRE_EQUAL( series[0].size(), 2U );
+    BOOST_REQUIRE_EQUAL( series[1].size(), 2U );
+
+    BOOST_CHECK( series[0][0].get_datetime() == At( 18 ) );
+    BOOST_CHECK( series[0][1].get_datetime() == At( 18 ) );
+    BOOST_CHECK( series[1][0].get_datetime() == At( 19 ) );
+    BOOST_CHECK( series[1][1].get_datetime() == At( 19 ) );
+
+    BOOST_CHECK_EQUAL( series[0][0].get_stationName(), "Station 2" );
+    BOOST_CHECK_EQUAL( series[0][1].get_stationName(), "Station 1" );
+    BOOST_CHECK_EQUAL( series[1][0].get_stationName(), "Station 2" );
+    BOOST_CHECK_EQUAL( series[1][1].get_stationName(), "Station 1" );
+
+    BOOST_CHECK_CLOSE( series[0][0].get_speed( velocityUnits::milesPerHour ), 20.0, 1e-6 );
+    BOOST_CHECK_CLOSE( series[0][1].get_speed( velocityUnits::milesPerHour ), 10.0, 1e-6 );
+    BOOST_CHECK_CLOSE( series[1][0].get_speed( velocityUnits::milesPerHour ), 22.0, 1e-6 );
+    BOOST_CHECK_CLOSE( series[1][1].get_speed( velocityUnits::milesPerHour ), 12.0, 1e-6 );
+}
+
+/**
+* Read a directory with one file per station.  Files are read in name order,
+* so the stations come back in that order at each time.
+*/
+BOOST_AUTO_TEST_CASE( time_series_directory )
+{
+    Write( "b_station_2", std::string( pszStation2At19 ) + pszStation2At18 );
+    Write( "a_station_1", std::string( pszStation1At18 ) + pszStation1At19 );
+
+    std::vector<std::vector<wxStation> > series =
+        wxStation::readStationTimeSeries( pszTmpPath, osDem );
+
+    BOOST_REQUIRE_EQUAL( series.size(), 2U );
+    for( unsigned int i = 0; i < series.size(); i++ )
+    {
+        BOOST_REQUIRE_EQUAL( series[i].size(), 2U );
+        BOOST_CHECK_EQUAL( series[i][0].get_stationName(), "Station 1" );
+        BOOST_CHECK_EQUAL( series[i][1].get_stationName(), "Station 2" );
+        BOOST_CHECK( series[i][0].get_datetime() == At( 18 + i ) );
+        BOOST_CHECK( series[i][1].get_datetime() == At( 18 + i ) );
+    }
+}
+
+/**
+* Two observations of one station at the same time can't be placed in a
+* single run.
+*/
+BOOST_AUTO_TEST_CASE( duplicate_observation )
+{
+    std::string osFile = Write( "duplicate", std::string( pszStation1At18 ) +
+                                             pszStation2At18 + pszStation1At18 );
+    BOOST_CHECK_THROW( wxStation::readStationTimeSeries( osFile, osDem ),
+                       std::domain_error );
+}
+
+/**
+* A station army makes one point initialization run per time, each with all
+* of the stations observed at that time.
+*/
+BOOST_AUTO_TEST_CASE( station_army )
+{
+    StationArmy army;
+    std::string osFile = FindDataPath( "mackay_wx_station_series.csv" );
+    BOOST_REQUIRE( army.makeStationArmy( osFile, osDem, "America/Boise" ) );
+
+    BOOST_REQUIRE_EQUAL( army.getSize(), 2 );
+    for( int i = 0; i < army.getSize(); i++ )
+    {
+        std::vector<wxStation> stations = army.run( i )->get_wxStations();
+        BOOST_REQUIRE_EQUAL( stations.size(), 2U );
+        BOOST_CHECK( stations[0].get_datetime() == At( 18 + i ) );
+        BOOST_CHECK( army.run( i )->get_date_time().utc_time() == At( 18 + i ) );
+        BOOST_CHECK( army.run( i )->input.initializationMethod ==
+                     WindNinjaInputs::pointInitializationFlag );
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
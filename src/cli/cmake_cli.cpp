@@ -28,6 +28,7 @@
  *****************************************************************************/
 
 #include "cli.h"
+#include "cli_server.h"
 #include "ninjaArmy.h"
 #include "ninjaException.h"
 #include "ninja_init.h"
@@ -35,6 +36,18 @@
 #include "gdal.h"
 #include "ogr_api.h"
 
+#include <cstdio>
+
+#ifdef WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define fileno _fileno
+#define fdopen _fdopen
+#else
+#include <unistd.h>
+#endif
+
 #ifdef _OPENMP
     omp_lock_t netCDF_lock;
 #endif
@@ -44,6 +57,9 @@
  * Allow for a few options:
  * If CORE_RUN is defined, force a core run
  * The 'core run' is a editable command line run.
+ * If the only argument is --server, requests are read from stdin and
+ * replies are written to stdout, see NinjaServer.  Run messages go to
+ * stderr so they cannot be mistaken for replies.
  * @see core_run.h
  * @param argc argument count
  * @param argv argument value(s)
@@ -60,7 +76,17 @@ int main(int argc, char *argv[])
 #ifdef CORE_RUN
     result = coreMain(argc, argv);
 #else
-    result = windNinjaCLI(argc, argv);
+    if(argc == 2 && EQUAL(argv[1], "--server"))
+    {
+        fflush(stdout);
+        int replyFd = dup(fileno(stdout));
+        dup2(fileno(stderr), fileno(stdout));
+        FILE *replyFile = fdopen(replyFd, "w");
+        result = windNinjaServer(std::cin, replyFile);
+        fclose(replyFile);
+    }
+    else
+        result = windNinjaCLI(argc, argv);
 #endif
 #ifdef _OPENMP
     omp_destroy_lock (&netCDF_lock);
@@ -32,6 +32,7 @@
 
 #include "Array2D.h"
 #include <assert.h>
+#include <cstddef>
 #include <vector>
 #include <limits>
 #include <algorithm>
@@ -57,7 +58,10 @@ class Array2D
     void set_numCols(unsigned int n);
     void setMatrix(unsigned nRows, unsigned nCols, T noDataVal);
     void setMatrix(unsigned nRows, unsigned nCols, T noDataVal, T defaultValue);
+    void clear();
     unsigned size() const;
+    T* get_dataPointer();
+    const T* get_dataPointer() const;
     bool hasNoDataValues() const;
     void setNoDataValue(T nDV);
     T getNoDataValue() const;
@@ -237,6 +241,17 @@ void Array2D<T>::setMatrix(unsigned nRows, unsigned nCols, T noDataVal, T defaul
     matrix.resize(cols*rows, defaultValue);
 }
 
+/**
+*@brief empties the matrix and releases its storage
+*/
+template<typename T>
+void Array2D<T>::clear()
+{
+    std::vector<T>().swap(matrix);
+    rows = 0;
+    cols = 0;
+}
+
 /**
 *@brief get size of Array2D object, which is just size of matrix
 *@return number of elements in matrix
@@ -413,6 +428,26 @@ void Array2D<T>::dumpMatrix(std::string path)
 //                          Operators
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+/**
+*@brief returns a pointer to the contiguous row major storage of the matrix
+*@return pointer to the first element, NULL if the matrix is empty
+*/
+template<typename T>
+T* Array2D<T>::get_dataPointer()
+{
+    return matrix.empty() ? NULL : &matrix[0];
+}
+
+/**
+*@brief returns a const pointer to the contiguous row major storage of the matrix
+*@return pointer to the first element, NULL if the matrix is empty
+*/
+template<typename T>
+const T* Array2D<T>::get_dataPointer() const
+{
+    return matrix.empty() ? NULL : &matrix[0];
+}
+
 /**
 *@brief overloads paranthesis operator to allow setting matrix elements via return value reference to elements
 *@param row row of element
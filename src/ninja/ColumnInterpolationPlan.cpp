@@ -0,0 +1,229 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Precomputed vertical interpolation from a wx model mesh onto the
+ *           WindNinja mesh
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ColumnInterpolationPlan.h"
+
+/*
+** Trilinear shape function values for the 8 local nodes of a cell, in the
+** same order and arithmetic as element::SFNV().
+*/
+static inline void ComputeShapeWeights(double u, double v, double w,
+                                       double *padfWeight)
+{
+    padfWeight[0]=0.125*(1-u)*(1-v)*(1-w);
+    padfWeight[1]=0.125*(1+u)*(1-v)*(1-w);
+    padfWeight[2]=0.125*(1+u)*(1+v)*(1-w);
+    padfWeight[3]=0.125*(1-u)*(1+v)*(1-w);
+    padfWeight[4]=0.125*(1-u)*(1-v)*(1+w);
+    padfWeight[5]=0.125*(1+u)*(1-v)*(1+w);
+    padfWeight[6]=0.125*(1+u)*(1+v)*(1+w);
+    padfWeight[7]=0.125*(1-u)*(1+v)*(1+w);
+}
+
+ColumnInterpolationPlan::ColumnInterpolationPlan()
+{
+    nNodes = 0;
+    wxRowStride = 0;
+    wxLayerStride = 0;
+}
+
+ColumnInterpolationPlan::ColumnInterpolationPlan(Mesh const &wxMesh,
+                                                 Mesh const &mesh)
+{
+    nNodes = 0;
+    wxRowStride = 0;
+    wxLayerStride = 0;
+    build(wxMesh, mesh);
+}
+
+ColumnInterpolationPlan::~ColumnInterpolationPlan()
+{
+}
+
+/**
+ * @brief Locate every WindNinja node in the wx model mesh.
+ * Columns are processed in parallel.  Each column does one horizontal search
+ * and one wx ground height lookup, then maps its layers with the normalized
+ * distance method.
+ * @param wxMesh Mesh the wx model fields are stored on.
+ * @param mesh WindNinja mesh.
+ */
+void ColumnInterpolationPlan::build(Mesh const &wxMesh, Mesh const &mesh)
+{
+    nNodes = mesh.nrows * mesh.ncols * mesh.nlayers;
+    wxRowStride = wxMesh.ncols;
+    wxLayerStride = wxMesh.nrows * wxMesh.ncols;
+
+    anNode0.assign(nNodes, -1);
+    adfLocal.assign(3 * nNodes, 0.0);
+
+    int nColumns = mesh.nrows * mesh.ncols;
+    int nTopLayer = mesh.nlayers - 1;
+    bool bFailed = false;
+    std::string osError;
+
+#pragma omp parallel
+    {
+        element elem_wx(&wxMesh);
+        int elem_wx_i, elem_wx_j, elem_wx_k, wx_i;
+        double x, y, z, x_wx, y_wx, z_wx;
+        double u_wx, v_wx, w_wx;
+        double wnNormDist, wxNormDist;
+
+#pragma omp for schedule(dynamic, 64)
+        for(int col = 0; col < nColumns; col++)
+        {
+            if(bFailed)
+                continue;
+
+            int i = col / mesh.ncols;
+            int j = col - i * mesh.ncols;
+
+            try
+            {
+                x = mesh.XORD(i, j, 0);
+                y = mesh.YORD(i, j, 0);
+
+                //wx model ground height under this column
+                elem_wx.get_uv(x, y, elem_wx_i, elem_wx_j, u_wx, v_wx);
+                wx_i = wxMesh.get_elemNum(elem_wx_i, elem_wx_j, 0);
+                elem_wx.get_xyz(wx_i, u_wx, v_wx, -1.0, x_wx, y_wx, z_wx);
+
+                wnNormDist = mesh.ZORD(i, j, nTopLayer) - mesh.ZORD(i, j, 0);
+                wxNormDist = mesh.ZORD(i, j, nTopLayer) - z_wx;
+
+                //layer 0 is the WindNinja ground and is never interpolated
+                for(int k = 1; k < mesh.nlayers; k++)
+                {
+                    x = mesh.XORD(i, j, k);
+                    y = mesh.YORD(i, j, k);
+                    z = (mesh.ZORD(i, j, k) - mesh.ZORD(i, j, 0)) / wnNormDist;
+                    z = z * wxNormDist;
+                    z += z_wx;
+
+                    elem_wx.get_uvw(x, y, z, elem_wx_i, elem_wx_j, elem_wx_k,
+                                    u_wx, v_wx, w_wx);
+
+                    if(elem_wx_k < 1) //use log profile to fill below here later
+                        continue;
+
+                    int n = k * nColumns + col;
+                    anNode0[n] = elem_wx_k * wxLayerStride +
+                                 elem_wx_i * wxRowStride + elem_wx_j;
+                    adfLocal[3 * n] = u_wx;
+                    adfLocal[3 * n + 1] = v_wx;
+                    adfLocal[3 * n + 2] = w_wx;
+                }
+            }
+            catch(std::exception &e)
+            {
+#pragma omp critical(column_plan_error)
+                {
+                    if(!bFailed)
+                    {
+                        bFailed = true;
+                        osError = e.what();
+                    }
+                }
+            }
+        }
+    }
+
+    if(bFailed)
+        throw std::range_error(osError);
+}
+
+/**
+ * @brief Interpolate one wx model field onto the WindNinja mesh.
+ * Nodes without a bracketing wx cell are set to -9999.
+ * @param source Field on the wx mesh the plan was built for.
+ * @param destination Field on the WindNinja mesh.
+ */
+void ColumnInterpolationPlan::apply(wn_3dScalarField const &source,
+                                    wn_3dScalarField &destination) const
+{
+    std::vector<wn_3dScalarField const *> sources(1, &source);
+    std::vector<wn_3dScalarField *> destinations(1, &destination);
+    apply(sources, destinations);
+}
+
+/**
+ * @brief Interpolate several fields sharing one wx mesh in a single sweep.
+ * The shape function weights of each node are computed once and used for
+ * every field.
+ * @param sources Fields on the wx mesh the plan was built for.
+ * @param destinations Fields on the WindNinja mesh, one per source.
+ */
+void ColumnInterpolationPlan::apply(std::vector<wn_3dScalarField const *> const &sources,
+                                    std::vector<wn_3dScalarField *> const &destinations) const
+{
+    if(sources.size() != destinations.size())
+        throw std::logic_error("Source and destination counts differ in ColumnInterpolationPlan::apply().");
+
+    int nFields = (int)sources.size();
+    if(nFields == 0)
+        return;
+
+    //global node offsets of local nodes 0-7 from local node 0
+    int anOffset[8];
+    anOffset[0] = 0;
+    anOffset[1] = 1;
+    anOffset[2] = wxRowStride + 1;
+    anOffset[3] = wxRowStride;
+    anOffset[4] = wxLayerStride;
+    anOffset[5] = wxLayerStride + 1;
+    anOffset[6] = wxLayerStride + wxRowStride + 1;
+    anOffset[7] = wxLayerStride + wxRowStride;
+
+#pragma omp parallel for schedule(static)
+    for(int n = 0; n < nNodes; n++)
+    {
+        int node0 = anNode0[n];
+        if(node0 < 0)
+        {
+            for(int f = 0; f < nFields; f++)
+                (*destinations[f])(n) = -9999.0;
+            continue;
+        }
+
+        double adfWeight[8];
+        ComputeShapeWeights(adfLocal[3 * n], adfLocal[3 * n + 1],
+                            adfLocal[3 * n + 2], adfWeight);
+
+        for(int f = 0; f < nFields; f++)
+        {
+            wn_3dScalarField const &src = *sources[f];
+            double value = 0.0;
+            for(int k = 0; k < 8; k++)
+                value = value + adfWeight[k] * src(node0 + anOffset[k]);
+            (*destinations[f])(n) = value;
+        }
+    }
+}
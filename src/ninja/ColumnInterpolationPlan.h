@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Precomputed vertical interpolation from a wx model mesh onto the
+ *           WindNinja mesh
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef COLUMN_INTERPOLATION_PLAN_H
+#define COLUMN_INTERPOLATION_PLAN_H
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "mesh.h"
+#include "element.h"
+#include "wn_3dScalarField.h"
+
+/**
+ * Stores, for every node of a WindNinja mesh, the wx model cell that
+ * brackets it and the local (u,v,w) coordinates inside that cell.  The
+ * search is done one WindNinja column at a time: the wx model ground height
+ * under the column is found once and every layer of the column is mapped
+ * with the normalized distance method used by
+ * wn_3dScalarField::interpolateScalarData().
+ *
+ * The plan depends only on the two meshes, so it is built once and applied
+ * to every field stored on the same wx mesh.
+ */
+class ColumnInterpolationPlan
+{
+public:
+    ColumnInterpolationPlan();
+    ColumnInterpolationPlan(Mesh const &wxMesh, Mesh const &mesh);
+    ~ColumnInterpolationPlan();
+
+    void build(Mesh const &wxMesh, Mesh const &mesh);
+
+    void apply(wn_3dScalarField const &source,
+               wn_3dScalarField &destination) const;
+    void apply(std::vector<wn_3dScalarField const *> const &sources,
+               std::vector<wn_3dScalarField *> const &destinations) const;
+
+    inline int get_nNodes() const {return nNodes;}
+
+private:
+    int nNodes;
+    int wxRowStride;    // node offset between wx rows (ncols)
+    int wxLayerStride;  // node offset between wx layers (nrows * ncols)
+
+    /*
+    ** Global node number of local node 0 of the bracketing wx cell, or -1
+    ** where no value is interpolated (WindNinja ground nodes and nodes that
+    ** fall in the lowest wx layer), and the local coordinates in that cell.
+    */
+    std::vector<int> anNode0;
+    std::vector<double> adfLocal;
+};
+
+#endif /* COLUMN_INTERPOLATION_PLAN_H */
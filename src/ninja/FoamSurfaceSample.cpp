@@ -0,0 +1,303 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Read OpenFOAM raw surface samples and grid them by nearest neighbour
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "FoamSurfaceSample.h"
+
+FoamSurfaceSample::FoamSurfaceSample()
+    : dfBinXMin(0.0), dfBinYMin(0.0), dfBinSize(1.0), nBinCols(0), nBinRows(0)
+{
+}
+
+FoamSurfaceSample::~FoamSurfaceSample()
+{
+}
+
+/**
+ * Read a raw OpenFOAM surface sample of U.
+ *
+ * The file has a '# U  POINT_DATA n' line, a '#  x  y  z  U_x  U_y  U_z'
+ * column header and one whitespace separated point per line.  Columns are
+ * located from the header so the order written by OpenFOAM doesn't matter.
+ * @param filename Path to U_triSurfaceSampling.raw.
+ */
+void FoamSurfaceSample::readRaw(const std::string &filename)
+{
+    VSILFILE *fin = VSIFOpenL(filename.c_str(), "rb");
+    if(fin == NULL)
+        throw std::runtime_error("Failed to open OpenFOAM sample " + filename + ".");
+
+    VSIFSeekL(fin, 0, SEEK_END);
+    vsi_l_offset nSize = VSIFTellL(fin);
+    VSIFSeekL(fin, 0, SEEK_SET);
+
+    std::vector<char> buf(nSize + 1);
+    if(VSIFReadL(&buf[0], 1, nSize, fin) != nSize)
+    {
+        VSIFCloseL(fin);
+        throw std::runtime_error("Failed to read OpenFOAM sample " + filename + ".");
+    }
+    VSIFCloseL(fin);
+    buf[nSize] = '\0';
+
+    adfX.clear();
+    adfY.clear();
+    adfU.clear();
+    adfV.clear();
+
+    int nColumns = 6;
+    int nXCol = 0, nYCol = 1, nUCol = 3, nVCol = 4;
+    std::vector<double> adfRow(nColumns);
+
+    char *p = &buf[0];
+    char *pEnd = p + nSize;
+    while(p < pEnd)
+    {
+        char *pszLine = p;
+        char *pszEol = strchr(p, '\n');
+        if(pszEol != NULL)
+        {
+            *pszEol = '\0';
+            p = pszEol + 1;
+        }
+        else
+            p = pEnd;
+
+        while(*pszLine == ' ' || *pszLine == '\t')
+            pszLine++;
+        if(*pszLine == '\0' || *pszLine == '\r')
+            continue;
+
+        if(*pszLine == '#')
+        {
+            char **papszTokens = CSLTokenizeString2(pszLine + 1, " \t\r", 0);
+            int nTokens = CSLCount(papszTokens);
+            if(nTokens >= 3 && EQUAL(papszTokens[1], "POINT_DATA"))
+            {
+                int nPoints = atoi(papszTokens[2]);
+                if(nPoints > 0)
+                {
+                    adfX.reserve(nPoints);
+                    adfY.reserve(nPoints);
+                    adfU.reserve(nPoints);
+                    adfV.reserve(nPoints);
+                }
+            }
+            else if(CSLFindString(papszTokens, "x") >= 0 &&
+                    CSLFindString(papszTokens, "U_x") >= 0)
+            {
+                nColumns = nTokens;
+                nXCol = CSLFindString(papszTokens, "x");
+                nYCol = CSLFindString(papszTokens, "y");
+                nUCol = CSLFindString(papszTokens, "U_x");
+                nVCol = CSLFindString(papszTokens, "U_y");
+                adfRow.resize(nColumns);
+            }
+            CSLDestroy(papszTokens);
+            if(nYCol < 0 || nVCol < 0)
+                throw std::runtime_error("Invalid column header in OpenFOAM sample " + filename + ".");
+            continue;
+        }
+
+        char *pszNext = pszLine;
+        int k;
+        for(k = 0; k < nColumns; k++)
+        {
+            char *pszValueEnd;
+            adfRow[k] = CPLStrtod(pszNext, &pszValueEnd);
+            if(pszValueEnd == pszNext)
+                break;
+            pszNext = pszValueEnd;
+        }
+        if(k < nColumns)
+            continue;
+
+        adfX.push_back(adfRow[nXCol]);
+        adfY.push_back(adfRow[nYCol]);
+        adfU.push_back(adfRow[nUCol]);
+        adfV.push_back(adfRow[nVCol]);
+    }
+
+    CPLDebug("WINDNINJA", "NinjaFoam read %d sample points", get_nPoints());
+
+    if(adfX.empty())
+        throw std::runtime_error("No points found in OpenFOAM sample " + filename + ".");
+
+    buildHash();
+}
+
+/**
+ * Bin the points on a uniform grid sized for a few points per bin.  Each bin
+ * holds a contiguous range of point indices in anBinPoint.
+ */
+void FoamSurfaceSample::buildHash()
+{
+    const int nPoints = get_nPoints();
+    double dfXMin = adfX[0], dfXMax = adfX[0];
+    double dfYMin = adfY[0], dfYMax = adfY[0];
+    for(int i = 1; i < nPoints; i++)
+    {
+        dfXMin = std::min(dfXMin, adfX[i]);
+        dfXMax = std::max(dfXMax, adfX[i]);
+        dfYMin = std::min(dfYMin, adfY[i]);
+        dfYMax = std::max(dfYMax, adfY[i]);
+    }
+
+    double dfXSize = dfXMax - dfXMin;
+    double dfYSize = dfYMax - dfYMin;
+    if(dfXSize > 0.0 && dfYSize > 0.0)
+        dfBinSize = 2.0 * sqrt(dfXSize * dfYSize / nPoints);
+    else
+        dfBinSize = 4.0 * std::max(dfXSize, dfYSize) / nPoints;
+    if(!(dfBinSize > 0.0))
+        dfBinSize = 1.0;
+
+    dfBinXMin = dfXMin;
+    dfBinYMin = dfYMin;
+    nBinCols = (int)(dfXSize / dfBinSize) + 1;
+    nBinRows = (int)(dfYSize / dfBinSize) + 1;
+
+    std::vector<int> anBin(nPoints);
+    anBinStart.assign(nBinCols * nBinRows + 1, 0);
+    for(int i = 0; i < nPoints; i++)
+    {
+        int nCol = std::min((int)((adfX[i] - dfBinXMin) / dfBinSize), nBinCols - 1);
+        int nRow = std::min((int)((adfY[i] - dfBinYMin) / dfBinSize), nBinRows - 1);
+        anBin[i] = nRow * nBinCols + nCol;
+        anBinStart[anBin[i] + 1]++;
+    }
+    for(int b = 0; b < nBinCols * nBinRows; b++)
+        anBinStart[b + 1] += anBinStart[b];
+
+    std::vector<int> anFill(anBinStart.begin(), anBinStart.end() - 1);
+    anBinPoint.resize(nPoints);
+    for(int i = 0; i < nPoints; i++)
+        anBinPoint[anFill[anBin[i]]++] = i;
+}
+
+/**
+ * Index of the point closest to (dfX, dfY).  Bins are searched in square
+ * rings around the query bin until no unvisited bin can hold a closer point.
+ * @return the point index, or -1 if no point is within dfMaxDistance.
+ */
+int FoamSurfaceSample::nearest(double dfX, double dfY, double dfMaxDistance) const
+{
+    const int nQCol = (int)floor((dfX - dfBinXMin) / dfBinSize);
+    const int nQRow = (int)floor((dfY - dfBinYMin) / dfBinSize);
+
+    int nBest = -1;
+    double dfBestD2 = 0.0;
+    for(int r = 0; ; r++)
+    {
+        const int nColMin = std::max(nQCol - r, 0);
+        const int nColMax = std::min(nQCol + r, nBinCols - 1);
+        const int nRowMin = std::max(nQRow - r, 0);
+        const int nRowMax = std::min(nQRow + r, nBinRows - 1);
+
+        for(int nRow = nRowMin; nRow <= nRowMax; nRow++)
+        {
+            /* interior rows only contribute the two ring columns */
+            const bool bEdgeRow = (nRow == nQRow - r || nRow == nQRow + r);
+            for(int nCol = nColMin; nCol <= nColMax; nCol++)
+            {
+                if(!bEdgeRow && nCol != nQCol - r && nCol != nQCol + r)
+                {
+                    if(nCol < nQCol + r)
+                        nCol = nQCol + r - 1;
+                    continue;
+                }
+                const int b = nRow * nBinCols + nCol;
+                for(int k = anBinStart[b]; k < anBinStart[b + 1]; k++)
+                {
+                    const int i = anBinPoint[k];
+                    const double dx = adfX[i] - dfX;
+                    const double dy = adfY[i] - dfY;
+                    const double d2 = dx * dx + dy * dy;
+                    if(nBest < 0 || d2 < dfBestD2)
+                    {
+                        nBest = i;
+                        dfBestD2 = d2;
+                    }
+                }
+            }
+        }
+
+        /* every point left is at least r bins away */
+        if(nBest >= 0 && dfBestD2 <= (r * dfBinSize) * (r * dfBinSize))
+            break;
+        if(r * dfBinSize > dfMaxDistance)
+            break;
+        if(nQCol - r <= 0 && nQCol + r >= nBinCols - 1 &&
+           nQRow - r <= 0 && nQRow + r >= nBinRows - 1)
+            break;
+    }
+    if(nBest >= 0 && dfBestD2 > dfMaxDistance * dfMaxDistance)
+        return -1;
+    return nBest;
+}
+
+/**
+ * Fill u and v with the values of the sample point nearest each cell center.
+ * The grids must already have the output geometry (typically the DEM's).
+ * Cells with no point within two bins or two cells of their center, whichever
+ * is larger, are set to the grids' no data value.
+ * @param u Grid to receive U_x.
+ * @param v Grid to receive U_y.
+ */
+void FoamSurfaceSample::grid(AsciiGrid<double> &u, AsciiGrid<double> &v) const
+{
+    if(adfX.empty())
+        throw std::logic_error("No OpenFOAM sample points to grid.");
+    if(!u.checkForCoincidentGrids(v))
+        throw std::logic_error("OpenFOAM output grids have different dimensions.");
+
+    const int nRows = u.get_nRows();
+    const int nCols = u.get_nCols();
+    const double dfCellSize = u.get_cellSize();
+    const double dfXll = u.get_xllCorner();
+    const double dfYll = u.get_yllCorner();
+    const double dfMaxDistance = 2.0 * std::max(dfBinSize, dfCellSize);
+
+#pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < nRows; i++)
+    {
+        const double dfY = dfYll + (i + 0.5) * dfCellSize;
+        for(int j = 0; j < nCols; j++)
+        {
+            const int k = nearest(dfXll + (j + 0.5) * dfCellSize, dfY, dfMaxDistance);
+            if(k < 0)
+            {
+                u(i,j) = u.get_noDataValue();
+                v(i,j) = v.get_noDataValue();
+                continue;
+            }
+            u(i,j) = adfU[k];
+            v(i,j) = adfV[k];
+        }
+    }
+}
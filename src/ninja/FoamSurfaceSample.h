@@ -0,0 +1,76 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Read OpenFOAM raw surface samples and grid them by nearest neighbour
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef FOAM_SURFACE_SAMPLE_H
+#define FOAM_SURFACE_SAMPLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "ascii_grid.h"
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+/**
+ * Point cloud written by the OpenFOAM surfaces function object in raw format
+ * (U_triSurfaceSampling.raw).  The file is read in one pass into contiguous
+ * x, y, u and v arrays and gridded by nearest neighbour through a uniform
+ * spatial hash, one output row per thread.  Cells with no sample nearby are
+ * left as no data.
+ */
+class FoamSurfaceSample
+{
+public:
+    FoamSurfaceSample();
+    ~FoamSurfaceSample();
+
+    void readRaw(const std::string &filename);
+    void grid(AsciiGrid<double> &u, AsciiGrid<double> &v) const;
+
+    inline int get_nPoints() const {return (int)adfX.size();}
+
+private:
+    void buildHash();
+    int nearest(double dfX, double dfY, double dfMaxDistance) const;
+
+    std::vector<double> adfX, adfY, adfU, adfV;
+
+    /* spatial hash, points sorted by bin (CSR layout) */
+    std::vector<int> anBinStart;
+    std::vector<int> anBinPoint;
+    double dfBinXMin, dfBinYMin, dfBinSize;
+    int nBinCols, nBinRows;
+};
+
+#endif /* FOAM_SURFACE_SAMPLE_H */
@@ -0,0 +1,294 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Precomputed bilinear resampling weights between two grids
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "GridResamplePlan.h"
+
+std::map<GridResamplePlan::planKey, boost::shared_ptr<GridResamplePlan> >
+GridResamplePlan::oPlanCache;
+
+bool GridResamplePlan::gridGeometry::operator==(gridGeometry const &rhs) const
+{
+    return nCols == rhs.nCols && nRows == rhs.nRows &&
+           xllCorner == rhs.xllCorner && yllCorner == rhs.yllCorner &&
+           cellSize == rhs.cellSize;
+}
+
+bool GridResamplePlan::gridGeometry::operator<(gridGeometry const &rhs) const
+{
+    if(nCols != rhs.nCols)
+        return nCols < rhs.nCols;
+    if(nRows != rhs.nRows)
+        return nRows < rhs.nRows;
+    if(xllCorner != rhs.xllCorner)
+        return xllCorner < rhs.xllCorner;
+    if(yllCorner != rhs.yllCorner)
+        return yllCorner < rhs.yllCorner;
+    return cellSize < rhs.cellSize;
+}
+
+GridResamplePlan::gridGeometry GridResamplePlan::GetGeometry(AsciiGrid<double> const &grid)
+{
+    gridGeometry g;
+    g.nCols = grid.get_nCols();
+    g.nRows = grid.get_nRows();
+    g.xllCorner = grid.get_xllCorner();
+    g.yllCorner = grid.get_yllCorner();
+    g.cellSize = grid.get_cellSize();
+    return g;
+}
+
+GridResamplePlan::GridResamplePlan() : nCells(0)
+{
+    srcGeometry.nCols = srcGeometry.nRows = 0;
+    srcGeometry.xllCorner = srcGeometry.yllCorner = srcGeometry.cellSize = 0.0;
+    dstGeometry = srcGeometry;
+}
+
+GridResamplePlan::GridResamplePlan(AsciiGrid<double> const &source,
+                                   AsciiGrid<double> const &destination) : nCells(0)
+{
+    build(source, destination);
+}
+
+GridResamplePlan::~GridResamplePlan()
+{
+
+}
+
+/**
+ * @brief Compute source indices and weights for every destination cell.
+ *
+ * Mirrors AsciiGrid<T>::interpolateGrid() with order1: cells within half a
+ * cell of the source edge use nearest neighbor, the rest use bilinear
+ * weights of the four surrounding source cell centers.
+ *
+ * @param source Grid that will be interpolated from.
+ * @param destination Grid that will be interpolated onto.
+ * @throws std::range_error if a destination cell lies outside the source.
+ */
+void GridResamplePlan::build(AsciiGrid<double> const &source,
+                             AsciiGrid<double> const &destination)
+{
+    srcGeometry = GetGeometry(source);
+    dstGeometry = GetGeometry(destination);
+    nCells = dstGeometry.nCols * dstGeometry.nRows;
+
+    anIndex.assign(4 * nCells, 0);
+    adfWeight.assign(4 * nCells, 0.0);
+
+    const double cs = srcGeometry.cellSize;
+    const double xll = srcGeometry.xllCorner;
+    const double yll = srcGeometry.yllCorner;
+    const double xMax = xll + srcGeometry.nCols * cs;
+    const double yMax = yll + srcGeometry.nRows * cs;
+    const int nSrcCols = srcGeometry.nCols;
+    const int nSrcRows = srcGeometry.nRows;
+
+    bool bOutOfBounds = false;
+    int i;
+
+#pragma omp parallel for default(shared) private(i)
+    for(i = 0; i < dstGeometry.nRows; i++)
+    {
+        double xC, yC;
+        int si, sj, n;
+        double t, u;
+        for(int j = 0; j < dstGeometry.nCols; j++)
+        {
+            n = 4 * (i * dstGeometry.nCols + j);
+            xC = (dstGeometry.cellSize / 2.0) + (j * dstGeometry.cellSize) + dstGeometry.xllCorner;
+            yC = (dstGeometry.cellSize / 2.0) + (i * dstGeometry.cellSize) + dstGeometry.yllCorner;
+
+            if(xC >= (xll + (nSrcCols * cs - (cs / 2))) || xC <= xll + (cs / 2) ||
+               yC >= (yll + (nSrcRows * cs - (cs / 2))) || yC <= yll + (cs / 2))
+            {
+                if(xC < xll || yC < yll || xC > xMax || yC > yMax)
+                {
+                    bOutOfBounds = true;
+                    continue;
+                }
+                sj = std::min(long((xC - xll) / cs), long(nSrcCols - 1));
+                si = std::min(long((yC - yll) / cs), long(nSrcRows - 1));
+                for(int k = 0; k < 4; k++)
+                {
+                    anIndex[n + k] = si * nSrcCols + sj;
+                    adfWeight[n + k] = (k == 0) ? 1.0 : 0.0;
+                }
+            }
+            else
+            {
+                sj = long(((xC - cs / 2) - xll) / cs);
+                si = long(((yC - cs / 2) - yll) / cs);
+
+                t = (yC - ((si * cs + (cs / 2)) + yll)) /
+                    ((((si + 1) * cs + (cs / 2)) + yll) - (((si * cs + (cs / 2))) + yll));
+                u = (xC - ((sj * cs + (cs / 2)) + xll)) /
+                    ((((sj + 1) * cs + (cs / 2)) + xll) - (((sj * cs + (cs / 2))) + xll));
+
+                anIndex[n]     = si * nSrcCols + sj;
+                anIndex[n + 1] = (si + 1) * nSrcCols + sj;
+                anIndex[n + 2] = (si + 1) * nSrcCols + sj + 1;
+                anIndex[n + 3] = si * nSrcCols + sj + 1;
+
+                adfWeight[n]     = (1 - t) * (1 - u);
+                adfWeight[n + 1] = t * (1 - u);
+                adfWeight[n + 2] = t * u;
+                adfWeight[n + 3] = (1 - t) * u;
+            }
+        }
+    }
+
+    if(bOutOfBounds)
+    {
+        nCells = 0;
+        anIndex.clear();
+        adfWeight.clear();
+        throw std::range_error("Invalid cell reference in GridResamplePlan::build().");
+    }
+}
+
+/**
+ * @brief Check that a plan was built for grids with this geometry.
+ */
+bool GridResamplePlan::matches(AsciiGrid<double> const &source,
+                               AsciiGrid<double> const &destination) const
+{
+    return nCells > 0 &&
+           GetGeometry(source) == srcGeometry &&
+           GetGeometry(destination) == dstGeometry;
+}
+
+/**
+ * @brief Interpolate a single band using the plan.
+ */
+void GridResamplePlan::apply(AsciiGrid<double> const &source,
+                             AsciiGrid<double> &destination) const
+{
+    std::vector<AsciiGrid<double> const *> sources(1, &source);
+    std::vector<AsciiGrid<double> *> destinations(1, &destination);
+    apply(sources, destinations);
+}
+
+/**
+ * @brief Interpolate several bands in one pass using the plan.
+ *
+ * As with interpolateFromGrid(), each destination takes the no data value of
+ * its source, and a cell is set to no data if any contributing source cell is
+ * no data.
+ *
+ * @param sources Grids to interpolate from, all with the plan's source geometry.
+ * @param destinations Grids to fill, all with the plan's destination geometry.
+ */
+void GridResamplePlan::apply(std::vector<AsciiGrid<double> const *> const &sources,
+                             std::vector<AsciiGrid<double> *> const &destinations) const
+{
+    if(sources.size() != destinations.size())
+        throw std::logic_error("Band count mismatch in GridResamplePlan::apply().");
+
+    const int nBands = sources.size();
+    std::vector<const double *> srcData(nBands);
+    std::vector<double *> dstData(nBands);
+    std::vector<double> noData(nBands);
+
+    for(int b = 0; b < nBands; b++)
+    {
+        if(!matches(*sources[b], *destinations[b]))
+            throw std::logic_error("Grid geometry does not match in GridResamplePlan::apply().");
+        noData[b] = sources[b]->data.getNoDataValue();
+        destinations[b]->data.setNoDataValue(noData[b]);
+        srcData[b] = sources[b]->data.get_dataPointer();
+        dstData[b] = destinations[b]->data.get_dataPointer();
+    }
+
+    int n;
+#pragma omp parallel for default(shared) private(n)
+    for(n = 0; n < nCells; n++)
+    {
+        const int *idx = &anIndex[4 * n];
+        const double *w = &adfWeight[4 * n];
+        for(int b = 0; b < nBands; b++)
+        {
+            const double *s = srcData[b];
+            const double v1 = s[idx[0]];
+            const double v2 = s[idx[1]];
+            const double v3 = s[idx[2]];
+            const double v4 = s[idx[3]];
+            if(v1 == noData[b] || v2 == noData[b] || v3 == noData[b] || v4 == noData[b])
+                dstData[b][n] = noData[b];
+            else
+                dstData[b][n] = w[0] * v1 + w[1] * v2 + w[2] * v3 + w[3] * v4;
+        }
+    }
+}
+
+/**
+ * @brief Fetch a plan for a pair of grids, building it on first use.
+ *
+ * Plans are shared between all threads and runs in the process.  The cache
+ * is flushed when it grows past MAX_CACHED_PLANS; plans that are still held
+ * by a caller stay alive until released.
+ */
+boost::shared_ptr<GridResamplePlan> GridResamplePlan::GetPlan(AsciiGrid<double> const &source,
+                                                              AsciiGrid<double> const &destination)
+{
+    planKey key(GetGeometry(source), GetGeometry(destination));
+    boost::shared_ptr<GridResamplePlan> plan;
+
+#pragma omp critical(gridResamplePlanCache)
+    {
+        std::map<planKey, boost::shared_ptr<GridResamplePlan> >::iterator it;
+        it = oPlanCache.find(key);
+        if(it != oPlanCache.end())
+            plan = it->second;
+    }
+    if(plan)
+        return plan;
+
+    /* Build outside of the lock, a duplicate build is harmless */
+    plan.reset(new GridResamplePlan(source, destination));
+
+#pragma omp critical(gridResamplePlanCache)
+    {
+        if(oPlanCache.size() >= MAX_CACHED_PLANS)
+            oPlanCache.clear();
+        oPlanCache[key] = plan;
+    }
+    return plan;
+}
+
+/**
+ * @brief Release all cached plans.
+ */
+void GridResamplePlan::ClearCache()
+{
+#pragma omp critical(gridResamplePlanCache)
+    {
+        oPlanCache.clear();
+    }
+}
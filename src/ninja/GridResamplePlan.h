@@ -0,0 +1,121 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Precomputed bilinear resampling weights between two grids
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef GRID_RESAMPLE_PLAN_H
+#define GRID_RESAMPLE_PLAN_H
+
+#include <vector>
+#include <map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "ascii_grid.h"
+
+/**
+ * Stores the source cell indices and bilinear weights needed to interpolate
+ * one grid onto another.  The plan depends only on the geometry of the two
+ * grids, so it can be built once and applied to any number of bands (air
+ * temperature, cloud cover, u, v, ...) sharing that geometry.  The values
+ * produced are identical to AsciiGrid<T>::interpolateFromGrid() with
+ * order1 interpolation.
+ *
+ * Plans are cached by geometry with GetPlan(), so every run in an army that
+ * interpolates the same wx model grid onto the same DEM shares one plan.
+ */
+class GridResamplePlan
+{
+public:
+    GridResamplePlan();
+    GridResamplePlan(AsciiGrid<double> const &source,
+                     AsciiGrid<double> const &destination);
+    ~GridResamplePlan();
+
+    void build(AsciiGrid<double> const &source,
+               AsciiGrid<double> const &destination);
+
+    bool matches(AsciiGrid<double> const &source,
+                 AsciiGrid<double> const &destination) const;
+
+    void apply(AsciiGrid<double> const &source,
+               AsciiGrid<double> &destination) const;
+    void apply(std::vector<AsciiGrid<double> const *> const &sources,
+               std::vector<AsciiGrid<double> *> const &destinations) const;
+
+    inline int get_nCells() const {return nCells;}
+
+    static boost::shared_ptr<GridResamplePlan> GetPlan(AsciiGrid<double> const &source,
+                                                       AsciiGrid<double> const &destination);
+    static void ClearCache();
+
+    /* Number of plans kept in the shared cache before it is flushed */
+    static const unsigned int MAX_CACHED_PLANS = 16;
+
+private:
+    /*
+    ** Geometry of one grid, used to key the cache and to check that a plan
+    ** can be applied to a pair of grids.
+    */
+    struct gridGeometry
+    {
+        int nCols;
+        int nRows;
+        double xllCorner;
+        double yllCorner;
+        double cellSize;
+
+        bool operator==(gridGeometry const &rhs) const;
+        bool operator<(gridGeometry const &rhs) const;
+    };
+    typedef std::pair<gridGeometry, gridGeometry> planKey;
+
+    static gridGeometry GetGeometry(AsciiGrid<double> const &grid);
+
+    gridGeometry srcGeometry;
+    gridGeometry dstGeometry;
+    int nCells;
+
+    /*
+    ** Four source cell offsets (row * nCols + col) and weights per destination
+    ** cell, stored contiguously.  Cells outside the interior of the source
+    ** grid use nearest neighbor, which is stored as one offset with a weight
+    ** of 1 repeated four times.
+    */
+    std::vector<int> anIndex;
+    std::vector<double> adfWeight;
+
+    static std::map<planKey, boost::shared_ptr<GridResamplePlan> > oPlanCache;
+};
+
+#endif /* GRID_RESAMPLE_PLAN_H */
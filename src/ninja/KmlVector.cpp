@@ -29,6 +29,10 @@
 
 #include "KmlVector.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 KmlVector::KmlVector()
 : kmlTime(boost::local_time::not_a_date_time),
   wxModelStartTime(boost::local_time::not_a_date_time)
@@ -146,6 +150,78 @@ KmlVector::~KmlVector()
 	delete[]splitValue;
 
     OCTDestroyCoordinateTransformation( coordTransform );
+
+    if(!kmlMemFile.empty())
+        VSIUnlink(kmlMemFile.c_str());
+}
+
+/**
+ * Open the in-memory buffer the kml document is written to.  makeKmz()
+ * copies it straight into the archive, so no kml file is written to disk.
+ */
+VSILFILE* KmlVector::openKmlBuffer()
+{
+	if(!kmlMemFile.empty())
+		VSIUnlink(kmlMemFile.c_str());
+	kmlMemFile = CPLSPrintf("/vsimem/KmlVector_%p/%s", this,
+	                        getShortName(kmlFile).c_str());
+	return VSIFOpenL(kmlMemFile.c_str(), "w");
+}
+
+std::map<std::string, KmlVector::legendBuffer> KmlVector::oLegendCache;
+
+KmlVector::legendBuffer KmlVector::GetCachedLegend(std::string const &key)
+{
+	legendBuffer data;
+#pragma omp critical(kml_legend_cache)
+	{
+		std::map<std::string, legendBuffer>::const_iterator it = oLegendCache.find(key);
+		if(it != oLegendCache.end())
+			data = it->second;
+	}
+	return data;
+}
+
+/**
+ * Serialize a rendered legend and keep it for later runs drawing the same
+ * legend.  EasyBMP can only write to a file, so the bitmap goes through a
+ * temporary file once per distinct legend.
+ */
+KmlVector::legendBuffer KmlVector::CacheLegend(std::string const &key, BMP &legend)
+{
+	std::string osTmpFile = CPLGenerateTempFilename(CPLSPrintf("NINJA_LEGEND_%p", &legend));
+	osTmpFile += ".bmp";
+	legend.WriteToFile(osTmpFile.c_str());
+
+	legendBuffer data(new std::vector<GByte>);
+	VSILFILE *fin = VSIFOpenL(osTmpFile.c_str(), "rb");
+	if(fin != NULL)
+	{
+		VSIFSeekL(fin, 0, SEEK_END);
+		data->resize((size_t)VSIFTellL(fin));
+		VSIRewindL(fin);
+		if(!data->empty())
+			VSIFReadL(&(*data)[0], 1, data->size(), fin);
+		VSIFCloseL(fin);
+	}
+	VSIUnlink(osTmpFile.c_str());
+
+#pragma omp critical(kml_legend_cache)
+	{
+		oLegendCache[key] = data;
+	}
+	return data;
+}
+
+/**
+ * Drop the rendered legends.  Called when an army is done.
+ */
+void KmlVector::ClearLegendCache()
+{
+#pragma omp critical(kml_legend_cache)
+	{
+		oLegendCache.clear();
+	}
 }
 
 void KmlVector::setSpeedGrid(AsciiGrid<double> &s, velocityUnits::eVelocityUnits units)
@@ -237,7 +313,7 @@ bool KmlVector::writeKml()
 {
 	VSILFILE* fout = 0;
 	makeDefaultStyles();
-	if((fout = VSIFOpenL(kmlFile.c_str(),"w")) == NULL)
+	if((fout = openKmlBuffer()) == NULL)
 		return false;
 	else
 	{
@@ -300,7 +376,7 @@ bool KmlVector::writeKml(egoogSpeedScaling scaling)
 {
 	VSILFILE *fout;
 	makeDefaultStyles();
-	if((fout = VSIFOpenL(kmlFile.c_str(),"w")) == NULL)
+	if((fout = openKmlBuffer()) == NULL)
 		return false;
 	else
 	{
@@ -546,144 +622,155 @@ bool KmlVector::writeScreenOverlayLegend(VSILFILE *fileOut)
         legendStrings[i] = os.str();
 		os.str("");
 	}
-	legend.SetSize(legendWidth,legendHeight);
-	legend.SetBitDepth(8);
+	//the bitmap only depends on the units and the legend text
+	os.str("");
+	os << "speed:" << (int)speedUnits << ":" << (splitValue[4] >= 100);
+	for(int i = 0;i < 5;i++)
+		os << ":" << legendStrings[i];
+	std::string legendKey = os.str();
 
-	//gray legend
-	/*for(int i = 0;i < legendWidth;i++)
+	legendData = GetCachedLegend(legendKey);
+	if(legendData.get() == NULL)
 	{
-		for(int j = 0;j < legendHeight;j++)
+		legend.SetSize(legendWidth,legendHeight);
+		legend.SetBitDepth(8);
+
+		//gray legend
+		/*for(int i = 0;i < legendWidth;i++)
 		{
-			legend(i,j)->Alpha = 0;
-			legend(i,j)->Blue = 192;
-			legend(i,j)->Green = 192;
-			legend(i,j)->Red = 192;
-		}
-	}*/
+			for(int j = 0;j < legendHeight;j++)
+			{
+				legend(i,j)->Alpha = 0;
+				legend(i,j)->Blue = 192;
+				legend(i,j)->Green = 192;
+				legend(i,j)->Red = 192;
+			}
+		}*/
 
-	//black legend
-	for(int i = 0;i < legendWidth;i++)
-	{
-		for(int j = 0;j < legendHeight;j++)
+		//black legend
+		for(int i = 0;i < legendWidth;i++)
 		{
-			legend(i,j)->Alpha = 0;
-			legend(i,j)->Blue = 0;
-			legend(i,j)->Green = 0;
-			legend(i,j)->Red = 0;
+			for(int j = 0;j < legendHeight;j++)
+			{
+				legend(i,j)->Alpha = 0;
+				legend(i,j)->Blue = 0;
+				legend(i,j)->Green = 0;
+				legend(i,j)->Red = 0;
+			}
+	    }
+	    /*
+		//for black text
+		RGBApixel black;
+		black.Red = 0;
+		black.Green = 0;
+		black.Blue = 0;
+		black.Alpha = 0;
+	    */
+		//for white text
+		RGBApixel white;
+		white.Red = 255;
+		white.Green = 255;
+		white.Blue = 255;
+		white.Alpha = 0;
+
+		RGBApixel colors[5];
+		//RGBApixel red, orange, yellow, green, blue;
+		colors[0].Red = 255;
+		colors[0].Green = 0;
+		colors[0].Blue = 0;
+		colors[0].Alpha = 0;
+
+		colors[1].Red = 255;
+		colors[1].Green = 127;
+		colors[1].Blue = 0;
+		colors[1].Alpha = 0;
+
+		colors[2].Red = 255;
+		colors[2].Green = 255;
+		colors[2].Blue = 0;
+		colors[2].Alpha = 0;
+
+		colors[3].Red = 0;
+		colors[3].Green = 255;
+		colors[3].Blue = 0;
+		colors[3].Alpha = 0;
+
+		colors[4].Red = 0;
+		colors[4].Green = 0;
+		colors[4].Blue = 255;
+		colors[4].Alpha = 0;
+
+		int arrowLength = 40;	//pixels;
+		int arrowHeadLength = 10; // pixels;
+		int textHeight = 12;	//pixels- 10 for maximum speed of "999.99 - 555.55";
+								//12 for normal double digits
+		if(splitValue[4] >= 100)
+			textHeight = 10;
+		int titleTextHeight = int(1.2 * textHeight);
+		int titleX, titleY;
+
+	    int x1, x2, x3, x4;
+		double x;
+		int y1, y2, y3, y4;
+		double y;
+
+		int textX;
+		int textY;
+
+		x = 0.05;
+		//y = 0.10;
+		y = 0.30;
+
+
+		titleX = x * legendWidth;
+		titleY = (y / 3) * legendHeight;
+
+		switch(speedUnits)
+		{
+			case velocityUnits::metersPerSecond:	// m/s
+				PrintString(legend,"Wind Speed (m/s)", titleX, titleY, titleTextHeight, white);
+				break;
+			case velocityUnits::milesPerHour:		// mph
+				PrintString(legend,"Wind Speed (mph)", titleX, titleY, titleTextHeight, white);
+				break;
+			case velocityUnits::kilometersPerHour:	// kph
+				PrintString(legend,"Wind Speed (kph)", titleX, titleY, titleTextHeight, white);
+				break;
+			default:				// default is mph
+				PrintString(legend,"Wind Speed (mph)", titleX, titleY, titleTextHeight, white);
+				break;
 		}
-    }
-    /*
-	//for black text
-	RGBApixel black;
-	black.Red = 0;
-	black.Green = 0;
-	black.Blue = 0;
-	black.Alpha = 0;
-    */
-	//for white text
-	RGBApixel white;
-	white.Red = 255;
-	white.Green = 255;
-	white.Blue = 255;
-	white.Alpha = 0;
-
-	RGBApixel colors[5];
-	//RGBApixel red, orange, yellow, green, blue;
-	colors[0].Red = 255;
-	colors[0].Green = 0;
-	colors[0].Blue = 0;
-	colors[0].Alpha = 0;
-
-	colors[1].Red = 255;
-	colors[1].Green = 127;
-	colors[1].Blue = 0;
-	colors[1].Alpha = 0;
-
-	colors[2].Red = 255;
-	colors[2].Green = 255;
-	colors[2].Blue = 0;
-	colors[2].Alpha = 0;
-
-	colors[3].Red = 0;
-	colors[3].Green = 255;
-	colors[3].Blue = 0;
-	colors[3].Alpha = 0;
-
-	colors[4].Red = 0;
-	colors[4].Green = 0;
-	colors[4].Blue = 255;
-	colors[4].Alpha = 0;
-
-	int arrowLength = 40;	//pixels;
-	int arrowHeadLength = 10; // pixels;
-	int textHeight = 12;	//pixels- 10 for maximum speed of "999.99 - 555.55";
-							//12 for normal double digits
-	if(splitValue[4] >= 100)
-		textHeight = 10;
-	int titleTextHeight = int(1.2 * textHeight);
-	int titleX, titleY;
 
-    int x1, x2, x3, x4;
-	double x;
-	int y1, y2, y3, y4;
-	double y;
-
-	int textX;
-	int textY;
-
-	x = 0.05;
-	//y = 0.10;
-	y = 0.30;
-
-
-	titleX = x * legendWidth;
-	titleY = (y / 3) * legendHeight;
-
-	switch(speedUnits)
-	{
-		case velocityUnits::metersPerSecond:	// m/s
-			PrintString(legend,"Wind Speed (m/s)", titleX, titleY, titleTextHeight, white);
-			break;
-		case velocityUnits::milesPerHour:		// mph
-			PrintString(legend,"Wind Speed (mph)", titleX, titleY, titleTextHeight, white);
-			break;
-		case velocityUnits::kilometersPerHour:	// kph
-			PrintString(legend,"Wind Speed (kph)", titleX, titleY, titleTextHeight, white);
-			break;
-		default:				// default is mph
-			PrintString(legend,"Wind Speed (mph)", titleX, titleY, titleTextHeight, white);
-			break;
-	}
+		for(int i = 0;i < 5;i++)
+		{
+			x1 = int(legendWidth * x);
+			x2 = x1 + arrowLength;
+			y1 = int(legendHeight * y);
+			y2 = y1;
 
-	for(int i = 0;i < 5;i++)
-	{
-		x1 = int(legendWidth * x);
-		x2 = x1 + arrowLength;
-		y1 = int(legendHeight * y);
-		y2 = y1;
+			x3 = x2 - arrowHeadLength;
+			y3 = y2 + arrowHeadLength;
 
-		x3 = x2 - arrowHeadLength;
-		y3 = y2 + arrowHeadLength;
+			x4 = x2 - arrowHeadLength;
+			y4 = y2 - arrowHeadLength;
 
-		x4 = x2 - arrowHeadLength;
-		y4 = y2 - arrowHeadLength;
+			textX = x2 + 10;
+			textY = y2 - int(textHeight * 0.5);
 
-		textX = x2 + 10;
-		textY = y2 - int(textHeight * 0.5);
 
+			DrawLine(legend, x1, y1, x2, y2, colors[i]);
+			DrawLine(legend, x2, y2, x3, y3, colors[i]);
+			DrawLine(legend, x2, y2, x4, y4, colors[i]);
 
-		DrawLine(legend, x1, y1, x2, y2, colors[i]);
-		DrawLine(legend, x2, y2, x3, y3, colors[i]);
-		DrawLine(legend, x2, y2, x4, y4, colors[i]);
+			PrintString(legend, legendStrings[i].c_str(), textX, textY, textHeight, white);
 
-		PrintString(legend, legendStrings[i].c_str(), textX, textY, textHeight, white);
 
+			y += 0.15;
+		}
 
-		y += 0.15;
+		legendData = CacheLegend(legendKey, legend);
 	}
 
-	legend.WriteToFile(legendFile.c_str());
-
 	//printf("\n\nfileOut in writeScreenOverlayLegend = %x\n", fileOut);
 
 	std::string shortName;
@@ -706,59 +793,13 @@ bool KmlVector::writeScreenOverlayLegend(VSILFILE *fileOut)
 	return true;
 }
 
-bool KmlVector::writeScreenOverlayDateTimeLegend(VSILFILE *fileOut)
+/*
+** Format the date and time lines shown in the date-time legends, e.g.
+** "Tuesday, July 05, 2011" and "14:00 MDT (20:00 UTC)".
+*/
+static void FormatLegendDateTime(const boost::local_time::local_date_time& time_,
+                                 std::string &dateString, std::string &timeString)
 {
-
-	if(timeDateLegendFile == "")
-		return false;
-
-	//make bitmap
-	int legendWidth = 285;
-	int legendHeight = 52;
-	BMP legend;
-
-	legend.SetSize(legendWidth,legendHeight);
-	legend.SetBitDepth(8);
-
-	//black legend
-	for(int i = 0;i < legendWidth;i++)
-	{
-		for(int j = 0;j < legendHeight;j++)
-		{
-			legend(i,j)->Alpha = 0;
-			legend(i,j)->Blue = 0;
-			legend(i,j)->Green = 0;
-			legend(i,j)->Red = 0;
-		}
-	}
-
-	//for white text
-	RGBApixel white;
-	white.Red = 255;
-	white.Green = 255;
-	white.Blue = 255;
-	white.Alpha = 0;
-
-	int textHeight = 12;	//pixels- 10 for maximum speed of "999.99 - 555.55";
-							//12 for normal double digits
-	int titleX, titleY;
-
-	double x;
-	double y;
-
-	//print date
-	x = 0.05;
-	y = 0.15;
-	titleX = x * legendWidth;
-	titleY = y * legendHeight;
-
-//	ostringstream os;
-//	boost::gregorian::date::ymd_type ymd = kmlTime.local_time().date().year_month_day();
-//	boost::gregorian::greg_weekday wd = kmlTime.local_time().date().day_of_week();
-//
-//	os <<  wd.as_long_string() << " " << ymd.month.as_long_string() << " " << ymd.day << ", " << ymd.year;
-//	std::string date_string = os.str();
-
 	std::ostringstream os;
 	boost::local_time::local_time_facet* timeOutputFacet;
 	timeOutputFacet = new boost::local_time::local_time_facet();
@@ -767,28 +808,18 @@ bool KmlVector::writeScreenOverlayDateTimeLegend(VSILFILE *fileOut)
 	//		https://collab.firelab.org/software/projects/windninja/wiki/KnownIssues
 	//		http://rhubbarb.wordpress.com/2009/10/17/boost-datetime-locales-and-facets/#comment-203
 
-
-
 	os.imbue(std::locale(std::locale::classic(), timeOutputFacet));
 	timeOutputFacet->format("%A, %B %d, %Y");
 
-	os << kmlTime;
-
-	PrintString(legend,os.str().c_str(), titleX, titleY, textHeight, white);
-
-	//print time
-	x = 0.05;
-	y = 0.60;
-
-	titleX = x * legendWidth;
-	titleY = y * legendHeight;
+	os << time_;
+	dateString = os.str();
 
 	os.str("");
 	//timeOutputFacet->format("%H:%M %z (%Q from UTC)");
 	timeOutputFacet->format("%H:%M %z (");
-	os << kmlTime;
+	os << time_;
 
-	std::string timeStringLegend(os.str());
+	timeString = os.str();
 
 	boost::posix_time::time_facet* timeOutputFacet2;
 	timeOutputFacet2 = new boost::posix_time::time_facet();
@@ -801,14 +832,73 @@ bool KmlVector::writeScreenOverlayDateTimeLegend(VSILFILE *fileOut)
 
 	os.str("");
 	timeOutputFacet2->format("%H:%M UTC)");
-	os << kmlTime.utc_time();
+	os << time_.utc_time();
 
-	timeStringLegend.append(os.str());
+	timeString.append(os.str());
+}
 
-	PrintString(legend,timeStringLegend.c_str(), titleX, titleY, textHeight, white);
+/*
+** Black bitmap with white text lines drawn at the given fractions of the
+** height, used for the date-time legends.
+*/
+static void DrawTextLegend(BMP &legend, int legendWidth, int legendHeight,
+                           const std::string *lines, const double *yFractions,
+                           int nLines)
+{
+	legend.SetSize(legendWidth,legendHeight);
+	legend.SetBitDepth(8);
 
+	//black legend
+	for(int i = 0;i < legendWidth;i++)
+	{
+		for(int j = 0;j < legendHeight;j++)
+		{
+			legend(i,j)->Alpha = 0;
+			legend(i,j)->Blue = 0;
+			legend(i,j)->Green = 0;
+			legend(i,j)->Red = 0;
+		}
+	}
+
+	//for white text
+	RGBApixel white;
+	white.Red = 255;
+	white.Green = 255;
+	white.Blue = 255;
+	white.Alpha = 0;
+
+	int textHeight = 12;	//pixels- 10 for maximum speed of "999.99 - 555.55";
+							//12 for normal double digits
+	double x = 0.05;
+	int titleX = x * legendWidth;
+	int titleY;
+
+	for(int i = 0;i < nLines;i++)
+	{
+		titleY = yFractions[i] * legendHeight;
+		PrintString(legend, lines[i].c_str(), titleX, titleY, textHeight, white);
+	}
+}
+
+bool KmlVector::writeScreenOverlayDateTimeLegend(VSILFILE *fileOut)
+{
+
+	if(timeDateLegendFile == "")
+		return false;
 
-	legend.WriteToFile(timeDateLegendFile.c_str());
+	std::string lines[2];
+	FormatLegendDateTime(kmlTime, lines[0], lines[1]);
+
+	std::string legendKey = "datetime:" + lines[0] + ":" + lines[1];
+	timeDateLegendData = GetCachedLegend(legendKey);
+	if(timeDateLegendData.get() == NULL)
+	{
+		//make bitmap, date then time
+		BMP legend;
+		double yFractions[2] = {0.15, 0.60};
+		DrawTextLegend(legend, 285, 52, lines, yFractions, 2);
+		timeDateLegendData = CacheLegend(legendKey, legend);
+	}
 
 	std::string shortName;
 	shortName = CPLGetFilename(timeDateLegendFile.c_str());
@@ -836,108 +926,21 @@ bool KmlVector::writeScreenOverlayDateTimeLegendWxModelRun(VSILFILE *fileOut)
     if(timeDateLegendFile == "")
         return false;
 
-    //make bitmap
-    int legendWidth = 285;
-    int legendHeight = 78;
-    BMP legend;
-
-    legend.SetSize(legendWidth,legendHeight);
-    legend.SetBitDepth(8);
+    std::string lines[3];
+    lines[0] = wxModelName;
+    FormatLegendDateTime(kmlTime, lines[1], lines[2]);
 
-    //black legend
-    for(int i = 0;i < legendWidth;i++)
+    std::string legendKey = "wxmodel:" + lines[0] + ":" + lines[1] + ":" + lines[2];
+    timeDateLegendData = GetCachedLegend(legendKey);
+    if(timeDateLegendData.get() == NULL)
     {
-        for(int j = 0;j < legendHeight;j++)
-        {
-            legend(i,j)->Alpha = 0;
-            legend(i,j)->Blue = 0;
-            legend(i,j)->Green = 0;
-            legend(i,j)->Red = 0;
-        }
+        //make bitmap, wx model name, date then time
+        BMP legend;
+        double yFractions[3] = {0.10, 0.40, 0.70};
+        DrawTextLegend(legend, 285, 78, lines, yFractions, 3);
+        timeDateLegendData = CacheLegend(legendKey, legend);
     }
 
-    //for white text
-    RGBApixel white;
-    white.Red = 255;
-    white.Green = 255;
-    white.Blue = 255;
-    white.Alpha = 0;
-
-    int textHeight = 12;    //pixels- 10 for maximum speed of "999.99 - 555.55";
-                            //12 for normal double digits
-    int titleX, titleY;
-
-    double x;
-    double y;
-
-    //print wxModel name----------------------------------------------------
-    x = 0.05;
-    y = 0.10;
-
-    titleX = x * legendWidth;
-    titleY = y * legendHeight;
-
-    PrintString(legend,wxModelName.c_str(), titleX, titleY, textHeight, white);
-
-    //print date---------------------------------------------------------
-    x = 0.05;
-    y = 0.40;
-    titleX = x * legendWidth;
-    titleY = y * legendHeight;
-
-    std::ostringstream os;
-    boost::local_time::local_time_facet* timeOutputFacet;
-    timeOutputFacet = new boost::local_time::local_time_facet();
-    //NOTE: WEIRD ISSUE WITH THE ABOVE 2 LINES OF CODE!  DO NOT CALL DELETE ON THIS BECAUSE THE LOCALE OBJECT BELOW DOES.
-    //      THIS IS A "PROBLEM" IN THE STANDARD LIBRARY. SEE THESE WEB SITES FOR MORE INFO:
-    //      https://collab.firelab.org/software/projects/windninja/wiki/KnownIssues
-    //      http://rhubbarb.wordpress.com/2009/10/17/boost-datetime-locales-and-facets/#comment-203
-
-
-
-    os.imbue(std::locale(std::locale::classic(), timeOutputFacet));
-    timeOutputFacet->format("%A, %B %d, %Y");
-
-    os << kmlTime;
-
-    PrintString(legend,os.str().c_str(), titleX, titleY, textHeight, white);
-
-    //print time---------------------------------------------------------
-    x = 0.05;
-    y = 0.70;
-
-    titleX = x * legendWidth;
-    titleY = y * legendHeight;
-
-    os.str("");
-    //timeOutputFacet->format("%H:%M %z (%Q from UTC)");
-    timeOutputFacet->format("%H:%M %z (");
-    os << kmlTime;
-
-    std::string timeStringLegend(os.str());
-
-    boost::posix_time::time_facet* timeOutputFacet2;
-    timeOutputFacet2 = new boost::posix_time::time_facet();
-    //NOTE: WEIRD ISSUE WITH THE ABOVE 2 LINES OF CODE!  DO NOT CALL DELETE ON THIS BECAUSE THE LOCALE OBJECT BELOW DOES.
-    //      THIS IS A "PROBLEM" IN THE STANDARD LIBRARY. SEE THESE WEB SITES FOR MORE INFO:
-    //      https://collab.firelab.org/software/projects/windninja/wiki/KnownIssues
-    //      http://rhubbarb.wordpress.com/2009/10/17/boost-datetime-locales-and-facets/#comment-203
-
-    os.imbue(std::locale(std::locale::classic(), timeOutputFacet2));
-
-    os.str("");
-    timeOutputFacet2->format("%H:%M UTC)");
-    os << kmlTime.utc_time();
-
-    timeStringLegend.append(os.str());
-
-    PrintString(legend,timeStringLegend.c_str(), titleX, titleY, textHeight, white);
-
-
-    legend.WriteToFile(timeDateLegendFile.c_str());
-
-    //printf("\n\nfileOut in writeScreenOverlayLegend = %x\n", fileOut);
-
     std::string shortName;
     shortName = CPLGetFilename(timeDateLegendFile.c_str());
 
@@ -1170,37 +1173,94 @@ bool KmlVector::writeDust(FILE *fileOut)
 }
 #endif
 
+/**
+ * Write one placemark per cell.  Rows are formatted into separate string
+ * buffers in parallel, a block of rows per task, and the buffers are
+ * written in row order.
+ */
 bool KmlVector::writeVectors(VSILFILE *fileOut)
 {
-	//int b, g, y, o, r;
-	//b = g = y = o = r = 0;
+	int nR = spd.get_nRows();
+	int nRowsPerBlock = 16;
+	int nBlocks = (nR + nRowsPerBlock - 1) / nRowsPerBlock;
 
+	int nThreads = 1;
+#ifdef _OPENMP
+	nThreads = omp_get_max_threads();
+#endif
+	/*
+	** The coordinate transformations are created up front, one per thread,
+	** as OGRCoordinateTransformation may not be shared between threads.
+	*/
+	std::vector<OGRCoordinateTransformation*> apoCT(nThreads, (OGRCoordinateTransformation*)NULL);
+	apoCT[0] = coordTransform;
+	for(int t = 1;t < nThreads;t++)
+		apoCT[t] = OGRCreateCoordinateTransformation(&oSourceSRS, &oTargetSRS);
+
+	//format a few blocks per thread at a time to bound memory use
+	int nBlocksPerPass = 4 * nThreads;
+	std::vector<std::string> blocks(nBlocksPerPass);
+	for(int firstBlock = 0;firstBlock < nBlocks;firstBlock += nBlocksPerPass)
+	{
+		int nPassBlocks = std::min(nBlocksPerPass, nBlocks - firstBlock);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for(int b = 0;b < nPassBlocks;b++)
+		{
+			int t = 0;
+#ifdef _OPENMP
+			t = omp_get_thread_num();
+#endif
+			int firstRow = (firstBlock + b) * nRowsPerBlock;
+			int lastRow = std::min(firstRow + nRowsPerBlock, nR);
+			blocks[b].clear();
+			formatVectorRows(firstRow, lastRow,
+			                 apoCT[t] != NULL ? apoCT[t] : coordTransform,
+			                 blocks[b]);
+		}
+
+		for(int b = 0;b < nPassBlocks;b++)
+		{
+			if(!blocks[b].empty())
+				VSIFWriteL(blocks[b].c_str(), 1, blocks[b].size(), fileOut);
+		}
+	}
+
+	for(int t = 1;t < nThreads;t++)
+	{
+		if(apoCT[t] != NULL)
+			OCTDestroyCoordinateTransformation(apoCT[t]);
+	}
+
+	return true;
+}
+
+/**
+ * Format the placemarks for rows [firstRow, lastRow) and append them to out.
+ */
+void KmlVector::formatVectorRows(int firstRow, int lastRow,
+                                 OGRCoordinateTransformation *poCT, std::string &out)
+{
 	double xPoint, yPoint;
 	double xCenter, yCenter;
 	double xTip, yTip, xTail, yTail, xHeadLeft, xHeadRight, yHeadLeft, yHeadRight;
-	double theta;
+	double theta, cellTheta;
 	double yScale = 0.5;
 	double xScale = yScale * 0.4;
 	double s = 0;
-	//double d = 0;
 	double cSize;
-	int nR;
 	int nC;
 
 	cSize = spd.get_cellSize();
-	nR = spd.get_nRows();
 	nC = spd.get_nCols();
 
-
-	//double PI = acos(-1.0);
-	geTheta = 0;
-	for(int i = 0;i < nR;i++)
+	for(int i = firstRow;i < lastRow;i++)
 	{
 		for(int j = 0;j < nC;j++)
 		{
 			yScale = 0.5;
 			s = spd(i,j);
-			geTheta = dir(i,j);
+			cellTheta = dir(i,j);
 			theta = dir(i,j) + 180.0;
 
 			if(s <= splitValue[1])
@@ -1215,9 +1275,6 @@ bool KmlVector::writeVectors(VSILFILE *fileOut)
 
 			spd.get_cellPosition(i, j, &xCenter, &yCenter);
 
-			//xCenter = (cSize / 2.0) + (j * cSize + spd.get_xllCorner());
-			//yCenter = (cSize / 2.0) + ((nR - i - 1) * cSize) + spd.get_yllCorner();
-
 			if(theta > 360)
 			{
 				theta -= 360;
@@ -1270,175 +1327,166 @@ bool KmlVector::writeVectors(VSILFILE *fileOut)
 			    xHeadLeft += xCenter;
 			    yHeadLeft += yCenter;
 			}
-			coordTransform->Transform(1, &xTip, &yTip);
-			coordTransform->Transform(1, &xTail, &yTail);
-			coordTransform->Transform(1, &xHeadRight, &yHeadRight);
-			coordTransform->Transform(1, &xHeadLeft, &yHeadLeft);
+			poCT->Transform(1, &xTip, &yTip);
+			poCT->Transform(1, &xTail, &yTail);
+			poCT->Transform(1, &xHeadRight, &yHeadRight);
+			poCT->Transform(1, &xHeadLeft, &yHeadLeft);
 
 			if(s != spd.get_noDataValue() && theta != dir.get_noDataValue())
 			{
-                VSIFPrintfL(fileOut, "<Placemark>");
-				//fprintf(fileOut, "\n<Icon><href>ffs_icon.ico</href></Icon>");
-				VSIFPrintfL(fileOut, "\n\t<name>Cell %d,%d</name>", i, j);
-				//fprintf(fileOut, "\n\t<description>Speed= %lf mph,Angle= %lf deg</description>", s, theta);
-				VSIFPrintfL(fileOut, "\n\t<ExtendedData>");
-				VSIFPrintfL(fileOut, "\n\t\t<Data name=\"Speed\">");
-				VSIFPrintfL(fileOut, "\n\t\t\t<value>%lf</value>", s);
-				VSIFPrintfL(fileOut, "\n\t\t</Data>");
-				VSIFPrintfL(fileOut, "\n\t\t<Data name=\"Angle\">");
-				VSIFPrintfL(fileOut, "\n\t\t\t<value>%lf</value>", geTheta);
-				VSIFPrintfL(fileOut, "\n\t\t</Data>");
-				VSIFPrintfL(fileOut, "\n\t</ExtendedData>");
-				VSIFPrintfL(fileOut, "\n\t<styleUrl>");
+				out += "<Placemark>";
+				out += CPLSPrintf("\n\t<name>Cell %d,%d</name>", i, j);
+				out += "\n\t<ExtendedData>";
+				out += "\n\t\t<Data name=\"Speed\">";
+				out += CPLSPrintf("\n\t\t\t<value>%lf</value>", s);
+				out += "\n\t\t</Data>";
+				out += "\n\t\t<Data name=\"Angle\">";
+				out += CPLSPrintf("\n\t\t\t<value>%lf</value>", cellTheta);
+				out += "\n\t\t</Data>";
+				out += "\n\t</ExtendedData>";
+				out += "\n\t<styleUrl>";
 				if(s <= splitValue[1])
-				{
-					VSIFPrintfL(fileOut, "#blue");
-					//b++;
-				}
+					out += "#blue";
 				else if(s <= splitValue[2])
-				{
-					VSIFPrintfL(fileOut, "#green");
-					//g++;
-				}
+					out += "#green";
 				else if(s <= splitValue[3])
-				{
-					VSIFPrintfL(fileOut, "#yellow");
-					//y++;
-				}
+					out += "#yellow";
 				else if(s <= splitValue[4])
-				{
-					VSIFPrintfL(fileOut, "#orange");
-					//o++;
-				}
+					out += "#orange";
 				else
-				{
-					VSIFPrintfL(fileOut, "#red");
-					//r++;
-				}
-				VSIFPrintfL(fileOut, "</styleUrl>");
+					out += "#red";
+				out += "</styleUrl>";
 
+				out += "\n\t<LineString>";
+				out += "\n\t<extrude>0</extrude>";
+				out += "\n\t<altitudeMode>relativeToGround</altitudeMode>";
+				out += "\n\t<coordinates>\n";
 				if( areEqual( s, 0.0 ) ) {
-                    VSIFPrintfL(fileOut, "\n\t<LineString>");
-				    VSIFPrintfL(fileOut, "\n\t<extrude>0</extrude>");
-				    VSIFPrintfL(fileOut, "\n\t<altitudeMode>relativeToGround</altitudeMode>");
-				    VSIFPrintfL(fileOut, "\n\t<coordinates>\n");
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xTail, yTail, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n",xHeadRight, yHeadRight, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xHeadLeft, yHeadLeft, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t</coordinates>\n");
-				    VSIFPrintfL(fileOut, "\t</LineString>\n");
-				    VSIFPrintfL(fileOut, "</Placemark>\n");
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xTail, yTail, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xHeadRight, yHeadRight, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xHeadLeft, yHeadLeft, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
 				}
 				else {
-                    VSIFPrintfL(fileOut, "\n\t<LineString>");
-				    VSIFPrintfL(fileOut, "\n\t<extrude>0</extrude>");
-				    VSIFPrintfL(fileOut, "\n\t<altitudeMode>relativeToGround</altitudeMode>");
-				    VSIFPrintfL(fileOut, "\n\t<coordinates>\n");
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n",xHeadRight, yHeadRight, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n",xTip, yTip, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xHeadLeft, yHeadLeft, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t\t%.10lf,%.10lf,%lf\n", xTail, yTail, (cSize / 8));
-				    VSIFPrintfL(fileOut, "\t</coordinates>\n");
-				    VSIFPrintfL(fileOut, "\t</LineString>\n");
-				    VSIFPrintfL(fileOut, "</Placemark>\n");
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xHeadRight, yHeadRight, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xHeadLeft, yHeadLeft, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xTip, yTip, (cSize / 8));
+				    out += CPLSPrintf("\t\t%.10lf,%.10lf,%lf\n", xTail, yTail, (cSize / 8));
 				}
+				out += "\t</coordinates>\n";
+				out += "\t</LineString>\n";
+				out += "</Placemark>\n";
 			}
 		}
 	}
-	//std::cout << endl << r << endl << o << endl << y << endl << g << endl << b << endl;
+}
 
-	return true;
+/*
+** Add one member to an open zip archive, in chunks as CPLWriteFileInZip()
+** takes an int size.
+*/
+static bool WriteZipMember(void *hZip, const std::string &name,
+                           const GByte *pabyData, vsi_l_offset nSize)
+{
+  if(CPLCreateFileInZip(hZip, name.c_str(), NULL) != CE_None)
+    return false;
+
+  const vsi_l_offset nChunk = 64 * 1024 * 1024;
+  bool ok = true;
+  for(vsi_l_offset nOffset = 0; nOffset < nSize && ok; nOffset += nChunk)
+  {
+    int nToWrite = (int)std::min(nChunk, nSize - nOffset);
+    ok = CPLWriteFileInZip(hZip, pabyData + nOffset, nToWrite) == CE_None;
+  }
+  CPLCloseFileInZip(hZip);
+  return ok;
+}
+
+static bool WriteZipMemberFromFile(void *hZip, const std::string &name,
+                                   const std::string &file)
+{
+  VSILFILE *fin = VSIFOpenL(file.c_str(), "rb");
+  if(fin == NULL)
+    return false;
+  VSIFSeekL(fin, 0, SEEK_END);
+  vsi_l_offset offset = VSIFTellL(fin);
+  VSIRewindL(fin);
+  std::vector<GByte> data((size_t)offset);
+  if(offset > 0)
+    VSIFReadL(&data[0], offset, 1, fin);
+  VSIFCloseL(fin);
+
+  return WriteZipMember(hZip, name, data.empty() ? NULL : &data[0], offset);
 }
 
 /**
 *@brief Uses GDAL VSI to make .kmz files
+*
+* The kml document and the legends are copied from memory into one open
+* archive, so nothing is written to disk but the kmz.
 */
 bool KmlVector::makeKmz()
 {
-  std::string args;
+  /* Check for an existing archive */
+  if(CPLCheckForFile((char*)kmzFile.c_str(), NULL))
+  {
+      VSIUnlink(kmzFile.c_str());
+  }
+
+  void *hZip = CPLCreateZip(kmzFile.c_str(), NULL);
+  if(hZip == NULL)
+    return false;
 
-  std::vector<std::string>filesToZip;
-  std::vector<std::string>filesInZip;
+  bool ok = true;
 
-  filesToZip.push_back(kmlFile);
-  filesToZip.push_back(legendFile);
+  vsi_l_offset nKmlSize = 0;
+  GByte *pabyKml = NULL;
+  if(!kmlMemFile.empty())
+    pabyKml = VSIGetMemFileBuffer(kmlMemFile.c_str(), &nKmlSize, FALSE);
+  if(pabyKml == NULL)
+    ok = false;
+  else
+    ok = WriteZipMember(hZip, getShortName(kmlFile), pabyKml, nKmlSize);
 
-  filesInZip.push_back(getShortName(kmlFile));
-  filesInZip.push_back(getShortName(legendFile));
+  if(ok && legendData.get() != NULL && !legendData->empty())
+    ok = WriteZipMember(hZip, getShortName(legendFile),
+                        &(*legendData)[0], legendData->size());
 
   #ifdef FRICTION_VELOCITY
-  if(ustarFlag==1)
+  if(ok && ustarFlag==1)
   {
-      filesToZip.push_back(ustar_png);
-      filesToZip.push_back(ustar_legend);
-      filesInZip.push_back(getShortName(ustar_png));
-      filesInZip.push_back(getShortName(ustar_legend));
+      ok = WriteZipMemberFromFile(hZip, getShortName(ustar_png), ustar_png) &&
+           WriteZipMemberFromFile(hZip, getShortName(ustar_legend), ustar_legend);
   }
   #endif
 
   #ifdef EMISSIONS
-  if(dustFlag==1)
+  if(ok && dustFlag==1)
   {
-      filesToZip.push_back(dust_png);
-      filesToZip.push_back(dust_legend);
-      filesInZip.push_back(getShortName(dust_png));
-      filesInZip.push_back(getShortName(dust_legend));
+      ok = WriteZipMemberFromFile(hZip, getShortName(dust_png), dust_png) &&
+           WriteZipMemberFromFile(hZip, getShortName(dust_legend), dust_legend);
   }
   #endif
 
-  if(timeDateLegendFile != "")
-    {
-      filesToZip.push_back(timeDateLegendFile);
-      filesInZip.push_back(getShortName(timeDateLegendFile));
-    }
+  if(ok && timeDateLegendFile != "" && timeDateLegendData.get() != NULL &&
+     !timeDateLegendData->empty())
+    ok = WriteZipMember(hZip, getShortName(timeDateLegendFile),
+                        &(*timeDateLegendData)[0], timeDateLegendData->size());
 
-  /* Check for an existing archive */
-  if(CPLCheckForFile((char*)kmzFile.c_str(), NULL))
-  {
-      VSIUnlink(kmzFile.c_str());
-  }
-
-
-  for(int x=0; x<filesToZip.size(); x++)
-  {
-    VSILFILE *fin;
-    VSILFILE *fout;
-
-    fin = VSIFOpenL(filesToZip[x].c_str(), "r");
-    vsi_l_offset offset;
-    VSIFSeekL(fin, 0, SEEK_END);
-    offset = VSIFTellL(fin);
-
-    VSIRewindL(fin);
-    char *data = (char*)CPLMalloc(offset * sizeof(char));
-    VSIFReadL(data, offset, 1, fin);
-    VSIFCloseL(fin);
+  CPLCloseZip(hZip);
 
-    std::string archive = "/vsizip/";
-    archive.append(kmzFile);
-    archive.append("/");
-    archive.append(filesInZip[x]);
-
-    fout = VSIFOpenL(archive.c_str(), "w");
-    VSIFWriteL(data, offset, 1, fout);
-    VSIFCloseL(fout);
-
-    CPLFree(data);
-
-  }
-
-  return true;
+  return ok;
 }
 bool KmlVector::removeKmlFile()
 {
 
-    VSIUnlink(kmlFile.c_str());
-    VSIUnlink(legendFile.c_str());
-    if(timeDateLegendFile != "")
-        VSIUnlink(timeDateLegendFile.c_str());
+    if(!kmlMemFile.empty())
+    {
+        VSIUnlink(kmlMemFile.c_str());
+        kmlMemFile = "";
+    }
     
     #ifdef FRICTION_VELOCITY
     if(ustar_png.c_str() != ""){
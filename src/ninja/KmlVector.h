@@ -64,6 +64,12 @@
 //#include <process.h>
 #include <stdio.h>
 #include <fstream>
+#include <vector>
+#include <map>
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#endif
 
 static const double PI = std::acos(-1.0);
 
@@ -119,6 +125,8 @@ public:
 	bool writeScreenOverlayDateTimeLegendWxModelRun(FILE *fileOut);
 
 	bool writeVectors(FILE *fileOut);
+	void formatVectorRows(int firstRow, int lastRow,
+	                      OGRCoordinateTransformation *poCT, std::string &out);
 	#ifdef FRICTION_VELOCITY
 	bool writeUstar(FILE *fileOut);
 	#endif
@@ -149,6 +157,8 @@ public:
 
 	std::string getShortName(std::string file);
 
+	static void ClearLegendCache();
+
 	//bool readPrjFile();
 	bool setProj4(std::string prj);
 
@@ -165,6 +175,7 @@ private:
 	velocityUnits::eVelocityUnits speedUnits;
 	std::string inputDirFile;
 	std::string kmlFile;
+	std::string kmlMemFile;
 	std::string kmzFile;
 	std::string legendFile;
 	std::string timeDateLegendFile;
@@ -185,8 +196,6 @@ private:
     boost::local_time::local_date_time kmlTime;
     boost::local_time::local_date_time wxModelStartTime;
 
-	double geTheta;
-
 	static const int numColors = 5;
 
 	double *splitValue;
@@ -194,6 +203,20 @@ private:
 	double northExtent, eastExtent, southExtent, westExtent;
 	double lineWidth;
 
+	VSILFILE* openKmlBuffer();
+
+	/*
+	** Rendered legend bitmaps, shared between all runs in the process that
+	** draw the same legend text.
+	*/
+	typedef boost::shared_ptr<std::vector<GByte> > legendBuffer;
+	legendBuffer legendData;
+	legendBuffer timeDateLegendData;
+
+	static legendBuffer GetCachedLegend(std::string const &key);
+	static legendBuffer CacheLegend(std::string const &key, BMP &legend);
+	static std::map<std::string, legendBuffer> oLegendCache;
+
 };
 
 #endif	//KMLVECTOR_H
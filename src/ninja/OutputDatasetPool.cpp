@@ -0,0 +1,271 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Collect per-run output bands and assemble multi-band rasters
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "OutputDatasetPool.h"
+
+#include <stdexcept>
+
+#ifndef Q_MOC_RUN
+#include "boost/date_time/posix_time/posix_time.hpp"
+#include "boost/lexical_cast.hpp"
+#endif
+
+OutputDatasetPool::OutputDatasetPool(int nRuns) : nRuns(nRuns)
+{
+}
+
+OutputDatasetPool::~OutputDatasetPool()
+{
+}
+
+/**
+ * Store one run's grid for the series osName.
+ * @param osName Name of the series, e.g. "spd" or "dir".
+ * @param nRun Run number, used to order the bands.
+ * @param osTime Time of the run, as written by boost::local_date_time.
+ * @param grid Grid to store.  Row 0 of an AsciiGrid is the south edge.
+ * @return true if this was the last band of the series, in which case the
+ *         caller is responsible for calling WriteGTiff().
+ */
+bool OutputDatasetPool::AddBand(const std::string &osName, int nRun,
+                                const std::string &osTime,
+                                AsciiGrid<double> const &grid)
+{
+    const int nXSize = grid.get_nCols();
+    const int nYSize = grid.get_nRows();
+
+    outputBand oBand;
+    oBand.osTime = osTime;
+    oBand.padfData.reset(new std::vector<double>((size_t)nXSize * nYSize));
+    double *padfData = &(*oBand.padfData)[0];
+    for(int i = 0; i < nYSize; i++)
+    {
+        for(int j = 0; j < nXSize; j++)
+        {
+            padfData[(size_t)i * nXSize + j] = grid.get_cellValue(nYSize - 1 - i, j);
+        }
+    }
+
+    bool bComplete = false;
+    std::string osError;
+#pragma omp critical(outputDatasetPool)
+    {
+        std::map<std::string, outputSeries>::iterator it = oSeries.find(osName);
+        if(it == oSeries.end())
+        {
+            outputSeries oNew;
+            oNew.nXSize = nXSize;
+            oNew.nYSize = nYSize;
+            oNew.adfGeoTransform[0] = grid.get_xllCorner();
+            oNew.adfGeoTransform[1] = grid.get_cellSize();
+            oNew.adfGeoTransform[2] = 0;
+            oNew.adfGeoTransform[3] = grid.get_yllCorner() + nYSize * grid.get_cellSize();
+            oNew.adfGeoTransform[4] = 0;
+            oNew.adfGeoTransform[5] = -grid.get_cellSize();
+            oNew.osPrj = grid.prjString;
+            it = oSeries.insert(std::make_pair(osName, oNew)).first;
+        }
+        if(it->second.nXSize != nXSize || it->second.nYSize != nYSize)
+            osError = "OutputDatasetPool: grid size differs between runs for " + osName;
+        else if(!it->second.oBands.insert(std::make_pair(nRun, oBand)).second)
+            osError = "OutputDatasetPool: duplicate run number for " + osName;
+        else
+            bComplete = (int)it->second.oBands.size() == nRuns;
+    }
+    if(!osError.empty())
+        throw std::logic_error(osError);
+
+    return bComplete;
+}
+
+/**
+ * Write a completed series to a GeoTIFF, one band per run, and release it.
+ * @param osName Name of the series passed to AddBand().
+ * @param osFilename Output filename, unless one was set with SetFilename().
+ * @return true on success.
+ */
+bool OutputDatasetPool::WriteGTiff(const std::string &osName,
+                                   const std::string &osFilename)
+{
+    std::string osFile(osFilename);
+#pragma omp critical(outputDatasetPool)
+    {
+        std::map<std::string, std::string>::iterator it = oFilenames.find(osName);
+        if(it != oFilenames.end())
+            osFile = it->second;
+    }
+    return WriteSeries(osName, osFile, true);
+}
+
+/**
+ * Set the file a series is written to, whichever run completes it.
+ * @param osName Name of the series, e.g. "spd" or "dir".
+ * @param osFilename Output filename.
+ */
+void OutputDatasetPool::SetFilename(const std::string &osName,
+                                    const std::string &osFilename)
+{
+#pragma omp critical(outputDatasetPool)
+    {
+        oFilenames[osName] = osFilename;
+    }
+}
+
+/**
+ * Write every series that is still collecting bands, with the bands it has,
+ * to the file set with SetFilename().  Used when some runs of the army
+ * failed, completed series have already been written.
+ * @return true if all incomplete series were written.
+ */
+bool OutputDatasetPool::Flush()
+{
+    std::vector<std::pair<std::string, std::string> > aoFiles;
+#pragma omp critical(outputDatasetPool)
+    {
+        std::map<std::string, outputSeries>::iterator it = oSeries.begin();
+        for(; it != oSeries.end(); ++it)
+        {
+            std::map<std::string, std::string>::iterator itFile =
+                oFilenames.find(it->first);
+            if(itFile != oFilenames.end())
+                aoFiles.push_back(*itFile);
+        }
+    }
+    bool bOk = true;
+    for(unsigned int i = 0; i < aoFiles.size(); i++)
+    {
+        if(!WriteSeries(aoFiles[i].first, aoFiles[i].second, false))
+            bOk = false;
+    }
+    return bOk;
+}
+
+/*
+** Write the bands of a series and release it.  Unless bComplete is false,
+** only a series holding a band for every run is written.
+*/
+bool OutputDatasetPool::WriteSeries(const std::string &osName,
+                                    const std::string &osFilename,
+                                    bool bComplete)
+{
+    outputSeries *poSeries = NULL;
+#pragma omp critical(outputDatasetPool)
+    {
+        std::map<std::string, outputSeries>::iterator it = oSeries.find(osName);
+        if(it != oSeries.end() && !it->second.oBands.empty() &&
+           (!bComplete || (int)it->second.oBands.size() == nRuns))
+            poSeries = &(it->second);
+    }
+    if(poSeries == NULL)
+        return false;
+
+    CPLSetConfigOption( "GDAL_CACHEMAX", "1024" );
+
+    GDALDriverH hMemDriver = GDALGetDriverByName( "MEM" );
+    GDALDatasetH hMemDS = GDALCreate(hMemDriver, "", poSeries->nXSize,
+                                     poSeries->nYSize, 0, GDT_Float64, NULL);
+    if(hMemDS == NULL)
+        return false;
+
+    GDALSetProjection(hMemDS, poSeries->osPrj.c_str());
+    GDALSetGeoTransform(hMemDS, poSeries->adfGeoTransform);
+
+    const std::string osStart = poSeries->oBands.begin()->second.osTime;
+    GDALSetMetadataItem(hMemDS, "TIFFTAG_DATETIME", osStart.c_str(), NULL);
+
+    bool bOk = true;
+    char szPointer[64];
+    std::map<int, outputBand>::iterator it = poSeries->oBands.begin();
+    for(; it != poSeries->oBands.end(); ++it)
+    {
+        memset(szPointer, 0, sizeof(szPointer));
+        CPLPrintPointer(szPointer, &(*it->second.padfData)[0], sizeof(szPointer));
+        char **papszBandOptions = CSLSetNameValue(NULL, "DATAPOINTER", szPointer);
+        CPLErr eErr = GDALAddBand(hMemDS, GDT_Float64, papszBandOptions);
+        CSLDestroy(papszBandOptions);
+        if(eErr != CE_None)
+        {
+            bOk = false;
+            break;
+        }
+
+        GDALRasterBandH hBand = GDALGetRasterBand(hMemDS, GDALGetRasterCount(hMemDS));
+        GDALSetRasterNoDataValue(hBand, -9999.0);
+
+        std::string h(boost::lexical_cast<std::string>(GetHourOffset(osStart, it->second.osTime)));
+        CPLDebug( "GTIFF", "offset in hours, DT = %s", h.c_str() );
+        GDALSetMetadataItem(hBand, "DT", h.c_str(), NULL); // offset in hours since first band
+    }
+
+    if(bOk)
+    {
+        char **papszOptions = NULL;
+        papszOptions = CSLAddString( papszOptions, "INTERLEAVE=BAND" );
+        papszOptions = CSLAddString( papszOptions, "BIGTIFF=YES" );
+        GDALDriverH hGtiffDriver = GDALGetDriverByName( "GTiff" );
+        GDALDatasetH hDstDS = GDALCreateCopy(hGtiffDriver, osFilename.c_str(),
+                                             hMemDS, FALSE, papszOptions, NULL, NULL);
+        CSLDestroy(papszOptions);
+        if(hDstDS == NULL)
+            bOk = false;
+        else
+            GDALClose(hDstDS);
+    }
+
+    /* the MEM bands only reference our buffers, close before releasing them */
+    GDALClose(hMemDS);
+
+#pragma omp critical(outputDatasetPool)
+    {
+        oSeries.erase(osName);
+    }
+
+    return bOk;
+}
+
+/*
+** Whole hours between two boost::local_date_time strings, ignoring the
+** trailing time zone abbreviation.
+*/
+int OutputDatasetPool::GetHourOffset(const std::string &osStart,
+                                     const std::string &osTime)
+{
+    std::string s(osTime);
+    std::string s0(osStart);
+
+    s.erase(s.length()-4); //get rid of tz
+    s0.erase(s0.length()-4); //get rid of tz
+
+    boost::posix_time::ptime t(boost::posix_time::time_from_string(s));
+    boost::posix_time::ptime t0(boost::posix_time::time_from_string(s0));
+
+    boost::posix_time::time_duration tdiff = t - t0;
+
+    return tdiff.hours();
+}
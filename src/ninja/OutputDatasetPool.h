@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Collect per-run output bands and assemble multi-band rasters
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef OUTPUT_DATASET_POOL_H
+#define OUTPUT_DATASET_POOL_H
+
+#include <string>
+#include <map>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "ascii_grid.h"
+
+#include "gdal.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+/**
+ * Collects the output grids of every run in an army so they can be written as
+ * one multi-band raster (one band per time step).
+ *
+ * Each run deposits its grids with AddBand().  The grid is copied once, north
+ * up, into a buffer owned by the pool, so runs never share a GDAL dataset and
+ * can deposit concurrently.  The run that deposits the last band of a series
+ * assembles it with WriteGTiff(): a band-less MEM dataset is created and each
+ * stored buffer is attached as a band with DATAPOINTER, so the data are not
+ * copied again before GDALCreateCopy().
+ *
+ * Bands are ordered by run number and tagged with DT, the offset in hours from
+ * the first band, regardless of the order the runs finish in.
+ *
+ * The army names the files of its series with SetFilename() before the runs
+ * start, so the name does not depend on which run finishes last.  If a run
+ * fails its series never complete, Flush() writes the bands collected so far.
+ */
+class OutputDatasetPool
+{
+public:
+    OutputDatasetPool(int nRuns);
+    ~OutputDatasetPool();
+
+    bool AddBand(const std::string &osName, int nRun, const std::string &osTime,
+                 AsciiGrid<double> const &grid);
+    bool WriteGTiff(const std::string &osName, const std::string &osFilename);
+    void SetFilename(const std::string &osName, const std::string &osFilename);
+    bool Flush();
+
+    inline int get_nRuns() const {return nRuns;}
+
+private:
+    OutputDatasetPool(OutputDatasetPool const &rhs);
+    OutputDatasetPool &operator=(OutputDatasetPool const &rhs);
+
+    /* One run's grid, stored north up */
+    struct outputBand
+    {
+        std::string osTime;
+        boost::shared_ptr<std::vector<double> > padfData;
+    };
+
+    /* All bands deposited for one output name (speed, direction, ...) */
+    struct outputSeries
+    {
+        int nXSize;
+        int nYSize;
+        double adfGeoTransform[6];
+        std::string osPrj;
+        std::map<int, outputBand> oBands;
+    };
+
+    static int GetHourOffset(const std::string &osStart, const std::string &osTime);
+    bool WriteSeries(const std::string &osName, const std::string &osFilename,
+                     bool bComplete);
+
+    int nRuns;
+    std::map<std::string, outputSeries> oSeries;
+    std::map<std::string, std::string> oFilenames;
+};
+
+#endif /* OUTPUT_DATASET_POOL_H */
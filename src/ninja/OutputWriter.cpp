@@ -52,9 +52,9 @@ OutputWriter::OutputWriter ()
     hDataSource   = NULL;
     hOGRDriver    = NULL;
     papszOptions  = NULL;
-    hSpdMemDs     = NULL;
-    hDirMemDs     = NULL;
-    hDustMemDs    = NULL;
+    datasetPool   = NULL;
+    runNumber     = 0;
+    maxRunNumber  = 0;
     hSrcSRS       = NULL;
     hDestSRS      = NULL;
     hTransform    = NULL;
@@ -191,15 +191,6 @@ OutputWriter::setDirGrid ( AsciiGrid<double> &d )
     return;
 }		/* -----  end of method OutputWriter::setDirGrid  ----- */
 
-void OutputWriter::setMemDs(GDALDatasetH hSpdMemDs, 
-              GDALDatasetH hDirMemDs, 
-              GDALDatasetH hDustMemDs)
-{
-    this->hSpdMemDs  = hSpdMemDs;
-    this->hDirMemDs  = hDirMemDs;
-    this->hDustMemDs = hDustMemDs;
-}
-
     bool
 OutputWriter::write (std::string outputFilename, std::string driver)
 {
@@ -218,28 +209,29 @@ OutputWriter::write (std::string outputFilename, std::string driver)
         for(int grid=0; grid<3; grid++){
             outFilename = outputFilename;
             if(grid == 0){
-                outFilename.insert(outFilename.find(".tif"), "_spd");
+                outFilename = GetGTiffFilename(outputFilename, "spd");
             }
             else if(grid == 1){
-                outFilename.insert(outFilename.find(".tif"), "_dir");
+                outFilename = GetGTiffFilename(outputFilename, "dir");
             }
 #ifdef EMISSIONS
             else if(grid == 2){
-                outFilename.insert(outFilename.find(".tif"), "_dust");
+                outFilename = GetGTiffFilename(outputFilename, "dust");
             }
 #endif
 
             if(outFilename.find("spd.tif") != outFilename.npos){
-                _writeGTiff(outFilename, hSpdMemDs);
+                _writeGTiff(outFilename, "spd", spd);
             }
             else if(outFilename.find("dir.tif") != outFilename.npos){
-                _writeGTiff(outFilename, hDirMemDs);
+                _writeGTiff(outFilename, "dir", dir);
             }
-            else if(outFilename.find("dust.tif") != outFilename.npos){
-                 _writeGTiff(outFilename, hDustMemDs);
+#ifdef EMISSIONS
+            else if(outFilename.find("dust.tif") != outFilename.npos &&
+                    dust.get_nCols() > 0){
+                 _writeGTiff(outFilename, "dust", dust);
             }
-
-           //_writeGTiff(outFilename);
+#endif
         }
     }
     else
@@ -747,213 +739,142 @@ OutputWriter::_writePDF (std::string outputfn)
     return true;
 }		/* -----  end of method OutputWriter::_writePDF  ----- */
 
-bool OutputWriter::_writeGTiff (std::string filename, GDALDatasetH &hMemDS)
+std::map<std::string, OutputWriter::pdfBasemapPtr> OutputWriter::oBasemapCache;
+
+OutputWriter::pdfBasemap::~pdfBasemap()
 {
-    CPLSetConfigOption( "GDAL_CACHEMAX", "1024" );
-    
-    int nXSize = spd.get_nCols();
-    int nYSize = spd.get_nRows();
-    
-    double *padfScanline;
-    padfScanline = new double[nXSize];
-    CPLErr eErr = CE_None;
-    
-    if(runNumber == 0)
-    {
-        /*------------------------------------------*/
-        /* Set dataset metadata                     */
-        /*------------------------------------------*/
-                  
-        adfGeoTransform[0] = spd.get_xllCorner();
-        adfGeoTransform[1] = spd.get_cellSize();
-        adfGeoTransform[2] = 0;
-        adfGeoTransform[3] = spd.get_yllCorner()+(spd.get_nRows()*spd.get_cellSize());
-        adfGeoTransform[4] = 0;
-        adfGeoTransform[5] = -spd.get_cellSize();
-        
-        char* pszDstWKT = (char*)spd.prjString.c_str();
-        GDALSetProjection(hMemDS, pszDstWKT);
-        GDALSetGeoTransform(hMemDS, adfGeoTransform);
-        
-        GDALSetMetadataItem(hMemDS, "TIFFTAG_DATETIME", ninjaTime.c_str(), NULL );
-        
-        GDALRasterBandH hBand = GDALGetRasterBand( hMemDS, 1 );
-        
-        GDALSetRasterNoDataValue(hBand, -9999.0);
-        GDALSetMetadataItem(hBand, "DT", "0", NULL ); // offset in hours
+    VSIUnlink( osFilename.c_str() );
+}
 
-        for(int i=nYSize-1; i>=0; i--)
-        {
-            for(int j=0; j<nXSize; j++)
-            {   
-                if(filename.find("spd.tif") != filename.npos){
-                    padfScanline[j] = spd.get_cellValue(nYSize-1-i, j);
-                }
-                else if(filename.find("dir.tif") != filename.npos){
-                    padfScanline[j] = dir.get_cellValue(nYSize-1-i, j);
-                }
-#ifdef EMISSIONS
-                else if(filename.find("dust.tif") != filename.npos){
-                    padfScanline[j] = dust.get_cellValue(nYSize-1-i, j);
-                }
-#endif
-                else{
-                    return false;
-                }
-                
-            }
-            eErr = GDALRasterIO(hBand, GF_Write, 0, i, nXSize, 1, padfScanline, nXSize,
-                                1, GDT_Float64, 0, 0);
-            assert( eErr == CE_None );
-        }
-    }
-    else if(runNumber < maxRunNumber){
-        /*------------------------------------------*/
-        /*  Add a new band                          */
-        /*------------------------------------------*/
-        
-        eErr = GDALAddBand(hMemDS, GDT_Float64, NULL);
-        if(eErr != 0){
-            return false;
-        }
-        
-        GDALRasterBandH hBand = GDALGetRasterBand( hMemDS, GDALGetRasterCount(hMemDS) );
-        
-        const char* startTime = GDALGetMetadataItem( hMemDS, "TIFFTAG_DATETIME", NULL );
-        
-        // calculate hours since startTime 
-        std::string s(ninjaTime);
-        std::string s0(startTime);
-        
-        s.erase(s.length()-4); //get rid of tz
-        s0.erase(s0.length()-4); //get rid of tz
-               
-        boost::posix_time::ptime t(boost::posix_time::time_from_string(s));
-        boost::posix_time::ptime t0(boost::posix_time::time_from_string(s0));
-        
-        boost::posix_time::time_duration tdiff = t - t0;
-        
-        int hdiff = tdiff.hours();
+/**
+ * Build the basemap cache key from the DEM file, extent and projection, the
+ * page size, the dpi and the base map type.  The file is identified by its
+ * name, size and modification time, so a DEM rewritten in place is not
+ * mistaken for the old one.  A DEM without a file is identified by the
+ * checksum of its band.
+ */
+std::string OutputWriter::BasemapCacheKey( GDALDatasetH hDem, double dfWidth,
+                                           double dfHeight, unsigned short nDPI,
+                                           int nBaseType )
+{
+    double adfGT[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    GDALGetGeoTransform( hDem, adfGT );
+    std::string osKey = CPLSPrintf( "%d,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,",
+                                    GDALGetRasterXSize( hDem ),
+                                    GDALGetRasterYSize( hDem ),
+                                    adfGT[0], adfGT[1], adfGT[2],
+                                    adfGT[3], adfGT[4], adfGT[5] );
+    osKey += CPLSPrintf( "%.17g,%.17g,%d,%d,", dfWidth, dfHeight, nDPI, nBaseType );
+    const char *pszDemFile = GDALGetDescription( hDem );
+    VSIStatBufL sStat;
+    if( VSIStatL( pszDemFile, &sStat ) == 0 )
+        osKey += CPLSPrintf( "%s,%lld,%lld,", pszDemFile,
+                             (long long)sStat.st_size, (long long)sStat.st_mtime );
+    else
+        osKey += CPLSPrintf( "%d,", GDALChecksumImage( GDALGetRasterBand( hDem, 1 ), 0, 0,
+                                                       GDALGetRasterXSize( hDem ),
+                                                       GDALGetRasterYSize( hDem ) ) );
+    osKey += GDALGetProjectionRef( hDem );
+    return osKey;
+}
 
-        std::string h(boost::lexical_cast<std::string>(hdiff));
-        
-        CPLDebug( "GTIFF", "offset in hours, DT = %s", h.c_str() );
-        
-        GDALSetRasterNoDataValue(hBand, -9999.0);
-        
-        GDALSetMetadataItem( hBand, "DT", h.c_str(), NULL ); // offset in hours since first band
+OutputWriter::pdfBasemapPtr OutputWriter::GetCachedBasemap( std::string const &key )
+{
+    pdfBasemapPtr basemap;
+#pragma omp critical(pdf_basemap_cache)
+    {
+        std::map<std::string, pdfBasemapPtr>::const_iterator it = oBasemapCache.find( key );
+        if( it != oBasemapCache.end() )
+            basemap = it->second;
+    }
+    return basemap;
+}
 
-        CPLErr eErr = CE_None;
-        for(int i=nYSize-1; i>=0; i--)
-        {
-            for(int j=0; j<nXSize; j++)
-            {
-                if(filename.find("spd.tif") != filename.npos){
-                    padfScanline[j] = spd.get_cellValue(nYSize-1-i, j);
-                }
-                else if(filename.find("dir.tif") != filename.npos){
-                    padfScanline[j] = dir.get_cellValue(nYSize-1-i, j);
-                }
-#ifdef EMISSIONS
-                else if(filename.find("dust.tif") != filename.npos){
-                    padfScanline[j] = dust.get_cellValue(nYSize-1-i, j);
-                }
-#endif
-                else{
-                    return false;
-                }
-            }
-            eErr = GDALRasterIO(hBand, GF_Write, 0, i, nXSize, 1, padfScanline, nXSize,
-                                1, GDT_Float64, 0, 0); 
-            assert( eErr == CE_None );
-        }
+/**
+ * Copy a prepared basemap into memory and keep it for later armies using the
+ * same DEM and page layout.  Returns an empty pointer if the copy fails.
+ */
+OutputWriter::pdfBasemapPtr OutputWriter::CacheBasemap( std::string const &key,
+                                                        const char *pszFile )
+{
+    pdfBasemapPtr basemap;
+    GDALDatasetH hSrc = GDALOpen( pszFile, GA_ReadOnly );
+    if( hSrc == NULL )
+        return basemap;
+
+    basemap.reset( new pdfBasemap );
+    basemap->osFilename = CPLSPrintf( "/vsimem/NinjaPdfBasemap_%p.tif", basemap.get() );
+
+    char **papszCopyOptions = NULL;
+    papszCopyOptions = CSLAddNameValue( papszCopyOptions, "TILED", "YES" );
+    GDALDatasetH hDst = GDALCreateCopy( GDALGetDriverByName( "GTiff" ),
+                                        basemap->osFilename.c_str(), hSrc,
+                                        FALSE, papszCopyOptions, NULL, NULL );
+    CSLDestroy( papszCopyOptions );
+    GDALClose( hSrc );
+    if( hDst == NULL )
+    {
+        basemap.reset();
+        return basemap;
     }
-    else{
-        /*------------------------------------------*/
-        /*  Write the tif to disk                   */
-        /*------------------------------------------*/
-        //get start time
-        const char* startTime = GDALGetMetadataItem(hMemDS, "TIFFTAG_DATETIME", NULL);
+    GDALClose( hDst );
 
-        eErr = GDALAddBand(hMemDS, GDT_Float64, NULL);
-        if(eErr != 0){
-            return false;
-        }
-        
-        //copy MEM to GTiff format
-        hDriver = GDALGetDriverByName( "GTiff" );
-
-        // write current grid to last band in hDstDS        
-        GDALRasterBandH hBand = GDALGetRasterBand( hMemDS, GDALGetRasterCount(hMemDS) );
-  
-        // calculate hours since startTime 
-        std::string s(ninjaTime);
-        std::string s0(startTime);
-        
-        s.erase(s.length()-4); //get rid of tz
-        s0.erase(s0.length()-4); //get rid of tz
-               
-        boost::posix_time::ptime t(boost::posix_time::time_from_string(s));
-        boost::posix_time::ptime t0(boost::posix_time::time_from_string(s0));
-        
-        boost::posix_time::time_duration tdiff = t - t0;
-        
-        int hdiff = tdiff.hours();
+#pragma omp critical(pdf_basemap_cache)
+    {
+        if( oBasemapCache.size() >= MAX_CACHED_BASEMAPS )
+            oBasemapCache.clear();
+        oBasemapCache[key] = basemap;
+    }
+    return basemap;
+}
 
-        std::string h(boost::lexical_cast<std::string>(hdiff));
-        
-        CPLDebug( "GTIFF", "offset in hours, DT = %s", h.c_str() );
-        
-        GDALSetRasterNoDataValue(hBand, -9999.0);
-        
-        GDALSetMetadataItem( hBand, "DT", h.c_str(), NULL ); // offset in hours since first band
+/**
+ * Drop the cached basemaps.  Armies still writing with one keep it alive.
+ */
+void OutputWriter::ClearBasemapCache()
+{
+#pragma omp critical(pdf_basemap_cache)
+    {
+        oBasemapCache.clear();
+    }
+}
 
-        CPLErr eErr;
+/**
+ * Name of the GeoTIFF written for one output grid.
+ * @param outputFilename GeoTIFF output filename set for the run.
+ * @param pszName Name of the grid, "spd", "dir" or "dust".
+ * @return the filename with _<name> added before the .tif extension.
+ */
+std::string OutputWriter::GetGTiffFilename(std::string const &outputFilename,
+                                           const char *pszName)
+{
+    std::string outFilename(outputFilename);
+    outFilename.insert(outFilename.find(".tif"), std::string("_") + pszName);
+    return outFilename;
+}
 
-        for(int i=nYSize-1; i>=0; i--)
-        {
-            for(int j=0; j<nXSize; j++)
-            {
-                if(filename.find("spd.tif") != filename.npos){
-                    padfScanline[j] = spd.get_cellValue(nYSize-1-i, j);
-                }
-                else if(filename.find("dir.tif") != filename.npos){
-                    padfScanline[j] = dir.get_cellValue(nYSize-1-i, j);
-                }
-#ifdef EMISSIONS
-                else if(filename.find("dust.tif") != filename.npos){
-                    padfScanline[j] = dust.get_cellValue(nYSize-1-i, j);
-                }
-#endif
-                else{
-                    return false;
-                }
-            }
-            eErr = GDALRasterIO(hBand, GF_Write, 0, i, nXSize, 1, padfScanline, nXSize,
-                                1, GDT_Float64, 0, 0); 
-            assert( eErr == CE_None );
-        }
-        
-        
-        GDALDriverH hGtiffDriver = GDALGetDriverByName( "GTiff" );
-        papszOptions = CSLAddString( papszOptions, "INTERLEAVE=BAND");	
-        papszOptions = CSLAddString( papszOptions, "BIGTIFF=YES" );        
-        hDstDS = GDALCreateCopy(hGtiffDriver, filename.c_str(), hMemDS, FALSE, papszOptions, NULL, NULL);
-        
-        //close MEM dataset
-        if( hMemDS != NULL ){
-            GDALClose( hMemDS );
-            hMemDS = NULL;
-        }
-    
-        //close GTiff dataset
-        if( hDstDS != NULL ){
-            GDALClose( hDstDS );
-            hDstDS = NULL;
-        }
+/*
+** Hand this run's grid to the army's dataset pool.  Runs deposit their bands
+** independently; the run that completes a series writes the multi-band
+** GeoTIFF.  Without a pool (single runs) a one band pool is used so the file
+** is written immediately.
+*/
+bool OutputWriter::_writeGTiff (std::string filename, const char *pszName,
+                                AsciiGrid<double> const &grid)
+{
+    OutputDatasetPool oSingleRunPool(1);
+    OutputDatasetPool *pool = datasetPool;
+    int nRun = runNumber;
+    if(pool == NULL)
+    {
+        pool = &oSingleRunPool;
+        nRun = 0;
     }
 
-    delete [] padfScanline;
+    if(pool->AddBand(pszName, nRun, ninjaTime, grid))
+    {
+        return pool->WriteGTiff(pszName, filename);
+    }
 
     return true;
 }
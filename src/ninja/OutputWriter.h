@@ -55,12 +55,16 @@
 #include "gdal.h"
 
 #include "gdal_util.h"
+#include "OutputDatasetPool.h"
 
 #ifndef Q_MOC_RUN
 #include "boost/date_time/local_time/local_time.hpp"
 #include "boost/date_time/posix_time/posix_time.hpp"
+#include <boost/shared_ptr.hpp>
 #endif
 
+#include <map>
+
 
 
 
@@ -94,15 +98,39 @@ class OutputWriter
         void setDPI( const unsigned short d );
         void setSize( const double w, const double h );
         
-        void setMemDs(GDALDatasetH hSpdMemDs, GDALDatasetH hDirMemDs, GDALDatasetH hDustMemDs);
+        void setDatasetPool(OutputDatasetPool *pool) {datasetPool=pool;}
 
         /* ====================  OPERATORS     ======================================= */
         bool write(std::string outputFilename, std::string driver);
 
+        static std::string GetGTiffFilename(std::string const &outputFilename,
+                                            const char *pszName);
+
         static const double BOTTOM_MARGIN;
         static const double TOP_MARGIN;
         static const double SIDE_MARGIN;
 
+        /*
+        ** A basemap prepared at final page resolution, held in /vsimem.  The
+        ** file is removed when the last army using it lets go.
+        */
+        struct pdfBasemap
+        {
+            std::string osFilename;
+            ~pdfBasemap();
+        };
+        typedef boost::shared_ptr<pdfBasemap> pdfBasemapPtr;
+
+        static std::string BasemapCacheKey(GDALDatasetH hDem, double dfWidth,
+                                           double dfHeight, unsigned short nDPI,
+                                           int nBaseType);
+        static pdfBasemapPtr GetCachedBasemap(std::string const &key);
+        static pdfBasemapPtr CacheBasemap(std::string const &key, const char *pszFile);
+        static void ClearBasemapCache();
+
+        /* Number of basemaps kept before the cache is flushed */
+        static const unsigned int MAX_CACHED_BASEMAPS = 4;
+
     protected:
         /* ====================  METHODS       ======================================= */
 
@@ -114,7 +142,8 @@ class OutputWriter
         void _destroyDefaultStyles();
 
         bool _writePDF(std::string outputfn);
-        bool _writeGTiff(std::string filename, GDALDatasetH &hMemDs);
+        bool _writeGTiff(std::string filename, const char *pszName,
+                         AsciiGrid<double> const &grid);
         std::string _getStyleFromSpeed( const double & spd );
         void _openSrcDataSet();
         void _closeDataSets();
@@ -143,9 +172,7 @@ class OutputWriter
 #endif
         int runNumber;
         int maxRunNumber;
-        GDALDatasetH hSpdMemDs;
-        GDALDatasetH hDirMemDs;
-        GDALDatasetH hDustMemDs;
+        OutputDatasetPool *datasetPool;
         
         std::string ninjaTime;
         double resolution;
@@ -195,7 +222,8 @@ class OutputWriter
         OGRFieldDefnH hFieldDefn;
         
         double adfGeoTransform[6];
-        
+
+        static std::map<std::string, pdfBasemapPtr> oBasemapCache;
 
 }; /* -----  end of class OutputWriter  ----- */
 
@@ -0,0 +1,229 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Precomputed inverse distance weights from points onto a grid
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "PointInterpolationPlan.h"
+
+PointInterpolationPlan::PointInterpolationPlan()
+    : nCols(0), nRows(0), xllCorner(0.0), yllCorner(0.0), cellSize(0.0),
+      nCells(0), power(0.0)
+{
+
+}
+
+PointInterpolationPlan::~PointInterpolationPlan()
+{
+
+}
+
+/**
+ * @brief Compute the contributing points and weights of every cell.
+ *
+ * @param grid Grid that will be interpolated onto.
+ * @param X x coordinates of the points.
+ * @param Y y coordinates of the points.
+ * @param influenceRadius Maximum interpolation distance of each point, less
+ *                        than zero for an infinite radius.
+ * @param numPoints Number of points.
+ * @param interpDistPower Power used for the distance weighting.
+ * @throws std::out_of_range for a bad power or point count.
+ */
+void PointInterpolationPlan::build(AsciiGrid<double> const &grid, const double *X, const double *Y,
+                                   const double *influenceRadius, int numPoints, double interpDistPower)
+{
+    if(interpDistPower <= 0)
+        throw std::out_of_range("interpDistPower in PointInterpolationPlan::build() must be greater than 0.");
+    if(numPoints <= 0)
+        throw std::out_of_range("numPoints in PointInterpolationPlan::build() must be greater than 0.");
+
+    nCols = grid.get_nCols();
+    nRows = grid.get_nRows();
+    xllCorner = grid.get_xllCorner();
+    yllCorner = grid.get_yllCorner();
+    cellSize = grid.get_cellSize();
+    nCells = nCols * nRows;
+    power = interpDistPower;
+    adfX.assign(X, X + numPoints);
+    adfY.assign(Y, Y + numPoints);
+    adfRadius.assign(influenceRadius, influenceRadius + numPoints);
+
+    /* first pass counts the points of each cell, second pass fills them */
+    anCellStart.assign(nCells + 1, 0);
+    int n;
+#pragma omp parallel for default(shared) private(n)
+    for(n = 0; n < nCells; n++)
+    {
+        const double xC = (cellSize / 2.0) + ((n % nCols) * cellSize) + xllCorner;
+        const double yC = (cellSize / 2.0) + ((n / nCols) * cellSize) + yllCorner;
+        int count = 0;
+        for(int k = 0; k < numPoints; k++)
+        {
+            const double distance = std::sqrt((xC-X[k])*(xC-X[k]) + (yC-Y[k])*(yC-Y[k]));
+            if(influenceRadius[k] < 0.0 || distance <= influenceRadius[k])
+                count++;
+        }
+        anCellStart[n + 1] = count;
+    }
+    for(n = 0; n < nCells; n++)
+        anCellStart[n + 1] += anCellStart[n];
+
+    anPoint.resize(anCellStart[nCells]);
+    adfWeight.resize(anCellStart[nCells]);
+#pragma omp parallel for default(shared) private(n)
+    for(n = 0; n < nCells; n++)
+    {
+        const double xC = (cellSize / 2.0) + ((n % nCols) * cellSize) + xllCorner;
+        const double yC = (cellSize / 2.0) + ((n / nCols) * cellSize) + yllCorner;
+        int e = anCellStart[n];
+        for(int k = 0; k < numPoints; k++)
+        {
+            const double distance = std::sqrt((xC-X[k])*(xC-X[k]) + (yC-Y[k])*(yC-Y[k]));
+            if(influenceRadius[k] >= 0.0 && distance > influenceRadius[k])
+                continue;
+            anPoint[e] = k;
+            adfWeight[e] = 1.0/std::pow(distance, interpDistPower);
+            e++;
+        }
+    }
+
+    /* transpose for the points with a finite radius */
+    anPointStart.assign(numPoints + 1, 0);
+    for(int e = 0; e < (int)anPoint.size(); e++)
+    {
+        if(adfRadius[anPoint[e]] >= 0.0)
+            anPointStart[anPoint[e] + 1]++;
+    }
+    for(int k = 0; k < numPoints; k++)
+        anPointStart[k + 1] += anPointStart[k];
+
+    anCell.resize(anPointStart[numPoints]);
+    std::vector<int> anNext(anPointStart.begin(), anPointStart.end() - 1);
+    for(n = 0; n < nCells; n++)
+    {
+        for(int e = anCellStart[n]; e < anCellStart[n + 1]; e++)
+        {
+            if(adfRadius[anPoint[e]] >= 0.0)
+                anCell[anNext[anPoint[e]]++] = n;
+        }
+    }
+}
+
+/**
+ * @brief Check that a plan was built for this grid geometry and these points.
+ */
+bool PointInterpolationPlan::matches(AsciiGrid<double> const &grid, const double *X, const double *Y,
+                                     const double *influenceRadius, int numPoints, double interpDistPower) const
+{
+    if(nCells == 0 || numPoints != (int)adfX.size() || interpDistPower != power ||
+       grid.get_nCols() != nCols || grid.get_nRows() != nRows ||
+       grid.get_xllCorner() != xllCorner || grid.get_yllCorner() != yllCorner ||
+       grid.get_cellSize() != cellSize)
+        return false;
+    for(int k = 0; k < numPoints; k++)
+    {
+        if(X[k] != adfX[k] || Y[k] != adfY[k] || influenceRadius[k] != adfRadius[k])
+            return false;
+    }
+    return true;
+}
+
+double PointInterpolationPlan::interpolateCell(const double *pointData, int n) const
+{
+    double value = 0.0;
+    double weight_sum = 0.0;
+    for(int e = anCellStart[n]; e < anCellStart[n + 1]; e++)
+    {
+        weight_sum = weight_sum + adfWeight[e];
+        value = value + pointData[anPoint[e]] * adfWeight[e];
+    }
+    return value / weight_sum;
+}
+
+/**
+ * @brief Interpolate point values onto every cell of the grid.
+ *
+ * Cells that no point reaches are set to the grid's no data value.
+ *
+ * @param pointData Value at each point.
+ * @param grid Grid to fill, with the plan's geometry.
+ */
+void PointInterpolationPlan::apply(const double *pointData, AsciiGrid<double> &grid) const
+{
+    double *data = grid.data.get_dataPointer();
+    const double noData = grid.data.getNoDataValue();
+    int n;
+#pragma omp parallel for default(shared) private(n)
+    for(n = 0; n < nCells; n++)
+    {
+        if(anCellStart[n + 1] == anCellStart[n])
+            data[n] = noData;
+        else
+            data[n] = interpolateCell(pointData, n);
+    }
+}
+
+/**
+ * @brief Recompute only the cells reached by points whose value changed.
+ *
+ * The grid must hold the result of an earlier apply() or update() with this
+ * plan.  A changed point with an infinite radius updates every cell.
+ *
+ * @param pointData Value at each point.
+ * @param changedPoints Indices of the points whose value changed.
+ * @param grid Grid to update.
+ * @return Number of cells recomputed.
+ */
+int PointInterpolationPlan::update(const double *pointData, std::vector<int> const &changedPoints,
+                                   AsciiGrid<double> &grid) const
+{
+    std::vector<char> abChanged(nCells, 0);
+    for(unsigned int c = 0; c < changedPoints.size(); c++)
+    {
+        const int k = changedPoints[c];
+        if(adfRadius[k] < 0.0)
+        {
+            apply(pointData, grid);
+            return nCells;
+        }
+        for(int e = anPointStart[k]; e < anPointStart[k + 1]; e++)
+            abChanged[anCell[e]] = 1;
+    }
+
+    double *data = grid.data.get_dataPointer();
+    int nUpdated = 0;
+    int n;
+#pragma omp parallel for default(shared) private(n) reduction(+:nUpdated)
+    for(n = 0; n < nCells; n++)
+    {
+        if(!abChanged[n])
+            continue;
+        data[n] = interpolateCell(pointData, n);
+        nUpdated++;
+    }
+    return nUpdated;
+}
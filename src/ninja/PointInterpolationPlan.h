@@ -0,0 +1,102 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Precomputed inverse distance weights from points onto a grid
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef POINT_INTERPOLATION_PLAN_H
+#define POINT_INTERPOLATION_PLAN_H
+
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ascii_grid.h"
+
+/**
+ * Stores, for every cell of a grid, the points within their influence radius
+ * and their inverse distance weights.  The plan depends only on the grid
+ * geometry and the point locations and radii, so it can be applied to any
+ * number of point values (u, v, air temperature, cloud cover, ...).  The
+ * values produced are identical to AsciiGrid<T>::interpolateFromPoints().
+ *
+ * The plan also knows which cells each point reaches, so when only some
+ * point values change, update() recomputes just those cells.
+ */
+class PointInterpolationPlan
+{
+public:
+    PointInterpolationPlan();
+    ~PointInterpolationPlan();
+
+    void build(AsciiGrid<double> const &grid, const double *X, const double *Y,
+               const double *influenceRadius, int numPoints, double interpDistPower);
+
+    bool matches(AsciiGrid<double> const &grid, const double *X, const double *Y,
+                 const double *influenceRadius, int numPoints, double interpDistPower) const;
+
+    void apply(const double *pointData, AsciiGrid<double> &grid) const;
+    int update(const double *pointData, std::vector<int> const &changedPoints,
+               AsciiGrid<double> &grid) const;
+
+    inline int get_nCells() const {return nCells;}
+    inline int get_nPoints() const {return (int)adfX.size();}
+
+private:
+    double interpolateCell(const double *pointData, int n) const;
+
+    int nCols;
+    int nRows;
+    double xllCorner;
+    double yllCorner;
+    double cellSize;
+    int nCells;
+    double power;
+
+    std::vector<double> adfX;
+    std::vector<double> adfY;
+    std::vector<double> adfRadius;
+
+    /*
+    ** Points and weights of each cell, in point order so sums match
+    ** interpolateFromPoints(), cell n uses entries anCellStart[n] to
+    ** anCellStart[n+1].
+    */
+    std::vector<int> anCellStart;
+    std::vector<int> anPoint;
+    std::vector<double> adfWeight;
+
+    /*
+    ** Cells reached by each point with a finite influence radius.  Points
+    ** with an infinite radius reach every cell and are not listed.
+    */
+    std::vector<int> anPointStart;
+    std::vector<int> anCell;
+};
+
+#endif /* POINT_INTERPOLATION_PLAN_H */
@@ -0,0 +1,279 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Write sampled output points of an army in run order
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "PointOutputWriter.h"
+
+#include <algorithm>
+
+PointOutputWriter::PointOutputWriter(std::string const &filename, eFormat format)
+: osFilename(filename), format(format), fout(NULL), bClosed(false),
+  bWriting(false), nNextRun(0)
+{
+}
+
+PointOutputWriter::~PointOutputWriter()
+{
+    try
+    {
+        Close();
+    }
+    catch(std::exception &e)
+    {
+        CPLDebug("NINJA", "PointOutputWriter: %s", e.what());
+    }
+}
+
+/**
+ * Parse an output_points_format value.
+ */
+PointOutputWriter::eFormat PointOutputWriter::GetFormat(std::string const &format)
+{
+    if(EQUAL(format.c_str(), "csv"))
+        return csv;
+    else if(EQUAL(format.c_str(), "binary"))
+        return binary;
+    throw std::runtime_error("Point output format must be either csv or binary, not " + format + ".");
+}
+
+/**
+ * Set the point IDs and locations written with every run.  All runs of an
+ * army share the same points, so only the first call has an effect.
+ */
+void PointOutputWriter::SetPoints(std::vector<std::string> const &names,
+                                  std::vector<double> const &lat,
+                                  std::vector<double> const &lon,
+                                  std::vector<double> const &height)
+{
+#pragma omp critical(point_output_writer)
+    {
+        if(this->names.empty())
+        {
+            this->names = names;
+            this->lat = lat;
+            this->lon = lon;
+            this->height = height;
+        }
+    }
+}
+
+/**
+ * Queue one run's values and write every run that is ready, in order.  The
+ * run's values are moved out of run.
+ *
+ * Only the hand-off is done under the lock.  The thread that finds runs
+ * ready while nobody is writing takes them out of the queue and writes them
+ * after releasing it, then checks again for runs queued in the meantime.
+ */
+void PointOutputWriter::AddRun(int nRun, pointRun &run)
+{
+    bool bAdded = false;
+    std::vector<pointRun> oReady;
+#pragma omp critical(point_output_writer)
+    {
+        if(!bClosed)
+        {
+            pointRun &queued = oPending[nRun];
+            queued.osDateTime = run.osDateTime;
+            queued.dfTime = run.dfTime;
+            queued.columns.swap(run.columns);
+            queued.values.swap(run.values);
+            bAdded = true;
+            if(!bWriting)
+                TakeRuns(oReady, false);
+        }
+    }
+    if(!bAdded)
+        throw std::runtime_error("PointOutputWriter: run added after the file was closed");
+
+    while(!oReady.empty())
+    {
+        std::string osError;
+        try
+        {
+            for(unsigned int i = 0; i < oReady.size(); i++)
+                WriteRun(oReady[i]);
+        }
+        catch(std::exception &e)
+        {
+            osError = e.what();
+        }
+        oReady.clear();
+#pragma omp critical(point_output_writer)
+        {
+            bWriting = false;
+            if(osError.empty())
+                TakeRuns(oReady, false);
+        }
+        if(!osError.empty())
+            throw std::runtime_error(osError);
+    }
+}
+
+/**
+ * Write the runs still queued, in run number order, and close the file.
+ * Call once every run has been added.
+ */
+void PointOutputWriter::Close()
+{
+    std::vector<pointRun> oReady;
+#pragma omp critical(point_output_writer)
+    {
+        if(!bClosed)
+        {
+            bClosed = true;
+            TakeRuns(oReady, true);
+        }
+    }
+
+    std::string osError;
+    try
+    {
+        for(unsigned int i = 0; i < oReady.size(); i++)
+            WriteRun(oReady[i]);
+    }
+    catch(std::exception &e)
+    {
+        osError = e.what();
+    }
+    if(fout != NULL)
+    {
+        VSIFCloseL(fout);
+        fout = NULL;
+    }
+    if(!osError.empty())
+        throw std::runtime_error(osError);
+}
+
+/*
+** Move the queued runs that are next in order, or all of them, into
+** oReady and mark the file as being written if there are any.  Called with
+** the point_output_writer lock held.
+*/
+void PointOutputWriter::TakeRuns(std::vector<pointRun> &oReady, bool bAll)
+{
+    std::map<int, pointRun>::iterator it = oPending.begin();
+    while(it != oPending.end() && (bAll || it->first <= nNextRun))
+    {
+        oReady.push_back(pointRun());
+        pointRun &ready = oReady.back();
+        ready.osDateTime = it->second.osDateTime;
+        ready.dfTime = it->second.dfTime;
+        ready.columns.swap(it->second.columns);
+        ready.values.swap(it->second.values);
+        nNextRun = it->first + 1;
+        oPending.erase(it);
+        it = oPending.begin();
+    }
+    bWriting = !oReady.empty();
+}
+
+void PointOutputWriter::WriteInt(int n)
+{
+    CPL_LSBPTR32(&n);
+    VSIFWriteL(&n, sizeof(int), 1, fout);
+}
+
+void PointOutputWriter::WriteString(std::string const &s)
+{
+    WriteInt((int)s.size());
+    VSIFWriteL(s.c_str(), 1, s.size(), fout);
+}
+
+/*
+** Open the file and write the column header (csv) or the point table
+** (binary).  The columns come from the first run written.
+*/
+void PointOutputWriter::WriteHeader(pointRun const &run)
+{
+    fout = VSIFOpenL(osFilename.c_str(), format == binary ? "wb" : "w");
+    if(fout == NULL)
+        throw std::runtime_error("PointOutputWriter: cannot open " + osFilename);
+
+    if(format == csv)
+    {
+        std::string osHeader = "ID,lat,lon,height";
+        if(!run.osDateTime.empty())
+            osHeader += ",datetime";
+        for(unsigned int c = 0; c < run.columns.size(); c++)
+            osHeader += "," + run.columns[c];
+        osHeader += "\n";
+        VSIFWriteL(osHeader.c_str(), 1, osHeader.size(), fout);
+        return;
+    }
+
+    VSIFWriteL("WNPOINTS", 1, 8, fout);
+    WriteInt((int)names.size());
+    WriteInt((int)run.columns.size());
+    for(unsigned int c = 0; c < run.columns.size(); c++)
+        WriteString(run.columns[c]);
+    std::vector<double> adfPoint(3);
+    for(unsigned int i = 0; i < names.size(); i++)
+    {
+        WriteString(names[i]);
+        adfPoint[0] = lat[i];
+        adfPoint[1] = lon[i];
+        adfPoint[2] = height[i];
+        for(int n = 0; n < 3; n++)
+            CPL_LSBPTR64(&adfPoint[n]);
+        VSIFWriteL(&adfPoint[0], sizeof(double), 3, fout);
+    }
+}
+
+void PointOutputWriter::WriteRun(pointRun const &run)
+{
+    if(fout == NULL)
+        WriteHeader(run);
+
+    const unsigned int nColumns = run.columns.size();
+    if(run.values.size() != names.size() * nColumns)
+        throw std::logic_error("PointOutputWriter: run values do not match the points");
+
+    if(format == csv)
+    {
+        std::string osRows;
+        for(unsigned int i = 0; i < names.size(); i++)
+        {
+            osRows += CPLSPrintf("%s,%lf,%lf,%lf", names[i].c_str(), lat[i], lon[i], height[i]);
+            if(!run.osDateTime.empty())
+                osRows += "," + run.osDateTime;
+            for(unsigned int c = 0; c < nColumns; c++)
+                osRows += CPLSPrintf(",%lf", run.values[i * nColumns + c]);
+            osRows += "\n";
+        }
+        VSIFWriteL(osRows.c_str(), 1, osRows.size(), fout);
+        return;
+    }
+
+    std::vector<double> adfRecord(1 + run.values.size());
+    adfRecord[0] = run.dfTime;
+    std::copy(run.values.begin(), run.values.end(), adfRecord.begin() + 1);
+    for(unsigned int n = 0; n < adfRecord.size(); n++)
+        CPL_LSBPTR64(&adfRecord[n]);
+    VSIFWriteL(&adfRecord[0], sizeof(double), adfRecord.size(), fout);
+}
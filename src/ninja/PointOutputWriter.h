@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Write sampled output points of an army in run order
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef POINT_OUTPUT_WRITER_H
+#define POINT_OUTPUT_WRITER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdexcept>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+/**
+ * Writes the values sampled at the requested output points for every run of
+ * an army to one file.  Runs hand over their rows with AddRun() as they
+ * finish; rows are written in run number order, rows of a run that finishes
+ * early are held until the runs before it have reported.  Close() writes
+ * anything left, in order.  Runs are queued under a lock but written
+ * outside it, by one thread at a time, so a run handing over its rows does
+ * not wait for another run's write.
+ *
+ * Two formats are supported:
+ *
+ *  csv     ID,lat,lon,height[,datetime],<columns> with one row per point and
+ *          run, as written by earlier versions.
+ *
+ *  binary  little endian; "WNPOINTS" magic, int32 point count, int32 column
+ *          count, each column name and point ID as an int32 length followed
+ *          by the characters, lat, lon and height of each point as doubles,
+ *          then per run the time as a double (seconds since 1970-01-01 UTC,
+ *          NaN if the run has no time) and point count * column count
+ *          doubles, point major.
+ */
+class PointOutputWriter
+{
+public:
+    enum eFormat
+    {
+        csv,
+        binary
+    };
+
+    /* One run's values at every point */
+    struct pointRun
+    {
+        std::string osDateTime;             // empty if the run has no time
+        double dfTime;                      // seconds since 1970 UTC, NaN if none
+        std::vector<std::string> columns;   // names of the sampled values
+        std::vector<double> values;         // points * columns, point major
+    };
+
+    PointOutputWriter(std::string const &filename, eFormat format);
+    ~PointOutputWriter();
+
+    void SetPoints(std::vector<std::string> const &names,
+                   std::vector<double> const &lat,
+                   std::vector<double> const &lon,
+                   std::vector<double> const &height);
+    void AddRun(int nRun, pointRun &run);
+    void Close();
+
+    static eFormat GetFormat(std::string const &format);
+
+private:
+    PointOutputWriter(PointOutputWriter const &rhs);
+    PointOutputWriter &operator=(PointOutputWriter const &rhs);
+
+    void TakeRuns(std::vector<pointRun> &oReady, bool bAll);
+    void WriteRun(pointRun const &run);
+    void WriteHeader(pointRun const &run);
+    void WriteInt(int n);
+    void WriteString(std::string const &s);
+
+    std::string osFilename;
+    eFormat format;
+    VSILFILE *fout;
+    bool bClosed;
+    bool bWriting;                      // a thread is writing taken runs
+
+    std::vector<std::string> names;
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<double> height;
+
+    std::map<int, pointRun> oPending;
+    int nNextRun;
+};
+
+#endif /* POINT_OUTPUT_WRITER_H */
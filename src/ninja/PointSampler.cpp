@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Locate output points in a mesh once and sample fields there
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "PointSampler.h"
+
+PointSampler::PointSampler()
+{
+}
+
+PointSampler::~PointSampler()
+{
+}
+
+/**
+ * Find the cell and local coordinates of each point.
+ * @param mesh Mesh the fields to sample are stored on.
+ * @param dem Elevation the point coordinates are relative to.
+ * @param projX Point x coordinates in the DEM projection.
+ * @param projY Point y coordinates in the DEM projection.
+ * @param heights Point heights above ground.
+ */
+void PointSampler::locate(Mesh const &mesh, Elevation const &dem,
+                          std::vector<double> const &projX,
+                          std::vector<double> const &projY,
+                          std::vector<double> const &heights)
+{
+    const int nPoints = projX.size();
+    anCell.assign(2 * nPoints, 0);
+    abFirstLayer.assign(nPoints, 0);
+    adfSampleHeight.assign(nPoints, 0.0);
+    anNode.assign(NODES_PER_POINT * nPoints, 0);
+    adfWeight.assign(NODES_PER_POINT * nPoints, 0.0);
+
+    element elem(&mesh);
+    double u_coord, v_coord, w_coord, x, y, z, z_ground, z_sample;
+    int elem_i, elem_j, elem_k, elem_num;
+
+    for(int i = 0; i < nPoints; i++)
+    {
+        x = projX[i];
+        y = projY[i];
+        if(!dem.check_inBounds(x, y)){
+            throw std::runtime_error("Requested output point is located outside of the DEM extent.");
+        }
+        x -= dem.xllCorner; //adjust to wn coords
+        y -= dem.yllCorner;
+
+        elem.get_uv(x, y, elem_i, elem_j, u_coord, v_coord);
+        elem_num = mesh.get_elemNum(elem_i, elem_j, 0);
+        elem.get_xyz(elem_num, u_coord, v_coord, -1, x, y, z); // get z at ground
+        z_ground = z;
+        z += heights[i];
+
+        elem.get_uvw(x, y, z, elem_i, elem_j, elem_k, u_coord, v_coord, w_coord);
+        anCell[2 * i] = elem_i;
+        anCell[2 * i + 1] = elem_j;
+
+        if(elem_k == 0)
+        {
+            // sample at the top of the first layer and let the caller apply a profile
+            abFirstLayer[i] = 1;
+            elem.get_xyz(elem_num, u_coord, v_coord, 1, x, y, z_sample);
+            adfSampleHeight[i] = z_sample - z_ground;
+            elem.get_uvw(x, y, z_sample, elem_i, elem_j, elem_k, u_coord, v_coord, w_coord);
+        }
+
+        for(int k = 0; k < NODES_PER_POINT; k++)
+        {
+            anNode[NODES_PER_POINT * i + k] = mesh.get_global_node(k, elem_i, elem_j, elem_k);
+            adfWeight[NODES_PER_POINT * i + k] = elem.SFNV(u_coord, v_coord, w_coord, k);
+        }
+    }
+}
+
+/**
+ * Value of a field at a located point (at the top of the first layer for
+ * first layer points).
+ */
+double PointSampler::sample(int nPoint, wn_3dScalarField const &field) const
+{
+    const int *panNode = &anNode[NODES_PER_POINT * nPoint];
+    const double *padfWeight = &adfWeight[NODES_PER_POINT * nPoint];
+    double value = 0.0;
+    for(int k = 0; k < NODES_PER_POINT; k++)
+        value += padfWeight[k] * field(panNode[k]);
+    return value;
+}
@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Locate output points in a mesh once and sample fields there
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef POINT_SAMPLER_H
+#define POINT_SAMPLER_H
+
+#include <vector>
+#include <stdexcept>
+
+#include "mesh.h"
+#include "element.h"
+#include "wn_3dScalarField.h"
+
+/**
+ * Resolves the requested output points (input_points_file) to mesh cells once
+ * and stores the node numbers and shape function weights of each sample
+ * location.  Every field on the mesh (u, v, w, ...) is then sampled with a
+ * weighted sum over eight nodes instead of a new element search per point and
+ * per field.
+ *
+ * Points that fall in the first cell layer are sampled at the top of that
+ * layer, directly above the point, so the caller can extend the value to the
+ * requested height with a log profile.
+ */
+class PointSampler
+{
+public:
+    PointSampler();
+    ~PointSampler();
+
+    void locate(Mesh const &mesh, Elevation const &dem,
+                std::vector<double> const &projX,
+                std::vector<double> const &projY,
+                std::vector<double> const &heights);
+
+    double sample(int nPoint, wn_3dScalarField const &field) const;
+
+    inline int get_nPoints() const {return (int)anCell.size() / 2;}
+    inline int get_cell_i(int nPoint) const {return anCell[2 * nPoint];}
+    inline int get_cell_j(int nPoint) const {return anCell[2 * nPoint + 1];}
+    inline bool inFirstLayer(int nPoint) const {return abFirstLayer[nPoint] != 0;}
+    /* height of the sample location above the ground, first layer points only */
+    inline double get_sampleHeight(int nPoint) const {return adfSampleHeight[nPoint];}
+
+    static const int NODES_PER_POINT = 8;
+
+private:
+    std::vector<int> anCell;            // cell_i, cell_j per point
+    std::vector<char> abFirstLayer;
+    std::vector<double> adfSampleHeight;
+    std::vector<int> anNode;            // NODES_PER_POINT per point
+    std::vector<double> adfWeight;      // NODES_PER_POINT per point
+};
+
+#endif /* POINT_SAMPLER_H */
@@ -29,6 +29,13 @@
 
 #include "ShapeVector.h"
 
+#include <vector>
+#include <string.h>
+
+#include "ogr_api.h"
+#include "ogr_srs_api.h"
+#include "cpl_vsi.h"
+
 ShapeVector::ShapeVector()
 {
 
@@ -63,129 +70,336 @@ void ShapeVector::setDataBaseName(std::string fileName)
 	DataBaseName = fileName;
 }
 
-bool ShapeVector::makeShapeFiles()
+/*
+** .dbf layout written by WriteShapeFiles(), matching the fields the
+** shapelib writer used to create.
+*/
+#define SHAPE_DBF_FIELD_COUNT   4
+#define SHAPE_DBF_HEADER_LENGTH (32 + 32 * SHAPE_DBF_FIELD_COUNT + 1)
+#define SHAPE_DBF_RECORD_LENGTH (1 + 16 + 8 + 8 + 8)
+#define SHAPE_SHP_RECORD_LENGTH 28
+
+static inline void PutMSB32(GByte *pabyDst, GInt32 nValue)
 {
-	double xC, yC;
-	xC = yC = 0;
-	double mapDir, qgisDir;
-	mapDir = qgisDir = 0;
-	if(CreateShape())
-		OpenShape();
+	CPL_MSBPTR32(&nValue);
+	memcpy(pabyDst, &nValue, 4);
+}
+
+static inline void PutLSB32(GByte *pabyDst, GInt32 nValue)
+{
+	CPL_LSBPTR32(&nValue);
+	memcpy(pabyDst, &nValue, 4);
+}
+
+static inline void PutLSB64(GByte *pabyDst, double dfValue)
+{
+	CPL_LSBPTR64(&dfValue);
+	memcpy(pabyDst, &dfValue, 8);
+}
+
+/*
+** Format a numeric dbf attribute right justified in nWidth characters,
+** truncating on overflow the same way dbfopen.cpp does.
+*/
+static inline void PutDBFNumber(GByte *pabyDst, const char *pszFormat,
+                                int nWidth, double dfValue, bool bInteger)
+{
+	char szField[64];
+	if(bInteger)
+		snprintf(szField, sizeof(szField), pszFormat, nWidth, (int)dfValue);
 	else
+		snprintf(szField, sizeof(szField), pszFormat, nWidth, 6, dfValue);
+	int nLen = (int)strlen(szField);
+	if(nLen > nWidth)
+		nLen = nWidth;
+	memcpy(pabyDst, szField, nLen);
+}
+
+static bool WriteBuffer(const char *pszFilename, std::vector<GByte> const &abyBuffer)
+{
+	VSILFILE *fp = VSIFOpenL(pszFilename, "wb");
+	if(fp == NULL)
 		return false;
+	size_t nWritten = VSIFWriteL(&abyBuffer[0], 1, abyBuffer.size(), fp);
+	VSIFCloseL(fp);
+	return nWritten == abyBuffer.size();
+}
+
+void ShapeVector::ComputeDirections(int i, int j, long &windDir, long &mapDir, long &qgisDir) const
+{
+	double dfMapDir, dfQgisDir;
+	dfMapDir = dir(i,j) + 180.0;
+	dfQgisDir = dir(i,j) + 180.0;
+
+	if(dfQgisDir > 360.0)
+	  dfQgisDir -= 360.0;
 
-	for(int i = 0;i < spd.get_nRows();i++)
+	if(dfMapDir > 360.0)
+		dfMapDir -= 360.0;
+
+	dfMapDir -= 90.0;
+	if(dfMapDir < 0.0)
+		dfMapDir += 360.0;
+
+	windDir = (long) (dir(i,j)+0.5);
+	mapDir = (long) (dfMapDir+0.5);
+	qgisDir = (long) (dfQgisDir+0.5);
+}
+
+/**
+ * Write the speed and direction grids as point features.
+ *
+ * The default output is an ESRI shapefile written by WriteShapeFiles().  The
+ * NINJA_SHAPE_FORMAT config option selects an OGR format instead: GPKG
+ * writes a GeoPackage and FlatGeobuf a .fgb file next to the .shp name.
+ * If the requested driver is not available the shapefile is written.
+ */
+bool ShapeVector::makeShapeFiles()
+{
+	const char *pszFormat = CPLGetConfigOption("NINJA_SHAPE_FORMAT", NULL);
+	if(pszFormat != NULL && !EQUAL(pszFormat, "ESRI Shapefile") &&
+	   !EQUAL(pszFormat, "SHP"))
 	{
-		for(int j = 0;j < spd.get_nCols();j++)
+		const char *pszExtension = NULL;
+		if(EQUAL(pszFormat, "GPKG"))
+			pszExtension = "gpkg";
+		else if(EQUAL(pszFormat, "FlatGeobuf"))
+			pszExtension = "fgb";
+
+		if(pszExtension != NULL && OGRGetDriverByName(pszFormat) != NULL)
+			return WriteOGRFile(pszFormat, pszExtension);
+
+		CPLDebug("WINDNINJA", "Vector format %s is not available, writing a shapefile",
+		         pszFormat);
+	}
+
+	if(!WriteShapeFiles())
+		return false;
+	WritePrjFile();
+
+	return true;
+}
+
+/**
+ * Build the .shp, .shx and .dbf contents in memory, one row of the grid per
+ * task, and write each file with a single sequential write.  The files are
+ * byte for byte what shapelib produced one point at a time.
+ */
+bool ShapeVector::WriteShapeFiles()
+{
+	int nRows = spd.get_nRows();
+	int nCols = spd.get_nCols();
+	int nRecords = nRows * nCols;
+
+	std::string osShxFile = CPLResetExtension(ShapeFileName.c_str(), "shx");
+	std::string osShpFile = CPLResetExtension(ShapeFileName.c_str(), "shp");
+	std::string osDbfFile = CPLResetExtension(DataBaseName.c_str(), "dbf");
+
+	std::vector<GByte> abySHP(100 + (size_t)nRecords * SHAPE_SHP_RECORD_LENGTH, 0);
+	std::vector<GByte> abySHX(100 + (size_t)nRecords * 8, 0);
+	std::vector<GByte> abyDBF(SHAPE_DBF_HEADER_LENGTH +
+	                          (size_t)nRecords * SHAPE_DBF_RECORD_LENGTH, ' ');
+
+	/* -------------------------------------------------------------------- */
+	/*      Records                                                         */
+	/* -------------------------------------------------------------------- */
+#pragma omp parallel for schedule(static)
+	for(int i = 0;i < nRows;i++)
+	{
+		double xC, yC;
+		long windDir, mapDir, qgisDir;
+		for(int j = 0;j < nCols;j++)
 		{
+			int n = i * nCols + j;
 			spd.get_cellPosition(i, j, &xC, &yC);
-			mapDir = dir(i,j) + 180.0;
-			qgisDir = dir(i,j) + 180.0;
-
-			if(qgisDir > 360.0)
-			  qgisDir -= 360.0;
+			ComputeDirections(i, j, windDir, mapDir, qgisDir);
 
-			if(mapDir > 360.0)
-				mapDir -= 360.0;
+			int nOffset = 100 + n * SHAPE_SHP_RECORD_LENGTH;
+			GByte *pabyRec = &abySHP[nOffset];
+			PutMSB32(pabyRec, n + 1);
+			PutMSB32(pabyRec + 4, (SHAPE_SHP_RECORD_LENGTH - 8) / 2);
+			PutLSB32(pabyRec + 8, SHPT_POINT);
+			PutLSB64(pabyRec + 12, xC);
+			PutLSB64(pabyRec + 20, yC);
 
-			mapDir -= 90.0;
-			if(mapDir < 0.0)
-				mapDir += 360.0;
+			GByte *pabyIdx = &abySHX[100 + (size_t)n * 8];
+			PutMSB32(pabyIdx, nOffset / 2);
+			PutMSB32(pabyIdx + 4, (SHAPE_SHP_RECORD_LENGTH - 8) / 2);
 
-			WriteShapePoint(xC, yC, spd(i,j), (long) (dir(i,j)+0.5), (long) (mapDir+0.5), (long) (qgisDir+0.5));
+			GByte *pabyDbf = &abyDBF[SHAPE_DBF_HEADER_LENGTH +
+			                         (size_t)n * SHAPE_DBF_RECORD_LENGTH];
+			PutDBFNumber(pabyDbf + 1, "%*.*f", 16, spd(i,j), false);
+			PutDBFNumber(pabyDbf + 17, "%*d", 8, (double)windDir, true);
+			PutDBFNumber(pabyDbf + 25, "%*d", 8, (double)mapDir, true);
+			PutDBFNumber(pabyDbf + 33, "%*d", 8, (double)qgisDir, true);
 		}
 	}
-	CloseShape();
 
-	if(!spd.prjString.empty())
+	/* -------------------------------------------------------------------- */
+	/*      .shp and .shx headers.  Cell centers are regular, so the bounds  */
+	/*      come from the corner cells.                                      */
+	/* -------------------------------------------------------------------- */
+	double adfMin[2] = {0.0, 0.0};
+	double adfMax[2] = {0.0, 0.0};
+	if(nRecords > 0)
 	{
-		std::string prjFilename(ShapeFileName);
-		int stringPos = prjFilename.find_last_of('.');
-		if(stringPos > 0)
-			prjFilename.erase(stringPos);
-		prjFilename.append(".prj");
+		spd.get_cellPosition(0, 0, &adfMin[0], &adfMin[1]);
+		spd.get_cellPosition(nRows - 1, nCols - 1, &adfMax[0], &adfMax[1]);
+	}
 
-		std::ofstream outputFile(prjFilename.c_str(), std::fstream::trunc);
-		outputFile << spd.prjString;
-		outputFile.close();
+	GByte abyHeader[100];
+	memset(abyHeader, 0, sizeof(abyHeader));
+	PutMSB32(abyHeader, 9994);
+	PutLSB32(abyHeader + 28, 1000);
+	PutLSB32(abyHeader + 32, SHPT_POINT);
+	PutLSB64(abyHeader + 36, adfMin[0]);
+	PutLSB64(abyHeader + 44, adfMin[1]);
+	PutLSB64(abyHeader + 52, adfMax[0]);
+	PutLSB64(abyHeader + 60, adfMax[1]);
+
+	PutMSB32(abyHeader + 24, (int)(abySHP.size() / 2));
+	memcpy(&abySHP[0], abyHeader, 100);
+	PutMSB32(abyHeader + 24, (int)(abySHX.size() / 2));
+	memcpy(&abySHX[0], abyHeader, 100);
+
+	/* -------------------------------------------------------------------- */
+	/*      .dbf header and field descriptors.                              */
+	/* -------------------------------------------------------------------- */
+	memset(&abyDBF[0], 0, SHAPE_DBF_HEADER_LENGTH);
+	abyDBF[0] = 0x03;
+	if(nRecords > 0)
+	{
+		abyDBF[1] = 95; /* date last updated, as written by dbfopen.cpp */
+		abyDBF[2] = 7;
+		abyDBF[3] = 26;
+	}
+	PutLSB32(&abyDBF[4], nRecords);
+	abyDBF[8] = SHAPE_DBF_HEADER_LENGTH % 256;
+	abyDBF[9] = SHAPE_DBF_HEADER_LENGTH / 256;
+	abyDBF[10] = SHAPE_DBF_RECORD_LENGTH % 256;
+	abyDBF[11] = SHAPE_DBF_RECORD_LENGTH / 256;
+
+	const char *apszFieldName[SHAPE_DBF_FIELD_COUNT] = {"speed", "dir", "AM_dir", "QGIS_dir"};
+	const int anFieldWidth[SHAPE_DBF_FIELD_COUNT] = {16, 8, 8, 8};
+	const int anFieldDecimals[SHAPE_DBF_FIELD_COUNT] = {6, 0, 0, 0};
+	for(int iField = 0; iField < SHAPE_DBF_FIELD_COUNT; iField++)
+	{
+		GByte *pabyField = &abyDBF[32 + 32 * iField];
+		memcpy(pabyField, apszFieldName[iField], strlen(apszFieldName[iField]));
+		pabyField[11] = 'N';
+		pabyField[16] = anFieldWidth[iField];
+		pabyField[17] = anFieldDecimals[iField];
 	}
+	abyDBF[SHAPE_DBF_HEADER_LENGTH - 1] = 0x0d;
+
+	if(!WriteBuffer(osShpFile.c_str(), abySHP) ||
+	   !WriteBuffer(osShxFile.c_str(), abySHX))
+		return false;
+	if(!WriteBuffer(osDbfFile.c_str(), abyDBF))
+		throw std::runtime_error("There was a problem writing the shape file");
 
 	return true;
 }
 
-
-bool ShapeVector::CreateShape()
+/**
+ * Write the points through an OGR driver, all features in one transaction.
+ */
+bool ShapeVector::WriteOGRFile(const char *pszFormat, const char *pszExtension)
 {
-	char 	DataBaseID[64]="";
+	std::string osFilename = CPLResetExtension(ShapeFileName.c_str(), pszExtension);
+
+	OGRSFDriverH hDriver = OGRGetDriverByName(pszFormat);
+	VSIStatBufL sStat;
+	if(VSIStatL(osFilename.c_str(), &sStat) == 0)
+		OGR_Dr_DeleteDataSource(hDriver, osFilename.c_str());
 
-     hSHP=SHPCreate(ShapeFileName.c_str(), SHPT_POINT);
-	if(hSHP==NULL)
+	OGRDataSourceH hDS = OGR_Dr_CreateDataSource(hDriver, osFilename.c_str(), NULL);
+	if(hDS == NULL)
 		return false;
-	SHPClose(hSHP);
-	// Create the database.
-	hDBF=DBFCreate(DataBaseName.c_str());
-	if(hDBF==NULL)
+
+	OGRSpatialReferenceH hSRS = NULL;
+	if(!spd.prjString.empty())
+	{
+		hSRS = OSRNewSpatialReference(NULL);
+		char *pszWkt = (char*)spd.prjString.c_str();
+		if(OSRImportFromWkt(hSRS, &pszWkt) != OGRERR_NONE)
+		{
+			OSRDestroySpatialReference(hSRS);
+			hSRS = NULL;
+		}
+	}
+
+	OGRLayerH hLayer = OGR_DS_CreateLayer(hDS, CPLGetBasename(osFilename.c_str()),
+	                                      hSRS, wkbPoint, NULL);
+	if(hSRS != NULL)
+		OSRDestroySpatialReference(hSRS);
+	if(hLayer == NULL)
+	{
+		OGR_DS_Destroy(hDS);
 		return false;
+	}
 
-     //sprintf(DataBaseID, "%s", "Xcoord");
-    	//DBFAddField(hDBF, DataBaseID, FTDouble, 16, 6);
-     //sprintf(DataBaseID, "%s", "Ycoord");
-    	//DBFAddField(hDBF, DataBaseID, FTDouble, 16, 6);
-     sprintf(DataBaseID, "%s", "speed");
-    	DBFAddField(hDBF, DataBaseID, FTDouble, 16, 6 );
-     sprintf(DataBaseID, "%s", "dir");
-    	DBFAddField(hDBF, DataBaseID, FTInteger, 8, 0);
-     sprintf(DataBaseID, "%s", "AM_dir");
-    	DBFAddField(hDBF, DataBaseID, FTInteger, 8, 0 );
-     sprintf(DataBaseID, "%s", "QGIS_dir");
-	DBFAddField(hDBF, DataBaseID,  FTInteger, 8, 0);
-	DBFClose(hDBF);
-
-     return true;
-}
+	OGRFieldDefnH hFieldDefn = OGR_Fld_Create("speed", OFTReal);
+	OGR_L_CreateField(hLayer, hFieldDefn, TRUE);
+	OGR_Fld_Destroy(hFieldDefn);
+	const char *apszDirFields[3] = {"dir", "AM_dir", "QGIS_dir"};
+	for(int iField = 0; iField < 3; iField++)
+	{
+		hFieldDefn = OGR_Fld_Create(apszDirFields[iField], OFTInteger);
+		OGR_L_CreateField(hLayer, hFieldDefn, TRUE);
+		OGR_Fld_Destroy(hFieldDefn);
+	}
 
-void ShapeVector::OpenShape()
-{
-/*
-	FILE *fx=fopen(ShapeFileName, "w");
-     if(fx)
-	     fclose(fx);
-	fx=fopen(DataBaseName, "w");
-     if(fx)
-	     fclose(fx);
-*/
-     hSHP=SHPOpen(ShapeFileName.c_str(), "rb+");
-     hDBF=DBFOpen(DataBaseName.c_str(), "rb+");
-}
+	OGR_L_StartTransaction(hLayer);
+	OGRFeatureH hFeature = OGR_F_Create(OGR_L_GetLayerDefn(hLayer));
+	OGRGeometryH hPoint = OGR_G_CreateGeometry(wkbPoint);
+	double xC, yC;
+	long windDir, mapDir, qgisDir;
+	bool bOk = true;
+	for(int i = 0;i < spd.get_nRows() && bOk;i++)
+	{
+		for(int j = 0;j < spd.get_nCols();j++)
+		{
+			spd.get_cellPosition(i, j, &xC, &yC);
+			ComputeDirections(i, j, windDir, mapDir, qgisDir);
 
+			OGR_G_SetPoint_2D(hPoint, 0, xC, yC);
+			OGR_F_SetGeometry(hFeature, hPoint);
+			OGR_F_SetFID(hFeature, OGRNullFID);
+			OGR_F_SetFieldDouble(hFeature, 0, spd(i,j));
+			OGR_F_SetFieldInteger(hFeature, 1, (int)windDir);
+			OGR_F_SetFieldInteger(hFeature, 2, (int)mapDir);
+			OGR_F_SetFieldInteger(hFeature, 3, (int)qgisDir);
+			if(OGR_L_CreateFeature(hLayer, hFeature) != OGRERR_NONE)
+			{
+				bOk = false;
+				break;
+			}
+		}
+	}
+	OGR_G_DestroyGeometry(hPoint);
+	OGR_F_Destroy(hFeature);
+	OGR_L_CommitTransaction(hLayer);
+	OGR_DS_Destroy(hDS);
 
-void ShapeVector::CloseShape()
-{
-	SHPClose(hSHP);
-	DBFClose(hDBF);
-}
+	if(!bOk)
+		throw std::runtime_error("There was a problem writing the shape file");
 
+	return true;
+}
 
-void ShapeVector::WriteShapePoint(double xpt, double ypt, double spd, long dir, long map_dir, long qgis_dir)
+void ShapeVector::WritePrjFile() const
 {
-	long NumRecord;
-	double zpt=0;
-	SHPObject *pSHP;
-	int ret;
+	if(!spd.prjString.empty())
+	{
+		std::string prjFilename(ShapeFileName);
+		int stringPos = prjFilename.find_last_of('.');
+		if(stringPos > 0)
+			prjFilename.erase(stringPos);
+		prjFilename.append(".prj");
 
-	pSHP=SHPCreateObject(SHPT_POINT, -1, 0, NULL, NULL, 1, &xpt, &ypt, &zpt, NULL);
-	ret = SHPWriteObject(hSHP, -1, pSHP);
-	if(ret == -1)
-		throw std::runtime_error("There was a problem writing the shape file");
-	SHPDestroyObject(pSHP);
-
-	NumRecord = DBFGetRecordCount(hDBF);
-	//DBFWriteDoubleAttribute(hDBF, NumRecord, 0, xpt);
-	//DBFWriteDoubleAttribute(hDBF, NumRecord, 1, ypt);
-	//DBFWriteIntegerAttribute(hDBF, NumRecord, 2, spd);
-	//DBFWriteIntegerAttribute(hDBF, NumRecord, 3, dir);
-	DBFWriteDoubleAttribute(hDBF, NumRecord, 0, spd);
-	DBFWriteIntegerAttribute(hDBF, NumRecord, 1, dir);
-	DBFWriteIntegerAttribute(hDBF, NumRecord, 2, map_dir);
-	DBFWriteIntegerAttribute(hDBF, NumRecord, 3, qgis_dir);
+		std::ofstream outputFile(prjFilename.c_str(), std::fstream::trunc);
+		outputFile << spd.prjString;
+		outputFile.close();
+	}
 }
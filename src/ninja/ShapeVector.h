@@ -61,19 +61,15 @@ public:
 
 private:
 
-	SHPHandle	hSHP;
-	DBFHandle	hDBF;
-
 	double resolution;
 
 	std::string ShapeFileName;
 	std::string DataBaseName;
 
-	bool CreateShape();
-	void OpenShape();
-
-	void WriteShapePoint(double xpt, double ypt, double spd, long dir, long map_dir, long qgis_dir);
+	void ComputeDirections(int i, int j, long &windDir, long &mapDir, long &qgisDir) const;
 
-	void CloseShape();
+	bool WriteShapeFiles();
+	bool WriteOGRFile(const char *pszFormat, const char *pszExtension);
+	void WritePrjFile() const;
 };
 #endif	//SHAPEVECTOR_H
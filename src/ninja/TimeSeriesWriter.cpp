@@ -0,0 +1,359 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Write the runs of an army as time slices of one NetCDF-CF file
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "TimeSeriesWriter.h"
+
+#include <stdexcept>
+#include <cstring>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+#define TIME_SERIES_NO_DATA -9999.0f
+
+TimeSeriesWriter::TimeSeriesWriter(std::string const &filename,
+                                   velocityUnits::eVelocityUnits speedUnits)
+: osFilename(filename), speedUnits(speedUnits)
+{
+    nCols = 0;
+    nRows = 0;
+    xllCorner = 0.0;
+    yllCorner = 0.0;
+    cellSize = 0.0;
+    nNextRun = 0;
+    nRecords = 0;
+    bFailed = false;
+    bClosed = false;
+    ncid = -1;
+    timeVarId = speedVarId = directionVarId = cloudVarId = -1;
+#ifdef _OPENMP
+    omp_init_lock(&queueLock);
+    omp_init_lock(&writeLock);
+#endif
+}
+
+TimeSeriesWriter::~TimeSeriesWriter()
+{
+    try
+    {
+        Close();
+    }
+    catch(std::exception &e)
+    {
+        CPLDebug("NINJA", "TimeSeriesWriter: %s", e.what());
+    }
+#ifdef _OPENMP
+    omp_destroy_lock(&queueLock);
+    omp_destroy_lock(&writeLock);
+#endif
+}
+
+/**
+ * Queue one run's grids and write every slice that is ready, in order.
+ * @param nRun Run number, slices are written in increasing run number.
+ * @param utcTime Time of the run in UTC.
+ * @param speed Wind speed in the speed units given to the constructor.
+ * @param direction Wind direction, degrees the wind is coming from.
+ * @param cloudCover Cloud cover as a fraction.
+ */
+void TimeSeriesWriter::AddSlice(int nRun, boost::posix_time::ptime const &utcTime,
+                                AsciiGrid<double> const &speed,
+                                AsciiGrid<double> const &direction,
+                                AsciiGrid<double> const &cloudCover)
+{
+    timeSlice slice;
+    boost::posix_time::time_duration since =
+        utcTime - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1));
+    slice.dfHours = since.total_seconds() / 3600.0;
+    CopyGrid(speed, slice.afSpeed);
+    CopyGrid(direction, slice.afDirection);
+    CopyGrid(cloudCover, slice.afCloud);
+
+    std::string osError;
+#ifdef _OPENMP
+    omp_set_lock(&queueLock);
+#endif
+    if(bClosed)
+        osError = "TimeSeriesWriter: slice added after the file was closed";
+    else if(nCols == 0)
+    {
+        nCols = speed.get_nCols();
+        nRows = speed.get_nRows();
+        xllCorner = speed.get_xllCorner();
+        yllCorner = speed.get_yllCorner();
+        cellSize = speed.get_cellSize();
+        prjString = speed.prjString;
+    }
+    else if(speed.get_nCols() != nCols || speed.get_nRows() != nRows)
+        osError = "TimeSeriesWriter: grid size differs between runs";
+    if(osError.empty())
+    {
+        timeSlice &queued = oPending[nRun];
+        queued.dfHours = slice.dfHours;
+        queued.afSpeed.swap(slice.afSpeed);
+        queued.afDirection.swap(slice.afDirection);
+        queued.afCloud.swap(slice.afCloud);
+    }
+#ifdef _OPENMP
+    omp_unset_lock(&queueLock);
+#endif
+    if(!osError.empty())
+        throw std::logic_error(osError);
+
+    Flush(false);
+}
+
+/**
+ * Write the slices still queued, in run number order, and close the file.
+ * Slices of runs that never reported are simply missing from the series.
+ */
+void TimeSeriesWriter::Close()
+{
+    if(bClosed)
+        return;
+    Flush(true);
+#ifdef _OPENMP
+    omp_set_lock(&queueLock);
+#endif
+    bClosed = true;
+#ifdef _OPENMP
+    omp_unset_lock(&queueLock);
+#endif
+    if(ncid >= 0)
+    {
+#ifdef _OPENMP
+        omp_guard netCDF_guard(netCDF_lock);
+#endif
+        int status = nc_close(ncid);
+        ncid = -1;
+        CheckStatus(status, "closing file");
+    }
+}
+
+/*
+** Write queued slices.  Unless bDrain is set only the next slice in run order
+** is eligible, and we return at once if another thread is already writing;
+** that thread picks up our slice before it lets go of the file.
+*/
+void TimeSeriesWriter::Flush(bool bDrain)
+{
+    bool bMore = true;
+    while(bMore)
+    {
+#ifdef _OPENMP
+        if(bDrain)
+            omp_set_lock(&writeLock);
+        else if(!omp_test_lock(&writeLock))
+            return;
+#endif
+        std::string osError;
+        try
+        {
+            timeSlice slice;
+            while(PopNext(bDrain, slice))
+            {
+                if(!bFailed)
+                    WriteSlice(slice);
+            }
+        }
+        catch(std::exception &e)
+        {
+            bFailed = true;
+            osError = e.what();
+        }
+#ifdef _OPENMP
+        omp_unset_lock(&writeLock);
+#endif
+        if(!osError.empty())
+            throw std::runtime_error(osError);
+
+        /* a slice queued while we held the file is waiting on us */
+#ifdef _OPENMP
+        omp_set_lock(&queueLock);
+#endif
+        bMore = !oPending.empty() && (bDrain || oPending.begin()->first <= nNextRun);
+#ifdef _OPENMP
+        omp_unset_lock(&queueLock);
+#endif
+    }
+}
+
+/*
+** Take the next slice off the queue.  With bAny the lowest queued run is
+** taken even if an earlier run has not reported.
+*/
+bool TimeSeriesWriter::PopNext(bool bAny, timeSlice &slice)
+{
+    bool bFound = false;
+#ifdef _OPENMP
+    omp_set_lock(&queueLock);
+#endif
+    std::map<int, timeSlice>::iterator it = oPending.begin();
+    if(it != oPending.end() && (bAny || it->first <= nNextRun))
+    {
+        slice.dfHours = it->second.dfHours;
+        slice.afSpeed.swap(it->second.afSpeed);
+        slice.afDirection.swap(it->second.afDirection);
+        slice.afCloud.swap(it->second.afCloud);
+        nNextRun = it->first + 1;
+        oPending.erase(it);
+        bFound = true;
+    }
+#ifdef _OPENMP
+    omp_unset_lock(&queueLock);
+#endif
+    return bFound;
+}
+
+/*
+** Create the file and define the CF dimensions and variables.  Called by the
+** writing thread for the first slice, holding the NetCDF lock.
+*/
+void TimeSeriesWriter::Create()
+{
+    int status;
+#ifdef NC_NETCDF4
+    status = nc_create(osFilename.c_str(), NC_CLOBBER | NC_NETCDF4, &ncid);
+#else
+    status = nc_create(osFilename.c_str(), NC_CLOBBER | NC_64BIT_OFFSET, &ncid);
+#endif
+    CheckStatus(status, osFilename.c_str());
+
+    int timeDimId, yDimId, xDimId, xVarId, yVarId, crsVarId;
+    CheckStatus(nc_def_dim(ncid, "time", NC_UNLIMITED, &timeDimId), "time dimension");
+    CheckStatus(nc_def_dim(ncid, "y", nRows, &yDimId), "y dimension");
+    CheckStatus(nc_def_dim(ncid, "x", nCols, &xDimId), "x dimension");
+
+    CheckStatus(nc_def_var(ncid, "time", NC_DOUBLE, 1, &timeDimId, &timeVarId), "time");
+    CheckStatus(nc_put_att_text(ncid, timeVarId, "standard_name", 4, "time"), "time standard_name");
+    const char *pszTimeUnits = "hours since 1970-01-01 00:00:00";
+    CheckStatus(nc_put_att_text(ncid, timeVarId, "units", strlen(pszTimeUnits), pszTimeUnits), "time units");
+    CheckStatus(nc_put_att_text(ncid, timeVarId, "calendar", 8, "standard"), "time calendar");
+
+    CheckStatus(nc_def_var(ncid, "y", NC_DOUBLE, 1, &yDimId, &yVarId), "y");
+    CheckStatus(nc_put_att_text(ncid, yVarId, "standard_name", 23, "projection_y_coordinate"), "y standard_name");
+    CheckStatus(nc_put_att_text(ncid, yVarId, "units", 1, "m"), "y units");
+    CheckStatus(nc_def_var(ncid, "x", NC_DOUBLE, 1, &xDimId, &xVarId), "x");
+    CheckStatus(nc_put_att_text(ncid, xVarId, "standard_name", 23, "projection_x_coordinate"), "x standard_name");
+    CheckStatus(nc_put_att_text(ncid, xVarId, "units", 1, "m"), "x units");
+
+    CheckStatus(nc_def_var(ncid, "crs", NC_INT, 0, NULL, &crsVarId), "crs");
+    CheckStatus(nc_put_att_text(ncid, crsVarId, "crs_wkt", prjString.size(), prjString.c_str()), "crs crs_wkt");
+    CheckStatus(nc_put_att_text(ncid, crsVarId, "spatial_ref", prjString.size(), prjString.c_str()), "crs spatial_ref");
+
+    std::string osSpeedUnits;
+    if(speedUnits == velocityUnits::milesPerHour)
+        osSpeedUnits = "mile hour-1";
+    else if(speedUnits == velocityUnits::kilometersPerHour)
+        osSpeedUnits = "km hour-1";
+    else
+        osSpeedUnits = "m s-1";
+
+    const char *apszNames[] = {"wind_speed", "wind_direction", "cloud_cover"};
+    const char *apszStandard[] = {"wind_speed", "wind_from_direction", "cloud_area_fraction"};
+    const char *apszUnits[] = {osSpeedUnits.c_str(), "degree", "1"};
+    int *apnVarId[] = {&speedVarId, &directionVarId, &cloudVarId};
+    int anDims[3] = {timeDimId, yDimId, xDimId};
+    float fNoData = TIME_SERIES_NO_DATA;
+    for(int i = 0; i < 3; i++)
+    {
+        int varId;
+        CheckStatus(nc_def_var(ncid, apszNames[i], NC_FLOAT, 3, anDims, &varId), apszNames[i]);
+#ifdef NC_NETCDF4
+        size_t anChunk[3] = {1, (size_t)nRows, (size_t)nCols};
+        CheckStatus(nc_def_var_chunking(ncid, varId, NC_CHUNKED, anChunk), apszNames[i]);
+        CheckStatus(nc_def_var_deflate(ncid, varId, 1, 1, 4), apszNames[i]);
+#endif
+        CheckStatus(nc_put_att_text(ncid, varId, "standard_name", strlen(apszStandard[i]), apszStandard[i]), apszNames[i]);
+        CheckStatus(nc_put_att_text(ncid, varId, "units", strlen(apszUnits[i]), apszUnits[i]), apszNames[i]);
+        CheckStatus(nc_put_att_text(ncid, varId, "grid_mapping", 3, "crs"), apszNames[i]);
+        CheckStatus(nc_put_att_float(ncid, varId, "_FillValue", NC_FLOAT, 1, &fNoData), apszNames[i]);
+        *apnVarId[i] = varId;
+    }
+
+    CheckStatus(nc_put_att_text(ncid, NC_GLOBAL, "Conventions", 6, "CF-1.6"), "global Conventions");
+    CheckStatus(nc_put_att_text(ncid, NC_GLOBAL, "source", 9, "WindNinja"), "global source");
+    CheckStatus(nc_enddef(ncid), "nc_enddef");
+
+    /* cell centers, south to north like the AsciiGrid rows */
+    std::vector<double> adfCoord(nCols);
+    for(int j = 0; j < nCols; j++)
+        adfCoord[j] = xllCorner + (j + 0.5) * cellSize;
+    CheckStatus(nc_put_var_double(ncid, xVarId, &adfCoord[0]), "x");
+    adfCoord.resize(nRows);
+    for(int i = 0; i < nRows; i++)
+        adfCoord[i] = yllCorner + (i + 0.5) * cellSize;
+    CheckStatus(nc_put_var_double(ncid, yVarId, &adfCoord[0]), "y");
+}
+
+void TimeSeriesWriter::WriteSlice(timeSlice const &slice)
+{
+    //the NetCDF library is not thread safe, runs read forecasts meanwhile
+#ifdef _OPENMP
+    omp_guard netCDF_guard(netCDF_lock);
+#endif
+    if(ncid < 0)
+        Create();
+
+    size_t index = nRecords;
+    CheckStatus(nc_put_var1_double(ncid, timeVarId, &index, &slice.dfHours), "time");
+
+    size_t anStart[3] = {index, 0, 0};
+    size_t anCount[3] = {1, (size_t)nRows, (size_t)nCols};
+    CheckStatus(nc_put_vara_float(ncid, speedVarId, anStart, anCount, &slice.afSpeed[0]), "wind_speed");
+    CheckStatus(nc_put_vara_float(ncid, directionVarId, anStart, anCount, &slice.afDirection[0]), "wind_direction");
+    CheckStatus(nc_put_vara_float(ncid, cloudVarId, anStart, anCount, &slice.afCloud[0]), "cloud_cover");
+    nRecords++;
+    CPLDebug("NINJA", "TimeSeriesWriter: wrote time slice %d to %s", nRecords, osFilename.c_str());
+}
+
+void TimeSeriesWriter::CopyGrid(AsciiGrid<double> const &grid, std::vector<float> &out)
+{
+    const int nC = grid.get_nCols();
+    const int nR = grid.get_nRows();
+    const double dfNoData = grid.get_noDataValue();
+    out.resize((size_t)nC * nR);
+    for(int i = 0; i < nR; i++)
+    {
+        for(int j = 0; j < nC; j++)
+        {
+            double dfValue = grid(i, j);
+            out[(size_t)i * nC + j] = dfValue == dfNoData ? TIME_SERIES_NO_DATA : (float)dfValue;
+        }
+    }
+}
+
+void TimeSeriesWriter::CheckStatus(int status, const char *pszWhat)
+{
+    if(status != NC_NOERR)
+    {
+        throw std::runtime_error(CPLSPrintf("TimeSeriesWriter: NetCDF error (%s): %s",
+                                            pszWhat, nc_strerror(status)));
+    }
+}
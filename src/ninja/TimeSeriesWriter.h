@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Write the runs of an army as time slices of one NetCDF-CF file
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef TIME_SERIES_WRITER_H
+#define TIME_SERIES_WRITER_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#include "omp_guard.h"
+#endif
+
+#include "netcdf.h"
+
+#include "ascii_grid.h"
+#include "ninjaUnits.h"
+
+#ifndef Q_MOC_RUN
+#include "boost/date_time/posix_time/posix_time.hpp"
+#endif
+
+#ifdef _OPENMP
+extern omp_lock_t netCDF_lock;
+#endif
+
+/**
+ * Writes the speed, direction and cloud cover grids of every run in an army
+ * into one NetCDF-CF file with an unlimited time dimension, instead of a set
+ * of small files per time step.  Each time slice is one chunk and is deflate
+ * compressed when the NetCDF library supports NetCDF-4.
+ *
+ * Runs hand their grids to AddSlice() as they finish.  Slices are written in
+ * run number order: a slice that arrives early is queued, and whichever run
+ * supplies the next slice in order writes everything that is ready.  A run
+ * never waits for another run's write, it leaves its slice in the queue for
+ * the thread already writing.  Close() writes anything left, in order, and
+ * closes the file.
+ */
+class TimeSeriesWriter
+{
+public:
+    TimeSeriesWriter(std::string const &filename,
+                     velocityUnits::eVelocityUnits speedUnits);
+    ~TimeSeriesWriter();
+
+    void AddSlice(int nRun, boost::posix_time::ptime const &utcTime,
+                  AsciiGrid<double> const &speed,
+                  AsciiGrid<double> const &direction,
+                  AsciiGrid<double> const &cloudCover);
+    void Close();
+
+    inline int get_nSlicesWritten() const {return nRecords;}
+
+private:
+    TimeSeriesWriter(TimeSeriesWriter const &rhs);
+    TimeSeriesWriter &operator=(TimeSeriesWriter const &rhs);
+
+    /* One run's grids, south to north as stored in AsciiGrid */
+    struct timeSlice
+    {
+        double dfHours;
+        std::vector<float> afSpeed;
+        std::vector<float> afDirection;
+        std::vector<float> afCloud;
+    };
+
+    void Flush(bool bWait);
+    bool PopNext(bool bAny, timeSlice &slice);
+    void Create();
+    void WriteSlice(timeSlice const &slice);
+    static void CopyGrid(AsciiGrid<double> const &grid, std::vector<float> &out);
+    static void CheckStatus(int status, const char *pszWhat);
+
+    std::string osFilename;
+    velocityUnits::eVelocityUnits speedUnits;
+
+    /* Geometry of the first slice, every slice must match it */
+    int nCols;
+    int nRows;
+    double xllCorner;
+    double yllCorner;
+    double cellSize;
+    std::string prjString;
+
+    std::map<int, timeSlice> oPending;
+    int nNextRun;
+    int nRecords;
+    bool bFailed;
+    bool bClosed;
+
+    int ncid;
+    int timeVarId;
+    int speedVarId;
+    int directionVarId;
+    int cloudVarId;
+
+#ifdef _OPENMP
+    omp_lock_t queueLock;
+    omp_lock_t writeLock;
+#endif
+};
+
+#endif /* TIME_SERIES_WRITER_H */
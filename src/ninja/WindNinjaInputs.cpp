@@ -33,9 +33,10 @@ WindNinjaInputs::WindNinjaInputs()
 : ninjaTime(boost::local_time::not_a_date_time)
 {
     //Initialize variables
-    hSpdMemDs = NULL;
-    hDirMemDs = NULL;
-    hDustMemDs = NULL;
+    outputDatasetPool = NULL;
+    sweep = NULL;
+    windAtlas = NULL;
+    incremental = NULL;
     armySize = 1;
     vegetation = WindNinjaInputs::trees;
     initializationMethod = WindNinjaInputs::noInitializationFlag;
@@ -73,6 +74,9 @@ WindNinjaInputs::WindNinjaInputs()
     wxModelAsciiOutFlag = false;
     txtOutFlag = false;
     volVTKOutFlag = false;
+    netcdfOutFlag = false;
+    netcdfOutFilename = "!set";
+    timeSeriesWriter = NULL;
     kmlFile = "!set";
     kmzFile = "!set";
     wxModelKmlFile = "!set";
@@ -110,7 +114,11 @@ WindNinjaInputs::WindNinjaInputs()
     pdfHeight = 11.0;
     pdfDPI = 150;
     keepOutGridsInMemory = false;
+    keepOut3dFieldsInMemory = false;
+    incrementalPointRun = false;
+    fileOutFlag = true;
     customOutputPath = "!set";
+    surfaceGridsFilename = "!set";
 #ifdef NINJA_SPEED_TESTING
     speedDampeningRatio = 1;
 #endif
@@ -150,6 +158,8 @@ WindNinjaInputs::WindNinjaInputs()
     
     outputPointsFilename = "!set";
     inputPointsFilename = "!set";
+    outputPointsFormat = "csv";
+    pointOutputWriter = NULL;
 
     outputPath = "!set";
 
@@ -172,9 +182,10 @@ WindNinjaInputs::WindNinjaInputs(const WindNinjaInputs &rhs)
 : ninjaTime(boost::local_time::not_a_date_time)
 {
   armySize = rhs.armySize;
-  hSpdMemDs = rhs.hSpdMemDs;
-  hDirMemDs = rhs.hDirMemDs;
-  hDustMemDs = rhs.hDustMemDs;
+  outputDatasetPool = rhs.outputDatasetPool;
+  sweep = rhs.sweep;
+  windAtlas = rhs.windAtlas;
+  incremental = NULL;
   
   vegetation = rhs.vegetation;
 
@@ -208,6 +219,8 @@ WindNinjaInputs::WindNinjaInputs(const WindNinjaInputs &rhs)
 #endif
   outputPointsFilename = rhs.outputPointsFilename;
   inputPointsFilename = rhs.inputPointsFilename;
+  outputPointsFormat = rhs.outputPointsFormat;
+  pointOutputWriter = rhs.pointOutputWriter;
   pointsNamesList = rhs.pointsNamesList;
   latList = rhs.latList;
   lonList = rhs.lonList;
@@ -250,6 +263,9 @@ WindNinjaInputs::WindNinjaInputs(const WindNinjaInputs &rhs)
   wxModelAsciiOutFlag = rhs.wxModelAsciiOutFlag;
   txtOutFlag = rhs.txtOutFlag;
   volVTKOutFlag = rhs.volVTKOutFlag;
+  netcdfOutFlag = rhs.netcdfOutFlag;
+  netcdfOutFilename = rhs.netcdfOutFilename;
+  timeSeriesWriter = rhs.timeSeriesWriter;
   kmlFile = rhs.kmlFile;
   kmzFile = rhs.kmzFile;
   wxModelKmlFile = rhs.wxModelKmlFile;
@@ -279,7 +295,11 @@ WindNinjaInputs::WindNinjaInputs(const WindNinjaInputs &rhs)
   dateTimeLegFile = rhs.dateTimeLegFile;
   volVTKFile = rhs.volVTKFile;
   keepOutGridsInMemory = rhs.keepOutGridsInMemory;
+  keepOut3dFieldsInMemory = rhs.keepOut3dFieldsInMemory;
+  incrementalPointRun = rhs.incrementalPointRun;
+  fileOutFlag = rhs.fileOutFlag;
   customOutputPath = rhs.customOutputPath;
+  surfaceGridsFilename = rhs.surfaceGridsFilename;
   
 #ifdef NINJA_SPEED_TESTING
   speedDampeningRatio = rhs.speedDampeningRatio;
@@ -360,9 +380,10 @@ WindNinjaInputs &WindNinjaInputs::operator=(const WindNinjaInputs &rhs)
       //ninjaCom stuff
       Com = NULL;   //must be set to null!
       armySize = rhs.armySize;
-      hSpdMemDs = rhs.hSpdMemDs;
-      hDirMemDs = rhs.hDirMemDs;
-      hDustMemDs = rhs.hDustMemDs;
+      outputDatasetPool = rhs.outputDatasetPool;
+      sweep = rhs.sweep;
+      windAtlas = rhs.windAtlas;
+      incremental = NULL;
       
       vegetation = rhs.vegetation;
 
@@ -404,6 +425,8 @@ WindNinjaInputs &WindNinjaInputs::operator=(const WindNinjaInputs &rhs)
 #endif
       outputPointsFilename = rhs.outputPointsFilename;
       inputPointsFilename = rhs.inputPointsFilename;
+      outputPointsFormat = rhs.outputPointsFormat;
+      pointOutputWriter = rhs.pointOutputWriter;
       pointsNamesList = rhs.pointsNamesList;
       latList = rhs.latList;
       lonList = rhs.lonList;
@@ -436,6 +459,9 @@ WindNinjaInputs &WindNinjaInputs::operator=(const WindNinjaInputs &rhs)
       wxModelAsciiOutFlag = rhs.wxModelAsciiOutFlag;
       txtOutFlag = rhs.txtOutFlag;
       volVTKOutFlag = rhs.volVTKOutFlag;
+      netcdfOutFlag = rhs.netcdfOutFlag;
+      netcdfOutFilename = rhs.netcdfOutFilename;
+      timeSeriesWriter = rhs.timeSeriesWriter;
       kmlFile = rhs.kmlFile;
       kmzFile = rhs.kmzFile;
       wxModelKmlFile = rhs.wxModelKmlFile;
@@ -473,7 +499,11 @@ WindNinjaInputs &WindNinjaInputs::operator=(const WindNinjaInputs &rhs)
       dateTimeLegFile = rhs.dateTimeLegFile;
       volVTKFile = rhs.volVTKFile;
       keepOutGridsInMemory = rhs.keepOutGridsInMemory;
+      keepOut3dFieldsInMemory = rhs.keepOut3dFieldsInMemory;
+      incrementalPointRun = rhs.incrementalPointRun;
+      fileOutFlag = rhs.fileOutFlag;
       customOutputPath = rhs.customOutputPath;
+      surfaceGridsFilename = rhs.surfaceGridsFilename;
       
 #ifdef NINJA_SPEED_TESTING
       speedDampeningRatio = rhs.speedDampeningRatio;
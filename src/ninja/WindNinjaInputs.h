@@ -45,6 +45,13 @@
 #include "wxStation.h"
 #include "ninjaCom.h"
 #include "ninja_conv.h"
+
+class OutputDatasetPool;
+class TimeSeriesWriter;
+class PointOutputWriter;
+class NinjaSweep;
+class NinjaWindAtlas;
+class NinjaIncremental;
 /*
 #ifdef WINDNINJA_EXPORTS
     #define WINDNINJA_API __declspec(dllexport) 	
@@ -119,9 +126,10 @@ public:
     ninjaComClass::eNinjaCom inputsComType;
     
     int armySize; 
-    GDALDatasetH hSpdMemDs;
-    GDALDatasetH hDirMemDs;
-    GDALDatasetH hDustMemDs;
+    OutputDatasetPool *outputDatasetPool; //shared by an army for multi-band GTiff output
+    NinjaSweep *sweep;  //shared by an army of neutral domain-average runs on one mesh
+    NinjaWindAtlas *windAtlas;  //basis solutions replacing the solve, owned by the army
+    NinjaIncremental *incremental;  //state of the previous point run, held during simulate_wind()
 
 
     //DEM input
@@ -134,6 +142,7 @@ public:
     std::string dirInitGridFilename;  //raster file of gridded wind directions
     eInitializationMethod initializationMethod;	//method to initialize WindNinja
     std::string forecastFilename;	//name of coarse weather model initialization file (NDFD, NAM, GFS, RUC, etc.)
+    std::string surfaceGridsFilename;	//roughness, rough_h and rough_d bands (m) replacing the uniform vegetation values
     velocityUnits::eVelocityUnits inputSpeedUnits;			//units of input windspeed (0=>m/s, 1=>mph, 2=>kph) (note that inputSpeed is always stored as m/s, and converted to and from the other units)
     velocityUnits::eVelocityUnits outputSpeedUnits;			//units of output windspeed (0=>m/s, 1=>mph, 2=>kph)
     double inputSpeed;			//input wind speed in m/s
@@ -193,6 +202,9 @@ public:
     bool wxModelShpOutFlag;		//flag specifying if a wxModel shapefile should be written
     bool wxModelAsciiOutFlag;		//flag specifying if wxModel ESRI Ascii Raster files should be written
     bool volVTKOutFlag;			//flag specifying if a volume VTK file should be written
+    bool netcdfOutFlag;			//flag specifying if the NetCDF-CF time series file should be written
+    std::string netcdfOutFilename;	//filename of the NetCDF-CF time series file, shared by all runs of an army
+    TimeSeriesWriter *timeSeriesWriter;	//shared by an army so every run lands in one file
     std::string kmlFile;
     std::string kmzFile;
     std::string wxModelKmlFile;
@@ -275,8 +287,13 @@ public:
 
     std::string outputPointsFilename; //name of file containing output for requested point locations
     std::string inputPointsFilename; // name of file containing locations of specfic points for output
+    std::string outputPointsFormat; //csv or binary
+    PointOutputWriter *pointOutputWriter; //shared by an army so every run lands in one file, in run order
     
     bool keepOutGridsInMemory; //flag to determine if the final grids should be kept in memory after simulate_wind() or not.  Normally this is done only for a dll run.
+    bool keepOut3dFieldsInMemory; //flag to keep the solved u, v, w fields after simulate_wind() for in-memory access.
+    bool incrementalPointRun; //flag to start a point run from the state of the previous run on the same domain.
+    bool fileOutFlag; //flag to write any output files at all; false leaves results only in memory.
 
     std::string outputPath;
     
@@ -73,6 +73,53 @@ void verify_option_set(const po::variables_map& vm, const char* optn)
     }
 }
 
+/**
+ * Function used to parse a list of values such as "5,10,15".  An item may
+ * also be a range written as start:step:end, such as "0:45:315".
+ * @param optn option name, for error messages
+ * @param value option value
+ * @return the values, in the order given
+ */
+std::vector<double> parse_value_list(const char* optn, const std::string& value)
+{
+    std::vector<double> values;
+    char **papszItems = CSLTokenizeString2(value.c_str(), ",", 0);
+    for(int i = 0; papszItems != NULL && papszItems[i] != NULL; i++)
+    {
+        char **papszRange = CSLTokenizeString2(papszItems[i], ":", 0);
+        int nParts = CSLCount(papszRange);
+        double adfRange[3];
+        bool bValid = (nParts == 1 || nParts == 3);
+        for(int j = 0; j < nParts && bValid; j++)
+        {
+            char *pszEnd = NULL;
+            adfRange[j] = strtod(papszRange[j], &pszEnd);
+            bValid = pszEnd != papszRange[j] && *pszEnd == '\0';
+        }
+        CSLDestroy(papszRange);
+        if(bValid && nParts == 3 && (adfRange[1] <= 0.0 || adfRange[2] < adfRange[0]))
+            bValid = false;
+        if(!bValid)
+        {
+            CSLDestroy(papszItems);
+            throw logic_error(std::string("Option '") + optn + "' has an invalid list: "
+                              + value + "\n");
+        }
+        if(nParts == 1)
+        {
+            values.push_back(adfRange[0]);
+            continue;
+        }
+        int nSteps = (int)((adfRange[2] - adfRange[0]) / adfRange[1] + 1e-9);
+        for(int j = 0; j <= nSteps; j++)
+            values.push_back(adfRange[0] + j * adfRange[1]);
+    }
+    CSLDestroy(papszItems);
+    if(values.empty())
+        throw logic_error(std::string("Option '") + optn + "' was not set.\n");
+    return values;
+}
+
 /*
 bool checkArgs(string arg1, string arg2, string arg3)
 {
@@ -133,15 +180,17 @@ void initializeOptions()
                 ("forecast_duration", po::value<int>(), "forecast duration to download (in hours)")
                 ("forecast_filename", po::value<std::string>(), "path/filename of an already downloaded wx forecast file")
                 ("match_points",po::value<bool>()->default_value(true), "match simulation to points(true, false)")
-                ("input_speed", po::value<double>(), "input wind speed")
+                ("input_speed", po::value<std::string>(), "input wind speed, or a list of speeds such as 5,10,15 or 5:5:20")
                 ("input_speed_units", po::value<std::string>(), "units of input wind speed (mps, mph, kph)")
                 ("output_speed_units", po::value<std::string>()->default_value("mph"), "units of output wind speed (mps, mph, kph)")
-                ("input_direction", po::value<double>(), "input wind direction")
+                ("input_direction", po::value<std::string>(), "input wind direction, or a list of directions such as 0:45:315")
+                ("wind_atlas", po::value<bool>()->default_value(false), "combine domain average runs from two stored basis solutions, neutral and non-diurnal only (true, false)")
                 ("uni_air_temp", po::value<double>(), "surface air temperature")
                 ("air_temp_units", po::value<std::string>(), "surface air temperature units (K, C, R, F)")
                 ("uni_cloud_cover", po::value<double>(), "cloud cover")
                 ("cloud_cover_units", po::value<std::string>(), "cloud cover units (fraction, percent, canopy_category)")
-                ("wx_station_filename", po::value<std::string>(), "path/filename of input wx station file")
+                ("wx_station_filename", po::value<std::string>(), "path/filename of input wx station file, or a directory of station files; an optional Date_Time column (UTC) makes one run per observation time")
+                ("incremental_point_run", po::value<bool>()->default_value(false), "re-solve from the previous point run on the same domain, for repeated runs in server mode (true, false)")
                 ("write_wx_station_kml", po::value<bool>()->default_value(false), "write a Google Earth kml file for the input wx stations (true, false)")
                 ("wx_station_kml_filename", po::value<std::string>(), "filename for the Google Earth kml wx station output file")
                 ("input_wind_height", po::value<double>(), "height of input wind speed above the vegetation")
@@ -172,6 +221,8 @@ void initializeOptions()
                 ("ascii_out_resolution", po::value<double>()->default_value(-1.0), "resolution of ascii fire behavior output files (-1 to use mesh resolution)")
                 ("units_ascii_out_resolution", po::value<std::string>()->default_value("m"), "units of ascii fire behavior output file resolutino (ft, m)")
                 ("write_vtk_output", po::value<bool>()->default_value(false), "write VTK output file (true, false)")
+                ("write_netcdf_output", po::value<bool>()->default_value(false), "write all runs to one NetCDF-CF time series file (true, false)")
+                ("netcdf_file", po::value<std::string>(), "output NetCDF path/filename (*.nc)")
                 ("write_farsite_atm", po::value<bool>()->default_value(false), "write a FARSITE atm file (true, false)")
                 #ifdef STABILITY
                 ("non_neutral_stability", po::value<bool>()->default_value(false), "use non-neutral stability (true, false)")
@@ -308,15 +359,17 @@ int windNinjaCLI(int argc, char* argv[])
                 ("forecast_duration", po::value<int>(), "forecast duration to download (in hours)")
                 ("forecast_filename", po::value<std::string>(), "path/filename of an already downloaded wx forecast file")
                 ("match_points",po::value<bool>()->default_value(true), "match simulation to points(true, false)")
-                ("input_speed", po::value<double>(), "input wind speed")
+                ("input_speed", po::value<std::string>(), "input wind speed, or a list of speeds such as 5,10,15 or 5:5:20")
                 ("input_speed_units", po::value<std::string>(), "units of input wind speed (mps, mph, kph)")
                 ("output_speed_units", po::value<std::string>()->default_value("mph"), "units of output wind speed (mps, mph, kph)")
-                ("input_direction", po::value<double>(), "input wind direction")
+                ("input_direction", po::value<std::string>(), "input wind direction, or a list of directions such as 0:45:315")
+                ("wind_atlas", po::value<bool>()->default_value(false), "combine domain average runs from two stored basis solutions, neutral and non-diurnal only (true, false)")
                 ("uni_air_temp", po::value<double>(), "surface air temperature")
                 ("air_temp_units", po::value<std::string>(), "surface air temperature units (K, C, R, F)")
                 ("uni_cloud_cover", po::value<double>(), "cloud cover")
                 ("cloud_cover_units", po::value<std::string>(), "cloud cover units (fraction, percent, canopy_category)")
-                ("wx_station_filename", po::value<std::string>(), "path/filename of input wx station file")
+                ("wx_station_filename", po::value<std::string>(), "path/filename of input wx station file, or a directory of station files; an optional Date_Time column (UTC) makes one run per observation time")
+                ("incremental_point_run", po::value<bool>()->default_value(false), "re-solve from the previous point run on the same domain, for repeated runs in server mode (true, false)")
                 ("write_wx_station_kml", po::value<bool>()->default_value(false), "write a Google Earth kml file for the input wx stations (true, false)")
                 ("wx_station_kml_filename", po::value<std::string>(), "filename for the Google Earth kml wx station output file")
                 ("input_wind_height", po::value<double>(), "height of input wind speed above the vegetation")
@@ -347,6 +400,8 @@ int windNinjaCLI(int argc, char* argv[])
                 ("ascii_out_resolution", po::value<double>()->default_value(-1.0), "resolution of ascii fire behavior output files (-1 to use mesh resolution)")
                 ("units_ascii_out_resolution", po::value<std::string>()->default_value("m"), "units of ascii fire behavior output file resolution (ft, m)")
                 ("write_vtk_output", po::value<bool>()->default_value(false), "write VTK output file (true, false)")
+                ("write_netcdf_output", po::value<bool>()->default_value(false), "write all runs to one NetCDF-CF time series file (true, false)")
+                ("netcdf_file", po::value<std::string>(), "output NetCDF path/filename (*.nc)")
                 ("write_farsite_atm", po::value<bool>()->default_value(false), "write a FARSITE atm file (true, false)")
                 ("write_pdf_output", po::value<bool>()->default_value(false), "write PDF output file (true, false)")
                 ("pdf_out_resolution", po::value<double>()->default_value(-1.0), "resolution of pdf output file (-1 to use mesh resolution)")
@@ -373,6 +428,7 @@ int windNinjaCLI(int argc, char* argv[])
                 #endif
                 ("input_points_file", po::value<std::string>(), "input file containing lat,long,z for requested output points (z in m above ground)")
                 ("output_points_file", po::value<std::string>(), "file to write containing output for requested points")
+                ("output_points_format", po::value<std::string>()->default_value("csv"), "format of the output points file (csv, binary)")
                 #ifdef NINJAFOAM
                 ("existing_case_directory", po::value<std::string>(), "path to an existing OpenFOAM case directory") 
                 ("momentum_flag", po::value<bool>()->default_value(false), "use momentum solver (true, false)")
@@ -607,7 +663,7 @@ int windNinjaCLI(int argc, char* argv[])
                           FALSE, 0);
             if (hDS == 0) {
               fprintf(stderr, "Failed to open fire perimeter file.\n");
-              exit(1);
+              return 1;
             }
 
             OGRLayerH hLayer;
@@ -619,7 +675,7 @@ int windNinjaCLI(int argc, char* argv[])
             hFeature = OGR_L_GetNextFeature(hLayer);
             if (hFeature == NULL) {
               fprintf(stderr, "Failed to get fire perimeter feature");
-              exit(1);
+              return 1;
             }
             hGeo = OGR_F_GetGeometryRef(hFeature);
             OGREnvelope psEnvelope;
@@ -654,7 +710,7 @@ int windNinjaCLI(int argc, char* argv[])
                 if( NULL == fetch )
                 {
                     fprintf(stderr, "Invalid DEM Source\n");
-                    exit(1);
+                    return 1;
                 }
             
                 int nSrtmError = fetch->FetchBoundingBox(bbox, 30.0,
@@ -665,7 +721,7 @@ int windNinjaCLI(int argc, char* argv[])
                 {
                     cerr << "Failed to download elevation data\n";
                     VSIUnlink(new_elev.c_str());
-                    exit(1);
+                    return 1;
                 }
                 
                 //fill in no data values
@@ -717,7 +773,7 @@ int windNinjaCLI(int argc, char* argv[])
             if( NULL == fetch )
             {
                 fprintf(stderr, "Invalid DEM Source\n");
-                exit(1);
+                return 1;
             }
 
             if(vm.count("north") || vm.count("south") ||
@@ -737,7 +793,7 @@ int windNinjaCLI(int argc, char* argv[])
                 if(south >= north || west >= east)
                 {
                     cerr << "Invalid bounding box\n";
-                    exit(1);
+                    return 1;
                 }
 
                 double bbox[4];
@@ -770,12 +826,12 @@ int windNinjaCLI(int argc, char* argv[])
                    y_buf < 0 )
                 {
                     cerr << "Invalid coordinates for dem\n";
-                    exit(1);
+                    return 1;
                 }
                 if(b_units != "miles" && b_units != "kilometers")
                 {
                     cerr << "Invalid units for buffer for dem\n";
-                    exit(1);
+                    return 1;
                 }
 
                 double center[2];
@@ -799,7 +855,7 @@ int windNinjaCLI(int argc, char* argv[])
             {
                 cerr << "Failed to download elevation data\n";
                 VSIUnlink(new_elev.c_str());
-                exit(1);
+                return 1;
             }
             vm.insert(std::make_pair("elevation_file", po::variable_value(vm["fetch_elevation"])));
             po::notify(vm);
@@ -937,6 +993,45 @@ int windNinjaCLI(int argc, char* argv[])
             }
         }
 
+        //a list of speeds or directions makes a sweep with one run for
+        //each combination, the speeds of a direction in a row
+        std::vector<double> inputSpeeds, inputDirections;
+        if(vm["initialization_method"].as<std::string>() == string("domainAverageInitialization"))
+        {
+            verify_option_set(vm, "input_speed");
+            verify_option_set(vm, "input_direction");
+            inputSpeeds = parse_value_list("input_speed", vm["input_speed"].as<std::string>());
+            inputDirections = parse_value_list("input_direction", vm["input_direction"].as<std::string>());
+            int nRuns = inputSpeeds.size() * inputDirections.size();
+            if(nRuns > 1)
+            {
+                #ifdef NINJAFOAM
+                windsim.setSize(nRuns, vm["momentum_flag"].as<bool>());
+                #else
+                windsim.setSize(nRuns, false);
+                #endif
+            }
+        }
+
+        //a station file or directory with observation times makes one run
+        //for each time step
+        bool stationTimes = false;
+        if(vm["initialization_method"].as<std::string>() == string("pointInitialization"))
+        {
+            verify_option_set(vm, "wx_station_filename");
+            try
+            {
+                stationTimes = windsim.makeStationArmy(vm["wx_station_filename"].as<std::string>(),
+                                                       vm["elevation_file"].as<std::string>(),
+                                                       osTimeZone);
+            }
+            catch(std::exception &e)
+            {
+                cout << "Could not read weather stations: " << e.what() << "\n";
+                return -1;
+            }
+        }
+
         /*
         windsim.Com = new ninjaCLIComHandler();
         int r = -1;
@@ -1002,6 +1097,11 @@ int windNinjaCLI(int argc, char* argv[])
                 windsim.setOutputPointsFilename( i_,
                         vm["output_points_file"].as<std::string>() );
             }
+            if( vm.count("input_points_file") )
+            {
+                windsim.setOutputPointsFormat( i_,
+                        vm["output_points_format"].as<std::string>() );
+            }
             
             #ifdef NINJA_SPEED_TESTING
             if(vm.count("initialization_speed_dampening_ratio"))
@@ -1075,10 +1175,10 @@ int windNinjaCLI(int argc, char* argv[])
                 windsim.setInitializationMethod( i_,
                         WindNinjaInputs::domainAverageInitializationFlag);
 
-                windsim.setInputSpeed( i_, vm["input_speed"].as<double>(),
+                windsim.setInputSpeed( i_, inputSpeeds[i_ % inputSpeeds.size()],
                         velocityUnits::getUnit( vm["input_speed_units"].as<std::string>() ) );
 
-                windsim.setInputDirection( i_, vm["input_direction"].as<double>() );
+                windsim.setInputDirection( i_, inputDirections[i_ / inputSpeeds.size()] );
 
                 windsim.setInputWindHeight( i_, vm["input_wind_height"].as<double>(),
                         lengthUnits::getUnit(vm["units_input_wind_height"].as<std::string>() ) );
@@ -1158,7 +1258,7 @@ int windNinjaCLI(int argc, char* argv[])
                 windsim.setInitializationMethod( i_,
                         WindNinjaInputs::pointInitializationFlag,
                         vm["match_points"].as<bool>() );
-                windsim.setWxStationFilename( i_, vm["wx_station_filename"].as<std::string>() );
+                windsim.setIncrementalPointRun( i_, vm["incremental_point_run"].as<bool>() );
                 if(vm["write_wx_station_kml"].as<bool>() == true)
                     wxStation::writeKmlFile(windsim.getWxStations( i_ ),
                                             vm["wx_station_kml_filename"].as<std::string>());
@@ -1168,18 +1268,21 @@ int windNinjaCLI(int argc, char* argv[])
 
                 if(vm["diurnal_winds"].as<bool>())
                 {
-                    option_dependency(vm, "diurnal_winds", "year");
-                    option_dependency(vm, "diurnal_winds", "month");
-                    option_dependency(vm, "diurnal_winds", "day");
-                    option_dependency(vm, "diurnal_winds", "hour");
-                    option_dependency(vm, "diurnal_winds", "minute");
-                    option_dependency(vm, "diurnal_winds", "time_zone");
-
                     windsim.setDiurnalWinds( i_, true);
-                    windsim.setDateTime( i_, vm["year"].as<int>(), vm["month"].as<int>(),
-                                             vm["day"].as<int>(), vm["hour"].as<int>(),
-                                             vm["minute"].as<int>(), 0.0,
-                                             osTimeZone);
+                    if(!stationTimes) //stations with times already set the run time
+                    {
+                        option_dependency(vm, "diurnal_winds", "year");
+                        option_dependency(vm, "diurnal_winds", "month");
+                        option_dependency(vm, "diurnal_winds", "day");
+                        option_dependency(vm, "diurnal_winds", "hour");
+                        option_dependency(vm, "diurnal_winds", "minute");
+                        option_dependency(vm, "diurnal_winds", "time_zone");
+
+                        windsim.setDateTime( i_, vm["year"].as<int>(), vm["month"].as<int>(),
+                                                 vm["day"].as<int>(), vm["hour"].as<int>(),
+                                                 vm["minute"].as<int>(), 0.0,
+                                                 osTimeZone);
+                    }
                 }
                 #ifdef STABILITY
                 //Atmospheric stability selections
@@ -1384,7 +1487,8 @@ int windNinjaCLI(int argc, char* argv[])
                     !vm.count("write_goog_output") &&
                     !vm.count("write_shapefile_output") &&
                     !vm.count("write_ascii_output") &&
-                    !vm.count("write_vtk_output"))
+                    !vm.count("write_vtk_output") &&
+                    !vm.count("write_netcdf_output"))
             {
                 cout << "No outputs selected.\n";
                 return -1;
@@ -1422,6 +1526,12 @@ int windNinjaCLI(int argc, char* argv[])
             {
                 windsim.setVtkOutFlag( i_, true );
             }
+            if(vm["write_netcdf_output"].as<bool>())
+            {
+                option_dependency(vm, "write_netcdf_output", "netcdf_file");
+                windsim.setNetcdfOutFlag( i_, true );
+                windsim.setNetcdfOutFilename( i_, vm["netcdf_file"].as<std::string>() );
+            }
             if(vm["write_pdf_output"].as<bool>())
             {
                 windsim.setPDFOutFlag( i_, true );
@@ -1489,6 +1599,12 @@ int windNinjaCLI(int argc, char* argv[])
             windsim.set_writeFarsiteAtmFile(true);
         }
 
+        if(vm["wind_atlas"].as<bool>())
+        {
+            option_dependency(vm, "wind_atlas", "input_speed");
+            windsim.setWindAtlasFlag(true);
+        }
+
         //run the simulations
         if(!windsim.startRuns(vm["num_threads"].as<int>()))
         {
@@ -60,6 +60,8 @@ void option_dependency(const po::variables_map& vm, const char* for_what, const
 
 void verify_option_set(const po::variables_map& vm, const char* optn);
 
+std::vector<double> parse_value_list(const char* optn, const std::string& value);
+
 
 //bool checkArgs(string arg1, string arg2, string arg3);
 
@@ -0,0 +1,194 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Long lived command server for WindNinja runs
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "cli_server.h"
+#include "cli.h"
+#include "GridResamplePlan.h"
+#include "KmlVector.h"
+#include "OutputWriter.h"
+#include "ninja_incremental.h"
+#include "ninja_wind_atlas.h"
+#include "wxModelReader.h"
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include <ctime>
+#include <sstream>
+
+const char *NinjaServer::DEFAULT_CACHE_DIR = "/vsimem/windninja_server";
+
+NinjaServer::NinjaServer() : runCount( 0 )
+{
+    if( CPLGetConfigOption( "NINJA_GRID_CACHE_DIR", NULL ) == NULL )
+    {
+        cacheDir = CPLGetConfigOption( "NINJA_SERVER_CACHE_DIR",
+                                       DEFAULT_CACHE_DIR );
+        VSIMkdir( cacheDir.c_str(), 0755 );
+        CPLSetConfigOption( "NINJA_GRID_CACHE_DIR", cacheDir.c_str() );
+    }
+}
+
+NinjaServer::~NinjaServer()
+{
+    if( !cacheDir.empty() )
+    {
+        ClearCache();
+        CPLSetConfigOption( "NINJA_GRID_CACHE_DIR", NULL );
+    }
+}
+
+/*
+** Drop the process caches kept between runs and remove the files of the
+** in-memory grid cache.  A cache directory set by the caller through
+** NINJA_GRID_CACHE_DIR is never touched.
+*/
+void NinjaServer::ClearCache()
+{
+    NinjaWindAtlas::ClearCache();
+    NinjaIncremental::ClearCache();
+    GridResamplePlan::ClearCache();
+    OutputWriter::ClearBasemapCache();
+    wxModelReader::ClearCache();
+    KmlVector::ClearLegendCache();
+
+    if( cacheDir.empty() )
+        return;
+    char **papszFiles = VSIReadDir( cacheDir.c_str() );
+    for( int i = 0; papszFiles != NULL && papszFiles[i] != NULL; i++ )
+    {
+        if( EQUAL( papszFiles[i], "." ) || EQUAL( papszFiles[i], ".." ) )
+            continue;
+        VSIUnlink( CPLFormFilename( cacheDir.c_str(), papszFiles[i], NULL ) );
+    }
+    CSLDestroy( papszFiles );
+}
+
+/**
+ * Handle one request line and write the reply.
+ *
+ * @param request request line.
+ * @param out stream for the reply.
+ * @return false if the server should stop.
+ */
+bool NinjaServer::HandleRequest( std::string const &request, std::ostream &out )
+{
+    char **papszTokens = CSLTokenizeString2( request.c_str(), " \t\r",
+                                             CSLT_HONOURSTRINGS );
+    if( CSLCount( papszTokens ) == 0 )
+    {
+        CSLDestroy( papszTokens );
+        return true;
+    }
+
+    bool bContinue = true;
+    const char *pszCommand = papszTokens[0];
+    if( EQUAL( pszCommand, "run" ) )
+    {
+        if( CSLCount( papszTokens ) < 2 )
+        {
+            out << "ERROR run needs arguments" << std::endl;
+        }
+        else
+        {
+            runCount++;
+            /* replace the command with the program name windNinjaCLI expects */
+            CPLFree( papszTokens[0] );
+            papszTokens[0] = CPLStrdup( "WindNinja_cli" );
+            time_t start = time( NULL );
+            int rc;
+            try
+            {
+                rc = windNinjaCLI( CSLCount( papszTokens ), papszTokens );
+            }
+            catch( std::exception &e )
+            {
+                CPLDebug( "NINJA", "Server run %d failed: %s", runCount, e.what() );
+                rc = -1;
+            }
+            if( rc == 0 )
+                out << "OK " << runCount << " " << (long)( time( NULL ) - start ) << std::endl;
+            else
+                out << "ERROR " << runCount << " " << rc << std::endl;
+        }
+    }
+    else if( EQUAL( pszCommand, "ping" ) )
+    {
+        out << "OK ping" << std::endl;
+    }
+    else if( EQUAL( pszCommand, "clear" ) )
+    {
+        ClearCache();
+        out << "OK clear" << std::endl;
+    }
+    else if( EQUAL( pszCommand, "quit" ) )
+    {
+        out << "OK quit" << std::endl;
+        bContinue = false;
+    }
+    else
+    {
+        out << "ERROR unknown command " << pszCommand << std::endl;
+    }
+    CSLDestroy( papszTokens );
+    return bContinue;
+}
+
+/**
+ * Serve requests until quit or the end of the input.
+ *
+ * @param in request stream.
+ * @param out reply file, flushed after each reply.
+ * @return 0
+ */
+int NinjaServer::Serve( std::istream &in, FILE *out )
+{
+    std::string request;
+    bool bContinue = true;
+    while( bContinue && std::getline( in, request ) )
+    {
+        std::ostringstream reply;
+        bContinue = HandleRequest( request, reply );
+        fputs( reply.str().c_str(), out );
+        fflush( out );
+    }
+    return 0;
+}
+
+/**
+ * Run a server on the given streams.
+ *
+ * @see NinjaServer
+ */
+int windNinjaServer( std::istream &in, FILE *out )
+{
+    NinjaServer server;
+    return server.Serve( in, out );
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Long lived command server for WindNinja runs
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef CLI_SERVER_H
+#define CLI_SERVER_H
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+/**
+ * Line based server that runs WindNinja requests in one long lived process.
+ *
+ * Each request is one line.  The first word is the command:
+ *
+ *   run <args>   run WindNinja with the same arguments as the command line
+ *                interface, usually just a configuration file.
+ *   ping         check that the server is alive.
+ *   clear        drop the wind atlas, incremental run, resampling plan,
+ *                basemap, forecast and legend caches and the in-memory
+ *                grid cache.
+ *   quit         stop the server.
+ *
+ * Each request gets one reply line starting with OK or ERROR.  Runs are
+ * executed in arrival order; each run spreads its ninjas over the threads
+ * given by its own num_threads option.
+ *
+ * GDAL drivers, the time zone database and the PDF basemap cache stay loaded
+ * between requests.  Unless NINJA_GRID_CACHE_DIR is already set, the
+ * elevation and surface grid cache is kept in memory under
+ * NINJA_SERVER_CACHE_DIR, so repeated runs on a domain skip the DEM read
+ * and surface processing.
+ */
+class NinjaServer
+{
+public:
+    NinjaServer();
+    ~NinjaServer();
+
+    int Serve( std::istream &in, FILE *out );
+    bool HandleRequest( std::string const &request, std::ostream &out );
+
+    static const char *DEFAULT_CACHE_DIR;
+
+private:
+    void ClearCache();
+
+    std::string cacheDir;
+    int runCount;
+};
+
+int windNinjaServer( std::istream &in, FILE *out );
+
+#endif /* CLI_SERVER_H */
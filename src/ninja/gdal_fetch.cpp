@@ -182,9 +182,15 @@ SURF_FETCH_E GDALFetch::FetchBoundingBox(double *bbox, double resolution,
     GDALSetProjection(hDstDS, pszDstWKT);
     GDALSetGeoTransform(hDstDS, adfDstGeoTransform);
 
+    /* warp from cached tiles of the source if the cache is enabled */
+    GDALDatasetH hCacheDS = OpenCachedSource(hSrcDS, pszDstWKT,
+                                             adfDstGeoTransform,
+                                             nPixels, nLines);
+    GDALDatasetH hWarpSrcDS = hCacheDS != NULL ? hCacheDS : hSrcDS;
+
     GDALWarpOptions *psWarpOptions = GDALCreateWarpOptions();
 
-    psWarpOptions->hSrcDS = hSrcDS;
+    psWarpOptions->hSrcDS = hWarpSrcDS;
     psWarpOptions->hDstDS = hDstDS;
 
     psWarpOptions->nBandCount = 1;
@@ -198,7 +204,7 @@ SURF_FETCH_E GDALFetch::FetchBoundingBox(double *bbox, double resolution,
     //psWarpOptions->pfnProgress = GDALTermProgress;
 
     psWarpOptions->pTransformerArg = 
-        GDALCreateGenImgProjTransformer( hSrcDS, 
+        GDALCreateGenImgProjTransformer( hWarpSrcDS, 
                                          GDALGetProjectionRef(hSrcDS), 
                                          hDstDS,
                                          GDALGetProjectionRef(hDstDS), 
@@ -217,6 +223,10 @@ SURF_FETCH_E GDALFetch::FetchBoundingBox(double *bbox, double resolution,
 
     GDALDestroyGenImgProjTransformer( psWarpOptions->pTransformerArg );
     GDALDestroyWarpOptions( psWarpOptions );
+    if( hCacheDS != NULL )
+    {
+        GDALClose( hCacheDS );
+    }
 
     if( eErr != CE_None )
     {
@@ -208,6 +208,25 @@ SURF_FETCH_E LandfireClient::FetchBoundingBox( double *bbox, double resolution,
     pszUrl = CPLSPrintf( LF_REQUEST_TEMPLATE, bbox[0], bbox[2], bbox[3],
                                               bbox[1], pszProduct );
 
+    /*
+    ** The server clips and projects the request, so an archive can only be
+    ** reused for the same box, product and projection.
+    */
+    std::string osCacheKey;
+    if( SurfaceTileCache::IsEnabled() )
+    {
+        osCacheKey = SurfaceTileCache::FormKey( CPLSPrintf( "landfire|%s|%d",
+                                                            pszUrl, nEpsgCode ) );
+        std::string osCachedZip = SurfaceTileCache::FindFile( osCacheKey, ".zip" );
+        if( !osCachedZip.empty() )
+        {
+            CPLDebug( "LCP_CLIENT", "Using cached archive %s",
+                      osCachedZip.c_str() );
+            CPLFree( (void*)pszProduct );
+            return ExtractLcp( osCachedZip.c_str(), filename );
+        }
+    }
+
     CPLFree( (void*)pszProduct );
     m_poResult = CPLHTTPFetch( pszUrl, NULL );
     CHECK_HTTP_RESULT( "Failed to get download URL" );
@@ -358,9 +377,10 @@ SURF_FETCH_E LandfireClient::FetchBoundingBox( double *bbox, double resolution,
 
     nSize = m_poResult->nDataLen;
     VSILFILE *fout;
-    const char *pszTmpZip = CPLFormFilename( NULL, 
-                                             CPLGenerateTempFilename( "NINJA_LCP_CLIENT" ),
-                                             ".zip" );
+    std::string osTmpZip = CPLFormFilename( NULL, 
+                                            CPLGenerateTempFilename( "NINJA_LCP_CLIENT" ),
+                                            ".zip" );
+    const char *pszTmpZip = osTmpZip.c_str();
     fout = VSIFOpenL( pszTmpZip, "w+" );
     if( NULL == fout )
     {
@@ -373,12 +393,33 @@ SURF_FETCH_E LandfireClient::FetchBoundingBox( double *bbox, double resolution,
 
     CPLHTTPDestroyResult( m_poResult );
 
-    /*
-    ** Extract the lcp and the prj file, and 'save as'
-    */
+    SURF_FETCH_E nError = ExtractLcp( pszTmpZip, filename );
+    if( nError == SURF_FETCH_E_NONE && !osCacheKey.empty() )
+    {
+        SurfaceTileCache::StoreFile( osCacheKey, ".zip", pszTmpZip );
+    }
+
+    if( !CSLTestBoolean( CPLGetConfigOption( "LCP_KEEP_ARCHIVE", "FALSE" ) ) )
+    {
+        VSIUnlink( pszTmpZip );
+    }
+
+    return nError;
+}
+
+/**
+ * Extract the lcp and the prj file from a downloaded archive and 'save as'.
+ *
+ * @param pszZip archive returned by the download service.
+ * @param filename lcp file to write, the prj is written next to it.
+ * @return zero on success.
+ */
+SURF_FETCH_E LandfireClient::ExtractLcp( const char *pszZip,
+                                         const char *filename )
+{
     char **papszFileList = NULL;
     std::string osPathInZip;
-    const char *pszVSIZip = CPLSPrintf( "/vsizip/%s", pszTmpZip );
+    const char *pszVSIZip = CPLSPrintf( "/vsizip/%s", pszZip );
     CPLDebug( "LCP_CLIENT", "Extracting lcp from %s", pszVSIZip );
     papszFileList = VSIReadDirRecursive( pszVSIZip );
     int bFound = FALSE;
@@ -399,22 +440,20 @@ SURF_FETCH_E LandfireClient::FetchBoundingBox( double *bbox, double resolution,
     {
         CPLError( CE_Failure, CPLE_AppDefined,
                   "Failed to find lcp in archive" );
-        //VSIUnlink( pszTmpZip );
         return SURF_FETCH_E_IO_ERR;
     }
     int nError = 0;
     const char *pszFileToFind = CPLSPrintf( "%s/Landscape_1.lcp",
                                             osPathInZip.c_str() );
-    nError = ExtractFileFromZip( pszTmpZip, pszFileToFind, filename );
+    nError = ExtractFileFromZip( pszZip, pszFileToFind, filename );
     if( nError )
     {
         CPLError( CE_Failure, CPLE_AppDefined,
                   "Failed to extract LCP from zip." );
-        VSIUnlink( pszTmpZip );
         return SURF_FETCH_E_IO_ERR;
     }
     pszFileToFind = CPLSPrintf( "%s/Landscape_1.prj", osPathInZip.c_str() );
-    nError = ExtractFileFromZip( pszTmpZip, pszFileToFind,
+    nError = ExtractFileFromZip( pszZip, pszFileToFind,
                                  CPLFormFilename( CPLGetPath( filename ),
                                                   CPLGetBasename( filename ),
                                                   ".prj" ) );
@@ -424,12 +463,6 @@ SURF_FETCH_E LandfireClient::FetchBoundingBox( double *bbox, double resolution,
                   "Failed to extract PRJ from zip." );
         return SURF_FETCH_E_IO_ERR;
     }
-
-    if( !CSLTestBoolean( CPLGetConfigOption( "LCP_KEEP_ARCHIVE", "FALSE" ) ) )
-    {
-        VSIUnlink( pszTmpZip );
-    }
-
     return SURF_FETCH_E_NONE;
 }
 
@@ -141,6 +141,7 @@ private:
     LandfireClient( LandfireClient &oOther ) { (void)oOther; }
 
     const char * ReplaceSRS( int nEpsgCode, const char *pszUrl );
+    SURF_FETCH_E ExtractLcp( const char *pszZip, const char *filename );
 
     CPLHTTPResult *m_poResult;
     std::string m_JobId;
@@ -0,0 +1,284 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Initialize a run from a forecast handed over in memory
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "memorySurfInitialization.h"
+
+memorySurfInitialization::memorySurfInitialization() : wxModelInitialization()
+{
+
+}
+
+memorySurfInitialization::memorySurfInitialization( memorySurfInitialization const& A )
+    : wxModelInitialization( A )
+{
+    wxModelFileName = A.wxModelFileName;
+}
+
+memorySurfInitialization::~memorySurfInitialization()
+{
+}
+
+memorySurfInitialization& memorySurfInitialization::operator= ( memorySurfInitialization const& A )
+{
+    if( &A != this ) {
+        wxModelInitialization::operator=( A );
+    }
+    return *this;
+}
+
+/**
+ * Wind height stored with the forecast.
+ * @return height of the forecast wind above ground in meters.
+ */
+double memorySurfInitialization::Get_Wind_Height()
+{
+    GDALDatasetH hDS = GDALOpen( wxModelFileName.c_str(), GA_ReadOnly );
+    if( hDS == NULL )
+        throw badForecastFile( "Cannot open the in-memory forecast." );
+    const char *pszHeight = GDALGetMetadataItem( hDS, "WIND_HEIGHT", NULL );
+    double dfHeight = pszHeight ? CPLAtof( pszHeight ) : 10.0;
+    GDALClose( hDS );
+    return dfHeight;
+}
+
+double memorySurfInitialization::getGridResolution()
+{
+    return -1.0;
+}
+
+/**
+ * Fetch the variable names, in band order within a time step.
+ *
+ * @return a vector of variable names
+ */
+std::vector<std::string> memorySurfInitialization::getVariableList()
+{
+    std::vector<std::string> varList;
+    varList.push_back( "U" );
+    varList.push_back( "V" );
+    varList.push_back( "T" );
+    varList.push_back( "CLOUD" );
+    return varList;
+}
+
+std::string memorySurfInitialization::getForecastIdentifier()
+{
+    return std::string( "MEMORY" );
+}
+
+std::string memorySurfInitialization::getPath()
+{
+    return std::string( "" );
+}
+
+int memorySurfInitialization::getStartHour()
+{
+    return 0;
+}
+
+int memorySurfInitialization::getEndHour()
+{
+    return 0;
+}
+
+/**
+ * Identify an in-memory forecast by name.
+ *
+ * @param fileName name returned by NinjaMemoryInput::CreateForecast().
+ * @return true if the name refers to an in-memory forecast.
+ */
+bool memorySurfInitialization::identify( std::string fileName )
+{
+    return NinjaMemoryInput::IsForecast( fileName );
+}
+
+/**
+ * Fetch the valid times of the forecast steps.
+ *
+ * @param pszVariable unused, all variables share the time steps.
+ * @param timeZonePtr time zone of the returned times.
+ * @return one time per step, in step order.
+ */
+std::vector<blt::local_date_time>
+memorySurfInitialization::getTimeList( const char *pszVariable,
+                                       blt::time_zone_ptr timeZonePtr )
+{
+    if( aoCachedTimes.size() > 0 )
+        return aoCachedTimes;
+    (void)pszVariable;
+
+    GDALDatasetH hDS = GDALOpen( wxModelFileName.c_str(), GA_ReadOnly );
+    if( hDS == NULL )
+        throw badForecastFile( "Cannot open the in-memory forecast." );
+
+    std::vector<blt::local_date_time> aoTimeList;
+    bpt::ptime time_t_epoch( boost::gregorian::date( 1970,1,1 ) );
+    int nBands = GDALGetRasterCount( hDS );
+    for( int b = 1; b <= nBands; b += NinjaMemoryInput::FORECAST_BANDS_PER_STEP )
+    {
+        const char *pszValidTime =
+            GDALGetMetadataItem( GDALGetRasterBand( hDS, b ), "VALID_TIME", NULL );
+        if( pszValidTime == NULL )
+        {
+            GDALClose( hDS );
+            throw badForecastFile( "Missing valid time in the in-memory forecast." );
+        }
+        bpt::time_duration duration( 0, 0, (long)CPLAtoGIntBig( pszValidTime ) );
+        aoTimeList.push_back( blt::local_date_time( time_t_epoch + duration,
+                                                    timeZonePtr ) );
+    }
+    GDALClose( hDS );
+    aoCachedTimes = aoTimeList;
+    return aoCachedTimes;
+}
+
+/**
+ * Checks the forecast values are in range.
+ */
+void memorySurfInitialization::checkForValidData()
+{
+    GDALDatasetH hDS = GDALOpen( wxModelFileName.c_str(), GA_ReadOnly );
+    if( hDS == NULL )
+        throw badForecastFile( "Cannot open the in-memory forecast." );
+
+    int nXSize = GDALGetRasterXSize( hDS );
+    int nYSize = GDALGetRasterYSize( hDS );
+    int nBands = GDALGetRasterCount( hDS );
+    if( nBands % NinjaMemoryInput::FORECAST_BANDS_PER_STEP != 0 )
+    {
+        GDALClose( hDS );
+        throw badForecastFile( "Incomplete time step in the in-memory forecast." );
+    }
+
+    std::vector<double> adfData( (size_t)nXSize * nYSize );
+    for( int b = 1; b <= nBands; b++ )
+    {
+        int k = ( b - 1 ) % NinjaMemoryInput::FORECAST_BANDS_PER_STEP;
+        GDALRasterIO( GDALGetRasterBand( hDS, b ), GF_Read, 0, 0, nXSize, nYSize,
+                      &adfData[0], nXSize, nYSize, GDT_Float64, 0, 0 );
+        for( size_t i = 0; i < adfData.size(); i++ )
+        {
+            double v = adfData[i];
+            bool bBad = CPLIsNan( v );
+            if( k == 0 || k == 1 )        //u, v in m/s
+                bBad = bBad || std::abs( v ) > 220.0;
+            else if( k == 2 )             //air temperature in K
+                bBad = bBad || v < 180.0 || v > 340.0;
+            else                          //cloud cover in percent
+                bBad = bBad || v < 0.0 || v > 100.0;
+            if( bBad )
+            {
+                GDALClose( hDS );
+                throw badForecastFile( CPLSPrintf( "Value out of range in band %d "
+                                                   "of the in-memory forecast.", b ) );
+            }
+        }
+    }
+    GDALClose( hDS );
+}
+
+/**
+ * Sets the surface grids from the time step matching the run time.
+ * @param input The WindNinjaInputs for misc. info.
+ * @param airGrid The air temperature grid to be filled.
+ * @param cloudGrid The cloud cover grid to be filled.
+ * @param uGrid The u velocity grid to be filled.
+ * @param vGrid The v velocity grid to be filled.
+ * @param wGrid The w velocity grid to be filled with zeros.
+ */
+void memorySurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
+        AsciiGrid<double> &airGrid,
+        AsciiGrid<double> &cloudGrid,
+        AsciiGrid<double> &uGrid,
+        AsciiGrid<double> &vGrid,
+        AsciiGrid<double> &wGrid )
+{
+    int nStep = -1;
+    std::vector<blt::local_date_time> timeList( getTimeList( NULL, input.ninjaTimeZone ) );
+    for( unsigned int i = 0; i < timeList.size(); i++ )
+    {
+        if( input.ninjaTime == timeList[i] )
+        {
+            nStep = i;
+            break;
+        }
+    }
+    if( nStep < 0 )
+        throw std::runtime_error( "Could not match ninjaTime with a time step in the in-memory forecast." );
+
+    GDALDataset *srcDS = (GDALDataset*)GDALOpen( input.forecastFilename.c_str(), GA_ReadOnly );
+    if( srcDS == NULL )
+        throw badForecastFile( "Cannot open the in-memory forecast." );
+    std::string srcWkt = srcDS->GetProjectionRef();
+    std::string dstWkt = input.dem.prjString;
+    if( dstWkt.empty() )
+        dstWkt = srcWkt;
+
+    //only warp the four bands of this step
+    const int nBandCount = NinjaMemoryInput::FORECAST_BANDS_PER_STEP;
+    GDALWarpOptions *psWarpOptions = GDALCreateWarpOptions();
+    psWarpOptions->nBandCount = nBandCount;
+    psWarpOptions->panSrcBands = (int*) CPLMalloc( sizeof( int ) * nBandCount );
+    psWarpOptions->panDstBands = (int*) CPLMalloc( sizeof( int ) * nBandCount );
+    psWarpOptions->padfDstNoDataReal = (double*) CPLMalloc( sizeof( double ) * nBandCount );
+    psWarpOptions->padfDstNoDataImag = (double*) CPLMalloc( sizeof( double ) * nBandCount );
+    for( int b = 0; b < nBandCount; b++ )
+    {
+        psWarpOptions->panSrcBands[b] = nStep * nBandCount + b + 1;
+        psWarpOptions->panDstBands[b] = b + 1;
+        psWarpOptions->padfDstNoDataReal[b] = -9999.0;
+        psWarpOptions->padfDstNoDataImag[b] = -9999.0;
+    }
+    psWarpOptions->papszWarpOptions =
+        CSLSetNameValue( psWarpOptions->papszWarpOptions, "INIT_DEST", "NO_DATA" );
+
+    GDALDataset *wrpDS = (GDALDataset*) GDALAutoCreateWarpedVRT( srcDS, srcWkt.c_str(),
+                                                                 dstWkt.c_str(),
+                                                                 GRA_NearestNeighbour,
+                                                                 1.0, psWarpOptions );
+    GDALDestroyWarpOptions( psWarpOptions );
+    if( wrpDS == NULL )
+    {
+        GDALClose( (GDALDatasetH) srcDS );
+        throw badForecastFile( "Cannot warp the in-memory forecast to the DEM." );
+    }
+
+    GDAL2AsciiGrid( wrpDS, 1, uGrid );
+    GDAL2AsciiGrid( wrpDS, 2, vGrid );
+    GDAL2AsciiGrid( wrpDS, 3, airGrid );
+    GDAL2AsciiGrid( wrpDS, 4, cloudGrid );
+
+    GDALClose( (GDALDatasetH) wrpDS );
+    GDALClose( (GDALDatasetH) srcDS );
+
+    cloudGrid /= 100.0;
+
+    wGrid.set_headerData( uGrid );
+    wGrid = 0.0;
+}
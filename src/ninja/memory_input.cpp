@@ -0,0 +1,244 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Wrap caller supplied grids as in-memory GDAL datasets
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "memory_input.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#define MEMORY_INPUT_DIR "/vsimem/windninja_input"
+
+/**
+ * Form a file name that is unique in this process.
+ *
+ * @param pszPrefix short description used in the name.
+ * @return /vsimem path for a new GeoTIFF.
+ */
+std::string NinjaMemoryInput::FormFileName( const char *pszPrefix )
+{
+    static int nCounter = 0;
+    int nId;
+#pragma omp critical(memory_input_name)
+    nId = ++nCounter;
+    return std::string( CPLSPrintf( "%s/%s_%d.tif", MEMORY_INPUT_DIR,
+                                    pszPrefix, nId ) );
+}
+
+/**
+ * Create an empty Float64 GeoTIFF with georeferencing.
+ *
+ * @return the dataset, which the caller closes.
+ */
+GDALDatasetH NinjaMemoryInput::Create( std::string const &name, int nBands,
+                                       int nXSize, int nYSize,
+                                       const double *padfGeoTransform,
+                                       const char *pszWkt )
+{
+    if( nBands < 1 || nXSize < 1 || nYSize < 1 || padfGeoTransform == NULL )
+        throw std::runtime_error( "Invalid in-memory grid dimensions." );
+    if( pszWkt == NULL || pszWkt[0] == '\0' )
+        throw std::runtime_error( "In-memory grids need a projection." );
+
+    GDALDriverH hDriver = GDALGetDriverByName( "GTiff" );
+    if( hDriver == NULL )
+        throw std::runtime_error( "The GTiff driver is not available." );
+
+    //many small bands for a forecast, keep them interleaved by band
+    char **papszOptions = CSLSetNameValue( NULL, "INTERLEAVE", "BAND" );
+    GDALDatasetH hDS = GDALCreate( hDriver, name.c_str(), nXSize, nYSize,
+                                   nBands, GDT_Float64, papszOptions );
+    CSLDestroy( papszOptions );
+    if( hDS == NULL )
+        throw std::runtime_error( "Could not create an in-memory grid." );
+
+    GDALSetGeoTransform( hDS, (double*)padfGeoTransform );
+    GDALSetProjection( hDS, pszWkt );
+    return hDS;
+}
+
+/**
+ * Copy grids into one in-memory dataset.
+ *
+ * @param pszPrefix short description used in the file name.
+ * @param nBands number of bands.
+ * @param papadfBands nXSize * nYSize values per band, NULL bands are
+ *                    filled with dfNoData.
+ * @param padfGeoTransform GDAL geotransform of the grids.
+ * @param pszWkt projection of the grids.
+ * @param dfNoData no data value.
+ * @return the /vsimem file name, to be passed to Release() when done.
+ */
+std::string NinjaMemoryInput::CreateGrid( const char *pszPrefix, int nBands,
+                                          const double * const *papadfBands,
+                                          int nXSize, int nYSize,
+                                          const double *padfGeoTransform,
+                                          const char *pszWkt, double dfNoData )
+{
+    std::string name = FormFileName( pszPrefix );
+    GDALDatasetH hDS = Create( name, nBands, nXSize, nYSize,
+                               padfGeoTransform, pszWkt );
+    CPLErr eErr = CE_None;
+    for( int i = 0; i < nBands && eErr == CE_None; i++ )
+    {
+        GDALRasterBandH hBand = GDALGetRasterBand( hDS, i + 1 );
+        GDALSetRasterNoDataValue( hBand, dfNoData );
+        if( papadfBands[i] == NULL )
+            eErr = GDALFillRaster( hBand, dfNoData, 0.0 );
+        else
+            eErr = GDALRasterIO( hBand, GF_Write, 0, 0, nXSize, nYSize,
+                                 (void*)papadfBands[i], nXSize, nYSize,
+                                 GDT_Float64, 0, 0 );
+    }
+    GDALClose( hDS );
+    if( eErr != CE_None )
+    {
+        Release( name );
+        throw std::runtime_error( "Could not write an in-memory grid." );
+    }
+    return name;
+}
+
+/**
+ * Copy a surface forecast into one in-memory dataset.
+ *
+ * @param nSteps number of time steps.
+ * @param panValidTimes valid time of each step, seconds since the epoch.
+ * @param padfU u wind (m/s), nSteps grids of nXSize * nYSize values.
+ * @param padfV v wind (m/s), same layout.
+ * @param padfAir air temperature (K), same layout.
+ * @param padfCloud cloud cover (percent), same layout.
+ * @param dfWindHeight height of the wind above ground (m).
+ * @return the /vsimem file name, to be passed to Release() when done.
+ */
+std::string NinjaMemoryInput::CreateForecast( int nSteps, const time_t *panValidTimes,
+                                              const double *padfU, const double *padfV,
+                                              const double *padfAir,
+                                              const double *padfCloud,
+                                              int nXSize, int nYSize,
+                                              const double *padfGeoTransform,
+                                              const char *pszWkt,
+                                              double dfWindHeight )
+{
+    if( nSteps < 1 || panValidTimes == NULL || padfU == NULL ||
+        padfV == NULL || padfAir == NULL || padfCloud == NULL )
+        throw std::runtime_error( "Incomplete in-memory forecast." );
+
+    std::string name = FormFileName( "forecast" );
+    GDALDatasetH hDS = Create( name, nSteps * FORECAST_BANDS_PER_STEP,
+                               nXSize, nYSize, padfGeoTransform, pszWkt );
+    GDALSetMetadataItem( hDS, "WINDNINJA_MEMORY_FORECAST", "YES", NULL );
+    GDALSetMetadataItem( hDS, "WIND_HEIGHT", CPLSPrintf( "%.17g", dfWindHeight ),
+                         NULL );
+
+    const double *apadfFields[FORECAST_BANDS_PER_STEP] =
+        { padfU, padfV, padfAir, padfCloud };
+    const char *apszNames[FORECAST_BANDS_PER_STEP] = { "U", "V", "T", "CLOUD" };
+    size_t nGridSize = (size_t)nXSize * nYSize;
+    CPLErr eErr = CE_None;
+    for( int i = 0; i < nSteps && eErr == CE_None; i++ )
+    {
+        for( int k = 0; k < FORECAST_BANDS_PER_STEP && eErr == CE_None; k++ )
+        {
+            GDALRasterBandH hBand =
+                GDALGetRasterBand( hDS, i * FORECAST_BANDS_PER_STEP + k + 1 );
+            GDALSetDescription( hBand, apszNames[k] );
+            GDALSetMetadataItem( hBand, "VALID_TIME",
+                                 CPLSPrintf( CPL_FRMT_GIB, (GIntBig)panValidTimes[i] ),
+                                 NULL );
+            eErr = GDALRasterIO( hBand, GF_Write, 0, 0, nXSize, nYSize,
+                                 (void*)( apadfFields[k] + i * nGridSize ),
+                                 nXSize, nYSize, GDT_Float64, 0, 0 );
+        }
+    }
+    GDALClose( hDS );
+    if( eErr != CE_None )
+    {
+        Release( name );
+        throw std::runtime_error( "Could not write an in-memory forecast." );
+    }
+    return name;
+}
+
+/**
+ * Check if a path is the directory of the in-memory inputs, or in it.
+ */
+bool NinjaMemoryInput::IsMemoryPath( std::string const &path )
+{
+    return EQUALN( path.c_str(), MEMORY_INPUT_DIR, strlen( MEMORY_INPUT_DIR ) );
+}
+
+/**
+ * Check if a name refers to an in-memory input.
+ */
+bool NinjaMemoryInput::IsMemoryFile( std::string const &name )
+{
+    return EQUALN( name.c_str(), MEMORY_INPUT_DIR "/",
+                   strlen( MEMORY_INPUT_DIR "/" ) );
+}
+
+/**
+ * Check if a name refers to an in-memory forecast.
+ */
+bool NinjaMemoryInput::IsForecast( std::string const &name )
+{
+    if( !IsMemoryFile( name ) )
+        return false;
+    GDALDatasetH hDS = GDALOpen( name.c_str(), GA_ReadOnly );
+    if( hDS == NULL )
+        return false;
+    bool bForecast =
+        GDALGetMetadataItem( hDS, "WINDNINJA_MEMORY_FORECAST", NULL ) != NULL;
+    GDALClose( hDS );
+    return bForecast;
+}
+
+/**
+ * Free an in-memory input.  Names that are not in-memory inputs are left
+ * alone.
+ */
+void NinjaMemoryInput::Release( std::string const &name )
+{
+    if( IsMemoryFile( name ) )
+        VSIUnlink( name.c_str() );
+}
+
+/**
+ * Take ownership of an in-memory input.  It is released when the last copy
+ * of the returned pointer goes away.
+ */
+NinjaMemoryInput::Ptr NinjaMemoryInput::Hold( std::string const &name )
+{
+    return Ptr( new std::string( name ), Releaser() );
+}
+
+void NinjaMemoryInput::Releaser::operator()( const std::string *name ) const
+{
+    Release( *name );
+    delete name;
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Wrap caller supplied grids as in-memory GDAL datasets
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef MEMORY_INPUT_H
+#define MEMORY_INPUT_H
+
+#include <ctime>
+#include <string>
+
+#include "boost/shared_ptr.hpp"
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "gdal.h"
+
+/**
+ * Inputs handed over in memory by an embedding application.
+ *
+ * Grids are copied into GeoTIFF files in GDAL's /vsimem file system, so
+ * every part of WindNinja that opens its inputs by name reads them without
+ * touching the disk.  All grids are north up, rows top to bottom, with a
+ * GDAL geotransform and WKT projection.
+ *
+ * A forecast holds four bands per time step, u and v (m/s), air
+ * temperature (K) and cloud cover (percent), and is identified by the
+ * WINDNINJA_MEMORY_FORECAST metadata item.  Each step carries its valid
+ * time in seconds since the epoch (UTC) in the VALID_TIME band metadata.
+ *
+ * Outputs that would be written next to an in-memory input go to the
+ * working directory instead, see IsMemoryPath().
+ *
+ * Hold() shares an input between the armies that use it, so copies of an
+ * army don't free it out from under each other.
+ */
+class NinjaMemoryInput
+{
+public:
+    static std::string CreateGrid( const char *pszPrefix, int nBands,
+                                   const double * const *papadfBands,
+                                   int nXSize, int nYSize,
+                                   const double *padfGeoTransform,
+                                   const char *pszWkt, double dfNoData );
+
+    static std::string CreateForecast( int nSteps, const time_t *panValidTimes,
+                                       const double *padfU, const double *padfV,
+                                       const double *padfAir,
+                                       const double *padfCloud,
+                                       int nXSize, int nYSize,
+                                       const double *padfGeoTransform,
+                                       const char *pszWkt,
+                                       double dfWindHeight );
+
+    static bool IsMemoryPath( std::string const &path );
+    static bool IsMemoryFile( std::string const &name );
+    static bool IsForecast( std::string const &name );
+    static void Release( std::string const &name );
+
+    typedef boost::shared_ptr<const std::string> Ptr;
+    static Ptr Hold( std::string const &name );
+
+    static const int FORECAST_BANDS_PER_STEP = 4;
+
+private:
+    struct Releaser
+    {
+        void operator()( const std::string *name ) const;
+    };
+
+    static std::string FormFileName( const char *pszPrefix );
+    static GDALDatasetH Create( std::string const &name, int nBands,
+                                int nXSize, int nYSize,
+                                const double *padfGeoTransform,
+                                const char *pszWkt );
+};
+
+#endif /* MEMORY_INPUT_H */
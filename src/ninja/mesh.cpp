@@ -798,11 +798,16 @@ void Mesh::set_meshResChoice(eMeshChoice choice)
 }
 
 void Mesh::compute_cellsize(Elevation& dem)
+{
+     compute_cellsize(dem.get_nCols(), dem.get_nRows(), dem.get_cellSize());
+}
+
+void Mesh::compute_cellsize(int nCols, int nRows, double cellSize)
 {
      double nXcells, nYcells, Xlength, Ylength, Xcellsize, Ycellsize;
 
-     Xlength=(dem.get_nCols()+1)*dem.get_cellSize();
-     Ylength=(dem.get_nRows()+1)*dem.get_cellSize();
+     Xlength=(nCols+1)*cellSize;
+     Ylength=(nRows+1)*cellSize;
 
      nXcells=2*std::sqrt((double)targetNumHorizCells)*(Xlength/(Xlength+Ylength));
      nYcells=2*std::sqrt((double)targetNumHorizCells)*(Ylength/(Xlength+Ylength));
@@ -94,6 +94,7 @@ public:
     void set_targetNumHorizCells(long cells);     //sets the target number of horizontal cells in the mesh and computes the cellsize
     void set_meshResChoice(eMeshChoice choice);               //sets the cellsize based on user selection of coarse, medium, or fine (and returns the cellsize, on error returns cellsize < 0)
     void compute_cellsize(Elevation& dem);                  //utility function to compute the horizontal cellsize given a target number of horizontal cells (and DEM)
+    void compute_cellsize(int nCols, int nRows, double cellSize);   //same, from the DEM header only
     void compute_domain_height(WindNinjaInputs& input);
     void set_domainHeight(double height, lengthUnits::eLengthUnits units);
     void set_numVertLayers(long layers);
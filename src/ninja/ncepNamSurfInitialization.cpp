@@ -150,7 +150,6 @@ void ncepNamSurfInitialization::checkForValidData()
 
     // open ds variable by variable
     GDALDataset *srcDS;
-    std::string temp;
     std::string srcWkt;
     int nBands = 0;
     bool noDataValueExists;
@@ -158,18 +157,11 @@ void ncepNamSurfInitialization::checkForValidData()
 
     std::vector<std::string> varList = getVariableList();
 
-    //Acquire a lock to protect the non-thread safe netCDF library
-#ifdef _OPENMP
-    omp_guard netCDF_guard(netCDF_lock);
-#endif
-
     for( unsigned int i = 0;i < varList.size();i++ ) {
 
-        temp = "NETCDF:" + wxModelFileName + ":" + varList[i];
-
-        srcDS = (GDALDataset*)GDALOpen( temp.c_str(), GA_ReadOnly );
-        if( srcDS == NULL )
-            throw badForecastFile("Cannot open forecast file.");
+        //decoded once under the netCDF lock and shared with the runs
+        wxModelReader reader( wxModelFileName, varList[i] );
+        srcDS = reader.GetDataset();
 
         srcWkt = srcDS->GetProjectionRef();
 
@@ -246,8 +238,6 @@ void ncepNamSurfInitialization::checkForValidData()
 
             delete [] padfScanline;
         }
-
-        GDALClose((GDALDatasetH) srcDS );
     }
 }
 
@@ -376,11 +366,6 @@ void ncepNamSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
 
     //get some info from the nam file in input
 
-    //Acquire a lock to protect the non-thread safe netCDF library
-#ifdef _OPENMP
-    omp_guard netCDF_guard(netCDF_lock);
-#endif
-
     GDALDataset* poDS;
 
     //attempt to grab the projection from the dem?
@@ -404,18 +389,8 @@ void ncepNamSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
         GDALClose((GDALDatasetH) poDS );
     }
 
-    poDS = (GDALDataset*)GDALOpen( input.forecastFilename.c_str(), GA_ReadOnly );
-
-    if( poDS == NULL ) {
-        CPLDebug( "ncepNamSurfInitialization::setSurfaceGrids()",
-                "Bad forecast file" );
-    }
-    else
-        GDALClose((GDALDatasetH) poDS );
-
     // open ds one by one and warp, then write to grid
     GDALDataset *srcDS, *wrpDS;
-    std::string temp;
     std::string srcWkt;
 
     std::vector<std::string> varList = getVariableList();
@@ -427,13 +402,9 @@ void ncepNamSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
 
     for( unsigned int i = 0;i < varList.size();i++ ) {
 
-        temp = "NETCDF:" + input.forecastFilename + ":" + varList[i];
-
-        srcDS = (GDALDataset*)GDALOpenShared( temp.c_str(), GA_ReadOnly );
-        if( srcDS == NULL ) {
-            CPLDebug( "ncepNamSurfInitialization::setSurfaceGrids()",
-                    "Bad forecast file" );
-        }
+        //only the decode is serialized, warping runs concurrently
+        wxModelReader reader( input.forecastFilename, varList[i] );
+        srcDS = reader.GetDataset();
 
         srcWkt = srcDS->GetProjectionRef();
 
@@ -520,7 +491,6 @@ void ncepNamSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
     }
 
         GDALDestroyWarpOptions( psWarpOptions );
-        GDALClose((GDALDatasetH) srcDS );
         GDALClose((GDALDatasetH) wrpDS );
     }
     cloudGrid /= 100.0;
@@ -82,6 +82,8 @@ ninja::ninja()
     nMaxMatchingIters = atoi( CPLGetConfigOption( "NINJA_POINT_MAX_MATCH_ITERS",
                                                   "150" ) );
     CPLDebug( "NINJA", "Maximum match iterations set to: %d", nMaxMatchingIters );
+    nMatchAccelDepth = atoi( CPLGetConfigOption( "NINJA_POINT_MATCH_ACCEL_DEPTH",
+                                                 "10" ) );
 
     //ninjaCom stuff
     input.lastComString[0] = '\0';
@@ -142,6 +144,7 @@ ninja::ninja(const ninja &rhs)
     num_outer_iter_tries_u = rhs.num_outer_iter_tries_u;
     num_outer_iter_tries_v = rhs.num_outer_iter_tries_v;
     num_outer_iter_tries_w = rhs.num_outer_iter_tries_w;
+    nMatchAccelDepth = rhs.nMatchAccelDepth;
 
     //Timers
     startTotal=0.0;
@@ -221,6 +224,7 @@ ninja &ninja::operator=(const ninja &rhs)
         num_outer_iter_tries_u = rhs.num_outer_iter_tries_u;
         num_outer_iter_tries_v = rhs.num_outer_iter_tries_v;
         num_outer_iter_tries_w = rhs.num_outer_iter_tries_w;
+        nMatchAccelDepth = rhs.nMatchAccelDepth;
 
         //Timers
         startTotal=0.0;
@@ -270,11 +274,57 @@ bool ninja::simulate_wind()
 {
 	checkCancel();
 
-	input.Com->ninjaCom(ninjaComClass::ninjaNone, "Reading elevation file...");
-	
-	readInputFile();
-	set_position();
-	set_uniVegetation();
+	//an incremental point run holds the state of the previous run on the domain
+	NinjaIncremental::Ptr poIncremental;
+	std::string incrementalKey;
+	input.incremental = NULL;
+	if(input.incrementalPointRun)
+	{
+	    std::string reason = NinjaIncremental::CheckIncremental(input);
+	    if(reason.empty())
+	        incrementalKey = NinjaIncremental::FormKey(*this);
+	    if(!incrementalKey.empty())
+	    {
+	        poIncremental = NinjaIncremental::Acquire(incrementalKey);
+	        input.incremental = poIncremental.get();
+	    }
+	    else if(!reason.empty())
+	        input.Com->ninjaCom(ninjaComClass::ninjaWarning, "Cannot re-solve incrementally, %s.", reason.c_str());
+	}
+
+	//reruns on the same input and mesh can skip reading and preprocessing
+	std::string gridCacheKey;
+	bool cachedGrids = false;
+	//supplied surface grids are not part of the cache key
+	if(NinjaGridCache::IsEnabled() && input.surfaceGridsFilename == "!set")
+	{
+	    double cachedResolution;
+	    gridCacheKey = NinjaGridCache::FormKey(input.dem.fileName, mesh.meshResolution,
+	                                           mesh.targetNumHorizCells, input.vegetation);
+	    cachedGrids = NinjaGridCache::Read(gridCacheKey, input.dem, input.surface,
+	                                       &cachedResolution);
+	    if(cachedGrids && mesh.meshResolution < 0.0)
+	    {
+	        mesh.meshResolution = cachedResolution;
+	        mesh.meshResolutionUnits = lengthUnits::meters;
+	    }
+	}
+
+	if(cachedGrids)
+	{
+	    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Using cached elevation and surface grids...");
+	    set_position();
+	}
+	else
+	{
+	    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Reading elevation file...");
+
+	    readInputFileAtMeshResolution();
+	    set_position();
+	    set_uniVegetation();
+	    if(input.surfaceGridsFilename != "!set")
+	        importSurfaceGrids();
+	}
 
 	checkInputs();
 
@@ -315,9 +365,22 @@ bool ninja::simulate_wind()
 		startMesh = omp_get_wtime();
 	#endif
 
-	input.Com->ninjaCom(ninjaComClass::ninjaNone, "Generating mesh...");
-	//generate mesh
-	mesh.buildStandardMesh(input);
+	//the grids of the previous run are cached, so its mesh still fits them
+	if(input.incremental != NULL && input.incremental->HasMesh() && cachedGrids)
+	{
+	    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Using the mesh of the previous run...");
+	    mesh = input.incremental->GetMesh();
+	}
+	else
+	{
+	    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Generating mesh...");
+	    //generate mesh
+	    mesh.buildStandardMesh(input);
+	    if(!cachedGrids && !gridCacheKey.empty())
+	        NinjaGridCache::Write(gridCacheKey, input.dem, input.surface, mesh.meshResolution);
+	    if(input.incremental != NULL && !gridCacheKey.empty())
+	        input.incremental->SetMesh(mesh);
+	}
 	
 	u0.allocate(&mesh);		//u is positive toward East
 	v0.allocate(&mesh);		//v is positive toward North
@@ -348,7 +411,14 @@ if(input.matchWxStations == true)
     num_outer_iter_tries_u = std::vector<int>(input.stations.size(),0);
     num_outer_iter_tries_v = std::vector<int>(input.stations.size(),0);
     num_outer_iter_tries_w = std::vector<int>(input.stations.size(),0);
-}
+    matchAccelerator.Reset(nMatchAccelDepth);
+}
+//the matrix of a neutral run is the same for every matching iteration
+boost::scoped_ptr<NinjaSweep> poMatchSystem;
+std::vector<double> matchPhi;
+if(input.matchWxStations == true && !input.stabilityFlag &&
+   input.sweep == NULL && input.incremental == NULL)
+    poMatchSystem.reset(new NinjaSweep());
 do
 {
 /*  ----------------------------------------*/
@@ -382,6 +452,21 @@ do
 		if(checkForNullRun())	//if it's a run with all zero velocity...
 			break;
 
+		//a run with a wind atlas combines the basis solutions, no solve
+		if(input.windAtlas != NULL)
+		{
+		    if(input.windAtlas->GetNumNodes() != mesh.NUMNP)
+		        throw std::logic_error("The wind atlas was solved on a different mesh.");
+		    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Combining wind atlas basis solutions...");
+		    u.allocate(&mesh);
+		    v.allocate(&mesh);
+		    w.allocate(&mesh);
+		    input.windAtlas->Combine(input.inputSpeed, input.inputDirection,
+		                             u.get_dataPointer(), v.get_dataPointer(),
+		                             w.get_dataPointer());
+		    break;
+		}
+
 /*  ----------------------------------------*/
 /*  BUILD "A" ARRAY OF AX=B                 */
 /*  ----------------------------------------*/
@@ -391,8 +476,17 @@ do
 
 		input.Com->ninjaCom(ninjaComClass::ninjaNone, "Building equations...");
 
+		//runs of a sweep share the matrix built by the first one, and an
+		//incremental run the matrix of the previous run
+		NinjaSweep *system = input.sweep;
+		if(input.incremental != NULL)
+		    system = input.incremental->GetSystem();
+		else if(poMatchSystem)
+		    system = poMatchSystem.get();
+		bool buildMatrix = (system == NULL || !system->HasMatrix());
+
 		//build A arrray
-		discretize();
+		discretize(buildMatrix);
 
         checkCancel();
 
@@ -401,7 +495,27 @@ do
 /*  ----------------------------------------*/
 
 		//set boundary conditions
-		setBoundaryConditions();
+		setBoundaryConditions(buildMatrix);
+
+		if(system != NULL)
+		{
+		    if(buildMatrix)
+		    {
+		        system->SetMatrix(mesh.NUMNP, SK, col_ind, row_ptr);
+		        SK = NULL;
+		        col_ind = NULL;
+		        row_ptr = NULL;
+		    }
+		    else if(system->GetNumNodes() != mesh.NUMNP)
+		        throw std::logic_error("Runs sharing a system must share one mesh.");
+		}
+		if(input.sweep != NULL &&
+		   input.sweep->WarmStart(input.inputSpeed, input.inputDirection, PHI))
+		    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Starting from an earlier solution of the sweep...");
+		if(input.incremental != NULL && input.incremental->WarmStart(mesh.NUMNP, PHI))
+		    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Starting from the solution of the previous run...");
+		if(poMatchSystem && (int)matchPhi.size() == mesh.NUMNP)
+		    std::copy(matchPhi.begin(), matchPhi.end(), PHI);
 
 		//#define WRITE_A_B
 		#ifdef WRITE_A_B	//used for debugging...
@@ -425,10 +539,31 @@ do
 
 		//solver
 
-		//if the CG solver diverges, try the minres solver
-		if(solve(SK, RHS, PHI, row_ptr, col_ind, mesh.NUMNP, MAXITS, print_iters, stop_tol)==false)
-		    if(solveMinres(SK, RHS, PHI, row_ptr, col_ind, mesh.NUMNP, MAXITS, print_iters, stop_tol)==false)
-			throw std::runtime_error("Solver returned false.");
+		{
+		    double *A = SK;
+		    int *rowPtr = row_ptr;
+		    int *colInd = col_ind;
+		    Preconditioner *M = NULL;
+		    if(system != NULL)
+		    {
+		        A = system->GetMatrix();
+		        rowPtr = system->GetRowPtr();
+		        colInd = system->GetColInd();
+		        M = system->GetPreconditioner();
+		    }
+
+		    //if the CG solver diverges, try the minres solver
+		    if(solve(A, RHS, PHI, rowPtr, colInd, mesh.NUMNP, MAXITS, print_iters, stop_tol, M)==false)
+		        if(solveMinres(A, RHS, PHI, rowPtr, colInd, mesh.NUMNP, MAXITS, print_iters, stop_tol)==false)
+			    throw std::runtime_error("Solver returned false.");
+
+		    if(input.sweep != NULL)
+		        input.sweep->AddSolution(input.inputSpeed, input.inputDirection, PHI);
+		    if(input.incremental != NULL)
+		        input.incremental->SetSolution(mesh.NUMNP, PHI);
+		    if(poMatchSystem)
+		        matchPhi.assign(PHI, PHI + mesh.NUMNP);
+		}
 
 		#ifdef _OPENMP
 			endSolve = omp_get_wtime();
@@ -489,6 +624,21 @@ if(input.matchWxStations == true && !isNullRun)
         input.Com->ninjaCom(ninjaComClass::ninjaWarning, error);
         throw(std::runtime_error(error));
 	}
+	if(matchAccelerator.IsEnabled())
+	{
+	    int plainIters = matchAccelerator.EstimatePlainIterations(input.outer_relax*matchTol,
+	                                                              max_matching_iters);
+	    input.Com->ninjaCom(ninjaComClass::ninjaNone,
+	                        "Stations matched in %d outer iterations, about %d saved by acceleration.",
+	                        matchingIterCount, std::max(0, plainIters - matchingIterCount));
+	}
+}
+
+//keep the state for the next point run on this domain
+if(poIncremental)
+{
+    input.incremental = NULL;
+    NinjaIncremental::Release(incrementalKey, poIncremental);
 }
 
 /*  ----------------------------------------*/
@@ -639,7 +789,7 @@ double ninja::getSmallestRadiusOfInfluence()
  * @param tol Convergence tolerance to stop at.
  * @return Returns true if solver converges and completes properly.
  */
-bool ninja::solve(double *A, double *b, double *x, int *row_ptr, int *col_ind, int NUMNP, int max_iter, int print_iters, double tol)
+bool ninja::solve(double *A, double *b, double *x, int *row_ptr, int *col_ind, int NUMNP, int max_iter, int print_iters, double tol, Preconditioner *poPreconditioner)
 {
     //stuff for sparse BLAS MV multiplication
     char transa='n';
@@ -659,12 +809,18 @@ bool ninja::solve(double *A, double *b, double *x, int *row_ptr, int *col_ind, i
 
     residual_percent_complete_old = -1.;
 
+    //a sweep passes in the preconditioner it set up for its shared matrix
     Preconditioner M;
-    if(M.initialize(NUMNP, A, row_ptr, col_ind, M.SSOR, matdescra)==false)
+    Preconditioner *pM = poPreconditioner;
+    if(pM == NULL)
     {
-        input.Com->ninjaCom(ninjaComClass::ninjaWarning, "Initialization of SSOR preconditioner failed, trying Jacobi preconditioner...");
-        if(M.initialize(NUMNP, A, row_ptr, col_ind, M.Jacobi, matdescra)==false)
-            throw std::runtime_error("Initialization of Jacobi preconditioner failed.");
+        if(M.initialize(NUMNP, A, row_ptr, col_ind, M.SSOR, matdescra)==false)
+        {
+            input.Com->ninjaCom(ninjaComClass::ninjaWarning, "Initialization of SSOR preconditioner failed, trying Jacobi preconditioner...");
+            if(M.initialize(NUMNP, A, row_ptr, col_ind, M.Jacobi, matdescra)==false)
+                throw std::runtime_error("Initialization of Jacobi preconditioner failed.");
+        }
+        pM = &M;
     }
 
 //#define NINJA_DEBUG_VERBOSE
@@ -706,6 +862,10 @@ bool ninja::solve(double *A, double *b, double *x, int *row_ptr, int *col_ind, i
     {
         tol = resid;
         max_iter = 0;
+        delete[] p;
+        delete[] z;
+        delete[] q;
+        delete[] r;
         return true;
     }
 
@@ -714,7 +874,7 @@ bool ninja::solve(double *A, double *b, double *x, int *row_ptr, int *col_ind, i
     {
         checkCancel();
 
-        M.solve(r, z, row_ptr, col_ind);	//apply preconditioner
+        pM->solve(r, z, row_ptr, col_ind);	//apply preconditioner
 
         rho = cblas_ddot(NUMNP, z, 1, r, 1);
         //rho = dot(NUMNP, z, r);
@@ -1463,7 +1623,7 @@ bool ninja::checkForNullRun()
 /**Function to build discretized equations.
  *
  */
-void ninja::discretize()
+void ninja::discretize(bool buildMatrix)
 {
     //The governing equation to solve is
     //
@@ -1495,11 +1655,15 @@ void ninja::discretize()
 
      NZND = (NZND - mesh.NUMNP)/2 + mesh.NUMNP;	//this is because we will only store the upper half of the SK matrix since it's symmetric
 
+	 //a run of a sweep only assembles its right hand side
+	 if(buildMatrix)
+	 {
 	 SK = new double[NZND];	//This is the final global stiffness matrix in Compressed Row Storage (CRS) and symmetric 
 	 //SK = new taucs_double[NZND];
 
 	 col_ind=new int[NZND];      //This holds the global column number of the corresponding element in the CRS storage
 	 row_ptr=new int[mesh.NUMNP+1];     //This holds the element number in the SK array (CRS) of the first non-zero entry for the global row (the "+1" is so we can use the last entry to quit loops; ie. so we know how many non-zero elements are in the last node)
+	 }
 	 RHS=new double[mesh.NUMNP];       //This is the final right hand side (RHS) matrix
 
      int type;                     //This is the type of node (corner, edge, side, internal)
@@ -1510,9 +1674,14 @@ void ninja::discretize()
      {
           PHI[i]=0.;
           RHS[i]=0.;
-          row_ptr[i]=0;
      }
 
+     if(buildMatrix)
+     {
+	 #pragma omp parallel for default(shared) private(i)
+     for(i=0;i<mesh.NUMNP;i++)
+          row_ptr[i]=0;
+
 	 #pragma omp parallel for default(shared) private(i)
      for(i=0;i<NZND;i++)
      {
@@ -1647,6 +1816,7 @@ void ninja::discretize()
           }
      }
      row_ptr[mesh.NUMNP]=temp;     //Set last value of row_ptr, so we can use "row_ptr+1" to use to index to in loops
+     }
 
 	 checkCancel();
 
@@ -1875,6 +2045,7 @@ void ninja::discretize()
 				 for(k=0;k<mesh.NNPE;k++)          //Start loop over nodes in the element
 				 {
 					 elem.QE[k]=elem.QE[k]+elem.WT*elem.SFV[0*mesh.NNPE*elem.NUMQPTV+k*elem.NUMQPTV+j]*elem.HVJ*elem.DV;
+					 if(buildMatrix)
 					 for(l=0;l<mesh.NNPE;l++)
 					 {
                                              elem.S[k*mesh.NNPE+l]=elem.S[k*mesh.NNPE+l]+elem.WT*(elem.DNDX[k]*elem.RX*elem.DNDX[l] + elem.DNDY[k]*elem.RY*elem.DNDY[l] + elem.DNDZ[k]*elem.RZ*elem.DNDZ[l])*elem.DV;
@@ -1909,6 +2080,9 @@ void ninja::discretize()
 #pragma omp atomic
 				 RHS[elem.NPK] += elem.QE[j];
 
+				 if(!buildMatrix)
+					 continue;
+
 				 for(k=0;k<mesh.NNPE;k++)           //k is the local column number in S[]
 				 {
 					 elem.KNP=mesh.get_global_node(k, i);
@@ -1941,7 +2115,7 @@ void ninja::discretize()
 /**Sets up boundary conditions for the simulation.
  *
  */
-void ninja::setBoundaryConditions()
+void ninja::setBoundaryConditions(bool buildMatrix)
 {
      //Specify known values of PHI
      //This is done by replacing the particular node equation (row) with all zeros except a "1" on the diagonal of SK[].
@@ -1980,6 +2154,7 @@ void ninja::setBoundaryConditions()
                 for(j=0;j<input.dem.get_nCols();j++)          //loop over nodes using i,j,k notation
                 {
                      NPK=k*input.dem.get_nCols()*input.dem.get_nRows()+i*input.dem.get_nCols()+j;            //NPK is the global row number (also the node # we're on)
+                     if(buildMatrix)
                      for(l=row_ptr[NPK];l<row_ptr[NPK+1];l++)     //loop through all non-zero elements for row NPK
                      {
                           KNP=col_ind[l];       //KNP is the global column number we're on
@@ -2276,146 +2451,102 @@ void ninja::prepareOutput()
 	/*
 	 * Interpolate u, v, w to specific locations if an input_points_file is provided
      */
-#pragma omp critical
-    {
-        if(input.inputPointsFilename != "!set"){
-            element elem(&mesh);
-            double new_u, new_v, new_w;
-            double lat, lon;
-            std::string pointName;
-            double u_coord, v_coord, w_coord, x, y, z, height_above_ground;
-            double z_ground, z_temp;
-            int elem_i, elem_j, elem_k, elem_num;
-            windProfile profile;
-            profile.profile_switch = windProfile::monin_obukov_similarity;
-
-            std::vector<boost::local_time::local_date_time> times;
-            std::string dt;
-
-            if(input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag){
-                times = (init->getTimeList(input.ninjaTimeZone));
-                dt =  boost::lexical_cast<std::string>(input.ninjaTime);
-            }
-
-            FILE *output;
-
-            if(input.outputPointsFilename != "!set"){ //if output file name is specified
-                if(input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag){// if it's a wx model run
-                    if(input.ninjaTime == times[0]){ //if it's the first time step write headers to new file
-                        output = fopen(input.outputPointsFilename.c_str(), "w");
-                        if(init->getForecastIdentifier()=="WRF-3D"){ //it's a 2D wx model run
-                            fprintf(output, "ID,lat,lon,height,datetime,u,v,w,wx_u,wx_v,wx_w\n");
-                        }
-                        else{
-                            fprintf(output, "ID,lat,lon,height,datetime,u,v,w,wx_u,wx_v\n");
-                        }
-                    }
-                    else{ //if not the first time step, just append data
-                        output = fopen(input.outputPointsFilename.c_str(), "a"); //append new time to end of file
-                    }
-                }
-                else{ //if it's not a wx model run
-                    output = fopen(input.outputPointsFilename.c_str(), "w");
-                    fprintf(output, "ID,lat,lon,height,u,v,w\n");
-                }
-            }
-            else{ //if out filename is not specified
-                if(input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag){ //if wx model run
-                    if(input.ninjaTime == times[0]){ //if it's the first time step write headers to new file
-                        output = fopen("output.txt", "w"); //append new time to end of file
-                        if(init->getForecastIdentifier()=="WRF-3D"){ //it's a 3D wx model run
-                            fprintf(output, "ID,lat,lon,height,datetime,u,v,w,wx_u,wx_v,wx_w\n");
-                        }
-                        else{//it's a 2D wx model run
-                            fprintf(output, "ID,lat,lon,height,datetime,u,v,w,wx_u,wx_v\n");
-                        }
-                    }
-                    else{ //if not the first time step, just append data
-                        output = fopen(input.outputPointsFilename.c_str(), "a"); //append new time to end of file
-                    }
-                }
-                else{ //if not a wx model run
-                    output = fopen("output.txt", "w");
-                    fprintf(output, "ID,lat,lon,height,u,v,w\n");
-                }
-            }
-
-            for(unsigned int i = 0; i < input.lonList.size(); i++ ){
-
-                /*
-                 * Transform coords from lat/long to WN mesh space
-                 */
-                x = input.projXList[i];
-                y = input.projYList[i];
-                height_above_ground = input.heightList[i];
-                lat = input.latList[i];
-                lon = input.lonList[i];
-                pointName = input.pointsNamesList[i];
-
-                if(!input.dem.check_inBounds(x, y)){
-                    throw std::runtime_error("Requested output point is located outside of the DEM extent.");
-                }
-
-                x -= input.dem.xllCorner; //adjust to wn coords
-                y -= input.dem.yllCorner; //adjust to wn coords
-
-                elem.get_uv(x, y, elem_i, elem_j, u_coord, v_coord);
-                elem_num = mesh.get_elemNum(elem_i, elem_j, 0);
-                elem.get_xyz(elem_num, u_coord, v_coord, -1, x, y, z); // get z at ground
-                z_ground = z;
-                z += height_above_ground;
-
-                /*
-                 * Perform interpolation on u, v, w
-                 */
-                elem.get_uvw(x, y, z, elem_i, elem_j, elem_k, u_coord, v_coord, w_coord); // find elem_k for this point
-                if(elem_k == 0){//if in first layer, use log profile
-                    //profile stuff is a little weird bc we are not at nodes
-                    //profile is set based on southwest corner of current cell (elem_i, elem_j)
-                    //could interpolate these too?
-                    profile.ObukovLength = init->L(elem_i,elem_j);
-                    profile.ABL_height = init->bl_height(elem_i,elem_j);
-                    profile.Roughness = input.surface.Roughness(elem_i,elem_j);
-                    profile.Rough_h = input.surface.Rough_h(elem_i,elem_j);
-                    profile.Rough_d = input.surface.Rough_d(elem_i,elem_j);
-                    profile.AGL = height_above_ground;  // height above the ground
-
-                    elem.get_xyz(elem_num, u_coord, v_coord, 1, x, y, z_temp); // get z at first layer
-
-                    profile.inputWindHeight = z_temp - z_ground - input.surface.Rough_h(elem_i, elem_j); // height above vegetation
-                    profile.inputWindSpeed = u.interpolate(x, y, z_temp);
-
-                    new_u = profile.getWindSpeed();
-                    profile.inputWindSpeed = v.interpolate(x, y, z_temp);
-                    new_v = profile.getWindSpeed();
-                    profile.inputWindSpeed = w.interpolate(x, y, z_temp);
-                    new_w = profile.getWindSpeed();
-                }
-                else{//else use linear interpolation
-                    new_u = u.interpolate(x,y,z);
-                    new_v = v.interpolate(x,y,z);
-                    new_w = w.interpolate(x,y,z);
-                }
+    if(input.inputPointsFilename != "!set")
+        writePointOutput();
+}
 
-                if(input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag){ //if wx model run
+/**Samples u, v, w at the points of the input_points_file and hands the values
+ * to the point output writer.
+ * The points are located in the mesh once, every field is then sampled from
+ * the stored node weights.  Points in the first cell layer are extended from
+ * the top of the layer to the requested height with a log profile.
+ */
+void ninja::writePointOutput()
+{
+    PointSampler sampler;
+    sampler.locate(mesh, input.dem, input.projXList, input.projYList, input.heightList);
+
+    bool isWxRun = input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag;
+    bool isWrf3d = isWxRun && init->getForecastIdentifier() == "WRF-3D";
+
+    PointOutputWriter::pointRun run;
+    run.columns.push_back("u");
+    run.columns.push_back("v");
+    run.columns.push_back("w");
+    if(isWxRun){
+        run.columns.push_back("wx_u");
+        run.columns.push_back("wx_v");
+        if(isWrf3d)
+            run.columns.push_back("wx_w");
+        run.osDateTime = boost::lexical_cast<std::string>(input.ninjaTime);
+        boost::posix_time::time_duration since = input.ninjaTime.utc_time() -
+            boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1));
+        run.dfTime = since.total_seconds();
+    }
+    else{
+        run.dfTime = std::numeric_limits<double>::quiet_NaN();
+    }
 
-                    if(init->getForecastIdentifier() == "WRF-3D"){
-                        fprintf(output,"%s,%lf,%lf,%lf,%s,%lf,%lf,%lf,%lf,%lf,%lf\n", pointName.c_str(), lat, lon, height_above_ground, dt.c_str(),
-                                new_u, new_v, new_w, init->u_wxList[i], init->v_wxList[i], init->w_wxList[i]);
-                    }
-                    else{
-                    fprintf(output,"%s,%lf,%lf,%lf,%s,%lf,%lf,%lf,%lf,%lf\n", pointName.c_str(), lat, lon, height_above_ground, dt.c_str(),
-                            new_u, new_v, new_w, init->u10List[i], init->v10List[i]);
-                    }
-                }
-                else{ //if not a wx model run
-                   fprintf(output,"%s,%lf,%lf,%lf,%lf,%lf,%lf\n", pointName.c_str(), lat, lon, height_above_ground, new_u, new_v, new_w);
-                }
-            }
-            fclose(output);
+    const int nColumns = run.columns.size();
+    const int nPoints = sampler.get_nPoints();
+    run.values.resize(nPoints * nColumns);
+
+    windProfile profile;
+    profile.profile_switch = windProfile::monin_obukov_similarity;
+
+    for(int i = 0; i < nPoints; i++){
+        double new_u = sampler.sample(i, u);
+        double new_v = sampler.sample(i, v);
+        double new_w = sampler.sample(i, w);
+
+        if(sampler.inFirstLayer(i)){//if in first layer, use log profile
+            //profile is set based on southwest corner of current cell (cell_i, cell_j)
+            int cell_i = sampler.get_cell_i(i);
+            int cell_j = sampler.get_cell_j(i);
+            profile.ObukovLength = init->L(cell_i, cell_j);
+            profile.ABL_height = init->bl_height(cell_i, cell_j);
+            profile.Roughness = input.surface.Roughness(cell_i, cell_j);
+            profile.Rough_h = input.surface.Rough_h(cell_i, cell_j);
+            profile.Rough_d = input.surface.Rough_d(cell_i, cell_j);
+            profile.AGL = input.heightList[i];  // height above the ground
+            profile.inputWindHeight = sampler.get_sampleHeight(i) - input.surface.Rough_h(cell_i, cell_j); // height above vegetation
+
+            profile.inputWindSpeed = new_u;
+            new_u = profile.getWindSpeed();
+            profile.inputWindSpeed = new_v;
+            new_v = profile.getWindSpeed();
+            profile.inputWindSpeed = new_w;
+            new_w = profile.getWindSpeed();
+        }
 
+        double *padfRow = &run.values[i * nColumns];
+        padfRow[0] = new_u;
+        padfRow[1] = new_v;
+        padfRow[2] = new_w;
+        if(isWrf3d){
+            padfRow[3] = init->u_wxList[i];
+            padfRow[4] = init->v_wxList[i];
+            padfRow[5] = init->w_wxList[i];
+        }
+        else if(isWxRun){
+            padfRow[3] = init->u10List[i];
+            padfRow[4] = init->v10List[i];
         }
     }
+
+    if(input.pointOutputWriter != NULL){
+        input.pointOutputWriter->SetPoints(input.pointsNamesList, input.latList,
+                                           input.lonList, input.heightList);
+        input.pointOutputWriter->AddRun(input.inputsRunNumber, run);
+    }
+    else{
+        std::string filename = input.outputPointsFilename != "!set" ?
+                               input.outputPointsFilename : std::string("output.txt");
+        PointOutputWriter writer(filename, PointOutputWriter::GetFormat(input.outputPointsFormat));
+        writer.SetPoints(input.pointsNamesList, input.latList, input.lonList, input.heightList);
+        writer.AddRun(0, run);
+        writer.Close();
+    }
 }
 
 /**Compares the current simulated wind field to the measured wind at points.
@@ -2445,6 +2576,9 @@ bool ninja::matched(int iter)
 		bool ret = true;
         bool u_keep_old, v_keep_old, w_keep_old;
         double delta = 0.1;
+        //inputs and relaxed misfits of all stations, for the accelerated step
+        std::vector<int> matchStations;
+        std::vector<double> matchX, matchF;
 
 
 		input.Com->ninjaCom(ninjaComClass::ninjaNone, "Stations matching check:");
@@ -2514,6 +2648,16 @@ bool ninja::matched(int iter)
             input.Com->ninjaCom(ninjaComClass::ninjaNone, "try_input_v = %lf\tv_solve = %lf\tv_true = %lf", try_input_v, try_output_v, true_v);
             input.Com->ninjaCom(ninjaComClass::ninjaNone, "try_input_w = %lf\tw_solve = %lf\tw_true = %lf", try_input_w, try_output_w, true_w);
 
+            if(matchAccelerator.IsEnabled())
+            {
+                matchStations.push_back(i);
+                matchX.push_back(try_input_u);
+                matchX.push_back(try_input_v);
+                matchF.push_back(input.outer_relax*(true_u - try_output_u));
+                matchF.push_back(input.outer_relax*(true_v - try_output_v));
+                continue;
+            }
+
 			//Compute new values using formula (from Lopes (2003)):
 			//
 			//            x2 = x1 + outer_relax(yr - y1)
@@ -2645,6 +2789,18 @@ bool ninja::matched(int iter)
 			//input.stationsScratch[i].set_w_speed(new_input_w, velocityUnits::metersPerSecond);
         }
 
+        //move all stations jointly, mixing in the earlier iterations
+        if(!ret && matchAccelerator.IsEnabled())
+        {
+            matchAccelerator.Step(matchX, matchF);
+            for(unsigned int j=0; j<matchStations.size(); j++)
+            {
+                wind_uv_to_sd(matchX[2*j], matchX[2*j+1], &spd, &dir);
+                input.stationsScratch[matchStations[j]].set_speed(spd, velocityUnits::metersPerSecond);
+                input.stationsScratch[matchStations[j]].set_direction(dir);
+            }
+        }
+
 		//compute percent complete
 		percent_complete=100.0-100.0*((maxCurrentOuterDiff-matchTol)/(maxStartingOuterDiff-matchTol));
 		//if(residual_percent_complete<residual_percent_complete_old)
@@ -2731,6 +2887,17 @@ void ninja::computeDustEmissions()
 
 void ninja::writeOutputFiles()
 {
+    if(!input.fileOutFlag)
+    {
+        if(!input.keepOut3dFieldsInMemory)
+        {
+            u.deallocate();
+            v.deallocate();
+            w.deallocate();
+        }
+        return;
+    }
+
     set_outputFilenames(mesh.meshResolution, mesh.meshResolutionUnits);
 
 	//Write volume data to VTK format (always in m/s?)
@@ -2747,9 +2914,12 @@ void ninja::writeOutputFiles()
 		}
 	}
 
-	u.deallocate();
-	v.deallocate();
-	w.deallocate();
+	if(!input.keepOut3dFieldsInMemory)
+	{
+		u.deallocate();
+		v.deallocate();
+		w.deallocate();
+	}
 
 	#pragma omp parallel sections
 	{
@@ -2843,6 +3013,38 @@ void ninja::writeOutputFiles()
 
 	}//end omp section
 
+	//append this run to the NetCDF-CF time series
+	#pragma omp section
+	{
+	try{
+		if(input.netcdfOutFlag==true)
+		{
+			//cloud cover is on the wx model grid (or one cell), put it on the wind grid
+			AsciiGrid<double> tempCloud(VelocityGrid);
+			tempCloud.interpolateFromGrid(CloudGrid, AsciiGrid<double>::order0);
+
+			if(input.timeSeriesWriter != NULL)
+			{
+				input.timeSeriesWriter->AddSlice(input.inputsRunNumber, input.ninjaTime.utc_time(),
+				                                 VelocityGrid, AngleGrid, tempCloud);
+			}
+			else
+			{
+				TimeSeriesWriter series(input.netcdfOutFilename, input.outputSpeedUnits);
+				series.AddSlice(0, input.ninjaTime.utc_time(), VelocityGrid, AngleGrid, tempCloud);
+				series.Close();
+			}
+		}
+	}catch (exception& e)
+	{
+		input.Com->ninjaCom(ninjaComClass::ninjaWarning, "Exception caught during NetCDF file writing: %s", e.what());
+	}catch (...)
+	{
+		input.Com->ninjaCom(ninjaComClass::ninjaWarning, "Exception caught during NetCDF file writing: Cannot determine exception type.");
+	}
+
+	}//end omp section
+
 
 	//write text file comparing measured to simulated winds (measured read from file, filename, etc. hard-coded in function)
 	#pragma omp section
@@ -3057,7 +3259,7 @@ void ninja::writeOutputFiles()
 			output.setDirGrid(AngleGrid);
 			output.setSpeedGrid(VelocityGrid, input.outputSpeedUnits);
 			
-			output.setMemDs(input.hSpdMemDs, input.hDirMemDs, input.hDustMemDs);// set the in-memory datasets
+			output.setDatasetPool(input.outputDatasetPool);// collect bands across the army
 
 			
 #ifdef EMISSIONS
@@ -3289,6 +3491,21 @@ void ninja::set_outputPointsFilename(std::string filename)
     input.outputPointsFilename = filename;
 }
 
+void ninja::set_outputPointsFormat(std::string format)
+{
+    PointOutputWriter::GetFormat(format); //throws on unknown formats
+    input.outputPointsFormat = format;
+}
+
+/**
+ * Sets the writer that collects the point output of an army in run order.
+ * @param writer Writer shared by the army, or NULL to write this run alone.
+ */
+void ninja::set_pointOutputWriter(PointOutputWriter *writer)
+{
+    input.pointOutputWriter = writer;
+}
+
 #ifdef NINJA_SPEED_TESTING
 void ninja::set_speedDampeningRatio(double r)
 {
@@ -3380,6 +3597,21 @@ void ninja::set_DEM(std::string dem_file_name)
     input.dem.fileName = dem_file_name;
 }
 
+/**
+ * Sets a raster of surface roughness parameters that replaces the uniform
+ * vegetation values.  Bands are roughness, roughness height and
+ * displacement height in meters, in the projection of the DEM.  No data
+ * cells keep the vegetation value.
+ * @param surface_file_name Name of the raster.
+ */
+void ninja::set_surfaceGridsFilename(std::string surface_file_name)
+{
+    if(!CPLCheckForFile((char*)surface_file_name.c_str(), NULL))
+        throw std::runtime_error(std::string("The file ") +
+                surface_file_name + " does not exist or may be in use by another program.");
+    input.surfaceGridsFilename = surface_file_name;
+}
+
 int ninja::get_inputsRunNumber() const
 {
     return input.inputsRunNumber;
@@ -4090,16 +4322,13 @@ void ninja::set_uniCloudCover(double cloud_cover, coverUnits::eCoverUnits units)
 }
 
 /**
- * Sets the in-memory datasets for GTiff output writer.
- * @param hSpdMemDS Name of the in-memory speed dataset.
- * @param hDirMemDS Name of the in-memory direction dataset.
- * @param hDustMemDS Name of the in-memory dust dataset.
+ * Sets the pool that collects GTiff output bands across an army.
+ * @param pool Pool shared by the runs of the army, or NULL to write each run
+ *             to its own single band file.
  */
-void ninja::set_memDs(GDALDatasetH hSpdMemDs, GDALDatasetH hDirMemDs, GDALDatasetH hDustMemDs)
+void ninja::set_outputDatasetPool(OutputDatasetPool *pool)
 {
-    input.hSpdMemDs = hSpdMemDs;
-    input.hDirMemDs = hDirMemDs;
-    input.hDustMemDs = hDustMemDs;
+    input.outputDatasetPool = pool;
 }
 
 /**
@@ -4154,6 +4383,9 @@ std::vector<wxStation> ninja::get_wxStations()
 void ninja::set_wxStations(std::vector<wxStation> &wxStations)
 {
     input.stations = wxStations;
+    input.stationsScratch = input.stations;
+    input.stationsOldInput = input.stations;
+    input.stationsOldOutput = input.stations;
     for (unsigned int i = 0; i < input.stations.size(); i++)
     {
         if (!input.stations[i].check_station())
@@ -4161,6 +4393,8 @@ void ninja::set_wxStations(std::vector<wxStation> &wxStations)
             throw std::range_error("Error in weather station parameters.");
         }
     }
+    if(!input.stations.empty())
+        input.inputSpeedUnits = input.stations[0].get_speedUnits();
 }
 void ninja::set_meshResChoice( std::string choice )
 {
@@ -4539,6 +4773,43 @@ void ninja::set_vtkOutFlag(bool flag)
     input.volVTKOutFlag = flag;
 }
 
+void ninja::set_netcdfOutFlag(bool flag)
+{
+    input.netcdfOutFlag = flag;
+}
+
+void ninja::set_netcdfOutFilename(std::string filename)
+{
+    input.netcdfOutFilename = filename;
+}
+
+/**
+ * Sets the writer that collects the runs of an army into one NetCDF file.
+ * @param writer Writer shared by the army, or NULL to write this run alone.
+ */
+void ninja::set_timeSeriesWriter(TimeSeriesWriter *writer)
+{
+    input.timeSeriesWriter = writer;
+}
+
+/**
+ * Sets the sweep whose matrix and preconditioner this run shares.
+ * @param sweep Sweep shared by the army, or NULL to assemble the system alone.
+ */
+void ninja::set_sweep(NinjaSweep *sweep)
+{
+    input.sweep = sweep;
+}
+
+/**
+ * Sets the wind atlas this run is combined from instead of being solved.
+ * @param atlas Atlas of the run's domain, or NULL to solve the run.
+ */
+void ninja::set_windAtlas(NinjaWindAtlas *atlas)
+{
+    input.windAtlas = atlas;
+}
+
 void ninja::set_outputPath(std::string path)
 {
     VSIStatBufL sStat;
@@ -4599,6 +4870,10 @@ void ninja::set_outputFilenames(double& meshResolution,
     if( input.diurnalWinds == true ||
         input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag )
         timestream << input.ninjaTime;
+    //runs of a station time series are told apart by their observation time
+    else if( input.initializationMethod == WindNinjaInputs::pointInitializationFlag &&
+             !input.ninjaTime.is_not_a_date_time() )
+        timestream << input.ninjaTime;
 #ifdef STABILITY
     else if( input.stabilityFlag == true && input.alphaStability == -1 )
         timestream << input.ninjaTime;
@@ -4619,6 +4894,9 @@ void ninja::set_outputFilenames(double& meshResolution,
         }else{
             pathName = CPLGetPath(input.dem.fileName.c_str());
         }
+        //in-memory inputs have no directory to write to
+        if( NinjaMemoryInput::IsMemoryPath( pathName ) )
+            pathName = ".";
     }
     else{ // if a custom output path was specified in the cli
         pathName = input.customOutputPath;
@@ -4788,6 +5066,97 @@ void ninja::keepOutputGridsInMemory(bool flag)
     input.keepOutGridsInMemory = flag;
 }
 
+/**
+ * Sets the flag that determines if the solved u, v, w fields are kept
+ * after simulate_wind().  The fields are several times larger than the
+ * output grids, so they are freed by default.
+ * @param flag True to keep the 3d fields.
+ */
+void ninja::keepOutput3dFieldsInMemory(bool flag)
+{
+    input.keepOut3dFieldsInMemory = flag;
+}
+
+/**
+ * Sets the flag that starts a point run from the mesh, system and solution
+ * of the previous point run on the same domain in this process.
+ * @param flag True to re-solve incrementally.
+ */
+void ninja::set_incrementalPointRun(bool flag)
+{
+    input.incrementalPointRun = flag;
+}
+
+/**
+ * Sets the flag that determines if any output files are written.  With
+ * the flag off the results are only available in memory, so it is
+ * normally used with keepOutputGridsInMemory().
+ * @param flag False to skip all file output.
+ */
+void ninja::set_fileOutFlag(bool flag)
+{
+    input.fileOutFlag = flag;
+}
+
+/**
+ * Returns a read-only pointer to one of the kept 3d fields.  The fields
+ * are stored layer by layer, each layer row by row from the south edge.
+ * @param name One of "u", "v", "w" (m/s) or "x", "y", "z" for the node
+ *             coordinates.
+ * @param nRows Number of node rows.
+ * @param nCols Number of node columns.
+ * @param nLayers Number of node layers.
+ * @return Pointer to the field or NULL if the field is not in memory.
+ */
+const double* ninja::get_outputField3d(const std::string &name, int &nRows,
+                                       int &nCols, int &nLayers) const
+{
+    const double *pData = NULL;
+    nRows = nCols = nLayers = 0;
+    if(name == "u" || name == "v" || name == "w")
+    {
+        const wn_3dScalarField &f = (name == "u") ? u : (name == "v") ? v : w;
+        pData = f.get_dataPointer();
+        if(pData)
+        {
+            nRows = f.get_nRows();
+            nCols = f.get_nCols();
+            nLayers = f.get_nLayers();
+        }
+    }
+    else if(name == "x" || name == "y" || name == "z")
+    {
+        //coordinates are only useful alongside a velocity field
+        if(u.get_dataPointer() == NULL)
+            return NULL;
+        const wn_3dArray &a = (name == "x") ? mesh.XORD : (name == "y") ? mesh.YORD : mesh.ZORD;
+        pData = a.get_dataPointer();
+        if(pData)
+        {
+            nRows = a.rows_;
+            nCols = a.cols_;
+            nLayers = a.layers_;
+        }
+    }
+    return pData;
+}
+
+/**
+ * Frees output grids and 3d fields kept in memory after simulate_wind().
+ */
+void ninja::releaseOutputGrids()
+{
+    AngleGrid.deallocate();
+    VelocityGrid.deallocate();
+    CloudGrid.deallocate();
+    AngleGrid.data.clear();
+    VelocityGrid.data.clear();
+    CloudGrid.data.clear();
+    u.deallocate();
+    v.deallocate();
+    w.deallocate();
+}
+
 double ninja::getFuelBedDepth(int fuelModel)
 {	//at this point must be in meters...  could change...
 
@@ -53,6 +53,7 @@
 #include <sstream>
 #include <cctype>
 #include <cfloat>
+#include <limits>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -77,6 +78,12 @@
 #include "ninjaCom.h"
 #include "ninjaException.h"
 #include "mesh.h"
+#include "ninja_grid_cache.h"
+#include "ninja_sweep.h"
+#include "ninja_wind_atlas.h"
+#include "ninja_incremental.h"
+#include "ninja_match_accelerator.h"
+#include "memory_input.h"
 #include "wn_3dArray.h"
 #include "wn_3dScalarField.h"
 #include "wn_3dVectorField.h"
@@ -97,9 +104,13 @@
 #include "element.h"
 #include "farsiteAtm.h"
 #include "OutputWriter.h"
+#include "TimeSeriesWriter.h"
+#include "PointSampler.h"
+#include "PointOutputWriter.h"
 
 #ifndef Q_MOC_RUN
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "boost/date_time/local_time/local_time.hpp"
 #include "boost/date_time/posix_time/posix_time_types.hpp" //no i/o just types
 #endif
@@ -188,13 +199,16 @@ public:
     ***************************************************************/
     void readInputFile(std::string fileName);
     void readInputFile();
-    void importSingleBand(GDALDataset*);
-    void importLCP(GDALDataset*);
+    void readInputFileAtMeshResolution();
+    void importSingleBand(GDALDataset*, double targetCellSize = -1.0);
+    void importLCP(GDALDataset*, double targetCellSize = -1.0);
+    void importSurfaceGrids();
     void setSurfaceGrids();
 
-    void set_memDs(GDALDatasetH hSpdMemDs, GDALDatasetH hDirMemDs, GDALDatasetH hDustMemDs); 
+    void set_outputDatasetPool(OutputDatasetPool *pool);
     void setArmySize(int n);
     void set_DEM(std::string dem_file_name);		//Sets elevation filename (Should be in units of meters!)
+    void set_surfaceGridsFilename(std::string surface_file_name);
     void set_initializationMethod(WindNinjaInputs::eInitializationMethod method, bool matchPoints = false);	//input wind initialization method
     WindNinjaInputs::eInitializationMethod get_initializationMethod(); //returns the initializationMethod
 
@@ -296,6 +310,8 @@ public:
 
     void set_inputPointsFilename(std::string filename); //set name for input file of requested output locations
     void set_outputPointsFilename(std::string filename); //set name for output file with winds at requested locations
+    void set_outputPointsFormat(std::string format); //csv or binary
+    void set_pointOutputWriter(PointOutputWriter *writer);
 
     const std::string get_VelFileName() const; //returns the name of the velocity file name
     const std::string get_AngFileName() const; //returns the name of the ang output file
@@ -326,6 +342,11 @@ public:
     void set_asciiResolution(double Resolution, lengthUnits::eLengthUnits units);	//sets the output resolution of the velocity and angle ASCII grid output files, if negative value the computational mesh resolution is used
     void set_txtOutFlag(bool flag);
     void set_vtkOutFlag(bool flag);		//determines if VTK volume output files will be written
+    void set_netcdfOutFlag(bool flag);		//determines if the NetCDF-CF time series file will be written
+    void set_netcdfOutFilename(std::string filename);
+    void set_timeSeriesWriter(TimeSeriesWriter *writer);
+    void set_sweep(NinjaSweep *sweep);
+    void set_windAtlas(NinjaWindAtlas *atlas);
     void set_pdfOutFlag(bool flag);
     void set_pdfResolution(double Resolution, lengthUnits::eLengthUnits units);
     void set_pdfDEM(std::string dem_file_name);
@@ -335,6 +356,11 @@ public:
     void set_outputFilenames(double& meshResolution, lengthUnits::eLengthUnits meshResolutionUnits);
     const std::string get_outputPath() const;
     void keepOutputGridsInMemory(bool flag);
+    void keepOutput3dFieldsInMemory(bool flag);
+    void set_incrementalPointRun(bool flag);
+    void set_fileOutFlag(bool flag);	//false skips every output file, results stay in memory only
+    const double* get_outputField3d(const std::string &name, int &nRows, int &nCols, int &nLayers) const;
+    void releaseOutputGrids();
     void set_outputPath(std::string path);
 
     void set_PrjString(std::string prj);
@@ -362,6 +388,8 @@ private:
     std::vector<int> num_outer_iter_tries_u;   //used in outer iterations calcs
     std::vector<int> num_outer_iter_tries_v;   //used in outer iterations calcs
     std::vector<int> num_outer_iter_tries_w;   //used in outer iterations calcs
+    int nMatchAccelDepth;   //earlier outer iterations mixed into a matching step, 0 for the plain update
+    NinjaMatchAccelerator matchAccelerator;
 
     wn_3dScalarField u, v, w;
     wn_3dScalarField u0;		//u is positive toward East
@@ -404,8 +432,11 @@ private:
 
     double getSmallestRadiusOfInfluence();
     void get_rootname(const char *NAME,char *shortname);
+    void importInputFile(bool atMeshResolution);
+    double get_importCellSize(GDALDataset *poDataset);
     bool solve(double *SK, double *RHS, double *PHI, int *row_ptr,
-               int *col_ind, int NUMNP, int MAXITS, int print_iters, double stop_tol);
+               int *col_ind, int NUMNP, int MAXITS, int print_iters, double stop_tol,
+               Preconditioner *poPreconditioner = NULL);
 
     /*-----------------------------------------------------------------------------
      * alternative solvers                                                           
@@ -462,10 +493,11 @@ private:
     //double stability_function(double z_over_L, double L_switch);
     bool writePrjFile(std::string inPrjString, std::string outFileName);
     bool checkForNullRun();
-    void discretize(); 
-    void setBoundaryConditions();
+    void discretize(bool buildMatrix = true);
+    void setBoundaryConditions(bool buildMatrix = true);
     void computeUVWField();
     void prepareOutput();
+    void writePointOutput();
     bool matched(int iter);
     void writeOutputFiles(); 
     void deleteDynamicMemory();
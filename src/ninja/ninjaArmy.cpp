@@ -29,12 +29,16 @@
 
 #include "ninjaArmy.h"
 
+extern boost::local_time::tz_database globalTimeZoneDB;
+
 /**
 * @brief Default constructor.
 *
 */
 ninjaArmy::ninjaArmy()
 : writeFarsiteAtmFile(false)
+, windAtlasFlag(false)
+, stationTimeSeries(false)
 {
     ninjas.push_back(new ninja());
     initLocalData();
@@ -49,6 +53,8 @@ ninjaArmy::ninjaArmy()
 #ifdef NINJAFOAM
 ninjaArmy::ninjaArmy(int numNinjas, bool momentumFlag)
 : writeFarsiteAtmFile(false)
+, windAtlasFlag(false)
+, stationTimeSeries(false)
 {
     ninjas.resize(numNinjas);  //allocate vector with enough memory for all ninjas
     for(unsigned int i = 0; i < ninjas.size(); i++)
@@ -72,6 +78,8 @@ ninjaArmy::ninjaArmy(int numNinjas, bool momentumFlag)
 #ifndef NINJAFOAM
 ninjaArmy::ninjaArmy(int numNinjas)
 : writeFarsiteAtmFile(false)
+, windAtlasFlag(false)
+, stationTimeSeries(false)
 {
     ninjas.resize(numNinjas);  //allocate vector with enough memory for all ninjas
     for(unsigned int i = 0; i < ninjas.size(); i++)
@@ -90,6 +98,8 @@ ninjaArmy::ninjaArmy(int numNinjas)
 ninjaArmy::ninjaArmy(const ninjaArmy& A)
 {
     writeFarsiteAtmFile = A.writeFarsiteAtmFile;
+    windAtlasFlag = A.windAtlasFlag;
+    stationTimeSeries = A.stationTimeSeries;
     ninjas = A.ninjas;
     copyLocalData( A );
 }
@@ -105,6 +115,9 @@ ninjaArmy::~ninjaArmy()
        delete ninjas[i];
     }
     destoryLocalData();
+    //release forecast data and legends cached for this army
+    wxModelReader::ClearCache();
+    KmlVector::ClearLegendCache();
 }
 
 /**
@@ -118,6 +131,8 @@ ninjaArmy& ninjaArmy::operator= (ninjaArmy const& A)
     if(&A != this)
     {
         writeFarsiteAtmFile = A.writeFarsiteAtmFile;
+        windAtlasFlag = A.windAtlasFlag;
+        stationTimeSeries = A.stationTimeSeries;
         ninjas = A.ninjas;
         copyLocalData( A );
     }
@@ -229,11 +244,195 @@ void ninjaArmy::makeArmy(std::string forecastFilename, std::string timeZone, boo
     }
 }
 
+/**
+ * @brief Makes an army of point runs, one for each observation time.
+ *
+ * The stations are read once from a station file, or from every station
+ * file in a directory.  Rows with a Date_Time column give a run for each
+ * distinct time, ordered in time.  Without times the army is a single run.
+ *
+ * @param stationPath Station file or directory of station files.
+ * @param demFile Elevation file, used to locate the stations.
+ * @param timeZone Time zone the runs are reported in (must match strings in
+ *                 the file "date_time_zonespec.csv").
+ * @return True if the stations carry observation times.
+ */
+bool ninjaArmy::makeStationArmy(std::string stationPath, std::string demFile,
+                                std::string timeZone)
+{
+    std::vector<std::vector<wxStation> > series =
+        wxStation::readStationTimeSeries(stationPath, demFile);
+    if(series.empty() || series[0].empty())
+        throw std::runtime_error("No weather stations were read from " + stationPath + ".");
+
+    bool hasTimes = !series[0][0].get_datetime().is_not_a_date_time();
+    boost::local_time::time_zone_ptr timeZonePtr;
+    if(hasTimes)
+    {
+        timeZonePtr = globalTimeZoneDB.time_zone_from_region(timeZone.c_str());
+        if(timeZonePtr == NULL)
+        {
+            std::ostringstream os;
+            os << "The time zone string: " << timeZone.c_str()
+               << " does not match any in "
+               << "the time zone database file: date_time_zonespec.csv.";
+            throw std::runtime_error(os.str());
+        }
+    }
+
+    tz = timeZone;
+    setSize(series.size(), false);
+    for(unsigned int i = 0; i < series.size(); i++)
+    {
+        if(hasTimes)
+            ninjas[i]->set_date_time(boost::local_time::local_date_time(
+                        series[i][0].get_datetime(), timeZonePtr));
+        ninjas[i]->set_initializationMethod(WindNinjaInputs::pointInitializationFlag);
+        ninjas[i]->set_wxStations(series[i]);
+        ninjas[i]->input.wxStationFilename = stationPath;
+        ninjas[i]->setArmySize(series.size());
+    }
+    stationTimeSeries = hasTimes && series.size() > 1;
+    return hasTimes;
+}
+
+/**
+ * @brief Makes an army for a surface forecast held in memory.
+ *
+ * The forecast is copied into an in-memory dataset owned by the army and
+ * one run is made for each time step, as makeArmy() does for a file.
+ *
+ * @param nSteps Number of time steps.
+ * @param panValidTimes Valid time of each step, seconds since the epoch.
+ * @param padfU u wind (m/s), nSteps grids of nXSize * nYSize values, north up.
+ * @param padfV v wind (m/s), same layout.
+ * @param padfAir Air temperature (K), same layout.
+ * @param padfCloud Cloud cover (percent), same layout.
+ * @param padfGeoTransform GDAL geotransform of the grids.
+ * @param pszWkt Projection of the grids.
+ * @param dfWindHeight Height of the wind above ground (m).
+ * @param timeZone String identifying time zone.
+ */
+void ninjaArmy::makeMemoryArmy(int nSteps, const time_t *panValidTimes,
+                               const double *padfU, const double *padfV,
+                               const double *padfAir, const double *padfCloud,
+                               int nXSize, int nYSize, const double *padfGeoTransform,
+                               const char *pszWkt, double dfWindHeight,
+                               std::string timeZone, bool momentumFlag)
+{
+    std::string forecast = NinjaMemoryInput::CreateForecast( nSteps, panValidTimes,
+            padfU, padfV, padfAir, padfCloud, nXSize, nYSize,
+            padfGeoTransform, pszWkt, dfWindHeight );
+    memoryInputs.push_back( NinjaMemoryInput::Hold( forecast ) );
+    makeArmy( forecast, timeZone, momentumFlag );
+}
+
+/**
+* @brief Combine the runs from stored basis solutions instead of solving them.
+*
+* Only neutral, non-diurnal domain-average runs can be combined, startRuns()
+* throws for anything else.
+*
+* @param flag True to use the wind atlas.
+*/
+void ninjaArmy::setWindAtlasFlag(bool flag)
+{
+    windAtlasFlag = flag;
+}
+
 void ninjaArmy::set_writeFarsiteAtmFile(bool flag)
 {
     writeFarsiteAtmFile = flag;
 }
 
+/*
+** Order runs by the inputs WindNinjaInputs::operator== compares, so that
+** duplicate runs end up next to each other.
+*/
+static bool CompareRunInputs( ninja *a, ninja *b )
+{
+    const WindNinjaInputs &x = a->input;
+    const WindNinjaInputs &y = b->input;
+    if( x.inputSpeed != y.inputSpeed )
+        return x.inputSpeed < y.inputSpeed;
+    if( x.inputSpeedUnits != y.inputSpeedUnits )
+        return x.inputSpeedUnits < y.inputSpeedUnits;
+    if( x.inputDirection != y.inputDirection )
+        return x.inputDirection < y.inputDirection;
+    if( x.airTemp != y.airTemp )
+        return x.airTemp < y.airTemp;
+    if( x.airTempUnits != y.airTempUnits )
+        return x.airTempUnits < y.airTempUnits;
+    if( x.cloudCover != y.cloudCover )
+        return x.cloudCover < y.cloudCover;
+    if( x.cloudCoverUnits != y.cloudCoverUnits )
+        return x.cloudCoverUnits < y.cloudCoverUnits;
+    if( x.ninjaTime.is_not_a_date_time() || y.ninjaTime.is_not_a_date_time() )
+    {
+        if( x.ninjaTime.is_not_a_date_time() != y.ninjaTime.is_not_a_date_time() )
+            return x.ninjaTime.is_not_a_date_time();
+    }
+    else if( x.ninjaTime != y.ninjaTime )
+        return x.ninjaTime < y.ninjaTime;
+    return x.diurnalWinds < y.diurnalWinds;
+}
+
+/**
+* @brief Check if the runs can be solved as a sweep sharing one system.
+*
+* All runs must be neutral domain-average runs on the same input and mesh
+* settings.  Set NINJA_SWEEP to NO to solve them separately.
+*
+* @return True if the army is a sweep.
+*/
+bool ninjaArmy::isSweep()
+{
+    if( ninjas.size() < 2 || wxList.size() > 1 ||
+        !CSLTestBoolean( CPLGetConfigOption( "NINJA_SWEEP", "YES" ) ) )
+        return false;
+#ifdef NINJAFOAM
+    if( ninjas[0]->identify() == "ninjafoam" )
+        return false;
+#endif
+    const ninja *first = ninjas[0];
+    for( unsigned int i = 0; i < ninjas.size(); i++ )
+    {
+        const ninja *run = ninjas[i];
+        if( !NinjaSweep::IsSweepable( run->input ) ||
+            run->input.dem.fileName != first->input.dem.fileName ||
+            run->input.surfaceGridsFilename != first->input.surfaceGridsFilename ||
+            run->input.vegetation != first->input.vegetation ||
+            run->input.inputWindHeight != first->input.inputWindHeight ||
+            run->input.outputWindHeight != first->input.outputWindHeight ||
+            run->mesh.meshResolution != first->mesh.meshResolution ||
+            run->mesh.targetNumHorizCells != first->mesh.targetNumHorizCells )
+            return false;
+    }
+    return true;
+}
+
+/**
+* @brief Check if the runs are a station time series solved in time order.
+*
+* Each run of the series starts from the mesh, system and solution of the
+* run before it.  Set NINJA_STATION_SERIES to NO to solve the runs in
+* parallel instead.
+*
+* @return True if the army is solved as a series.
+*/
+bool ninjaArmy::isStationSeries()
+{
+    if( !stationTimeSeries ||
+        !CSLTestBoolean( CPLGetConfigOption( "NINJA_STATION_SERIES", "YES" ) ) )
+        return false;
+    for( unsigned int i = 0; i < ninjas.size(); i++ )
+    {
+        if( !NinjaIncremental::CheckIncremental( ninjas[i]->input ).empty() )
+            return false;
+    }
+    return true;
+}
+
 /**
 * @brief Function to start WindNinja core runs using multiple threads.
 *
@@ -248,17 +447,21 @@ bool ninjaArmy::startRuns(int numProcessors)
     if(ninjas.size()<1 || numProcessors<1)
         return false;
 
-    //check for duplicate runs before we start the simulations 
+    //check for duplicate runs before we start the simulations, sorted so
+    //that only neighbors need to be compared
     if(ninjas.size() > 1){
-        for(unsigned int i=0; i<ninjas.size()-1; i++){
-            for(unsigned int j=i+1; j<ninjas.size(); j++){
-                if(ninjas[i]->input == ninjas[j]->input){
-                    throw std::runtime_error("Multiple runs were requested with the same input parameters.");
-                }
+        std::vector<ninja*> sorted(ninjas);
+        std::sort(sorted.begin(), sorted.end(), CompareRunInputs);
+        for(unsigned int i=0; i<sorted.size()-1; i++){
+            if(sorted[i]->input == sorted[i+1]->input){
+                throw std::runtime_error("Multiple runs were requested with the same input parameters.");
             }
         }
     }
 #ifdef NINJAFOAM
+    if(windAtlasFlag && ninjas[0]->identify() == "ninjafoam"){
+        throw std::logic_error("The wind atlas can only be used with the conservation of mass solver.");
+    }
     //if it's a ninjafoam run and the user specified an existing case dir, set it here
     if(ninjas[0]->identify() == "ninjafoam" & ninjas[0]->input.existingCaseDirectory != "!set"){
         NinjaFoam::SetFoamPath(ninjas[0]->input.existingCaseDirectory.c_str());
@@ -298,109 +501,141 @@ bool ninjaArmy::startRuns(int numProcessors)
         hBand = GDALGetRasterBand( hDS, 1 );
         assert( hBand );
 
-        int nXSize = GDALGetRasterXSize( hDS );
-        int nYSize = GDALGetRasterYSize( hDS );
         /*
-        ** Figure out How big we need to make our raster, given a width,
-        ** height and dpi.
+        ** The prepared basemap only depends on the DEM, page size, dpi and
+        ** base map type, so reuse one prepared by an earlier army if we can.
         */
-        double dfWidth, dfHeight;
-        unsigned short nDPI;
-        dfHeight = ninjas[0]->input.pdfHeight - OutputWriter::TOP_MARGIN - OutputWriter::BOTTOM_MARGIN;
-        dfWidth = ninjas[0]->input.pdfWidth - 2.0*OutputWriter::SIDE_MARGIN;
-        nDPI = ninjas[0]->input.pdfDPI;
-        double dfRatio, dfRatioH, dfRatioW;
-
-        dfRatioH = dfHeight * nDPI / nYSize;
-        dfRatioW = dfWidth * nDPI / nXSize;
-        dfRatio = MIN( dfRatioH, dfRatioW );
-
-        int nNewXSize = nXSize * dfRatio;
-        int nNewYSize = nYSize * dfRatio;
-
-        CPLSetConfigOption( "GDAL_PAM_ENABLED", "OFF" );
-
-        SURF_FETCH_E retval = SURF_FETCH_E_NONE;
-        if( ninjas[0]->input.pdfBaseType == WindNinjaInputs::TOPOFIRE )
+        std::string osKey = OutputWriter::BasemapCacheKey( hDS,
+                                    ninjas[0]->input.pdfWidth,
+                                    ninjas[0]->input.pdfHeight,
+                                    ninjas[0]->input.pdfDPI,
+                                    (int)ninjas[0]->input.pdfBaseType );
+        pdfBasemap = OutputWriter::GetCachedBasemap( osKey );
+        if( pdfBasemap )
         {
-            SurfaceFetch * fetcher = FetchFactory::GetSurfaceFetch( "relief" );
-            retval = fetcher->makeReliefOf( ninjas[0]->input.dem.fileName,
-                                            pszTmpColorRelief, nNewXSize, nNewYSize );
-            delete fetcher;
+            CPLDebug( "NINJA", "Using cached pdf basemap %s",
+                      pdfBasemap->osFilename.c_str() );
+            GDALClose( hDS );
         }
-        /*
-        ** If we fail, or the user wants a hillshade, copy the dem into the
-        ** file as an 8 bit GeoTiff
-        */
-        if( ninjas[0]->input.pdfBaseType == WindNinjaInputs::HILLSHADE ||
-            retval != SURF_FETCH_E_NONE )
+        else
         {
-            CPLDebug( "NINJA", "Failed to download relief, creating hillshade" );
-            GDALDriverH hDrv = NULL;
-            hDrv = GDALGetDriverByName( "GTiff" );
-            assert( hDrv );
-            CPLSetErrorHandler( CPLQuietErrorHandler );
-            GDALDeleteDataset( hDrv, pszTmpColorRelief );
-            CPLPopErrorHandler();
-
-            GDALDatasetH h8bit = GDALCreate( hDrv, pszTmpColorRelief, nNewXSize,
-                                             nNewYSize, 1, GDT_Byte, NULL );
-            CPLErr eErr = CE_None;
-            double adfGeoTransform[6];
-            eErr = GDALGetGeoTransform( hDS, adfGeoTransform );
-            assert( eErr == CE_None );
-            adfGeoTransform[1] /= dfRatio;
-            adfGeoTransform[5] /= dfRatio;
-            GDALSetGeoTransform( h8bit, adfGeoTransform );
-
-            GDALSetProjection( h8bit, GDALGetProjectionRef( hDS ) );
-
-            GDALRasterBandH h8bitBand = GDALGetRasterBand( h8bit, 1 );
-            float *padfData = NULL;
-            padfData = (float*)CPLMalloc( nNewXSize * nNewYSize * sizeof( float ) );
-            unsigned char *pabyData = NULL;
-            pabyData = (unsigned char*)CPLMalloc( nNewXSize * nNewYSize * sizeof( unsigned char* ) );
-            double adfMinMax[2];
-            int bSuccess = TRUE;
-            double dfMin, dfMax, dfMean, dfStdDev;
-            GDALComputeRasterStatistics( hBand, FALSE, &dfMin, &dfMax, &dfMean, &dfStdDev, NULL, NULL );
-
-            eErr = GDALRasterIO( hBand, GF_Read, 0, 0, nXSize, nYSize,
-                                 padfData, nNewXSize, nNewYSize,
-                                 GDT_Float32, 0, 0 );
-            assert( eErr == CE_None );
-            for( int i = 0; i < nNewXSize * nNewYSize; i++ )
+            int nXSize = GDALGetRasterXSize( hDS );
+            int nYSize = GDALGetRasterYSize( hDS );
+            /*
+            ** Figure out How big we need to make our raster, given a width,
+            ** height and dpi.
+            */
+            double dfWidth, dfHeight;
+            unsigned short nDPI;
+            dfHeight = ninjas[0]->input.pdfHeight - OutputWriter::TOP_MARGIN - OutputWriter::BOTTOM_MARGIN;
+            dfWidth = ninjas[0]->input.pdfWidth - 2.0*OutputWriter::SIDE_MARGIN;
+            nDPI = ninjas[0]->input.pdfDPI;
+            double dfRatio, dfRatioH, dfRatioW;
+
+            dfRatioH = dfHeight * nDPI / nYSize;
+            dfRatioW = dfWidth * nDPI / nXSize;
+            dfRatio = MIN( dfRatioH, dfRatioW );
+
+            int nNewXSize = nXSize * dfRatio;
+            int nNewYSize = nYSize * dfRatio;
+
+            CPLSetConfigOption( "GDAL_PAM_ENABLED", "OFF" );
+
+            SURF_FETCH_E retval = SURF_FETCH_E_NONE;
+            if( ninjas[0]->input.pdfBaseType == WindNinjaInputs::TOPOFIRE )
             {
-                /*
-                ** Figure out what is going on here and document it.  It makes a
-                ** potentially useful map whern dfMax=BIG and dfMin=-BIG.
-                */
-                //double dfMin = GDALGetRasterMinimum( hBand, NULL );
-                //double dfMax = GDALGetRasterMaximum( hBand, NULL );
-                //pabyData[j] = (unsigned char)(padfData[j] * (dfMax - dfMin) / (dfMax - dfMin)) * 255;
-
-                /* Normal */
-                pabyData[i] = ((padfData[i] - dfMin) / (dfMax - dfMin)) * 255;
+                SurfaceFetch * fetcher = FetchFactory::GetSurfaceFetch( "relief" );
+                retval = fetcher->makeReliefOf( ninjas[0]->input.dem.fileName,
+                                                pszTmpColorRelief, nNewXSize, nNewYSize );
+                delete fetcher;
             }
-            eErr = GDALRasterIO( h8bitBand, GF_Write, 0, 0, nNewXSize,
-                                 nNewYSize, pabyData, nNewXSize, nNewYSize,
-                                 GDT_Byte, 0, 0 );
-            assert( eErr == CE_None );
-            CPLFree( (void*)padfData );
-            CPLFree( (void*)pabyData );
-            GDALFlushCache( h8bit );
-            GDALClose( hDS );
-            GDALClose( h8bit );
-
-            /* delete stats file */
-            if( CPLCheckForFile( (char*)CPLSPrintf("%s.aux.xml", ninjas[0]->input.dem.fileName.c_str()), NULL ) ){
-                VSIUnlink( CPLSPrintf("%s.aux.xml", ninjas[0]->input.dem.fileName.c_str()) );
+            /*
+            ** If we fail, or the user wants a hillshade, copy the dem into the
+            ** file as an 8 bit GeoTiff
+            */
+            if( ninjas[0]->input.pdfBaseType == WindNinjaInputs::HILLSHADE ||
+                retval != SURF_FETCH_E_NONE )
+            {
+                CPLDebug( "NINJA", "Failed to download relief, creating hillshade" );
+                GDALDriverH hDrv = NULL;
+                hDrv = GDALGetDriverByName( "GTiff" );
+                assert( hDrv );
+                CPLSetErrorHandler( CPLQuietErrorHandler );
+                GDALDeleteDataset( hDrv, pszTmpColorRelief );
+                CPLPopErrorHandler();
+
+                GDALDatasetH h8bit = GDALCreate( hDrv, pszTmpColorRelief, nNewXSize,
+                                                 nNewYSize, 1, GDT_Byte, NULL );
+                CPLErr eErr = CE_None;
+                double adfGeoTransform[6];
+                eErr = GDALGetGeoTransform( hDS, adfGeoTransform );
+                assert( eErr == CE_None );
+                adfGeoTransform[1] /= dfRatio;
+                adfGeoTransform[5] /= dfRatio;
+                GDALSetGeoTransform( h8bit, adfGeoTransform );
+
+                GDALSetProjection( h8bit, GDALGetProjectionRef( hDS ) );
+
+                GDALRasterBandH h8bitBand = GDALGetRasterBand( h8bit, 1 );
+                float *padfData = NULL;
+                padfData = (float*)CPLMalloc( nNewXSize * nNewYSize * sizeof( float ) );
+                unsigned char *pabyData = NULL;
+                pabyData = (unsigned char*)CPLMalloc( nNewXSize * nNewYSize * sizeof( unsigned char* ) );
+                double adfMinMax[2];
+                int bSuccess = TRUE;
+                double dfMin, dfMax, dfMean, dfStdDev;
+                GDALComputeRasterStatistics( hBand, FALSE, &dfMin, &dfMax, &dfMean, &dfStdDev, NULL, NULL );
+
+                eErr = GDALRasterIO( hBand, GF_Read, 0, 0, nXSize, nYSize,
+                                     padfData, nNewXSize, nNewYSize,
+                                     GDT_Float32, 0, 0 );
+                assert( eErr == CE_None );
+                for( int i = 0; i < nNewXSize * nNewYSize; i++ )
+                {
+                    /*
+                    ** Figure out what is going on here and document it.  It makes a
+                    ** potentially useful map whern dfMax=BIG and dfMin=-BIG.
+                    */
+                    //double dfMin = GDALGetRasterMinimum( hBand, NULL );
+                    //double dfMax = GDALGetRasterMaximum( hBand, NULL );
+                    //pabyData[j] = (unsigned char)(padfData[j] * (dfMax - dfMin) / (dfMax - dfMin)) * 255;
+
+                    /* Normal */
+                    pabyData[i] = ((padfData[i] - dfMin) / (dfMax - dfMin)) * 255;
+                }
+                eErr = GDALRasterIO( h8bitBand, GF_Write, 0, 0, nNewXSize,
+                                     nNewYSize, pabyData, nNewXSize, nNewYSize,
+                                     GDT_Byte, 0, 0 );
+                assert( eErr == CE_None );
+                CPLFree( (void*)padfData );
+                CPLFree( (void*)pabyData );
+                GDALFlushCache( h8bit );
+                GDALClose( hDS );
+                GDALClose( h8bit );
+
+                /* delete stats file */
+                if( CPLCheckForFile( (char*)CPLSPrintf("%s.aux.xml", ninjas[0]->input.dem.fileName.c_str()), NULL ) ){
+                    VSIUnlink( CPLSPrintf("%s.aux.xml", ninjas[0]->input.dem.fileName.c_str()) );
+                }
+            }
+            else
+            {
+                GDALClose( hDS );
+            }
+            /*
+            ** Only keep the base map the user asked for, a hillshade made
+            ** because the relief download failed should be retried next time.
+            */
+            if( retval == SURF_FETCH_E_NONE )
+            {
+                pdfBasemap = OutputWriter::CacheBasemap( osKey, pszTmpColorRelief );
             }
         }
         /* Make sure all runs point to the proper DEM file */
         for(unsigned int i = 0; i < ninjas.size(); i++)
         {
-            ninjas[i]->input.pdfDEMFileName = pszTmpColorRelief;
+            ninjas[i]->input.pdfDEMFileName = pdfBasemap ? pdfBasemap->osFilename
+                                                         : std::string( pszTmpColorRelief );
         }
         CPLSetConfigOption( "GDAL_PAM_ENABLED", "ON" );
     }
@@ -473,70 +708,108 @@ bool ninjaArmy::startRuns(int numProcessors)
 #ifdef _OPENMP
         omp_set_num_threads(numProcessors);
 #endif
-        for(unsigned int i = 0; i < ninjas.size(); i++)
+        //small domains don't scale to all cores, so solve several runs at once
+        int nCells = atoi(CPLGetConfigOption("NINJAFOAM_MESH_COUNT",
+                          CPLSPrintf("%d", ninjas[0]->input.meshCount)));
+        int nConcurrent = NinjaFoam::GetConcurrentRuns(nCells, ninjas.size(), numProcessors);
+        unsigned int nFirst = 0;
+
+        if(nConcurrent > 1)
         {
-            try{
-                //set number of threads for the run
-                ninjas[i]->set_numberCPUs( numProcessors );
- 
-                //start the run
-                if(!ninjas[i]->simulate_wind()){
-                    throw std::runtime_error("ninjaArmy: Error in NinjaFoam::simulate_wind().");
-                }
-                //if it's a ninjafoam run and diurnal is turned on, link the ninjafoam with 
-                //a ninja run to add diurnal flow after the cfd solution is computed
-                if(ninjas[i]->identify() == "ninjafoam" & ninjas[i]->input.diurnalWinds == true){
-                    CPLDebug("NINJA", "Starting a ninja to add diurnal to ninjafoam output.");
-                    ninja* diurnal_ninja = new ninja(*ninjas[i]);
-                    diurnal_ninja->set_foamVelocityGrid(ninjas[i]->VelocityGrid);
-                    diurnal_ninja->set_foamAngleGrid(ninjas[i]->AngleGrid);
-                    if(ninjas[i]->input.initializationMethod == WindNinjaInputs::domainAverageInitializationFlag){
-                        diurnal_ninja->input.initializationMethod = WindNinjaInputs::foamDomainAverageInitializationFlag;
-                    }
-                    else if(ninjas[i]->input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag){
-                        diurnal_ninja->input.initializationMethod = WindNinjaInputs::foamWxModelInitializationFlag;
-                    }
-                    else{
-                        throw std::runtime_error("ninjaArmy: Initialization method not set properly.");
-                    }
-                    diurnal_ninja->input.inputWindHeight = ninjas[i]->input.outputWindHeight;
-                    //if case is re-used resolution may not be set, set mesh resolution based on ninjas[0]
-                    diurnal_ninja->set_meshResolution(ninjas[0]->get_meshResolution(), lengthUnits::getUnit("m")); 
-                    if(!diurnal_ninja->simulate_wind()){
-                        throw std::runtime_error("ninjaArmy: Error in ninja::simulate_wind().");
-                    }
-                    //set output path on original ninja for the GUI
-                    ninjas[i]->input.outputPath = diurnal_ninja->input.outputPath;
-                } 
-                //write farsite atmosphere file
-                writeFarsiteAtmosphereFile();
-            
-            }catch (bad_alloc& e)
+            //mesh once in the army's case, unless it is an existing meshed case
+            NinjaFoam *poFirst = dynamic_cast<NinjaFoam*>(ninjas[0]);
+            if(poFirst->CheckForValidCaseDir(NinjaFoam::GetFoamPath()) != NINJA_SUCCESS)
             {
-                std::cout << "Exception bad_alloc caught: " << e.what() << endl;
-                std::cout << "WindNinja appears to have run out of memory." << endl;
-                status = false;
-            }catch (cancelledByUser& e)
+                nFirst = 1;
+                if(!simulateFoamRun(0, numProcessors)){
+                    status = false;
+                    nConcurrent = 1; //nothing to share, fall back to serial runs
+                }
+            }
+        }
+
+        if(nConcurrent > 1)
+        {
+            int nCoresPerRun = numProcessors / nConcurrent;
+            CPLDebug("NINJAFOAM", "Solving %d runs at once on %d cores each",
+                     nConcurrent, nCoresPerRun);
+
+            //each run gets its own copy of the meshed case
+            for(unsigned int i = nFirst; i < ninjas.size(); i++)
             {
-                std::cout << "Exception caught: " << e.what() << endl;
-                status = false;
-            }catch (exception& e)
+                std::string caseDir = NinjaFoam::CreateCaseDirectory(ninjas[i]->input.dem.fileName);
+                if(!NinjaFoamMeshCache::CloneCase(NinjaFoam::GetFoamPath(), caseDir.c_str())){
+                    throw std::runtime_error("Error copying the NINJAFOAM case directory.");
+                }
+                dynamic_cast<NinjaFoam*>(ninjas[i])->SetCaseDirectory(caseDir.c_str());
+            }
+
+            #pragma omp parallel for schedule(dynamic, 1) num_threads(nConcurrent)
+            for(int i = nFirst; i < (int)ninjas.size(); i++)
             {
-                std::cout << "Exception caught: " << e.what() << endl;
-                status = false;
-            }catch (...)
+                //a thread owns one block of cores for all the runs it solves
+                int nThread = 0;
+#ifdef _OPENMP
+                nThread = omp_get_thread_num();
+#endif
+                dynamic_cast<NinjaFoam*>(ninjas[i])->SetCoreOffset(nThread * nCoresPerRun);
+                if(!simulateFoamRun(i, nCoresPerRun)){
+                    status = false;
+                }
+            }
+            //write farsite atmosphere file
+            writeFarsiteAtmosphereFile();
+        }
+        else
+        {
+            for(unsigned int i = nFirst; i < ninjas.size(); i++)
             {
-                std::cout << "Exception caught: Cannot determine exception type." << endl;
-                status = false;
+                if(!simulateFoamRun(i, numProcessors)){
+                    status = false;
+                }
+                //write farsite atmosphere file
+                writeFarsiteAtmosphereFile();
             }
         }
     }
 #endif //NINJAFOAM            
     else
     {
+        //atlas runs are combined from two basis solutions solved once per
+        //domain and cached for the life of the process
+        windAtlases.clear();
+        if(windAtlasFlag)
+        {
+            for(unsigned int i = 0; i < ninjas.size(); i++)
+            {
+                NinjaWindAtlas::Ptr poAtlas = NinjaWindAtlas::Get(*ninjas[i], numProcessors);
+                windAtlases.push_back(poAtlas);
+                ninjas[i]->set_windAtlas(poAtlas.get());
+            }
+        }
+
+        //a sweep solves its runs one after another on all threads, sharing
+        //the matrix and preconditioner built by the first run
+        boost::shared_ptr<NinjaSweep> poSweep;
+        if(!windAtlasFlag && isSweep())
+        {
+            CPLDebug("NINJA", "Solving %d runs as a sweep", (int)ninjas.size());
+            poSweep.reset(new NinjaSweep());
+        }
+
+        //a station time series is solved in time order, each run picking
+        //up the state the previous one left for the domain
+        bool stationSeries = !poSweep && isStationSeries();
+        if(stationSeries)
+            CPLDebug("NINJA", "Solving %d runs as a station time series", (int)ninjas.size());
+        bool serialRuns = poSweep || stationSeries;
+
         for(unsigned int i = 0; i < ninjas.size(); i++)
         {
-            ninjas[i]->set_numberCPUs(1);
+            ninjas[i]->set_numberCPUs(serialRuns ? numProcessors : 1);
+            ninjas[i]->set_sweep(poSweep.get());
+            if(stationSeries)
+                ninjas[i]->set_incrementalPointRun(true);
         }
 
         /*FOR_EVERY(iter_ninja, ninjas)
@@ -551,22 +824,48 @@ bool ninjaArmy::startRuns(int numProcessors)
         
         std::vector<boost::local_time::local_date_time> timeList; 
      
-        //create MEM datasets for GTiff output writer
-        ninjas[0]->readInputFile();
-        ninjas[0]->set_position();
-        ninjas[0]->set_uniVegetation();
-        ninjas[0]->mesh.buildStandardMesh(ninjas[0]->input);
-        
-        int nXSize = ninjas[0]->input.dem.get_nCols(); //57; 
-        int nYSize = ninjas[0]->input.dem.get_nRows(); //70; 
-    
-        GDALDriverH hDriver = GDALGetDriverByName( "MEM" );
-        
-        hSpdMemDS = GDALCreate(hDriver, "", nXSize, nYSize, 1, GDT_Float64, NULL);
-        hDirMemDS = GDALCreate(hDriver, "", nXSize, nYSize, 1, GDT_Float64, NULL);
-        hDustMemDS = GDALCreate(hDriver, "", nXSize, nYSize, 1, GDT_Float64, NULL);
+        //collects each run's bands for the multi-band GTiff output writer
+        OutputDatasetPool oOutputPool(ninjas.size());
+#ifdef EMISSIONS
+        //the series are named before the runs, any of them may complete one
+        if( wxList.size() > 1 && ninjas[0]->input.geotiffOutFlag )
+        {
+            const char *apszGrids[] = { "spd", "dir", "dust" };
+            for(int k = 0; k < 3; k++)
+                oOutputPool.SetFilename( apszGrids[k],
+                        OutputWriter::GetGTiffFilename( ninjas[0]->input.geotiffOutFilename,
+                                                        apszGrids[k] ) );
+        }
+#endif
+
+        //one NetCDF file for the whole army, each run appends a time slice
+        boost::shared_ptr<TimeSeriesWriter> poTimeSeries;
+        if( ninjas[0]->input.netcdfOutFlag )
+        {
+            poTimeSeries.reset( new TimeSeriesWriter( ninjas[0]->input.netcdfOutFilename,
+                                                      ninjas[0]->input.outputSpeedUnits ) );
+            for(unsigned int i = 0; i < ninjas.size(); i++)
+            {
+                ninjas[i]->set_timeSeriesWriter( poTimeSeries.get() );
+            }
+        }
 
-	#pragma omp parallel for //spread runs on single threads
+        //one point output file for the whole army, rows written in run order
+        boost::shared_ptr<PointOutputWriter> poPointWriter;
+        if( ninjas[0]->input.inputPointsFilename != "!set" )
+        {
+            std::string osPointFile = ninjas[0]->input.outputPointsFilename;
+            if( osPointFile == "!set" )
+                osPointFile = "output.txt";
+            poPointWriter.reset( new PointOutputWriter( osPointFile,
+                    PointOutputWriter::GetFormat( ninjas[0]->input.outputPointsFormat ) ) );
+            for(unsigned int i = 0; i < ninjas.size(); i++)
+            {
+                ninjas[i]->set_pointOutputWriter( poPointWriter.get() );
+            }
+        }
+
+	#pragma omp parallel for if(!serialRuns) //spread runs on single threads
         //FOR_EVERY(iter_ninja, ninjas) //Doesn't work with omp
         for( int i = 0; i < ninjas.size(); i++ )
         {
@@ -582,8 +881,8 @@ bool ninjaArmy::startRuns(int numProcessors)
                     ninjas[i]->set_date_time(timeList[0]);
                     ninjas[i]->set_wxModelFilename( wxList[i] );
                     ninjas[i]->set_date_time( timeList[0] );
-                    //set in-memory datasets for GTiff output writer
-                    ninjas[i]->set_memDs(hSpdMemDS, hDirMemDS, hDustMemDS); 
+                    //bands are collected per run and written once all runs are done
+                    ninjas[i]->set_outputDatasetPool(&oOutputPool);
                     
                     delete model;
                 }
@@ -663,6 +962,37 @@ bool ninjaArmy::startRuns(int numProcessors)
 #endif
             }
         }
+        //the sweep and the army wide writers go away with this scope
+        for(unsigned int i = 0; i < ninjas.size(); i++)
+        {
+            if(ninjas[i] != NULL)
+            {
+                ninjas[i]->set_sweep(NULL);
+                ninjas[i]->set_timeSeriesWriter(NULL);
+                ninjas[i]->set_pointOutputWriter(NULL);
+            }
+        }
+        //series left incomplete by a failed run still get the bands they have
+        oOutputPool.Flush();
+        //write anything still queued and close the NetCDF and point files
+        //before a failed run is reported, so the runs that finished are kept
+        try
+        {
+            if(poTimeSeries)
+                poTimeSeries->Close();
+            if(poPointWriter)
+                poPointWriter->Close();
+        }
+        catch(exception& e)
+        {
+            if(status)
+            {
+                std::cout << "Exception caught: " << e.what() << endl;
+                status = false;
+                throw;
+            }
+            CPLDebug("NINJA", "Closing output files after a failed run: %s", e.what());
+        }
 #ifdef _OPENMP
         NinjaRethrowThreadedException( anErrors, asMessages, numProcessors );
 #endif
@@ -751,6 +1081,79 @@ bool ninjaArmy::startFirstRun()
     return status;
 }
 
+#ifdef NINJAFOAM
+/**
+ * @brief Solve one NinjaFoam run of the army
+ *
+ * Adds diurnal flow with a linked ninja run if requested.  Errors are
+ * reported and swallowed so the other runs can go on.
+ * @param i index of the run
+ * @param numProcessors cores the run may use
+ * @return true on success
+ */
+bool ninjaArmy::simulateFoamRun(unsigned int i, int numProcessors)
+{
+    try{
+        //set number of threads for the run
+        ninjas[i]->set_numberCPUs( numProcessors );
+
+        //start the run
+        if(!ninjas[i]->simulate_wind()){
+            throw std::runtime_error("ninjaArmy: Error in NinjaFoam::simulate_wind().");
+        }
+        //if it's a ninjafoam run and diurnal is turned on, link the ninjafoam with 
+        //a ninja run to add diurnal flow after the cfd solution is computed
+        if(ninjas[i]->identify() == "ninjafoam" & ninjas[i]->input.diurnalWinds == true){
+            CPLDebug("NINJA", "Starting a ninja to add diurnal to ninjafoam output.");
+            ninja* diurnal_ninja = new ninja(*ninjas[i]);
+            diurnal_ninja->set_foamVelocityGrid(ninjas[i]->VelocityGrid);
+            diurnal_ninja->set_foamAngleGrid(ninjas[i]->AngleGrid);
+            if(ninjas[i]->input.initializationMethod == WindNinjaInputs::domainAverageInitializationFlag){
+                diurnal_ninja->input.initializationMethod = WindNinjaInputs::foamDomainAverageInitializationFlag;
+            }
+            else if(ninjas[i]->input.initializationMethod == WindNinjaInputs::wxModelInitializationFlag){
+                diurnal_ninja->input.initializationMethod = WindNinjaInputs::foamWxModelInitializationFlag;
+            }
+            else{
+                throw std::runtime_error("ninjaArmy: Initialization method not set properly.");
+            }
+            diurnal_ninja->input.inputWindHeight = ninjas[i]->input.outputWindHeight;
+            //if case is re-used resolution may not be set, set mesh resolution based on ninjas[0]
+            diurnal_ninja->set_meshResolution(ninjas[0]->get_meshResolution(), lengthUnits::getUnit("m")); 
+            if(!diurnal_ninja->simulate_wind()){
+                throw std::runtime_error("ninjaArmy: Error in ninja::simulate_wind().");
+            }
+            //set output path on original ninja for the GUI
+            ninjas[i]->input.outputPath = diurnal_ninja->input.outputPath;
+        } 
+    }catch (bad_alloc& e)
+    {
+        #pragma omp critical(foam_army_messages)
+        {
+        std::cout << "Exception bad_alloc caught: " << e.what() << endl;
+        std::cout << "WindNinja appears to have run out of memory." << endl;
+        }
+        return false;
+    }catch (cancelledByUser& e)
+    {
+        #pragma omp critical(foam_army_messages)
+        std::cout << "Exception caught: " << e.what() << endl;
+        return false;
+    }catch (exception& e)
+    {
+        #pragma omp critical(foam_army_messages)
+        std::cout << "Exception caught: " << e.what() << endl;
+        return false;
+    }catch (...)
+    {
+        #pragma omp critical(foam_army_messages)
+        std::cout << "Exception caught: Cannot determine exception type." << endl;
+        return false;
+    }
+    return true;
+}
+#endif //NINJAFOAM
+
 /**
  * @brief write the atm file
  *
@@ -761,9 +1164,10 @@ void ninjaArmy::writeFarsiteAtmosphereFile()
 {
     if(writeFarsiteAtmFile)
     {
-        //If wxModelInitialization, make one .atm with all runs (times) listed, else the setAtmFlags() function
-        //  has already set each ninja to write their own atm file, so don't do it here!
-        if(ninjas[0]->get_initializationMethod() == WindNinjaInputs::wxModelInitializationFlag)
+        //If wxModelInitialization or a station time series, make one .atm with all runs (times) listed, else the
+        //  setAtmFlags() function has already set each ninja to write their own atm file, so don't do it here!
+        if(ninjas[0]->get_initializationMethod() == WindNinjaInputs::wxModelInitializationFlag ||
+           stationTimeSeries)
         {
             //Set directory path from first ninja's velocity file
             std::string filePath = CPLGetPath( ninjas[0]->get_VelFileName().c_str() );
@@ -850,8 +1254,9 @@ void ninjaArmy::setAtmFlags()
 {
     if(writeFarsiteAtmFile)
     {
-        //if it's not a weather model run, set all ninja's atm write flags
-        if(!(ninjas[0]->get_initializationMethod() == WindNinjaInputs::wxModelInitializationFlag))
+        //if it's not a weather model run or a station time series, set all ninja's atm write flags
+        if(!(ninjas[0]->get_initializationMethod() == WindNinjaInputs::wxModelInitializationFlag ||
+             stationTimeSeries))
         {
             //FOR_EVERY( ninja, ninjas )
             for(unsigned int i = 0; i < ninjas.size(); i++)
@@ -1034,6 +1439,56 @@ int ninjaArmy::setDEM( const int nIndex, const std::string dem_filename, char **
     IF_VALID_INDEX_TRY( nIndex, ninjas, ninjas[ nIndex ]->set_DEM( dem_filename ) );
 }
 
+int ninjaArmy::setMemoryDEM( const int nIndex, const double *padfElevation,
+                             const int nXSize, const int nYSize,
+                             const double *padfGeoTransform, const char *pszWkt,
+                             const double dfNoData, char ** papszOptions )
+{
+    IF_VALID_INDEX( nIndex, ninjas )
+    {
+        if( padfElevation == NULL )
+            return NINJA_E_INVALID;
+        try
+        {
+            std::string dem = NinjaMemoryInput::CreateGrid( "dem", 1, &padfElevation,
+                    nXSize, nYSize, padfGeoTransform, pszWkt, dfNoData );
+            memoryInputs.push_back( NinjaMemoryInput::Hold( dem ) );
+            ninjas[ nIndex ]->set_DEM( dem );
+        }
+        catch( ... )
+        {
+            return NINJA_E_INVALID;
+        }
+        return NINJA_SUCCESS;
+    }
+    return NINJA_E_INVALID;
+}
+
+int ninjaArmy::setMemorySurface( const int nIndex, const double *padfRoughness,
+                                 const double *padfRoughH, const double *padfRoughD,
+                                 const int nXSize, const int nYSize,
+                                 const double *padfGeoTransform, const char *pszWkt,
+                                 char ** papszOptions )
+{
+    IF_VALID_INDEX( nIndex, ninjas )
+    {
+        const double *apadfBands[3] = { padfRoughness, padfRoughH, padfRoughD };
+        try
+        {
+            std::string surface = NinjaMemoryInput::CreateGrid( "surface", 3, apadfBands,
+                    nXSize, nYSize, padfGeoTransform, pszWkt, -9999.0 );
+            memoryInputs.push_back( NinjaMemoryInput::Hold( surface ) );
+            ninjas[ nIndex ]->set_surfaceGridsFilename( surface );
+        }
+        catch( ... )
+        {
+            return NINJA_E_INVALID;
+        }
+        return NINJA_SUCCESS;
+    }
+    return NINJA_E_INVALID;
+}
+
 int ninjaArmy::setPosition( const int nIndex, const double lat_degrees, const double lon_degrees,
                  char ** papszOptions )
 {
@@ -1054,6 +1509,11 @@ int ninjaArmy::setOutputPointsFilename( const int nIndex, const std::string file
     IF_VALID_INDEX_TRY( nIndex, ninjas, ninjas[ nIndex ]->set_outputPointsFilename( filename ) );
 }
 
+int ninjaArmy::setOutputPointsFormat( const int nIndex, const std::string format, char **papszOptions)
+{
+    IF_VALID_INDEX_TRY( nIndex, ninjas, ninjas[ nIndex ]->set_outputPointsFormat( format ) );
+}
+
 int ninjaArmy::readInputFile( const int nIndex, const std::string filename, char ** papszOptions )
 {
     IF_VALID_INDEX_TRY( nIndex, ninjas,
@@ -1335,6 +1795,13 @@ int ninjaArmy::setWxStationFilename( const int nIndex, const std::string station
             ninjas[ nIndex ]->set_wxStationFilename( station_filename ) );
 }
 
+int ninjaArmy::setIncrementalPointRun( const int nIndex, const bool flag,
+                                       char ** papszOptions )
+{
+    IF_VALID_INDEX_TRY( nIndex, ninjas,
+            ninjas[ nIndex ]->set_incrementalPointRun( flag ) );
+}
+
 std::vector<wxStation> ninjaArmy::getWxStations( const int nIndex, char ** papszOptions )
 {
     IF_VALID_INDEX( nIndex, ninjas )
@@ -1672,6 +2139,19 @@ int ninjaArmy::setVtkOutFlag( const int nIndex, const bool flag, char ** papszOp
             ninjas[ nIndex ]->set_vtkOutFlag( flag ) );
 }
 
+int ninjaArmy::setNetcdfOutFlag( const int nIndex, const bool flag, char ** papszOptions )
+{
+    IF_VALID_INDEX_TRY( nIndex, ninjas,
+            ninjas[ nIndex ]->set_netcdfOutFlag( flag ) );
+}
+
+int ninjaArmy::setNetcdfOutFilename( const int nIndex, const std::string filename,
+                                     char ** papszOptions )
+{
+    IF_VALID_INDEX_TRY( nIndex, ninjas,
+            ninjas[ nIndex ]->set_netcdfOutFilename( filename ) );
+}
+
 int ninjaArmy::setTxtOutFlag( const int nIndex, const bool flag, char ** papszOptions )
 {
     IF_VALID_INDEX_TRY( nIndex, ninjas,
@@ -1744,6 +2224,84 @@ std::string ninjaArmy::getOutputPath( const int nIndex, char ** papszOptions )
     }
     return std::string("");
 }
+
+int ninjaArmy::setFileOutFlag( const int nIndex, const bool flag, char ** papszOptions )
+{
+    IF_VALID_INDEX_TRY( nIndex, ninjas, ninjas[ nIndex ]->set_fileOutFlag( flag ) );
+}
+
+int ninjaArmy::setOutputGridsInMemory( const int nIndex, const bool flag,
+                                       const bool include3d, char ** papszOptions )
+{
+    IF_VALID_INDEX_TRY( nIndex, ninjas,
+            ninjas[ nIndex ]->keepOutputGridsInMemory( flag );
+            ninjas[ nIndex ]->keepOutput3dFieldsInMemory( flag && include3d ) );
+}
+
+const double * ninjaArmy::getOutputGrid( const int nIndex, const std::string name,
+                                         int *pnRows, int *pnCols,
+                                         double *padfGeoTransform, double *pdfNoData,
+                                         char ** papszOptions )
+{
+    IF_VALID_INDEX( nIndex, ninjas )
+    {
+        //forecast runs of a multi-file army are freed as they finish
+        if( ninjas[ nIndex ] == NULL )
+            return NULL;
+        const AsciiGrid<double> *poGrid = NULL;
+        if( name == "speed" )
+            poGrid = &ninjas[ nIndex ]->VelocityGrid;
+        else if( name == "direction" )
+            poGrid = &ninjas[ nIndex ]->AngleGrid;
+        else if( name == "cloud" )
+            poGrid = &ninjas[ nIndex ]->CloudGrid;
+        //deallocate() leaves a zero cell size behind
+        if( poGrid == NULL || poGrid->get_cellSize() <= 0.0 )
+            return NULL;
+        const double *pData = poGrid->data.get_dataPointer();
+        if( pData == NULL )
+            return NULL;
+        *pnRows = poGrid->get_nRows();
+        *pnCols = poGrid->get_nCols();
+        if( padfGeoTransform )
+        {
+            padfGeoTransform[0] = poGrid->get_xllCorner();
+            padfGeoTransform[1] = poGrid->get_cellSize();
+            padfGeoTransform[2] = 0.0;
+            padfGeoTransform[3] = poGrid->get_yllCorner();
+            padfGeoTransform[4] = 0.0;
+            padfGeoTransform[5] = poGrid->get_cellSize();
+        }
+        if( pdfNoData )
+            *pdfNoData = poGrid->get_noDataValue();
+        return pData;
+    }
+    return NULL;
+}
+
+const double * ninjaArmy::getOutputField3d( const int nIndex, const std::string name,
+                                            int *pnRows, int *pnCols, int *pnLayers,
+                                            char ** papszOptions )
+{
+    IF_VALID_INDEX( nIndex, ninjas )
+    {
+        if( ninjas[ nIndex ] == NULL )
+            return NULL;
+        return ninjas[ nIndex ]->get_outputField3d( name, *pnRows, *pnCols, *pnLayers );
+    }
+    return NULL;
+}
+
+int ninjaArmy::releaseOutputGrids( const int nIndex, char ** papszOptions )
+{
+    IF_VALID_INDEX( nIndex, ninjas )
+    {
+        if( ninjas[ nIndex ] != NULL )
+            ninjas[ nIndex ]->releaseOutputGrids();
+        return NINJA_SUCCESS;
+    }
+    return NINJA_E_INVALID;
+}
 /**
  * @brief Reset the army in able to reinitialize needed parameters
  *
@@ -1752,6 +2310,9 @@ void ninjaArmy::reset()
 {
     ninjas.clear();
     writeFarsiteAtmFile = false;
+    windAtlasFlag = false;
+    stationTimeSeries = false;
+    windAtlases.clear();
 }
 
 void ninjaArmy::cancel()
@@ -1781,6 +2342,9 @@ void ninjaArmy::copyLocalData( const ninjaArmy &A )
 {
     CPLFree( (void*)pszTmpColorRelief );
     pszTmpColorRelief = CPLStrdup( A.pszTmpColorRelief );
+    pdfBasemap = A.pdfBasemap;
+    memoryInputs = A.memoryInputs;
+    windAtlases = A.windAtlases;
 }
 
 void ninjaArmy::destoryLocalData(void)
@@ -1801,4 +2365,7 @@ void ninjaArmy::destoryLocalData(void)
 
     CPLFree( (void*)pszTmpColorRelief );
     CPLPopErrorHandler();
+
+    //released once no copy of the army holds them
+    memoryInputs.clear();
 }
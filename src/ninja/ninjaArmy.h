@@ -42,6 +42,7 @@
 #include "farsiteAtm.h"
 #include "wxModelInitializationFactory.h"
 #include "ninja_errors.h"
+#include "memory_input.h"
 #include <algorithm>
 #ifndef Q_MOC_RUN
 #include "boost/typeof/typeof.hpp"
@@ -116,7 +117,16 @@ public:
     };
 
     void makeArmy(std::string forecastFilename, std::string timeZone, bool momentumFlag);
+    void makeMemoryArmy(int nSteps, const time_t *panValidTimes,
+                        const double *padfU, const double *padfV,
+                        const double *padfAir, const double *padfCloud,
+                        int nXSize, int nYSize, const double *padfGeoTransform,
+                        const char *pszWkt, double dfWindHeight,
+                        std::string timeZone, bool momentumFlag);
+    bool makeStationArmy(std::string stationPath, std::string demFile,
+                         std::string timeZone);
     void set_writeFarsiteAtmFile(bool flag);
+    void setWindAtlasFlag(bool flag);
     bool startRuns(int numProcessors);
     bool startFirstRun();
 
@@ -367,6 +377,42 @@ public:
     */
     int setDEM( const int nIndex, const std::string dem_filename, char ** papszOptions=NULL );
     /**
+    * \brief Set an elevation grid held in memory as the DEM of a ninja
+    *
+    * The grid is copied, north up with rows from the top, in meters.
+    *
+    * \param nIndex index of a ninja
+    * \param padfElevation nXSize * nYSize elevations
+    * \param padfGeoTransform GDAL geotransform of the grid
+    * \param pszWkt projection of the grid
+    * \param dfNoData no data value
+    * \return errval Returns NINJA_SUCCESS upon success
+    */
+    int setMemoryDEM( const int nIndex, const double *padfElevation,
+                      const int nXSize, const int nYSize,
+                      const double *padfGeoTransform, const char *pszWkt,
+                      const double dfNoData, char ** papszOptions=NULL );
+    /**
+    * \brief Set surface roughness grids held in memory for a ninja
+    *
+    * The grids replace the uniform vegetation values and are sampled at
+    * the DEM cells, so they must be in the DEM projection.  NULL grids
+    * keep the vegetation values.
+    *
+    * \param nIndex index of a ninja
+    * \param padfRoughness roughness (m)
+    * \param padfRoughH roughness height (m)
+    * \param padfRoughD displacement height (m)
+    * \param padfGeoTransform GDAL geotransform of the grids
+    * \param pszWkt projection of the grids
+    * \return errval Returns NINJA_SUCCESS upon success
+    */
+    int setMemorySurface( const int nIndex, const double *padfRoughness,
+                          const double *padfRoughH, const double *padfRoughD,
+                          const int nXSize, const int nYSize,
+                          const double *padfGeoTransform, const char *pszWkt,
+                          char ** papszOptions=NULL );
+    /**
     * \brief Set the latitude/longitude position of a ninja
     *
     * \param nIndex index of a ninja
@@ -397,6 +443,17 @@ public:
     */
     int setOutputPointsFilename( const int nIndex, const std::string filename,
                                 char **papszOptions=NULL);
+    /**
+    * \brief Set the output points file format for a ninja
+    *
+    * All runs of an army started together write to one file, in run order.
+    *
+    * \param nIndex index of a ninja
+    * \param format "csv" or "binary"
+    * \return errval Returns NINJA_SUCCESS upon success
+    */
+    int setOutputPointsFormat( const int nIndex, const std::string format,
+                               char **papszOptions=NULL);
 
     int readInputFile( const int nIndex, std::string filename, char ** papszOptions=NULL );
     int readInputFile( const int nIndex, char ** papszOptions=NULL );
@@ -685,6 +742,19 @@ public:
     int setWxStationFilename( const int nIndex, const std::string station_filename,
                               char ** papszOptions=NULL );
     /**
+    * \brief Re-solve a point run incrementally from the previous run
+    *
+    * The run reuses the mesh, matrix, preconditioner and solution of the
+    * last point run on the same domain in this process, and only
+    * recomputes the station grids where stations changed.
+    *
+    * \param nIndex index of a ninja
+    * \param flag true to re-solve incrementally
+    * \return errval Returns NINJA_SUCCESS upon success
+    */
+    int setIncrementalPointRun( const int nIndex, const bool flag,
+                                char ** papszOptions=NULL );
+    /**
     * \brief Set the vegetation parameter for a ninja
     *
     * \param nIndex index of a ninja
@@ -1040,6 +1110,26 @@ public:
     */
     int setVtkOutFlag( const int nIndex, const bool flag, char ** papszOptions=NULL );
     /**
+    * \brief Enable/disable NetCDF-CF time series output for a ninja
+    *
+    * All runs of an army started together are written to one file, one
+    * time slice per run.
+    *
+    * \param nIndex index of a ninja
+    * \param flag   determines if NetCDF output should be enabled or not
+    * \return errval Returns NINJA_SUCCESS if successful
+    */
+    int setNetcdfOutFlag( const int nIndex, const bool flag, char ** papszOptions=NULL );
+    /**
+    * \brief Set the NetCDF-CF time series output filename for a ninja
+    *
+    * \param nIndex index of a ninja
+    * \param filename path of the NetCDF file (*.nc)
+    * \return errval Returns NINJA_SUCCESS if successful
+    */
+    int setNetcdfOutFilename( const int nIndex, const std::string filename,
+                              char ** papszOptions=NULL );
+    /**
     * \brief Enable/disable txt output for a ninja
     *
     * \param nIndex index of a ninja
@@ -1124,6 +1214,71 @@ public:
     * \return path String of the path, which is empty if no output is set
     */
     std::string getOutputPath( const int nIndex, char ** papszOptions=NULL );
+    /**
+    * \brief Enable/disable all file output for a ninja
+    *
+    * With file output off the results are only available through
+    * getOutputGrid() and getOutputField3d().
+    *
+    * \param nIndex index of a ninja
+    * \param flag   false to skip writing any output files
+    * \return errval Returns NINJA_SUCCESS if successful
+    */
+    int setFileOutFlag( const int nIndex, const bool flag, char ** papszOptions=NULL );
+    /**
+    * \brief Keep the output grids of a ninja in memory after the run
+    *
+    * \param nIndex index of a ninja
+    * \param flag   keep the speed, direction and cloud grids
+    * \param include3d also keep the solved u, v, w fields
+    * \return errval Returns NINJA_SUCCESS if successful
+    */
+    int setOutputGridsInMemory( const int nIndex, const bool flag, const bool include3d,
+                                char ** papszOptions=NULL );
+    /**
+    * \brief Returns a read-only pointer to an output grid kept in memory
+    *
+    * Rows are stored from the south edge, so the geotransform is
+    * { xllCorner, cellSize, 0, yllCorner, 0, cellSize }.  The pointer is
+    * owned by the army and valid until releaseOutputGrids() or the army
+    * is destroyed.
+    *
+    * \param nIndex index of a ninja
+    * \param name "speed" (output speed units), "direction" (degrees) or
+    *             "cloud" (fraction)
+    * \param pnRows number of rows
+    * \param pnCols number of columns
+    * \param padfGeoTransform 6 geotransform values, may be NULL
+    * \param pdfNoData no data value, may be NULL
+    * \return pointer to the grid, NULL if it is not in memory
+    */
+    const double * getOutputGrid( const int nIndex, const std::string name,
+                                  int *pnRows, int *pnCols,
+                                  double *padfGeoTransform, double *pdfNoData,
+                                  char ** papszOptions=NULL );
+    /**
+    * \brief Returns a read-only pointer to a 3d output field kept in memory
+    *
+    * Only available for native solver runs kept with include3d.  Values
+    * are stored layer by layer, each layer from the south edge.
+    *
+    * \param nIndex index of a ninja
+    * \param name "u", "v", "w" (m/s) or "x", "y", "z" node coordinates
+    * \param pnRows number of node rows
+    * \param pnCols number of node columns
+    * \param pnLayers number of node layers
+    * \return pointer to the field, NULL if it is not in memory
+    */
+    const double * getOutputField3d( const int nIndex, const std::string name,
+                                     int *pnRows, int *pnCols, int *pnLayers,
+                                     char ** papszOptions=NULL );
+    /**
+    * \brief Free the output grids and fields a ninja kept in memory
+    *
+    * \param nIndex index of a ninja
+    * \return errval Returns NINJA_SUCCESS if successful
+    */
+    int releaseOutputGrids( const int nIndex, char ** papszOptions=NULL );
     /*-----------------------------------------------------------------------------
      *  Termination Section
      *-----------------------------------------------------------------------------*/
@@ -1131,18 +1286,21 @@ public:
     void cancel();
     void cancelAndReset();
     
-    GDALDatasetH hSpdMemDS; //in-memory dataset for GTiff output writer
-    GDALDatasetH hDirMemDS; //in-memory dataset for GTiff output writer
-    GDALDatasetH hDustMemDS; //in-memory dataset for GTiff output writer
-
     std::vector<std::string> wxList;
 protected:
     std::vector<ninja*> ninjas;
     std::string tz;
 
     bool writeFarsiteAtmFile;
+    bool windAtlasFlag;
+    bool stationTimeSeries;
     void writeFarsiteAtmosphereFile();
     void setAtmFlags();
+    bool isSweep();
+    bool isStationSeries();
+#ifdef NINJAFOAM
+    bool simulateFoamRun(unsigned int i, int numProcessors);
+#endif
 
     /*
     ** This function initializes various data for the lifetime of the
@@ -1154,8 +1312,12 @@ protected:
     void destoryLocalData(void);
     void copyLocalData( const ninjaArmy &A );
 
+    std::vector<NinjaMemoryInput::Ptr> memoryInputs; //in-memory inputs, shared with copies of the army
+    std::vector<NinjaWindAtlas::Ptr> windAtlases; //basis solutions used by the runs
+
 private:
     char *pszTmpColorRelief;
+    OutputWriter::pdfBasemapPtr pdfBasemap; //prepared pdf basemap used by the current runs
 };
 
 #endif /* NINJA_ARMY_H */
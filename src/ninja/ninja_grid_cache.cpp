@@ -0,0 +1,315 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Binary cache of preprocessed input grids at the mesh resolution
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninja_grid_cache.h"
+
+#include <cstring>
+#include <vector>
+
+static const char szCacheMagic[8] = { 'W', 'N', 'G', 'C', 'A', 'C', 'H', 'E' };
+static const GUInt32 nCacheByteOrder = 0x01020304;
+static const int nCacheGrids = 8;
+
+/*
+** Grids stored in the cache, in file order.  The elevation is always first.
+*/
+static void CollectGrids( Elevation &dem, surfProperties &surface,
+                          AsciiGrid<double> **papoGrids )
+{
+    papoGrids[0] = &dem;
+    papoGrids[1] = &surface.Roughness;
+    papoGrids[2] = &surface.Rough_h;
+    papoGrids[3] = &surface.Rough_d;
+    papoGrids[4] = &surface.Albedo;
+    papoGrids[5] = &surface.Bowen;
+    papoGrids[6] = &surface.Cg;
+    papoGrids[7] = &surface.Anthropogenic;
+}
+
+/*
+** 64 bit FNV-1a hash of the cache key, used for the file name.
+*/
+static GUIntBig HashKey( std::string const &key )
+{
+    GUIntBig nHash = ( (GUIntBig)0xcbf29ce4 << 32 ) | 0x84222325;
+    GUIntBig nPrime = ( (GUIntBig)0x00000100 << 32 ) | 0x000001b3;
+    for( size_t i = 0; i < key.size(); i++ )
+    {
+        nHash ^= (unsigned char)key[i];
+        nHash *= nPrime;
+    }
+    return nHash;
+}
+
+/**
+ * Check if the grid cache is enabled.
+ *
+ * @return true if NINJA_GRID_CACHE_DIR is set.
+ */
+bool NinjaGridCache::IsEnabled()
+{
+    const char *pszDir = CPLGetConfigOption( "NINJA_GRID_CACHE_DIR", NULL );
+    return pszDir != NULL && pszDir[0] != '\0';
+}
+
+/**
+ * Form the cache key for an input file and mesh settings.
+ *
+ * The input is identified by path, size and modification time.  The mesh
+ * is identified by its resolution if one was set, otherwise by the target
+ * number of cells used to compute it.
+ *
+ * @param inputFile elevation or lcp file name.
+ * @param meshResolution mesh resolution in meters, or less than 0 if it is
+ *                       computed from the target number of cells.
+ * @param targetNumHorizCells target number of horizontal cells.
+ * @param vegetation vegetation used to set the surface properties.
+ * @return the key, or an empty string if the input cannot be found.
+ */
+std::string NinjaGridCache::FormKey( std::string const &inputFile,
+                                     double meshResolution,
+                                     long targetNumHorizCells,
+                                     int vegetation )
+{
+    VSIStatBufL sStat;
+    if( VSIStatL( inputFile.c_str(), &sStat ) != 0 )
+        return std::string();
+
+    if( meshResolution > 0.0 )
+        targetNumHorizCells = 0;
+    else
+        meshResolution = -1.0;
+
+    return std::string( CPLSPrintf( "%d|%s|" CPL_FRMT_GIB "|" CPL_FRMT_GIB
+                                    "|%.17g|%ld|%d", FORMAT_VERSION,
+                                    inputFile.c_str(), (GIntBig)sStat.st_size,
+                                    (GIntBig)sStat.st_mtime, meshResolution,
+                                    targetNumHorizCells, vegetation ) );
+}
+
+std::string NinjaGridCache::FormFileName( std::string const &key )
+{
+    GUIntBig nHash = HashKey( key );
+    const char *pszDir = CPLGetConfigOption( "NINJA_GRID_CACHE_DIR", "." );
+    return std::string( CPLFormFilename( pszDir,
+                                         CPLSPrintf( "%08x%08x",
+                                                     (unsigned)( nHash >> 32 ),
+                                                     (unsigned)( nHash & 0xffffffff ) ),
+                                         "wng" ) );
+}
+
+/**
+ * Load cached grids.
+ *
+ * @param key cache key from FormKey().
+ * @param dem elevation to fill.
+ * @param surface surface properties to fill.
+ * @param meshResolution set to the mesh resolution the grids were built at.
+ * @return true if the grids were loaded, false on a miss or a bad file.
+ */
+bool NinjaGridCache::Read( std::string const &key, Elevation &dem,
+                           surfProperties &surface, double *meshResolution )
+{
+    if( !IsEnabled() || key.empty() )
+        return false;
+
+    std::string osFile = FormFileName( key );
+    VSIStatBufL sStat;
+    if( VSIStatL( osFile.c_str(), &sStat ) != 0 )
+        return false;
+    VSILFILE *fp = VSIFOpenL( osFile.c_str(), "rb" );
+    if( fp == NULL )
+        return false;
+
+    char szMagic[8];
+    GUInt32 nByteOrder = 0, nVersion = 0, nKeyLen = 0, nPrjLen = 0;
+    GInt32 nCols = 0, nRows = 0;
+    GInt32 anUnits[4];
+    double adfHeader[3];
+    double adfNoData[nCacheGrids];
+    double dfMeshResolution;
+    bool bOk = true;
+
+    bOk = bOk && VSIFReadL( szMagic, 8, 1, fp ) == 1;
+    bOk = bOk && memcmp( szMagic, szCacheMagic, 8 ) == 0;
+    bOk = bOk && VSIFReadL( &nByteOrder, 4, 1, fp ) == 1;
+    bOk = bOk && nByteOrder == nCacheByteOrder;
+    bOk = bOk && VSIFReadL( &nVersion, 4, 1, fp ) == 1;
+    bOk = bOk && nVersion == (GUInt32)FORMAT_VERSION;
+    bOk = bOk && VSIFReadL( &nKeyLen, 4, 1, fp ) == 1;
+    bOk = bOk && nKeyLen == key.size();
+    std::vector<char> achKey( key.size() + 1 );
+    bOk = bOk && VSIFReadL( &(achKey[0]), 1, nKeyLen, fp ) == nKeyLen;
+    bOk = bOk && memcmp( &(achKey[0]), key.c_str(), nKeyLen ) == 0;
+    bOk = bOk && VSIFReadL( &nCols, 4, 1, fp ) == 1;
+    bOk = bOk && VSIFReadL( &nRows, 4, 1, fp ) == 1;
+    bOk = bOk && nCols > 0 && nRows > 0;
+    bOk = bOk && VSIFReadL( adfHeader, 8, 3, fp ) == 3;
+    bOk = bOk && VSIFReadL( &dfMeshResolution, 8, 1, fp ) == 1;
+    bOk = bOk && VSIFReadL( adfNoData, 8, nCacheGrids, fp ) == (size_t)nCacheGrids;
+    bOk = bOk && VSIFReadL( anUnits, 4, 4, fp ) == 4;
+    bOk = bOk && VSIFReadL( &nPrjLen, 4, 1, fp ) == 1;
+    std::string osPrj;
+    if( bOk && nPrjLen > 0 && (vsi_l_offset)nPrjLen < sStat.st_size )
+    {
+        std::vector<char> achPrj( nPrjLen );
+        bOk = VSIFReadL( &(achPrj[0]), 1, nPrjLen, fp ) == nPrjLen;
+        osPrj.assign( &(achPrj[0]), nPrjLen );
+    }
+
+    /* grid data starts on an 8 byte boundary */
+    vsi_l_offset nOffset = ( VSIFTellL( fp ) + 7 ) / 8 * 8;
+    size_t nGridSize = (size_t)nCols * nRows;
+    vsi_l_offset nLength = (vsi_l_offset)nGridSize * sizeof( double ) * nCacheGrids;
+    bOk = bOk && (vsi_l_offset)sStat.st_size >= nOffset + nLength;
+    if( !bOk )
+    {
+        CPLDebug( "NINJA", "Ignoring bad grid cache file %s", osFile.c_str() );
+        VSIFCloseL( fp );
+        return false;
+    }
+
+    AsciiGrid<double> *apoGrids[nCacheGrids];
+    CollectGrids( dem, surface, apoGrids );
+    for( int i = 0; i < nCacheGrids; i++ )
+    {
+        apoGrids[i]->set_headerData( nCols, nRows, adfHeader[0], adfHeader[1],
+                                     adfHeader[2], adfNoData[i], adfNoData[i],
+                                     osPrj );
+    }
+
+    /* the grids are stored back to back, read each straight into place */
+    bOk = VSIFSeekL( fp, nOffset, SEEK_SET ) == 0;
+    for( int i = 0; i < nCacheGrids && bOk; i++ )
+    {
+        bOk = VSIFReadL( apoGrids[i]->data.get_dataPointer(), sizeof( double ),
+                         nGridSize, fp ) == nGridSize;
+    }
+    VSIFCloseL( fp );
+
+    if( !bOk )
+        return false;
+
+    dem.elevationUnits = (Elevation::eElevDistanceUnits)anUnits[0];
+    surface.RoughnessUnits = (lengthUnits::eLengthUnits)anUnits[1];
+    surface.Rough_hUnits = (lengthUnits::eLengthUnits)anUnits[2];
+    surface.Rough_dUnits = (lengthUnits::eLengthUnits)anUnits[3];
+    *meshResolution = dfMeshResolution;
+
+    CPLDebug( "NINJA", "Loaded %dx%d input grids from %s", nCols, nRows,
+              osFile.c_str() );
+    return true;
+}
+
+/**
+ * Store grids in the cache.  The file is written under a temporary name
+ * and renamed, so concurrent readers never see a partial file.
+ *
+ * @param key cache key from FormKey().
+ * @param dem elevation at the mesh resolution.
+ * @param surface surface properties, on the same grid as the elevation.
+ * @param meshResolution mesh resolution the grids were built at.
+ * @return true if the grids were written.
+ */
+bool NinjaGridCache::Write( std::string const &key, Elevation &dem,
+                            surfProperties &surface, double meshResolution )
+{
+    if( !IsEnabled() || key.empty() )
+        return false;
+
+    AsciiGrid<double> *apoGrids[nCacheGrids];
+    CollectGrids( dem, surface, apoGrids );
+    GInt32 nCols = dem.get_nCols();
+    GInt32 nRows = dem.get_nRows();
+    if( nCols <= 0 || nRows <= 0 )
+        return false;
+    for( int i = 1; i < nCacheGrids; i++ )
+    {
+        if( apoGrids[i]->get_nCols() != nCols ||
+            apoGrids[i]->get_nRows() != nRows )
+            return false;
+    }
+
+    std::string osFile = FormFileName( key );
+    std::string osTmpFile = osFile + CPLSPrintf( "." CPL_FRMT_GIB ".tmp", (GIntBig)CPLGetPID() );
+    VSILFILE *fp = VSIFOpenL( osTmpFile.c_str(), "wb" );
+    if( fp == NULL )
+    {
+        CPLDebug( "NINJA", "Cannot write grid cache file %s", osTmpFile.c_str() );
+        return false;
+    }
+
+    GUInt32 nVersion = FORMAT_VERSION;
+    GUInt32 nKeyLen = key.size();
+    GUInt32 nPrjLen = dem.prjString.size();
+    double adfHeader[3] = { dem.get_xllCorner(), dem.get_yllCorner(),
+                            dem.get_cellSize() };
+    double adfNoData[nCacheGrids];
+    for( int i = 0; i < nCacheGrids; i++ )
+        adfNoData[i] = apoGrids[i]->get_noDataValue();
+    GInt32 anUnits[4] = { dem.elevationUnits, surface.RoughnessUnits,
+                          surface.Rough_hUnits, surface.Rough_dUnits };
+
+    bool bOk = true;
+    bOk = bOk && VSIFWriteL( szCacheMagic, 8, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( &nCacheByteOrder, 4, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( &nVersion, 4, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( &nKeyLen, 4, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( key.c_str(), 1, nKeyLen, fp ) == nKeyLen;
+    bOk = bOk && VSIFWriteL( &nCols, 4, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( &nRows, 4, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( adfHeader, 8, 3, fp ) == 3;
+    bOk = bOk && VSIFWriteL( &meshResolution, 8, 1, fp ) == 1;
+    bOk = bOk && VSIFWriteL( adfNoData, 8, nCacheGrids, fp ) == (size_t)nCacheGrids;
+    bOk = bOk && VSIFWriteL( anUnits, 4, 4, fp ) == 4;
+    bOk = bOk && VSIFWriteL( &nPrjLen, 4, 1, fp ) == 1;
+    if( nPrjLen > 0 )
+        bOk = bOk && VSIFWriteL( dem.prjString.c_str(), 1, nPrjLen, fp ) == nPrjLen;
+
+    static const char achPad[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    size_t nPad = ( 8 - VSIFTellL( fp ) % 8 ) % 8;
+    if( nPad > 0 )
+        bOk = bOk && VSIFWriteL( achPad, 1, nPad, fp ) == nPad;
+
+    size_t nGridSize = (size_t)nCols * nRows;
+    for( int i = 0; i < nCacheGrids && bOk; i++ )
+    {
+        bOk = VSIFWriteL( apoGrids[i]->data.get_dataPointer(), sizeof( double ),
+                          nGridSize, fp ) == nGridSize;
+    }
+    bOk = VSIFCloseL( fp ) == 0 && bOk;
+
+    if( !bOk || VSIRename( osTmpFile.c_str(), osFile.c_str() ) != 0 )
+    {
+        CPLDebug( "NINJA", "Failed to write grid cache file %s", osFile.c_str() );
+        VSIUnlink( osTmpFile.c_str() );
+        return false;
+    }
+    return true;
+}
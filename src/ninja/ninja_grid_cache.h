@@ -0,0 +1,77 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Binary cache of preprocessed input grids at the mesh resolution
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef NINJA_GRID_CACHE_H
+#define NINJA_GRID_CACHE_H
+
+#include <string>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "Elevation.h"
+#include "SurfProperties.h"
+
+/**
+ * Cache of the elevation and surface property grids a run builds from its
+ * input file, stored at the computational (mesh) resolution.
+ *
+ * Reruns on the same input and mesh settings load the grids instead of
+ * reading the input through GDAL, deriving roughness and resampling.  The
+ * cache is enabled by setting the NINJA_GRID_CACHE_DIR config option to a
+ * writable directory.  Each run reads the grids straight into its own
+ * arrays with no intermediate buffer; runs reading the same file are served
+ * from the operating system's page cache.
+ *
+ * Files are written in native byte order and are not meant to be moved
+ * between machines.
+ */
+class NinjaGridCache
+{
+public:
+    static bool IsEnabled();
+
+    static std::string FormKey( std::string const &inputFile,
+                                double meshResolution,
+                                long targetNumHorizCells,
+                                int vegetation );
+
+    static bool Read( std::string const &key, Elevation &dem,
+                      surfProperties &surface, double *meshResolution );
+    static bool Write( std::string const &key, Elevation &dem,
+                       surfProperties &surface, double meshResolution );
+
+    static const int FORMAT_VERSION = 1;
+
+private:
+    static std::string FormFileName( std::string const &key );
+};
+
+#endif /* NINJA_GRID_CACHE_H */
@@ -0,0 +1,202 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  State kept between point runs on one domain for incremental re-solves
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninja_incremental.h"
+#include "ninja.h"
+#include "ninja_grid_cache.h"
+
+#include <algorithm>
+
+std::map<std::string, NinjaIncremental::Ptr> NinjaIncremental::oCache;
+
+NinjaIncremental::NinjaIncremental() : hasMesh( false )
+{
+}
+
+/**
+ * Check that a run can reuse the system of an earlier run.
+ *
+ * @param input run inputs.
+ * @return an empty string if the run can be incremental, otherwise the
+ *         reason it cannot.
+ */
+std::string NinjaIncremental::CheckIncremental( WindNinjaInputs const &input )
+{
+    if( input.initializationMethod != WindNinjaInputs::pointInitializationFlag )
+        return "only point initialization is supported";
+    if( input.stabilityFlag )
+        return "the system changes with the stations when stability is used";
+    return std::string();
+}
+
+/**
+ * Form the key of the domain a run is solved on.
+ *
+ * @param run run to form the key for.
+ * @return the key, or an empty string if the input cannot be found.
+ */
+std::string NinjaIncremental::FormKey( ninja const &run )
+{
+    std::string key = NinjaGridCache::FormKey( run.input.dem.fileName,
+                                               run.mesh.meshResolution,
+                                               run.mesh.targetNumHorizCells,
+                                               run.input.vegetation );
+    if( key.empty() )
+        return key;
+    //the mesh height depends on the output wind height
+    key += CPLSPrintf( "|%.17g|%s", run.input.outputWindHeight,
+                       run.input.surfaceGridsFilename.c_str() );
+    return key;
+}
+
+/**
+ * Take the state of a domain out of the cache.
+ *
+ * @param key key from FormKey().
+ * @return the state of the last run on the domain, or a new empty state if
+ *         there is none or another run holds it.
+ */
+NinjaIncremental::Ptr NinjaIncremental::Acquire( std::string const &key )
+{
+    Ptr state;
+#pragma omp critical(incremental_cache)
+    {
+        std::map<std::string, Ptr>::iterator it = oCache.find( key );
+        if( it != oCache.end() )
+        {
+            state = it->second;
+            oCache.erase( it );
+        }
+    }
+    if( !state )
+        state.reset( new NinjaIncremental() );
+    return state;
+}
+
+/**
+ * Store the state of a run that completed, replacing any other state of
+ * the domain.
+ */
+void NinjaIncremental::Release( std::string const &key, Ptr state )
+{
+#pragma omp critical(incremental_cache)
+    {
+        if( oCache.size() >= MAX_CACHED_STATES && oCache.find( key ) == oCache.end() )
+            oCache.clear();
+        oCache[key] = state;
+    }
+}
+
+void NinjaIncremental::ClearCache()
+{
+#pragma omp critical(incremental_cache)
+    oCache.clear();
+}
+
+void NinjaIncremental::SetMesh( Mesh const &m )
+{
+    mesh = m;
+    hasMesh = true;
+}
+
+/**
+ * Copy the previous solution into the solver's starting guess.
+ *
+ * @return false if there is no solution on a mesh of this size.
+ */
+bool NinjaIncremental::WarmStart( int nNodes, double *padfPhi ) const
+{
+    if( phi.empty() || (int)phi.size() != nNodes )
+        return false;
+    std::copy( phi.begin(), phi.end(), padfPhi );
+    return true;
+}
+
+void NinjaIncremental::SetSolution( int nNodes, const double *padfPhi )
+{
+    phi.assign( padfPhi, padfPhi + nNodes );
+}
+
+/**
+ * Interpolate station values onto a grid, recomputing only the cells
+ * reached by stations whose value changed since the last run.
+ *
+ * The stations must be given in the same order on every run.  Moving,
+ * adding or removing a station rebuilds the weights and the whole grid.
+ *
+ * @param field which station value is interpolated.
+ * @param values value at each station.
+ * @param X x coordinates of the stations.
+ * @param Y y coordinates of the stations.
+ * @param influenceRadius influence radius of each station.
+ * @param numPoints number of stations.
+ * @param interpDistPower power used for the distance weighting.
+ * @param grid grid to fill.
+ */
+void NinjaIncremental::Interpolate( eStationField field, const double *values,
+                                    const double *X, const double *Y,
+                                    const double *influenceRadius, int numPoints,
+                                    double interpDistPower, AsciiGrid<double> &grid )
+{
+    std::vector<double> &previous = stationValues[field];
+    AsciiGrid<double> &previousGrid = stationGrids[field];
+
+    if( !plan.matches( grid, X, Y, influenceRadius, numPoints, interpDistPower ) )
+    {
+        plan.build( grid, X, Y, influenceRadius, numPoints, interpDistPower );
+        for( int f = 0; f < numStationFields; f++ )
+            stationValues[f].clear();
+    }
+
+    if( (int)previous.size() != numPoints ||
+        previousGrid.get_nCols() != grid.get_nCols() ||
+        previousGrid.get_nRows() != grid.get_nRows() )
+    {
+        plan.apply( values, grid );
+    }
+    else
+    {
+        std::vector<int> changed;
+        for( int k = 0; k < numPoints; k++ )
+        {
+            if( values[k] != previous[k] )
+                changed.push_back( k );
+        }
+        grid = previousGrid;
+        int nUpdated = 0;
+        if( !changed.empty() )
+            nUpdated = plan.update( values, changed, grid );
+        CPLDebug( "NINJA", "Incremental station field %d: %d of %d stations changed, "
+                  "%d of %d cells updated", (int)field, (int)changed.size(),
+                  numPoints, nUpdated, plan.get_nCells() );
+    }
+
+    previous.assign( values, values + numPoints );
+    previousGrid = grid;
+}
@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  State kept between point runs on one domain for incremental re-solves
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef NINJA_INCREMENTAL_H
+#define NINJA_INCREMENTAL_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/shared_ptr.hpp"
+
+#include "ascii_grid.h"
+#include "mesh.h"
+#include "ninja_sweep.h"
+#include "PointInterpolationPlan.h"
+#include "WindNinjaInputs.h"
+
+class ninja;
+
+/**
+ * Mesh, system and solution of the last point run on a domain.
+ *
+ * Operational point runs are repeated on one domain as new observations
+ * arrive, often with only a few stations changed.  A run that picks up the
+ * state of the previous run copies its mesh, skips assembling the matrix
+ * and setting up the preconditioner, and starts the solver from the
+ * previous solution.  The station grids are only recomputed in the cells
+ * reached by stations whose values changed.  The outer iterations that
+ * match the stations reuse the state the same way.
+ *
+ * A state is used by one run at a time.  Acquire() takes it out of the
+ * cache and Release() puts it back once the run has succeeded, so a failed
+ * run never leaves a half updated state behind.
+ */
+class NinjaIncremental
+{
+public:
+    typedef boost::shared_ptr<NinjaIncremental> Ptr;
+
+    enum eStationField
+    {
+        airTempField,
+        cloudCoverField,
+        uField,
+        vField,
+        numStationFields
+    };
+
+    static std::string CheckIncremental( WindNinjaInputs const &input );
+    static std::string FormKey( ninja const &run );
+    static Ptr Acquire( std::string const &key );
+    static void Release( std::string const &key, Ptr state );
+    static void ClearCache();
+
+    bool HasMesh() const { return hasMesh; }
+    Mesh const &GetMesh() const { return mesh; }
+    void SetMesh( Mesh const &m );
+
+    NinjaSweep *GetSystem() { return &system; }
+
+    bool WarmStart( int nNodes, double *padfPhi ) const;
+    void SetSolution( int nNodes, const double *padfPhi );
+
+    void Interpolate( eStationField field, const double *values,
+                      const double *X, const double *Y,
+                      const double *influenceRadius, int numPoints,
+                      double interpDistPower, AsciiGrid<double> &grid );
+
+    static const unsigned int MAX_CACHED_STATES = 8;
+
+private:
+    NinjaIncremental();
+    NinjaIncremental( NinjaIncremental const & );
+    NinjaIncremental &operator=( NinjaIncremental const & );
+
+    bool hasMesh;
+    Mesh mesh;
+    NinjaSweep system;
+    std::vector<double> phi;
+
+    PointInterpolationPlan plan;
+    std::vector<double> stationValues[numStationFields];
+    AsciiGrid<double> stationGrids[numStationFields];
+
+    static std::map<std::string, Ptr> oCache;
+};
+
+#endif /* NINJA_INCREMENTAL_H */
@@ -0,0 +1,213 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Anderson acceleration of the station matching iterations
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninja_match_accelerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+NinjaMatchAccelerator::NinjaMatchAccelerator()
+{
+    depth = 0;
+    steps = 0;
+}
+
+/**
+ * Forget the iterations of an earlier run.
+ *
+ * @param nDepth number of earlier iterations mixed into a step, 0 takes the
+ *               plain relaxed update.
+ */
+void NinjaMatchAccelerator::Reset( int nDepth )
+{
+    depth = nDepth;
+    steps = 0;
+    lastX.clear();
+    lastF.clear();
+    dX.clear();
+    dF.clear();
+    norms.clear();
+}
+
+/**
+ * Compute the station inputs of the next outer iteration.
+ *
+ * @param x inputs of the iteration just solved, replaced by the next inputs.
+ * @param f relaxed misfit of the iteration, the plain update is x + f.
+ */
+void NinjaMatchAccelerator::Step( std::vector<double> &x,
+                                  std::vector<double> const &f )
+{
+    if( steps > 0 && lastX.size() == x.size() && depth > 0 )
+    {
+        std::vector<double> deltaX( x.size() );
+        std::vector<double> deltaF( x.size() );
+        for( unsigned int i = 0; i < x.size(); i++ )
+        {
+            deltaX[i] = x[i] - lastX[i];
+            deltaF[i] = f[i] - lastF[i];
+        }
+        dX.push_back( deltaX );
+        dF.push_back( deltaF );
+        while( (int)dF.size() > depth )
+        {
+            dX.pop_front();
+            dF.pop_front();
+        }
+        //a step that made the misfit much worse no longer fits the history
+        if( MaxNorm( f ) > 2.0 * MaxNorm( lastF ) )
+        {
+            dX.clear();
+            dF.clear();
+        }
+    }
+    else
+    {
+        dX.clear();
+        dF.clear();
+    }
+    if( norms.size() < 2 )
+        norms.push_back( MaxNorm( f ) );
+    lastX = x;
+    lastF = f;
+    steps++;
+
+    std::vector<double> gamma;
+    while( !dF.empty() && !Solve( gamma, f ) )
+    {
+        dX.pop_front();
+        dF.pop_front();
+    }
+    if( dF.empty() )
+        gamma.clear();
+
+    for( unsigned int i = 0; i < x.size(); i++ )
+    {
+        x[i] += f[i];
+        for( unsigned int j = 0; j < gamma.size(); j++ )
+            x[i] -= gamma[j] * ( dX[j][i] + dF[j][i] );
+    }
+}
+
+/**
+ * Estimate the outer iterations the plain update would have needed.
+ *
+ * The first step of the accelerator is a plain step, the reduction of the
+ * misfit over it is the convergence rate of the plain update.
+ *
+ * @param tol misfit the matching stops at, in the units of f.
+ * @param nMaxIters maximum number of outer iterations.
+ * @return estimated number of outer iterations without acceleration.
+ */
+int NinjaMatchAccelerator::EstimatePlainIterations( double tol,
+                                                    int nMaxIters ) const
+{
+    if( norms.size() < 2 )
+        return steps + 1;
+    if( norms[0] <= tol )
+        return 1;
+    if( norms[1] <= tol )
+        return 2;
+    double rate = norms[1] / norms[0];
+    if( rate >= 1.0 )
+        return nMaxIters;
+    int n = (int)std::ceil( std::log( tol / norms[0] ) / std::log( rate ) ) + 1;
+    return std::min( n, nMaxIters );
+}
+
+double NinjaMatchAccelerator::MaxNorm( std::vector<double> const &f )
+{
+    double norm = 0.0;
+    for( unsigned int i = 0; i < f.size(); i++ )
+        norm = std::max( norm, std::fabs( f[i] ) );
+    return norm;
+}
+
+/*
+** Least squares mixing coefficients, min |f - dF gamma|, from the normal
+** equations.  The history is short so the system is tiny, a singular one
+** makes the caller drop the oldest iteration.
+*/
+bool NinjaMatchAccelerator::Solve( std::vector<double> &gamma,
+                                   std::vector<double> const &f ) const
+{
+    int m = dF.size();
+    std::vector<double> A( m * m );
+    gamma.assign( m, 0.0 );
+    double trace = 0.0;
+    for( int j = 0; j < m; j++ )
+    {
+        for( int k = j; k < m; k++ )
+        {
+            double sum = 0.0;
+            for( unsigned int i = 0; i < f.size(); i++ )
+                sum += dF[j][i] * dF[k][i];
+            A[j * m + k] = sum;
+            A[k * m + j] = sum;
+        }
+        for( unsigned int i = 0; i < f.size(); i++ )
+            gamma[j] += dF[j][i] * f[i];
+        trace += A[j * m + j];
+    }
+    if( trace <= 0.0 )
+        return false;
+    for( int j = 0; j < m; j++ )
+        A[j * m + j] += 1e-10 * trace;
+
+    //gaussian elimination with partial pivoting
+    for( int c = 0; c < m; c++ )
+    {
+        int p = c;
+        for( int r = c + 1; r < m; r++ )
+            if( std::fabs( A[r * m + c] ) > std::fabs( A[p * m + c] ) )
+                p = r;
+        if( std::fabs( A[p * m + c] ) <= 1e-12 * trace )
+            return false;
+        if( p != c )
+        {
+            for( int k = 0; k < m; k++ )
+                std::swap( A[c * m + k], A[p * m + k] );
+            std::swap( gamma[c], gamma[p] );
+        }
+        for( int r = c + 1; r < m; r++ )
+        {
+            double factor = A[r * m + c] / A[c * m + c];
+            for( int k = c; k < m; k++ )
+                A[r * m + k] -= factor * A[c * m + k];
+            gamma[r] -= factor * gamma[c];
+        }
+    }
+    for( int c = m - 1; c >= 0; c-- )
+    {
+        for( int k = c + 1; k < m; k++ )
+            gamma[c] -= A[c * m + k] * gamma[k];
+        gamma[c] /= A[c * m + c];
+    }
+    return true;
+}
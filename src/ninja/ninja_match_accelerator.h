@@ -0,0 +1,74 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Anderson acceleration of the station matching iterations
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef NINJA_MATCH_ACCELERATOR_H
+#define NINJA_MATCH_ACCELERATOR_H
+
+#include <deque>
+#include <vector>
+
+/**
+ * Anderson acceleration of the outer iterations that match wx stations.
+ *
+ * Each outer iteration moves the station inputs by a relaxed fraction of
+ * the misfit at the station locations.  The station velocities respond
+ * linearly to the inputs, so the misfits of the last few iterations span
+ * the response of the solver.  Each step mixes the earlier inputs to
+ * minimise the misfit over all stations jointly, which needs a handful of
+ * solves where the plain update needs dozens.
+ *
+ * The residual of the plain update over its first step gives its rate of
+ * convergence, used to estimate how many solves the acceleration saved.
+ */
+class NinjaMatchAccelerator
+{
+public:
+    NinjaMatchAccelerator();
+
+    void Reset( int nDepth );
+    bool IsEnabled() const { return depth > 0; }
+
+    void Step( std::vector<double> &x, std::vector<double> const &f );
+
+    int EstimatePlainIterations( double tol, int nMaxIters ) const;
+
+private:
+    static double MaxNorm( std::vector<double> const &f );
+    bool Solve( std::vector<double> &gamma, std::vector<double> const &f ) const;
+
+    int depth;
+    int steps;
+    std::vector<double> lastX;
+    std::vector<double> lastF;
+    std::deque<std::vector<double> > dX;
+    std::deque<std::vector<double> > dF;
+    std::vector<double> norms;
+};
+
+#endif /* NINJA_MATCH_ACCELERATOR_H */
@@ -0,0 +1,168 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Shared system for sweeps of domain-average runs
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninja_sweep.h"
+
+#include "cpl_conv.h"
+
+#include <cmath>
+#include <stdexcept>
+
+NinjaSweep::NinjaSweep()
+{
+    numNodes = 0;
+    SK = NULL;
+    col_ind = NULL;
+    row_ptr = NULL;
+}
+
+NinjaSweep::~NinjaSweep()
+{
+    delete[] SK;
+    delete[] col_ind;
+    delete[] row_ptr;
+}
+
+/**
+ * Check if a run can share its system with other runs on the same mesh.
+ *
+ * Only neutral domain-average runs qualify, stability and diurnal flow
+ * change the matrix or make the initial field depend on more than the
+ * input speed and direction.
+ *
+ * @param input run inputs.
+ * @return true if the run can be part of a sweep.
+ */
+bool NinjaSweep::IsSweepable( WindNinjaInputs const &input )
+{
+    return input.initializationMethod == WindNinjaInputs::domainAverageInitializationFlag &&
+           !input.diurnalWinds && !input.stabilityFlag && !input.matchWxStations;
+}
+
+bool NinjaSweep::HasMatrix() const
+{
+    return SK != NULL;
+}
+
+/**
+ * Take over the matrix of the first run of the sweep, with its boundary
+ * conditions applied, and set up the preconditioner for it.
+ *
+ * @param nNodes number of mesh nodes.
+ * @param padfSK upper triangle of the matrix in CRS storage, owned by the
+ *               sweep from now on.
+ * @param panColInd column indices, owned by the sweep from now on.
+ * @param panRowPtr row pointers, owned by the sweep from now on.
+ */
+void NinjaSweep::SetMatrix( int nNodes, double *padfSK, int *panColInd,
+                            int *panRowPtr )
+{
+    if( HasMatrix() )
+        throw std::logic_error( "The sweep matrix is already set." );
+    numNodes = nNodes;
+    SK = padfSK;
+    col_ind = panColInd;
+    row_ptr = panRowPtr;
+
+    char matdescra[6];
+    matdescra[0] = 's';   //symmetric
+    matdescra[1] = 'u';   //upper triangle stored
+    matdescra[2] = 'n';   //non-unit diagonal
+    matdescra[3] = 'c';   //zero based indexing
+    if( !preconditioner.initialize( numNodes, SK, row_ptr, col_ind,
+                                    Preconditioner::SSOR, matdescra ) )
+    {
+        if( !preconditioner.initialize( numNodes, SK, row_ptr, col_ind,
+                                        Preconditioner::Jacobi, matdescra ) )
+            throw std::runtime_error( "Initialization of Jacobi preconditioner failed." );
+    }
+}
+
+/**
+ * Fill a starting guess from the closest solution found so far.
+ *
+ * A solution in the same direction is preferred, otherwise the one with the
+ * smallest change in direction is used.  It is scaled to the new speed.
+ *
+ * @param speed input speed of the run.
+ * @param direction input direction of the run, degrees.
+ * @param padfPhi starting guess to fill, GetNumNodes() values.
+ * @return true if a guess was set, false if padfPhi was left as is.
+ */
+bool NinjaSweep::WarmStart( double speed, double direction, double *padfPhi ) const
+{
+    int nBest = -1;
+    double dfBest = 0.0;
+    for( unsigned int i = 0; i < solutions.size(); i++ )
+    {
+        if( solutions[i].speed <= 0.0 )
+            continue;
+        double dfDiff = fabs( fmod( solutions[i].direction - direction, 360.0 ) );
+        dfDiff = MIN( dfDiff, 360.0 - dfDiff );
+        if( nBest < 0 || dfDiff < dfBest )
+        {
+            nBest = i;
+            dfBest = dfDiff;
+        }
+    }
+    /* past a right angle the old solution is a worse start than zero */
+    if( nBest < 0 || dfBest >= 90.0 )
+        return false;
+
+    Solution const &oSolution = solutions[nBest];
+    double dfScale = speed / oSolution.speed;
+    for( int i = 0; i < numNodes; i++ )
+        padfPhi[i] = dfScale * oSolution.phi[i];
+    return true;
+}
+
+/**
+ * Keep a solution to start later runs from.  One solution is kept per
+ * direction.
+ *
+ * @param speed input speed of the run.
+ * @param direction input direction of the run, degrees.
+ * @param padfPhi solution, GetNumNodes() values.
+ */
+void NinjaSweep::AddSolution( double speed, double direction,
+                              const double *padfPhi )
+{
+    if( speed <= 0.0 )
+        return;
+    for( unsigned int i = 0; i < solutions.size(); i++ )
+    {
+        if( solutions[i].direction == direction )
+            return;
+    }
+    Solution oSolution;
+    oSolution.speed = speed;
+    oSolution.direction = direction;
+    oSolution.phi.assign( padfPhi, padfPhi + numNodes );
+    solutions.push_back( oSolution );
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Shared system for sweeps of domain-average runs
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef NINJA_SWEEP_H
+#define NINJA_SWEEP_H
+
+#include <vector>
+
+#include "preconditioner.h"
+#include "WindNinjaInputs.h"
+
+/**
+ * Assembled system shared by a sweep of domain-average runs.
+ *
+ * Neutral domain-average runs on one mesh solve the same matrix with
+ * different right hand sides.  The first run of a sweep hands its assembled
+ * matrix to the sweep, which sets up the preconditioner once.  Later runs
+ * only assemble their right hand side and start the solver from an earlier
+ * solution scaled to their speed.  The solution is linear in the input
+ * speed, so the start is exact for a direction that was already solved.
+ *
+ * A sweep is not thread safe, its runs are solved one after another.
+ */
+class NinjaSweep
+{
+public:
+    NinjaSweep();
+    ~NinjaSweep();
+
+    static bool IsSweepable( WindNinjaInputs const &input );
+
+    bool HasMatrix() const;
+    void SetMatrix( int nNodes, double *padfSK, int *panColInd, int *panRowPtr );
+    int GetNumNodes() const { return numNodes; }
+    double *GetMatrix() { return SK; }
+    int *GetColInd() { return col_ind; }
+    int *GetRowPtr() { return row_ptr; }
+    Preconditioner *GetPreconditioner() { return &preconditioner; }
+
+    bool WarmStart( double speed, double direction, double *padfPhi ) const;
+    void AddSolution( double speed, double direction, const double *padfPhi );
+
+private:
+    NinjaSweep( NinjaSweep const & );
+    NinjaSweep &operator=( NinjaSweep const & );
+
+    struct Solution
+    {
+        double speed;
+        double direction;
+        std::vector<double> phi;
+    };
+
+    int numNodes;
+    double *SK;
+    int *col_ind;
+    int *row_ptr;
+    Preconditioner preconditioner;
+    std::vector<Solution> solutions;
+};
+
+#endif /* NINJA_SWEEP_H */
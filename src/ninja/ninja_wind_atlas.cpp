@@ -0,0 +1,198 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Basis solutions for neutral domain-average runs
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninja_wind_atlas.h"
+#include "ninja.h"
+#include "constants.h"
+
+#include <cmath>
+#include <stdexcept>
+
+std::map<std::string, NinjaWindAtlas::Ptr> NinjaWindAtlas::oCache;
+
+NinjaWindAtlas::NinjaWindAtlas() : numNodes( 0 )
+{
+}
+
+/**
+ * Check that a run is linear in its input wind.
+ *
+ * @param input run inputs.
+ * @return an empty string if the run can use an atlas, otherwise the reason
+ *         it cannot.
+ */
+std::string NinjaWindAtlas::CheckLinear( WindNinjaInputs const &input )
+{
+    if( input.initializationMethod != WindNinjaInputs::domainAverageInitializationFlag )
+        return "only domain-average initialization is supported";
+    if( input.diurnalWinds )
+        return "diurnal winds are not linear in the input wind";
+    if( input.stabilityFlag )
+        return "non-neutral stability is not linear in the input wind";
+    if( input.matchWxStations )
+        return "matching weather stations is not linear in the input wind";
+    return std::string();
+}
+
+/**
+ * Form the key of the domain a run is solved on.
+ *
+ * @param run run to form the key for.
+ * @return the key, or an empty string if the input cannot be found.
+ */
+std::string NinjaWindAtlas::FormKey( ninja const &run )
+{
+    std::string key = NinjaGridCache::FormKey( run.input.dem.fileName,
+                                               run.mesh.meshResolution,
+                                               run.mesh.targetNumHorizCells,
+                                               run.input.vegetation );
+    if( key.empty() )
+        return key;
+    //the output height sets the mesh height and where the basis is sampled
+    key += CPLSPrintf( "|%.17g|%.17g|%s", run.input.inputWindHeight,
+                       run.input.outputWindHeight,
+                       run.input.surfaceGridsFilename.c_str() );
+    return key;
+}
+
+/**
+ * Fetch the atlas of a run's domain, solving the basis if no atlas is
+ * cached for it.
+ *
+ * @param prototype run whose domain and settings the basis is solved with.
+ * @param numProcessors threads for the basis solves.
+ * @throw logic_error if the run is not linear in its input wind.
+ * @return the atlas.
+ */
+NinjaWindAtlas::Ptr NinjaWindAtlas::Get( ninja const &prototype, int numProcessors )
+{
+    std::string reason = CheckLinear( prototype.input );
+    if( !reason.empty() )
+        throw std::logic_error( "A wind atlas cannot be used for this run: " + reason + "." );
+    std::string key = FormKey( prototype );
+    if( key.empty() )
+        throw std::runtime_error( "Cannot find the elevation file for the wind atlas." );
+
+    Ptr atlas;
+#pragma omp critical(wind_atlas_cache)
+    {
+        std::map<std::string, Ptr>::const_iterator it = oCache.find( key );
+        if( it != oCache.end() )
+            atlas = it->second;
+    }
+    if( atlas )
+        return atlas;
+
+    atlas.reset( new NinjaWindAtlas() );
+    atlas->SolveBasis( prototype, numProcessors );
+#pragma omp critical(wind_atlas_cache)
+    {
+        if( oCache.size() >= MAX_CACHED_ATLASES )
+            oCache.clear();
+        oCache[key] = atlas;
+    }
+    return atlas;
+}
+
+void NinjaWindAtlas::ClearCache()
+{
+#pragma omp critical(wind_atlas_cache)
+    oCache.clear();
+}
+
+/*
+** Solve for a 1 m/s wind from the west and from the south.  The two solves
+** share their matrix through a sweep.
+*/
+void NinjaWindAtlas::SolveBasis( ninja const &prototype, int numProcessors )
+{
+    static const double adfDirection[2] = { 270.0, 180.0 };
+    static const char *apszFields[3] = { "u", "v", "w" };
+    NinjaSweep sweep;
+    for( int b = 0; b < 2; b++ )
+    {
+        ninja basis( prototype );
+        basis.set_windAtlas( NULL );
+        basis.set_sweep( &sweep );
+        basis.set_inputSpeed( 1.0, velocityUnits::metersPerSecond );
+        basis.set_inputDirection( adfDirection[b] );
+        basis.set_fileOutFlag( false );
+        basis.keepOutput3dFieldsInMemory( true );
+        basis.set_numberCPUs( numProcessors );
+        //writers shared by the army must not see the basis runs
+        basis.input.inputPointsFilename = "!set";
+        basis.input.pointOutputWriter = NULL;
+        basis.input.timeSeriesWriter = NULL;
+        basis.input.outputDatasetPool = NULL;
+        basis.simulate_wind();
+
+        std::vector<double> *fields = ( b == 0 ) ? east : north;
+        for( int i = 0; i < 3; i++ )
+        {
+            int nRows, nCols, nLayers;
+            const double *pData = basis.get_outputField3d( apszFields[i], nRows,
+                                                          nCols, nLayers );
+            if( pData == NULL )
+                throw std::runtime_error( "The wind atlas basis run kept no 3D field." );
+            fields[i].assign( pData, pData + (size_t)nRows * nCols * nLayers );
+        }
+        basis.releaseOutputGrids();
+    }
+    numNodes = east[0].size();
+    if( north[0].size() != east[0].size() )
+        throw std::logic_error( "The wind atlas basis runs have different meshes." );
+}
+
+/**
+ * Combine the basis solutions into the 3D wind for an input wind.
+ *
+ * @param speed input speed, m/s.
+ * @param direction input direction, degrees the wind comes from.
+ * @param u u field to fill, GetNumNodes() values.
+ * @param v v field to fill, GetNumNodes() values.
+ * @param w w field to fill, GetNumNodes() values.
+ */
+void NinjaWindAtlas::Combine( double speed, double direction,
+                              double *u, double *v, double *w ) const
+{
+    //components of the wind vector, which points away from the direction
+    double dfEast = -speed * sin( direction * pi / 180.0 );
+    double dfNorth = -speed * cos( direction * pi / 180.0 );
+    double *apadfOut[3] = { u, v, w };
+    for( int i = 0; i < 3; i++ )
+    {
+        const double *padfEast = &( east[i][0] );
+        const double *padfNorth = &( north[i][0] );
+        double *padfOut = apadfOut[i];
+        int j;
+#pragma omp parallel for
+        for( j = 0; j < numNodes; j++ )
+            padfOut[j] = dfEast * padfEast[j] + dfNorth * padfNorth[j];
+    }
+}
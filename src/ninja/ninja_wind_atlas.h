@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Basis solutions for neutral domain-average runs
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef NINJA_WIND_ATLAS_H
+#define NINJA_WIND_ATLAS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "boost/shared_ptr.hpp"
+
+#include "WindNinjaInputs.h"
+
+class ninja;
+
+/**
+ * Two basis solutions of a domain for neutral domain-average runs.
+ *
+ * Without stability or diurnal flow the initial field is a log profile
+ * scaled by the input speed, and the mass-consistent adjustment is linear
+ * in the initial field.  The 3D wind for any speed and direction is then a
+ * combination of the solutions for a 1 m/s wind toward the east and toward
+ * the north.  Runs that use an atlas do not assemble or solve a system.
+ *
+ * Atlases are kept in memory and reused by later armies on the same domain.
+ */
+class NinjaWindAtlas
+{
+public:
+    typedef boost::shared_ptr<NinjaWindAtlas> Ptr;
+
+    static std::string CheckLinear( WindNinjaInputs const &input );
+    static std::string FormKey( ninja const &run );
+    static Ptr Get( ninja const &prototype, int numProcessors );
+    static void ClearCache();
+
+    int GetNumNodes() const { return numNodes; }
+    void Combine( double speed, double direction,
+                  double *u, double *v, double *w ) const;
+
+    static const unsigned int MAX_CACHED_ATLASES = 8;
+
+private:
+    NinjaWindAtlas();
+    void SolveBasis( ninja const &prototype, int numProcessors );
+
+    int numNodes;
+    std::vector<double> east[3];    //u, v and w for a 1 m/s wind toward the east
+    std::vector<double> north[3];   //u, v and w for a 1 m/s wind toward the north
+
+    static std::map<std::string, Ptr> oCache;
+};
+
+#endif /* NINJA_WIND_ATLAS_H */
@@ -29,12 +29,12 @@
 
 #include "ninjafoam.h"
 
-const char* NinjaFoam::pszFoamPath = NULL;
+const char* NinjaFoam::pszArmyFoamPath = NULL;
 
 NinjaFoam::NinjaFoam() : ninja()
 {
-    pszVrtMem = NULL;
-    pszGridFilename = NULL;
+    pszFoamPath = NULL;
+    coreOffset = -1;
 
     boundary_name = "";
     type = "";
@@ -79,7 +79,8 @@ NinjaFoam::NinjaFoam() : ninja()
 
 NinjaFoam::NinjaFoam(NinjaFoam const& A ) : ninja(A)
 {
-
+    pszFoamPath = A.pszFoamPath ? CPLStrdup(A.pszFoamPath) : NULL;
+    coreOffset = A.coreOffset;
 }
 
 /**
@@ -92,14 +93,15 @@ NinjaFoam& NinjaFoam::operator= (NinjaFoam const& A)
 {
     if(&A != this) {
         ninja::operator=(A);
+        SetCaseDirectory(A.pszFoamPath);
+        coreOffset = A.coreOffset;
     }
     return *this;
 }
 
 NinjaFoam::~NinjaFoam()
 {
-    CPLFree( (void*)pszVrtMem );
-    CPLFree( (void*)pszGridFilename );
+    CPLFree( (void*)pszFoamPath );
 }
 
 double NinjaFoam::get_meshResolution()
@@ -162,6 +164,26 @@ bool NinjaFoam::simulate_wind()
 
     int status = 0;
 
+    //runs use the army's case directory unless they were given their own
+    if(pszFoamPath == NULL){
+        SetCaseDirectory(pszArmyFoamPath);
+    }
+
+    //a case meshed earlier from the same DEM and mesh settings can be cloned
+    std::string meshCacheKey;
+    bool storeMesh = false;
+    if(CheckForValidCaseDir(pszFoamPath) != NINJA_SUCCESS && NinjaFoamMeshCache::IsEnabled()){
+        meshCacheKey = NinjaFoamMeshCache::FormKey(input.dem,
+                NinjaRemoveSpaces(CPLGetBasename(input.dem.fileName.c_str())),
+                input.meshCount, input.outputWindHeight);
+        if(NinjaFoamMeshCache::Restore(meshCacheKey, pszFoamPath)){
+            input.Com->ninjaCom(ninjaComClass::ninjaNone, "Using cached mesh...");
+        }
+        else{
+            storeMesh = true;
+        }
+    }
+
     //if pszFoamPath is not valid, create a new case 
     if(CheckForValidCaseDir(pszFoamPath) != NINJA_SUCCESS){
         status = GenerateNewCase();
@@ -301,6 +323,10 @@ bool NinjaFoam::simulate_wind()
         return NINJA_E_OTHER;
     }
 
+    if(storeMesh){
+        NinjaFoamMeshCache::Store(meshCacheKey, pszFoamPath);
+    }
+
     #ifdef _OPENMP
     endOutputSampling = omp_get_wtime();
     #endif
@@ -642,19 +668,137 @@ int NinjaFoam::WriteFoamFiles()
 
 void NinjaFoam::SetFoamPath(const char* pszPath)
 {
-    pszFoamPath = pszPath;
+    pszArmyFoamPath = pszPath;
 
 }
 
+const char * NinjaFoam::GetFoamPath()
+{
+    return pszArmyFoamPath;
+}
+
 int NinjaFoam::GenerateFoamDirectory(std::string demName)
 {
-    std::string t = NinjaRemoveSpaces(std::string(CPLGetBasename(demName.c_str())));
-    pszFoamPath = CPLStrdup(CPLGenerateTempFilename( CPLSPrintf("NINJAFOAM_%s", t.c_str())));
-    VSIMkdir( pszFoamPath, 0777 );
+    pszArmyFoamPath = CPLStrdup(CreateCaseDirectory(demName).c_str());
 
     return NINJA_SUCCESS;
 }
 
+/**
+ * Create a new, empty case directory in the temp dir.
+ * @param demName DEM the case is for, used in the directory name.
+ * @return path of the directory.
+ */
+std::string NinjaFoam::CreateCaseDirectory(std::string demName)
+{
+    std::string t = NinjaRemoveSpaces(std::string(CPLGetBasename(demName.c_str())));
+    std::string path = CPLGenerateTempFilename( CPLSPrintf("NINJAFOAM_%s", t.c_str()));
+    VSIMkdir( path.c_str(), 0777 );
+
+    return path;
+}
+
+/**
+ * Run in a case directory other than the army's.
+ * @param pszPath case directory, copied.
+ */
+void NinjaFoam::SetCaseDirectory(const char *pszPath)
+{
+    const char *pszOld = pszFoamPath;
+    pszFoamPath = pszPath ? CPLStrdup(pszPath) : NULL;
+    CPLFree( (void*)pszOld );
+}
+
+/**
+ * Bind the parallel OpenFOAM applications of this run to cores
+ * nOffset .. nOffset + numberCPUs - 1.  Used when several runs share a node.
+ * The cores are only passed to mpiexec when NINJAFOAM_MPI_BIND is set.
+ * @param nOffset first core, or -1 to let mpiexec bind.
+ */
+void NinjaFoam::SetCoreOffset(int nOffset)
+{
+    coreOffset = nOffset;
+}
+
+/**
+ * Number of runs to solve at once on nCores cores.
+ *
+ * Decomposition stops paying off once a subdomain holds fewer than about
+ * NINJAFOAM_CELLS_PER_CORE cells (10000 by default), so each run gets
+ * enough cores to reach that and the remaining cores go to further runs.
+ * NINJAFOAM_CONCURRENT_RUNS caps the result; it is 1 (serial) by default
+ * and AUTO leaves the choice to the cell count alone.
+ *
+ * @param nCells target number of cells of each run.
+ * @param nRuns number of runs in the army.
+ * @param nCores cores available.
+ * @return number of concurrent runs, at least 1.
+ */
+int NinjaFoam::GetConcurrentRuns(int nCells, int nRuns, int nCores)
+{
+    const char *pszMax = CPLGetConfigOption("NINJAFOAM_CONCURRENT_RUNS", "1");
+    int nMax = EQUAL(pszMax, "AUTO") ? nRuns : atoi(pszMax);
+    int nCellsPerCore = atoi(CPLGetConfigOption("NINJAFOAM_CELLS_PER_CORE", "10000"));
+    if(nCellsPerCore < 1)
+        nCellsPerCore = 10000;
+
+    int nCoresPerRun = nCells / nCellsPerCore;
+    nCoresPerRun = std::max(1, std::min(nCoresPerRun, nCores));
+
+    int nConcurrent = nCores / nCoresPerRun;
+    nConcurrent = std::min(nConcurrent, std::min(nMax, nRuns));
+
+    return std::max(1, nConcurrent);
+}
+
+/*
+** mpiexec command line for a parallel OpenFOAM application.  Runs given a
+** core offset are bound to their own cores so concurrent runs don't share.
+** The binding options differ between MPI implementations, so they are only
+** added when NINJAFOAM_MPI_BIND names one: OPENMPI (--cpu-set/--bind-to) or
+** MPICH (-bind-to user:).  By default, for NONE, or for an implementation
+** that takes neither (Intel MPI pins through I_MPI_PIN_PROCESSOR_LIST),
+** mpiexec places the processes itself.
+** Free the list with CSLDestroy().
+*/
+char ** NinjaFoam::MpiArgv(const char *pszApp)
+{
+    char **papszArgv = NULL;
+    papszArgv = CSLAddString(papszArgv, "mpiexec");
+    papszArgv = CSLAddString(papszArgv, "-np");
+    papszArgv = CSLAddString(papszArgv, CPLSPrintf("%d", input.numberCPUs));
+    if(coreOffset >= 0){
+        const char *pszBind = CPLGetConfigOption("NINJAFOAM_MPI_BIND", "NONE");
+        if(EQUAL(pszBind, "OPENMPI")){
+            papszArgv = CSLAddString(papszArgv, "--cpu-set");
+            papszArgv = CSLAddString(papszArgv, CPLSPrintf("%d-%d", coreOffset,
+                                                           coreOffset + input.numberCPUs - 1));
+            papszArgv = CSLAddString(papszArgv, "--bind-to");
+            papszArgv = CSLAddString(papszArgv, "core");
+        }
+        else if(EQUAL(pszBind, "MPICH")){
+            std::string osCores = "user:";
+            for(int i = 0; i < input.numberCPUs; i++){
+                if(i > 0)
+                    osCores += ",";
+                osCores += CPLSPrintf("%d", coreOffset + i);
+            }
+            papszArgv = CSLAddString(papszArgv, "-bind-to");
+            papszArgv = CSLAddString(papszArgv, osCores.c_str());
+        }
+        else if(!EQUAL(pszBind, "NONE")){
+            CPLDebug("NINJAFOAM", "Unknown NINJAFOAM_MPI_BIND value %s, "
+                     "runs are not bound to cores.", pszBind);
+        }
+    }
+    papszArgv = CSLAddString(papszArgv, pszApp);
+    papszArgv = CSLAddString(papszArgv, "-case");
+    papszArgv = CSLAddString(papszArgv, pszFoamPath);
+    papszArgv = CSLAddString(papszArgv, "-parallel");
+
+    return papszArgv;
+}
+
 void NinjaFoam::SetBcs()
 {
     bcs.push_back("east_face");
@@ -1269,19 +1413,15 @@ int NinjaFoam::MoveDynamicMesh()
                                       "-parallel",
                                       NULL };
 #else
-        const char *const papszArgv[] = { "mpiexec",
-                                      "-np",
-                                      CPLSPrintf("%d", input.numberCPUs),
-                                      "moveDynamicMesh",
-                                      "-case",
-                                      pszFoamPath,
-                                      "-parallel",
-                                      NULL };
+        char **papszArgv = MpiArgv("moveDynamicMesh");
 #endif
 
         input.Com->ninjaCom(ninjaComClass::ninjaNone, "Running moveDynamicMesh...");
 
         CPLSpawnedProcess *sp = CPLSpawnAsync(NULL, papszArgv, FALSE, TRUE, TRUE, NULL);
+#ifndef WIN32
+        CSLDestroy(papszArgv);
+#endif
         CPL_FILE_HANDLE out_child = CPLSpawnAsyncGetInputFileHandle(sp);
 
         char data[PIPE_BUFFER_SIZE + 1];
@@ -1749,17 +1889,13 @@ int NinjaFoam::SimpleFoam()
                                        NULL };
         #else
         CPLSetConfigOption("MPI_BUFFER_SIZE", "20000000");
-        const char *const papszArgv[] = { "mpiexec",
-                                      "-np",
-                                      CPLSPrintf("%d", input.numberCPUs),
-                                      "simpleFoam",
-                                      "-case",
-                                      pszFoamPath,
-                                      "-parallel",
-                                       NULL };
+        char **papszArgv = MpiArgv("simpleFoam");
         #endif
 
         CPLSpawnedProcess *sp = CPLSpawnAsync(NULL, papszArgv, FALSE, TRUE, TRUE, NULL);
+        #ifndef WIN32
+        CSLDestroy(papszArgv);
+        #endif
         CPL_FILE_HANDLE out_child = CPLSpawnAsyncGetInputFileHandle(sp);
 
         while(CPLPipeRead(out_child, &data, sizeof(data)-1)){
@@ -1837,364 +1973,50 @@ int NinjaFoam::Sample()
 }
 
 /*
-** Sanitize OpenFOAM output so OGR can consume the data using a VRT.
-**
-** We need to:
-**      Open raw output.
-**      Remove 1st header line.
-**      Remove leading # on next line
-**      Remove leading '  '
-**      Change 5 '  ' to ','
-**      Remove trailing '  '
-**
-** This essentially copies the data and changes it inline.
+** Read the raw surface sample written by the sample step into memory.
 **
+** The surfaces function object writes one directory per time under
+** postProcessing/surfaces; there is only one after a run.
 */
 
-int NinjaFoam::SanitizeOutput()
+int NinjaFoam::ReadRawOutput(FoamSurfaceSample &sample)
 {
-    /*
-    ** Note that fin is a normal FILE used with VSI*, not VSI*L.  This is for
-    ** the VSIFGets functions.
-    */
-    FILE *fin;
-    VSILFILE *fout, *fvrt;
-    char buf[512];
-    int rc;
-    const char *pszVrtFile;
-    const char *pszVrt;
-    const char *pszMem;
-    std::string s;
-
-    pszMem = CPLSPrintf( "%s/output.raw", pszFoamPath );
-    /* This is a member, hold on to it so we can read it later */
-    pszVrtMem = CPLStrdup( CPLSPrintf( "%s/output.vrt", pszFoamPath ) );
-
+    std::string osRawFile;
     char **papszOutputSurfacePath;
     papszOutputSurfacePath = VSIReadDir( CPLSPrintf("%s/postProcessing/surfaces/", pszFoamPath) );
 
     for(int i = 0; i < CSLCount( papszOutputSurfacePath ); i++){
         if(std::string(papszOutputSurfacePath[i]) != "." &&
            std::string(papszOutputSurfacePath[i]) != "..") {
-            fin = VSIFOpen(CPLSPrintf( "%s/postProcessing/surfaces/%s/U_triSurfaceSampling.raw", 
-                            pszFoamPath, 
-                            papszOutputSurfacePath[i]), "r");
+            osRawFile = CPLSPrintf( "%s/postProcessing/surfaces/%s/U_triSurfaceSampling.raw",
+                                    pszFoamPath,
+                                    papszOutputSurfacePath[i] );
             break;
         }
-        else{
-            continue;
-        }
     }
+    CSLDestroy( papszOutputSurfacePath );
 
-    fout = VSIFOpenL( pszMem, "w" );
-    fvrt = VSIFOpenL( pszVrtMem, "w" );
-    if( !fin )
+    if( osRawFile.empty() )
     {
         CPLError( CE_Failure, CPLE_AppDefined, "Failed to open output file for " \
                                                 "reading." );
         return NINJA_E_FILE_IO;
     }
-    if( !fout )
-    {
-        VSIFClose( fin );
-        CPLError( CE_Failure, CPLE_AppDefined, "Failed to open output file for " \
-                                                "writing." );
-        return NINJA_E_FILE_IO;
-    }
-    if( !fvrt )
-    {
-        VSIFClose( fin );
-        VSIFClose( fout );
-        CPLError( CE_Failure, CPLE_AppDefined, "Failed to open vrt file for " \
-                                                "writing." );
-        return NINJA_E_FILE_IO;
-    }
-    pszVrtFile = CPLSPrintf( "CSV:%s", pszMem );
 
-    pszVrt = CPLSPrintf( NINJA_FOAM_OGR_VRT, "output", pszVrtFile, "output" );
-
-    VSIFWriteL( pszVrt, strlen( pszVrt ), 1, fvrt );
-    VSIFCloseL( fvrt );
-    buf[0] = '\0';
-    /*
-    ** eat the first line
-    */
-    VSIFGets( buf, 512, fin );
-    /*
-    ** fix the header
-    */
-    VSIFGets( buf, 512, fin );
-
-    s = buf;
-    ReplaceKeys( s, "#", "", 1 );
-    ReplaceKeys( s, "  ", "", 1 );
-    ReplaceKeys( s, "  ", ",", 5 );
-    ReplaceKeys( s, "  ", "", 1 );
-    VSIFWriteL( s.c_str(), s.size(), 1, fout );
-    /*
-    ** sanitize the data.
-    */
-    while( VSIFGets( buf, 512, fin ) != NULL )
+    try
     {
-        s = buf;
-        ReplaceKeys( s, " ", ",", 5 );
-        VSIFWriteL( s.c_str(), s.size(), 1, fout );
+        sample.readRaw( osRawFile );
     }
-    VSIFClose( fin );
-    VSIFCloseL( fout );
-
-    return 0;
-}
-
-static int TransformGeoToPixelSpace( double *adfInvGeoTransform, double dfX,
-                                     double dfY, int *iPixel, int *iLine )
-{
-    *iPixel = (int) floor( adfInvGeoTransform[0] +
-                           adfInvGeoTransform[1] * dfX +
-                           adfInvGeoTransform[2] * dfY );
-    *iLine  = (int) floor( adfInvGeoTransform[3] +
-                           adfInvGeoTransform[4] * dfX +
-                           adfInvGeoTransform[5] * dfY );
-    return NINJA_SUCCESS;
-}
-
-int NinjaFoam::SampleCloud()
-{
-    int rc;
-    OGRDataSourceH hDS = NULL;
-    OGRLayerH hLayer = NULL;
-    OGRFeatureH hFeature = NULL;
-    OGRFeatureDefnH hFeatDefn = NULL;
-    OGRGeometryH hGeometry = NULL;
-    GDALDatasetH hGriddedDS = NULL;
-
-    double adfGeoTransform[6], adfInvGeoTransform[6];
-
-    hDS = OGROpen( pszVrtMem, FALSE, NULL );
-    if( hDS == NULL )
+    catch( std::exception &e )
     {
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Invalid in memory datasource in NinjaFoam" );
+        CPLError( CE_Failure, CPLE_AppDefined, "%s", e.what() );
         return NINJA_E_FILE_IO;
     }
-
-    hLayer = OGR_DS_GetLayer( hDS, 0 );
-    if( hLayer == NULL )
-    {
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Failed to extract a valid layer for NinjaFoam resampling" );
-        return NINJA_E_OTHER;
-    }
-    double dfX, dfY, dfU, dfV;
-    int nPoints, nXSize, nYSize;
-    double dfXMax, dfYMax, dfXMin, dfYMin, dfCellSize;
-
-    dfXMin = input.dem.get_xllCorner();
-    dfXMax = input.dem.get_xllCorner() + input.dem.get_xDimension();
-    dfYMin = input.dem.get_yllCorner();
-    dfYMax = input.dem.get_yllCorner() + input.dem.get_yDimension();
-    dfCellSize = input.dem.get_cellSize();
-
-    nPoints = OGR_L_GetFeatureCount( hLayer, TRUE );
-    CPLDebug( "WINDNINJA", "NinjaFoam gridding %d points", nPoints );
-
-    /* Get DEM/output specs */
-    nXSize = input.dem.get_nCols();
-    nYSize = input.dem.get_nRows();
-
-    GDALDriverH hDriver = GDALGetDriverByName( "GTiff" );
-    pszGridFilename = CPLStrdup( CPLSPrintf( "%s/foam.tif", pszFoamPath ) );
-    hGriddedDS = GDALCreate( hDriver, pszGridFilename, nXSize, nYSize, 2,
-                             GDT_Float64, NULL );
-    GDALRasterBandH hUBand, hVBand;
-    hUBand = GDALGetRasterBand( hGriddedDS, 1 );
-    hVBand = GDALGetRasterBand( hGriddedDS, 2 );
-    GDALSetRasterNoDataValue( hUBand, -9999 );
-    GDALSetRasterNoDataValue( hVBand, -9999 );
-
-    /* Set the projection from the DEM */
-    rc = GDALSetProjection( hGriddedDS, input.dem.prjString.c_str() );
-
-    adfGeoTransform[0] = dfXMin;
-    adfGeoTransform[1] = dfCellSize;
-    adfGeoTransform[2] = 0;
-    adfGeoTransform[3] = dfYMax;
-    adfGeoTransform[4] = 0;
-    adfGeoTransform[5] = -dfCellSize;
-
-    GDALSetGeoTransform( hGriddedDS, adfGeoTransform );
-    rc = GDALInvGeoTransform( adfGeoTransform, adfInvGeoTransform );
-
-    int i = 0;
-    int nUIndex, nVIndex;
-    int nPixel, nLine;
-    OGR_L_ResetReading( hLayer );
-    hFeatDefn = OGR_L_GetLayerDefn( hLayer );
-    nUIndex = OGR_FD_GetFieldIndex( hFeatDefn, "U" );
-    nVIndex = OGR_FD_GetFieldIndex( hFeatDefn, "V" );
-    while( (hFeature = OGR_L_GetNextFeature( hLayer )) != NULL )
-    {
-        hGeometry = OGR_F_GetGeometryRef( hFeature );
-        dfX = OGR_G_GetX( hGeometry, 0 );
-        dfY = OGR_G_GetY( hGeometry, 0 );
-        dfU = OGR_F_GetFieldAsDouble( hFeature, nUIndex );
-        dfV = OGR_F_GetFieldAsDouble( hFeature, nVIndex );
-        TransformGeoToPixelSpace( adfInvGeoTransform, dfX, dfY, &nPixel, &nLine );
-        GDALRasterIO( hUBand, GF_Write, nPixel, nLine, 1, 1, &dfU,
-                      1, 1, GDT_Float64, 0, 0 );
-        GDALRasterIO( hVBand, GF_Write, nPixel, nLine, 1, 1, &dfV,
-                      1, 1, GDT_Float64, 0, 0 );
-        i++;
-    }
-    OGR_DS_Destroy( hDS );
-    GDALClose( hGriddedDS );
+    CPLDebug( "WINDNINJA", "NinjaFoam gridding %d points", sample.get_nPoints() );
 
     return 0;
 }
 
-/*
-** Sample a point cloud and create a 2-band GDALDataset of U and V values.
-**
-** Open the data source created by SanitizeOutput() and read in the point
-** features.  We'll then pass this to GDALGrid*() to write data to bands.
-**
-** TODO: Investigate Grid interp method and options.
-**
-*/
-
-int NinjaFoam::SampleCloudGrid()
-{
-    int rc;
-    OGRDataSourceH hDS = NULL;
-    OGRLayerH hLayer = NULL;
-    OGRFeatureH hFeature = NULL;
-    OGRFeatureDefnH hFeatDefn = NULL;
-    OGRGeometryH hGeometry = NULL;
-    GDALDatasetH hGriddedDS = NULL;
-
-    double adfGeoTransform[6];
-
-    hDS = OGROpen( pszVrtMem, FALSE, NULL );
-    if( hDS == NULL )
-    {
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Invalid in memory datasource in NinjaFoam" );
-        return NINJA_E_FILE_IO;
-    }
-
-    hLayer = OGR_DS_GetLayer( hDS, 0 );
-    if( hLayer == NULL )
-    {
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Failed to extract a valid layer for NinjaFoam resampling" );
-        return NINJA_E_OTHER;
-    }
-    double *padfX, *padfY, *padfU, *padfV;
-    double *padfData;
-    int nPoints, nXSize, nYSize;
-    double dfXMax, dfYMax, dfXMin, dfYMin, dfCellSize;
-
-    dfXMin = input.dem.get_xllCorner();
-    dfXMax = input.dem.get_xllCorner() + input.dem.get_xDimension();
-    dfYMin = input.dem.get_yllCorner();
-    dfYMax = input.dem.get_yllCorner() + input.dem.get_yDimension();
-    dfCellSize = input.dem.get_cellSize();
-
-    nPoints = OGR_L_GetFeatureCount( hLayer, TRUE );
-    CPLDebug( "WINDNINJA", "NinjaFoam gridding %d points", nPoints );
-    padfX = (double*)CPLMalloc( sizeof( double ) * nPoints );
-    padfY = (double*)CPLMalloc( sizeof( double ) * nPoints );
-    padfU = (double*)CPLMalloc( sizeof( double ) * nPoints );
-    padfV = (double*)CPLMalloc( sizeof( double ) * nPoints );
-
-    int i = 0;
-    int nUIndex, nVIndex;
-    OGR_L_ResetReading( hLayer );
-    hFeatDefn = OGR_L_GetLayerDefn( hLayer );
-    nUIndex = OGR_FD_GetFieldIndex( hFeatDefn, "U" );
-    nVIndex = OGR_FD_GetFieldIndex( hFeatDefn, "V" );
-    while( (hFeature = OGR_L_GetNextFeature( hLayer )) != NULL )
-    {
-        hGeometry = OGR_F_GetGeometryRef( hFeature );
-        padfX[i] = OGR_G_GetX( hGeometry, 0 );
-        padfY[i] = OGR_G_GetY( hGeometry, 0 );
-        padfU[i] = OGR_F_GetFieldAsDouble( hFeature, nUIndex );
-        padfV[i] = OGR_F_GetFieldAsDouble( hFeature, nVIndex );
-        i++;
-    }
-
-    /* Get DEM/output specs */
-    nXSize = input.dem.get_nCols();
-    nYSize = input.dem.get_nRows();
-
-    /*
-    ** XXX
-    ** Nearest neighbour gridding options.  Switch these if you switch the
-    ** algorithm.
-    ** XXX
-    */
-    GDALGridNearestNeighborOptions sOptions;
-    sOptions.dfRadius1 = 0.;
-    sOptions.dfRadius2 = sOptions.dfRadius1;
-    sOptions.dfAngle = 0.;
-    sOptions.dfNoDataValue = -9999;
-
-    GDALDriverH hDriver = GDALGetDriverByName( "GTiff" );
-    pszGridFilename = CPLStrdup( CPLSPrintf( "%s/foam.tif", pszFoamPath ) );
-    hGriddedDS = GDALCreate( hDriver, pszGridFilename, nXSize, nYSize, 2,
-                             GDT_Float64, NULL );
-    padfData = (double*)CPLMalloc( sizeof( double ) * nXSize * nYSize );
-
-    /* U field */
-    rc = GDALGridCreate( GGA_NearestNeighbor, (void*)&sOptions, nPoints,
-                         padfX, padfY, padfU, dfXMin, dfXMax, dfYMax, dfYMin,
-                         nXSize, nYSize, GDT_Float64, padfData, NULL, NULL );
-
-    GDALRasterBandH hBand;
-    hBand = GDALGetRasterBand( hGriddedDS, 1 );
-    GDALSetRasterNoDataValue( hBand, -9999 );
-    GDALRasterIO( hBand, GF_Write, 0, 0, nXSize, nYSize, padfData,
-                  nXSize, nYSize, GDT_Float64, 0, 0 );
-
-    /* V field */
-    rc = GDALGridCreate( GGA_NearestNeighbor, (void*)&sOptions, nPoints,
-                         padfX, padfY, padfV, dfXMin, dfXMax, dfYMax, dfYMin,
-                         nXSize, nYSize, GDT_Float64, padfData, NULL, NULL );
-
-    hBand = GDALGetRasterBand( hGriddedDS, 2 );
-    GDALSetRasterNoDataValue( hBand, -9999 );
-    GDALRasterIO( hBand, GF_Write, 0, 0, nXSize, nYSize, padfData,
-                  nXSize, nYSize, GDT_Float64, 0, 0 );
-
-    /* Set the projection from the DEM */
-    rc = GDALSetProjection( hGriddedDS, input.dem.prjString.c_str() );
-
-    adfGeoTransform[0] = dfXMin;
-    adfGeoTransform[1] = dfCellSize;
-    adfGeoTransform[2] = 0;
-    adfGeoTransform[3] = dfYMax;
-    adfGeoTransform[4] = 0;
-    adfGeoTransform[5] = -dfCellSize;
-
-    GDALSetGeoTransform( hGriddedDS, adfGeoTransform );
-
-    CPLFree( (void*)padfX );
-    CPLFree( (void*)padfY );
-    CPLFree( (void*)padfU );
-    CPLFree( (void*)padfV );
-
-    CPLFree( (void*)padfData );
-    OGR_DS_Destroy( hDS );
-    GDALClose( hGriddedDS );
-
-    return 0;
-}
-
-const char * NinjaFoam::GetGridFilename()
-{
-    return pszGridFilename;
-}
-
 void NinjaFoam::SetOutputResolution()
 {
     //Set output file resolutions now
@@ -2246,6 +2068,9 @@ void NinjaFoam::SetOutputFilenames()
         }else{
             pathName = CPLGetPath(input.dem.fileName.c_str());
         }
+        //in-memory inputs have no directory to write to
+        if( NinjaMemoryInput::IsMemoryPath( pathName ) )
+            pathName = ".";
     }
     else{
         pathName = input.customOutputPath;
@@ -2340,24 +2165,30 @@ int NinjaFoam::SampleRawOutput()
     /* convert output from xyz to speed and direction                    */
     /*-------------------------------------------------------------------*/
 
-    AsciiGrid<double> foamU, foamV;
+    FoamSurfaceSample sample;
     int rc;
-    rc = SanitizeOutput();
-
-    if( CSLTestBoolean( CPLGetConfigOption( "NINJAFOAM_USE_GDALGRID", "NO" ) ) )
-        rc = SampleCloudGrid();
-    else
-        rc = SampleCloud();
-    GDALDatasetH hDS;
-    hDS = GDALOpen( GetGridFilename(), GA_ReadOnly );
-    if( hDS == NULL )
+    rc = ReadRawOutput( sample );
+    if( rc != 0 )
     {
         input.Com->ninjaCom(ninjaComClass::ninjaNone, "Invalid output written" );
-        return false;
+        return rc;
     }
 
-    GDAL2AsciiGrid( (GDALDataset *)hDS, 1, foamU );
-    GDAL2AsciiGrid( (GDALDataset *)hDS, 2, foamV );
+    /* nearest sample point to each DEM cell center */
+    AsciiGrid<double> foamU( input.dem.get_nCols(), input.dem.get_nRows(),
+                             input.dem.get_xllCorner(), input.dem.get_yllCorner(),
+                             input.dem.get_cellSize(), -9999.0, -9999.0,
+                             input.dem.prjString );
+    AsciiGrid<double> foamV( foamU );
+    sample.grid( foamU, foamV );
+    // If we failed to fill in the data for the entire grid, we've failed.
+    // Report a better message.
+    if( foamU.get_hasNoDataValues() || foamV.get_hasNoDataValues() ) {
+        input.Com->ninjaCom(ninjaComClass::ninjaNone,
+                "the openfoam output could not be interpolated to a proper "
+                "surface, simulation failed.");
+        return NINJA_E_OTHER;
+    }
 
     AsciiGrid<double> foamSpd( foamU );
     AsciiGrid<double> foamDir( foamU );
@@ -2372,14 +2203,6 @@ int NinjaFoam::SampleRawOutput()
 
     AngleGrid = foamDir;
     VelocityGrid = foamSpd;
-    // If we failed to fill in the data for the entire grid, we've failed.
-    // Report a better message.
-    if( AngleGrid.get_hasNoDataValues() || VelocityGrid.get_hasNoDataValues() ) {
-        input.Com->ninjaCom(ninjaComClass::ninjaNone,
-                "the openfoam output could not be interpolated to a proper "
-                "surface, simulation failed.");
-        return NINJA_E_OTHER;
-    }
     if(VelocityGrid.get_maxValue() > 220.0){
         input.Com->ninjaCom(ninjaComClass::ninjaNone, "The flow solution did not converge. This may occasionally "
                 "happen in very complex terrain when the mesh resolution is high. Try the simulation "
@@ -2387,8 +2210,6 @@ int NinjaFoam::SampleRawOutput()
         return(NINJA_E_OTHER);
     }
 
-    GDALClose( hDS );
-
     return NINJA_SUCCESS;
 }
 
@@ -2409,6 +2230,10 @@ int NinjaFoam::WriteOutputFiles()
     //resample to requested output resolutions
     SetOutputResolution();
 
+    //results stay in memory only
+    if(!input.fileOutFlag)
+        return 0;
+
     //set up filenames
     SetOutputFilenames();
 
@@ -2777,26 +2602,35 @@ int NinjaFoam::GenerateNewCase()
 
     input.Com->ninjaCom(ninjaComClass::ninjaNone, "Converting DEM to STL format...");
 
-    const char *pszStlFileName = CPLStrdup(CPLFormFilename(
+    std::string stlName = NinjaRemoveSpaces(std::string(CPLFormFilename(
                 (CPLSPrintf("%s/constant/triSurface/", pszFoamPath)),
-                CPLGetBasename(input.dem.fileName.c_str()), ".stl"));
+                CPLGetBasename(input.dem.fileName.c_str()), ".stl")));
+    std::string stlOutName = NinjaRemoveSpaces(std::string(CPLSPrintf(
+                "%s/constant/triSurface/%s_out.stl", pszFoamPath,
+                CPLGetBasename(input.dem.fileName.c_str()))));
+
+    // the output surface is the terrain translated to the output wind height,
+    // written from the same DEM read unless
+    // NINJAFOAM_USE_SURFACE_TRANSFORM_POINTS = YES.
+    bool useSurfaceTransformPoints =
+        CSLTestBoolean( CPLGetConfigOption( "NINJAFOAM_USE_SURFACE_TRANSFORM_POINTS", "NO" ) );
 
-    std::string stlName = NinjaRemoveSpaces(std::string(pszStlFileName));
+    const char *apszStlFiles[] = { stlName.c_str(), stlOutName.c_str() };
+    double adfStlOffsets[] = { 0.0, input.outputWindHeight };
 
     int nBand = 1;
     const char * inFile = input.dem.fileName.c_str();
     CPLErr eErr;
 
-    eErr = NinjaElevationToStl(inFile,
-                        (const char*)stlName.c_str(),
+    eErr = NinjaElevationToStlSurfaces(inFile,
                         nBand,
                         input.dem.get_cellSize(),
                         NinjaStlBinary,
-                        0,
+                        useSurfaceTransformPoints ? 1 : 2,
+                        apszStlFiles,
+                        adfStlOffsets,
                         NULL);
 
-    CPLFree((void*)pszStlFileName);
-
     if(eErr != 0){
         input.Com->ninjaCom(ninjaComClass::ninjaNone, "Error while converting DEM to STL format.");
         return NINJA_E_OTHER;
@@ -2809,34 +2643,16 @@ int NinjaFoam::GenerateNewCase()
     #endif
 
     /*-------------------------------------------------------------------*/
-    /*  write output stl and run surfaceCheck on original stl            */
+    /*  write output stl                                                 */
     /*-------------------------------------------------------------------*/
 
-    input.Com->ninjaCom(ninjaComClass::ninjaNone, "Transforming surface points to output wind height...");
-
-    // create the output surface stl with NinjaElevationToStl unless
-    // NINJAFOAM_USE_SURFACE_TRANSFORM_POINTS = YES.
-    if( CSLTestBoolean( CPLGetConfigOption( "NINJAFOAM_USE_SURFACE_TRANSFORM_POINTS", "NO" ) ) ) {
+    if( useSurfaceTransformPoints ) {
+        input.Com->ninjaCom(ninjaComClass::ninjaNone, "Transforming surface points to output wind height...");
         status = SurfaceTransformPoints();
         if(status != 0){
             input.Com->ninjaCom(ninjaComClass::ninjaNone, "Error during surfaceTransformPoints().");
             return NINJA_E_OTHER;
         }
-    }else{
-        pszStlFileName = CPLStrdup((CPLSPrintf("%s/constant/triSurface/%s_out.stl", pszFoamPath,
-                    CPLGetBasename(input.dem.fileName.c_str()))));
-        stlName = NinjaRemoveSpaces(std::string(pszStlFileName));
-        nBand = 1;
-
-        eErr = NinjaElevationToStl(inFile,
-                            (const char*)stlName.c_str(),
-                            nBand,
-                            input.dem.get_cellSize(),
-                            NinjaStlBinary,
-                            input.outputWindHeight,
-                            NULL);
-
-        CPLFree((void*)pszStlFileName);
     }
 
     checkCancel();
@@ -37,6 +37,8 @@
 #include "stl_create.h"
 #include "ninja_conv.h"
 #include "ninja_errors.h"
+#include "FoamSurfaceSample.h"
+#include "ninjafoam_mesh_cache.h"
 
 #include "gdal_alg.h"
 #include "cpl_spawn.h"
@@ -78,9 +80,17 @@ public:
     double get_meshResolution();
     static int GenerateFoamDirectory(std::string demName);
     static void SetFoamPath(const char *pszPath);
+    static const char * GetFoamPath();
+    static std::string CreateCaseDirectory(std::string demName);
+    void SetCaseDirectory(const char *pszPath);
+    void SetCoreOffset(int nOffset);
+    static int GetConcurrentRuns(int nCells, int nRuns, int nCores);
 
 private:
-    static const char *pszFoamPath;
+    static const char *pszArmyFoamPath; //case directory shared by the army's runs
+    const char *pszFoamPath; //case directory of this run
+    int coreOffset; //first core the parallel applications are bound to, or -1
+    char ** MpiArgv(const char *pszApp);
 
     /* OpenFOAM case setup */
     int UpdateExistingCase();
@@ -168,9 +178,6 @@ private:
     int WriteOutputFiles();
     void SetOutputResolution();
     void SetOutputFilenames();
-
-    const char *pszVrtMem;
-    const char *pszGridFilename;
     
     /* Timers */
     double startTotal, endTotal;
@@ -185,13 +192,10 @@ private:
 #ifdef NINJA_BUILD_TESTING
 public:
 #endif
-    int SanitizeOutput();
-    int SampleCloudGrid();
-    int SampleCloud();
+    int ReadRawOutput(FoamSurfaceSample &sample);
 #ifdef NINJA_BUILD_TESTING
 private:
 #endif
-    const char * GetGridFilename();
 
 };
 
@@ -0,0 +1,255 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Content addressed cache of meshed NinjaFOAM cases
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "ninjafoam_mesh_cache.h"
+
+#include <cstring>
+
+#include "ninja_conv.h"
+
+static const char *pszKeyFile = "ninjafoam.cachekey";
+
+/*
+** 64 bit FNV-1a hash, continued from nHash.
+*/
+static GUIntBig HashBytes( GUIntBig nHash, const void *pData, size_t nBytes )
+{
+    const GUIntBig nPrime = ( (GUIntBig)0x00000100 << 32 ) | 0x000001b3;
+    const unsigned char *pabyData = (const unsigned char*)pData;
+    for( size_t i = 0; i < nBytes; i++ )
+    {
+        nHash ^= pabyData[i];
+        nHash *= nPrime;
+    }
+    return nHash;
+}
+
+static const GUIntBig nHashSeed = ( (GUIntBig)0xcbf29ce4 << 32 ) | 0x84222325;
+
+static std::string FormatHash( GUIntBig nHash )
+{
+    return std::string( CPLSPrintf( "%08x%08x", (unsigned)( nHash >> 32 ),
+                                     (unsigned)( nHash & 0xffffffff ) ) );
+}
+
+/*
+** Copy a case directory.  Processor directories from a decomposed run and
+** sampled output are left out at the top level.
+*/
+static bool CopyCaseTree( const char *pszSrc, const char *pszDst, bool bTop )
+{
+    if( VSIMkdir( pszDst, 0777 ) != 0 )
+    {
+        VSIStatBufL sStat;
+        if( VSIStatL( pszDst, &sStat ) != 0 || !VSI_ISDIR( sStat.st_mode ) )
+            return false;
+    }
+
+    char **papszList = VSIReadDir( pszSrc );
+    bool bOk = true;
+    for( int i = 0; i < CSLCount( papszList ) && bOk; i++ )
+    {
+        const char *pszName = papszList[i];
+        if( EQUAL( pszName, "." ) || EQUAL( pszName, ".." ) )
+            continue;
+        if( bTop && ( EQUALN( pszName, "processor", 9 ) ||
+                      EQUAL( pszName, "postProcessing" ) ||
+                      EQUAL( pszName, pszKeyFile ) ) )
+            continue;
+
+        std::string osSrc = CPLFormFilename( pszSrc, pszName, NULL );
+        std::string osDst = CPLFormFilename( pszDst, pszName, NULL );
+        VSIStatBufL sStat;
+        if( VSIStatL( osSrc.c_str(), &sStat ) != 0 )
+            continue;
+        if( VSI_ISDIR( sStat.st_mode ) )
+            bOk = CopyCaseTree( osSrc.c_str(), osDst.c_str(), false );
+        else
+            bOk = CPLCopyFile( osDst.c_str(), osSrc.c_str() ) == 0;
+    }
+    CSLDestroy( papszList );
+    return bOk;
+}
+
+/**
+ * Check if the mesh cache is enabled.
+ *
+ * @return true if NINJAFOAM_MESH_CACHE_DIR is set.
+ */
+bool NinjaFoamMeshCache::IsEnabled()
+{
+    const char *pszDir = CPLGetConfigOption( "NINJAFOAM_MESH_CACHE_DIR", NULL );
+    return pszDir != NULL && pszDir[0] != '\0';
+}
+
+/**
+ * Form the cache key for a DEM and mesh settings.
+ *
+ * The DEM is identified by a hash of its values, header and projection, so
+ * copies of the same DEM share a mesh.  The STL name is part of the key
+ * because the case dictionaries refer to it.
+ *
+ * @param dem elevation the case is meshed from.
+ * @param stlName base name of the STL surfaces in constant/triSurface.
+ * @param meshCount target number of cells.
+ * @param outputWindHeight height of the sampling surface.
+ * @return the key.
+ */
+std::string NinjaFoamMeshCache::FormKey( Elevation const &dem,
+                                         std::string const &stlName,
+                                         int meshCount,
+                                         double outputWindHeight )
+{
+    const int nRows = dem.get_nRows();
+    const int nCols = dem.get_nCols();
+    GUIntBig nHash = nHashSeed;
+    for( int i = 0; i < nRows; i++ )
+    {
+        for( int j = 0; j < nCols; j++ )
+        {
+            double dfValue = dem( i, j );
+            nHash = HashBytes( nHash, &dfValue, sizeof( double ) );
+        }
+    }
+    nHash = HashBytes( nHash, dem.prjString.c_str(), dem.prjString.size() );
+
+    return std::string( CPLSPrintf( "%d|%s|%s|%d|%d|%.17g|%.17g|%.17g|%d|%.17g",
+                                    FORMAT_VERSION, stlName.c_str(),
+                                    FormatHash( nHash ).c_str(), nCols, nRows,
+                                    dem.get_xllCorner(), dem.get_yllCorner(),
+                                    dem.get_cellSize(), meshCount,
+                                    outputWindHeight ) );
+}
+
+std::string NinjaFoamMeshCache::FormDirName( std::string const &key )
+{
+    const char *pszDir = CPLGetConfigOption( "NINJAFOAM_MESH_CACHE_DIR", "." );
+    GUIntBig nHash = HashBytes( nHashSeed, key.c_str(), key.size() );
+    return std::string( CPLFormFilename( pszDir,
+                                         CPLSPrintf( "NINJAFOAM_MESH_%s",
+                                                     FormatHash( nHash ).c_str() ),
+                                         NULL ) );
+}
+
+/**
+ * Clone a cached case into a case directory.
+ *
+ * @param key cache key from FormKey().
+ * @param pszCaseDir case directory to fill, created if needed.
+ * @return true if the case was restored, false on a miss.
+ */
+bool NinjaFoamMeshCache::Restore( std::string const &key, const char *pszCaseDir )
+{
+    if( !IsEnabled() || key.empty() )
+        return false;
+
+    std::string osDir = FormDirName( key );
+    std::string osKeyFile = CPLFormFilename( osDir.c_str(), pszKeyFile, NULL );
+    VSIStatBufL sStat;
+    if( VSIStatL( osKeyFile.c_str(), &sStat ) != 0 )
+        return false;
+
+    /* the full key guards against hash collisions */
+    VSILFILE *fp = VSIFOpenL( osKeyFile.c_str(), "rb" );
+    if( fp == NULL )
+        return false;
+    std::string osStoredKey( (size_t)sStat.st_size, '\0' );
+    bool bOk = sStat.st_size == 0 ||
+               VSIFReadL( &osStoredKey[0], 1, osStoredKey.size(), fp ) == osStoredKey.size();
+    VSIFCloseL( fp );
+    if( !bOk || osStoredKey != key )
+    {
+        CPLDebug( "NINJAFOAM", "Ignoring mesh cache entry %s", osDir.c_str() );
+        return false;
+    }
+
+    if( !CopyCaseTree( osDir.c_str(), pszCaseDir, true ) )
+    {
+        CPLDebug( "NINJAFOAM", "Failed to restore cached mesh %s", osDir.c_str() );
+        return false;
+    }
+
+    CPLDebug( "NINJAFOAM", "Restored cached mesh %s to %s", osDir.c_str(), pszCaseDir );
+    return true;
+}
+
+/**
+ * Store a solved case.  An existing entry for the key is left alone.
+ *
+ * The case is copied under a temporary name and renamed, so concurrent runs
+ * never clone a partial case.
+ *
+ * @param key cache key from FormKey().
+ * @param pszCaseDir case directory to store.
+ * @return true if the key is cached on return.
+ */
+bool NinjaFoamMeshCache::Store( std::string const &key, const char *pszCaseDir )
+{
+    if( !IsEnabled() || key.empty() )
+        return false;
+
+    std::string osDir = FormDirName( key );
+    VSIStatBufL sStat;
+    if( VSIStatL( osDir.c_str(), &sStat ) == 0 )
+        return true;
+
+    std::string osTmpDir = osDir + CPLSPrintf( ".tmp%p", (void*)&key );
+    bool bOk = CopyCaseTree( pszCaseDir, osTmpDir.c_str(), true );
+    if( bOk )
+    {
+        std::string osKeyFile = CPLFormFilename( osTmpDir.c_str(), pszKeyFile, NULL );
+        VSILFILE *fp = VSIFOpenL( osKeyFile.c_str(), "wb" );
+        bOk = fp != NULL &&
+              VSIFWriteL( key.c_str(), 1, key.size(), fp ) == key.size();
+        if( fp != NULL )
+            VSIFCloseL( fp );
+    }
+    bOk = bOk && VSIRename( osTmpDir.c_str(), osDir.c_str() ) == 0;
+    if( !bOk )
+    {
+        NinjaUnlinkTree( osTmpDir.c_str() );
+        return VSIStatL( osDir.c_str(), &sStat ) == 0;
+    }
+
+    CPLDebug( "NINJAFOAM", "Stored meshed case in %s", osDir.c_str() );
+    return true;
+}
+
+/**
+ * Copy a meshed case to another case directory, without processor
+ * directories or sampled output.
+ *
+ * @param pszSrcDir case directory to copy.
+ * @param pszDstDir case directory to fill, created if needed.
+ * @return true on success.
+ */
+bool NinjaFoamMeshCache::CloneCase( const char *pszSrcDir, const char *pszDstDir )
+{
+    return CopyCaseTree( pszSrcDir, pszDstDir, true );
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Content addressed cache of meshed NinjaFOAM cases
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef NINJAFOAM_MESH_CACHE_H
+#define NINJAFOAM_MESH_CACHE_H
+
+#include <string>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include "Elevation.h"
+
+/**
+ * Cache of meshed NinjaFOAM case directories.
+ *
+ * A case is stored after its first successful solve and keyed by the
+ * content of the DEM, the target cell count (which the mesh choice sets)
+ * and the output wind height of the sampling surface.  Later runs with the
+ * same key clone the stored case and go through UpdateExistingCase()
+ * instead of meshing, so only ApplyInit and simpleFoam are run.
+ *
+ * The cache is enabled by setting the NINJAFOAM_MESH_CACHE_DIR config
+ * option to a writable directory.  CloneCase() is also used to give
+ * concurrent runs of an army their own copy of the army's meshed case.
+ */
+class NinjaFoamMeshCache
+{
+public:
+    static bool IsEnabled();
+
+    static std::string FormKey( Elevation const &dem,
+                                std::string const &stlName,
+                                int meshCount,
+                                double outputWindHeight );
+
+    static bool Restore( std::string const &key, const char *pszCaseDir );
+    static bool Store( std::string const &key, const char *pszCaseDir );
+    static bool CloneCase( const char *pszSrcDir, const char *pszDstDir );
+
+    static const int FORMAT_VERSION = 1;
+
+private:
+    static std::string FormDirName( std::string const &key );
+};
+
+#endif /* NINJAFOAM_MESH_CACHE_H */
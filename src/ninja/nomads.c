@@ -206,6 +206,7 @@ static char ** NomadsBuildForecastFileList( const char *pszKey, int nFcstHour,
     char *pszVars;
     const char *pszUrl;
     char **papszFileList = NULL;
+    const char *pszCgiUrl;
 
     int i;
 
@@ -214,6 +215,12 @@ static char ** NomadsBuildForecastFileList( const char *pszKey, int nFcstHour,
     {
         return NULL;
     }
+    /* NOMADS_URL_CGI points the requests at a mirror or a test server. */
+#ifdef NOMADS_USE_IP
+    pszCgiUrl = CPLGetConfigOption( "NOMADS_URL_CGI", NOMADS_URL_CGI_IP );
+#else /* NOMADS_USE_IP */
+    pszCgiUrl = CPLGetConfigOption( "NOMADS_URL_CGI", NOMADS_URL_CGI_HOST );
+#endif /* NOMADS_USE_IP */
     pszVars = NomadsBuildArgList( ppszKey[NOMADS_VARIABLES], "var" );
     pszLevels = NomadsBuildArgList( ppszKey[NOMADS_LEVELS], "lev" );
     for( i = 0; i < nHours; i++ )
@@ -236,12 +243,7 @@ static char ** NomadsBuildForecastFileList( const char *pszKey, int nFcstHour,
                   pszGribDir );
 
         pszUrl =
-            CPLSPrintf( "%s%s?%s&%s%s&file=%s&dir=/%s",
-#ifdef NOMADS_USE_IP
-                        NOMADS_URL_CGI_IP,
-#else /* NOMADS_USE_IP */
-                        NOMADS_URL_CGI_HOST,
-#endif /* NOMADS_USE_IP */
+            CPLSPrintf( "%s%s?%s&%s%s&file=%s&dir=/%s", pszCgiUrl,
                         ppszKey[NOMADS_FILTER_BIN], pszVars, pszLevels,
                         NOMADS_SUBREGION, pszGribFile, pszGribDir );
         pszUrl = CPLSPrintf( pszUrl, padfBbox[0], padfBbox[1],
@@ -324,7 +326,7 @@ static int NomadsFetchVsi( const char *pszUrl, const char *pszFilename )
     VSILFILE *fin, *fout;
     vsi_l_offset nOffset, nBytesWritten, nVsiBlockSize;
     char *pabyBuffer;
-    nVsiBlockSize = atoi( CPLGetConfigOption( "NOMADS_VSI_BLOCK_SIZE", "512" ) );
+    nVsiBlockSize = atoi( CPLGetConfigOption( "NOMADS_VSI_BLOCK_SIZE", "1048576" ) );
 
     if( !EQUALN( pszUrl, "/vsicurl/", 9 ) )
     {
@@ -369,46 +371,316 @@ static int NomadsFetchVsi( const char *pszUrl, const char *pszFilename )
     return rc;
 }
 
-static int NomadsFetchHttp( const char *pszUrl, const char *pszFilename )
+/*
+** A complete response from the server that isn't grib data, ie the 'data file
+** is not present' page or a 404.  Asking again won't change the answer.
+*/
+#define NOMADS_ERR_NO_DATA 2
+
+/*
+** Fetch a url into a partial file.  If the partial file already has data,
+** only the rest is requested with an HTTP range.  Servers that ignore the
+** range send the whole file, which replaces the partial file.  Data received
+** before a failure is kept so the next try can resume from it.
+**
+** Returns NOMADS_ERR for transport errors and server errors that may go away,
+** and NOMADS_ERR_NO_DATA for a complete response that isn't grib data.
+*/
+static int NomadsFetchRange( const char *pszUrl, const char *pszPartFile )
 {
     CPLHTTPResult *psResult;
     VSILFILE *fout;
-    psResult = NULL;
-    psResult = CPLHTTPFetch( pszUrl, NULL );
-    if( !psResult || psResult->nStatus != 0 || psResult->nDataLen < 1 ||
-        strstr( (char*)psResult->pabyData, "HTTP error code : 404" ) ||
-        strstr( (char*)psResult->pabyData, "data file is not present" ) )
+    VSIStatBufL sStat;
+    vsi_l_offset nOffset;
+    char **papszOptions;
+    const char *pszCode;
+    int bAppend, bGrib, nHttpCode, rc;
+
+    nOffset = 0;
+    if( VSIStatL( pszPartFile, &sStat ) == 0 )
     {
+        nOffset = sStat.st_size;
+    }
+    papszOptions = NULL;
+    if( nOffset > 0 )
+    {
+        papszOptions =
+            CSLAddString( papszOptions,
+                          CPLSPrintf( "HEADERS=Range: bytes=" CPL_FRMT_GUIB "-",
+                                      (GUIntBig)nOffset ) );
+        CPLDebug( "NOMADS", "Resuming %s at " CPL_FRMT_GUIB " bytes",
+                  CPLGetFilename( pszPartFile ), (GUIntBig)nOffset );
+    }
+    psResult = CPLHTTPFetch( pszUrl, papszOptions );
+    CSLDestroy( papszOptions );
+    if( !psResult )
+    {
+        return NOMADS_ERR;
+    }
+    bAppend = nOffset > 0 &&
+              CSLFetchNameValue( psResult->papszHeaders, "Content-Range" ) != NULL;
+    bGrib = psResult->nDataLen >= 4 &&
+            EQUALN( (const char*)psResult->pabyData, "GRIB", 4 );
+    nHttpCode = 0;
+    if( psResult->pszErrBuf &&
+        ( pszCode = strstr( psResult->pszErrBuf, "HTTP error code" ) ) )
+    {
+        pszCode = strchr( pszCode, ':' );
+        nHttpCode = pszCode ? atoi( pszCode + 1 ) : 0;
+    }
+    rc = psResult->nStatus == 0 && psResult->nDataLen > 0 ? NOMADS_OK : NOMADS_ERR;
+    if( nOffset > 0 && psResult->pszErrBuf &&
+        strstr( psResult->pszErrBuf, "416" ) )
+    {
+        /* Range not satisfiable, the partial file is already complete. */
         CPLHTTPDestroyResult( psResult );
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Failed to download file." );
+        return NOMADS_OK;
+    }
+    if( bAppend || bGrib )
+    {
+        fout = VSIFOpenL( pszPartFile, bAppend ? "ab" : "wb" );
+        if( !fout )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Failed to open file for writing." );
+            CPLHTTPDestroyResult( psResult );
+            return NOMADS_ERR;
+        }
+        if( VSIFWriteL( psResult->pabyData, psResult->nDataLen, 1, fout ) != 1 )
+        {
+            rc = NOMADS_ERR;
+        }
+        VSIFCloseL( fout );
+    }
+    else if( psResult->nStatus == 0 && ( rc == NOMADS_OK || nHttpCode > 0 ) )
+    {
+        /* Error pages, ie 'data file is not present', are not grib data */
+        VSIUnlink( pszPartFile );
+        /* Timeouts, throttling and server errors are worth another try */
+        if( nHttpCode == 408 || nHttpCode == 429 || nHttpCode >= 500 )
+            rc = NOMADS_ERR;
+        else
+            rc = NOMADS_ERR_NO_DATA;
+    }
+    CPLHTTPDestroyResult( psResult );
+    return rc;
+}
+
+/*
+** Check that a file holds complete grib messages.  The filter returns the
+** messages back to back, so the file starts with 'GRIB' and ends with the
+** end section, '7777'.
+*/
+static int NomadsCheckGrib( const char *pszFilename )
+{
+    VSILFILE *fin;
+    char abyHead[4], abyTail[4];
+    int rc;
+    fin = VSIFOpenL( pszFilename, "rb" );
+    if( !fin )
+    {
         return NOMADS_ERR;
     }
-    fout = VSIFOpenL( pszFilename, "wb" );
+    rc = NOMADS_ERR;
+    if( VSIFReadL( abyHead, 4, 1, fin ) == 1 &&
+        VSIFSeekL( fin, 0, SEEK_END ) == 0 && VSIFTellL( fin ) >= 16 &&
+        VSIFSeekL( fin, VSIFTellL( fin ) - 4, SEEK_SET ) == 0 &&
+        VSIFReadL( abyTail, 4, 1, fin ) == 1 &&
+        EQUALN( abyHead, "GRIB", 4 ) && EQUALN( abyTail, "7777", 4 ) )
+    {
+        rc = NOMADS_OK;
+    }
+    VSIFCloseL( fin );
+    return rc;
+}
+
+static int NomadsCopyFile( const char *pszSrc, const char *pszDst )
+{
+    VSILFILE *fin, *fout;
+    char *pabyBuffer;
+    size_t nRead;
+    int nBlockSize, rc;
+    nBlockSize = 1024 * 1024;
+    fin = VSIFOpenL( pszSrc, "rb" );
+    if( !fin )
+    {
+        return NOMADS_ERR;
+    }
+    fout = VSIFOpenL( pszDst, "wb" );
     if( !fout )
     {
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Failed to open file for writing." );
-        CPLHTTPDestroyResult( psResult );
+        VSIFCloseL( fin );
         return NOMADS_ERR;
     }
-    VSIFWriteL( psResult->pabyData, psResult->nDataLen, 1, fout );
+    pabyBuffer = CPLMalloc( sizeof( char ) * nBlockSize );
+    rc = NOMADS_OK;
+    do
+    {
+        nRead = VSIFReadL( pabyBuffer, 1, nBlockSize, fin );
+        if( nRead > 0 && VSIFWriteL( pabyBuffer, 1, nRead, fout ) != nRead )
+        {
+            rc = NOMADS_ERR;
+        }
+    } while( nRead > 0 && rc == NOMADS_OK );
+    CPLFree( (void*)pabyBuffer );
+    VSIFCloseL( fin );
     VSIFCloseL( fout );
-    CPLHTTPDestroyResult( psResult );
-    return NOMADS_OK;
+    return rc;
 }
 
-static void NomadsFetchAsync( void *pData )
+/*
+** Name of a url in the forecast cache.  The url holds the model, forecast
+** cycle, file, variables and bounding box, so a 64 bit FNV-1a hash of it
+** identifies the file.
+*/
+static const char * NomadsCacheFilename( const char *pszCacheDir,
+                                         const char *pszUrl )
 {
-    int rc;
-    NomadsThreadData *psData;
-    psData = (NomadsThreadData*)pData;
+    GUIntBig nHash, nPrime;
+    const unsigned char *p;
+    nHash = ( (GUIntBig)0xcbf29ce4 << 32 ) | 0x84222325;
+    nPrime = ( (GUIntBig)0x00000100 << 32 ) | 0x000001b3;
+    for( p = (const unsigned char*)pszUrl; *p != '\0'; p++ )
+    {
+        nHash ^= *p;
+        nHash *= nPrime;
+    }
+    return CPLFormFilename( pszCacheDir,
+                            CPLSPrintf( "%08x%08x", (unsigned)( nHash >> 32 ),
+                                        (unsigned)( nHash & 0xffffffff ) ),
+                            ".grib2" );
+}
+
+/*
+** Download one forecast file.
+**
+** If NOMADS_CACHE_DIR is set, a valid copy of the url in the cache is used
+** instead of the network, and downloads are stored there.  Failed and short
+** downloads are retried NOMADS_MAX_RETRIES times, resuming where they
+** stopped, and kept in the cache between runs.  A download is only accepted
+** if it is complete grib data.  A complete response that isn't grib data
+** fails right away.
+*/
+int NomadsFetchFile( const char *pszUrl, const char *pszFilename )
+{
+    const char *pszCacheDir;
+    char *pszCacheFile;
+    char *pszPartFile;
+    int nMaxTries, i, rc;
+
+    pszCacheDir = CPLGetConfigOption( "NOMADS_CACHE_DIR", NULL );
+    pszCacheFile = NULL;
+    if( pszCacheDir != NULL && pszCacheDir[0] != '\0' )
+    {
+        pszCacheFile = CPLStrdup( NomadsCacheFilename( pszCacheDir, pszUrl ) );
+        if( NomadsCheckGrib( pszCacheFile ) == NOMADS_OK )
+        {
+            CPLDebug( "NOMADS", "Using cached %s for %s",
+                      CPLGetFilename( pszCacheFile ),
+                      CPLGetFilename( pszFilename ) );
+            rc = NomadsCopyFile( pszCacheFile, pszFilename );
+            CPLFree( (void*)pszCacheFile );
+            return rc;
+        }
+        pszPartFile = CPLStrdup( CPLSPrintf( "%s.part", pszCacheFile ) );
+    }
+    else
+    {
+        pszPartFile = CPLStrdup( CPLSPrintf( "%s.part", pszFilename ) );
+    }
+
+    nMaxTries = atoi( CPLGetConfigOption( "NOMADS_MAX_RETRIES", "3" ) ) + 1;
+    rc = NOMADS_ERR;
+    for( i = 0; i < nMaxTries && rc == NOMADS_ERR; i++ )
+    {
+        if( i > 0 )
+        {
+            CPLSleep( i );
+        }
 #ifdef NOMADS_USE_VSI_READ
-    rc = NomadsFetchVsi( psData->pszUrl, psData->pszFilename );
+        rc = NomadsFetchVsi( pszUrl, pszPartFile );
 #else /* NOMADS_USE_VSI_READ */
-    rc = NomadsFetchHttp( psData->pszUrl, psData->pszFilename );
+        rc = NomadsFetchRange( pszUrl, pszPartFile );
 #endif /* NOMADS_USE_VSI_READ */
-    psData->nErr = rc;
+        if( rc == NOMADS_OK && NomadsCheckGrib( pszPartFile ) != NOMADS_OK )
+        {
+            /* Complete response, but not valid data.  Start over. */
+            VSIUnlink( pszPartFile );
+            rc = NOMADS_ERR;
+        }
+    }
+    if( rc == NOMADS_ERR_NO_DATA )
+    {
+        CPLDebug( "NOMADS", "No grib data at %s", pszUrl );
+        rc = NOMADS_ERR;
+    }
+
+    if( rc == NOMADS_OK )
+    {
+        if( pszCacheFile != NULL )
+        {
+            if( VSIRename( pszPartFile, pszCacheFile ) == 0 )
+            {
+                rc = NomadsCopyFile( pszCacheFile, pszFilename );
+            }
+            else
+            {
+                rc = NomadsCopyFile( pszPartFile, pszFilename );
+                VSIUnlink( pszPartFile );
+            }
+        }
+        else if( VSIRename( pszPartFile, pszFilename ) != 0 )
+        {
+            rc = NomadsCopyFile( pszPartFile, pszFilename );
+            VSIUnlink( pszPartFile );
+        }
+    }
+    else
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Failed to download file." );
+        /* Partial files in the cache are resumed by the next run. */
+        if( pszCacheFile == NULL )
+        {
+            VSIUnlink( pszPartFile );
+        }
+    }
+    CPLFree( (void*)pszCacheFile );
+    CPLFree( (void*)pszPartFile );
+    return rc;
+}
+
+/*
+** Download worker.  Takes the next file off the queue until the queue is
+** empty, a download fails, or the fetch is cancelled.
+*/
+static void NomadsFetchAsync( void *pData )
+{
+    NomadsFetchQueue *psQueue;
+    int i, rc;
+    psQueue = (NomadsFetchQueue*)pData;
+    for( ;; )
+    {
+        CPLAcquireMutex( psQueue->hMutex, 1000.0 );
+        if( psQueue->nNext >= psQueue->nFiles || psQueue->nErr ||
+            psQueue->bCancel )
+        {
+            CPLReleaseMutex( psQueue->hMutex );
+            break;
+        }
+        i = psQueue->nNext++;
+        CPLReleaseMutex( psQueue->hMutex );
+
+        rc = NomadsFetchFile( psQueue->papszUrls[i], psQueue->papszFiles[i] );
+
+        CPLAcquireMutex( psQueue->hMutex, 1000.0 );
+        psQueue->nDone++;
+        if( rc != NOMADS_OK )
+        {
+            psQueue->nErr = rc;
+        }
+        CPLReleaseMutex( psQueue->hMutex );
+    }
 }
 
 static double NomadsGetMinSize( const char **ppszModel )
@@ -458,14 +730,24 @@ static double NomadsGetMinSize( const char **ppszModel )
 **                             although it is probably unnecessary.  See
 **                             NOMADS_VSI_BLOCK_SIZE below.  If not enabled, a
 **                             single fetch is made for each file, which is
-**                             faster.
+**                             faster, and interrupted downloads are resumed
+**                             with HTTP range requests.
 ** Available runtime configuration options:
 **        NOMADS_THREAD_COUNT: Number of threads to use for downloads if
 **                             NOMADS_ENABLE_ASYNC is set to ON during
 **                             compilation.  Default is 4.
 **        NOMADS_VSI_BLOCK_SIZE: Number of bytes to request at a time when
 **                               downloading files if NOMADS_USE_VSI_READ is
-**                               set to ON during compilation. Default is 512.
+**                               set to ON during compilation. Default is 1 MB.
+**        NOMADS_MAX_RETRIES: Number of times to retry a failed file download
+**                            before stepping back a forecast run.  Partial
+**                            downloads are resumed.  Default is 3.
+**        NOMADS_CACHE_DIR: Directory to keep downloaded forecast files in.
+**                          Repeated fetches for the same forecast cycle,
+**                          files and bounding box are read from it instead
+**                          of the network.  Unset by default.
+**        NOMADS_URL_CGI: Base url of the grib filter cgi scripts, for
+**                        mirrors or testing.  Default is the NOMADS host.
 **        NOMADS_MAX_FCST_REWIND: Number of forecast run time steps to go back
 **                                to attempt to get a full time frame.
 **        GDAL_HTTP_TIMEOUT: Timeout for HTTP requests in seconds.  We should
@@ -542,7 +824,9 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
     double dfXMax, dfXMin, dfYMax, dfYMin;
     int nBufTries;
 
-    NomadsThreadData *pasData;
+#ifdef NOMADS_ENABLE_ASYNC
+    NomadsFetchQueue sQueue;
+#endif /* NOMADS_ENABLE_ASYNC */
     nomads_utc *ref, *end, *fcst;
     nrc = NOMADS_OK;
 
@@ -633,12 +917,10 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
         nThreads = 4;
     }
     pThreads = CPLMalloc( sizeof( void * ) * nThreads );
-    pasData = CPLMalloc( sizeof( NomadsThreadData ) * nThreads );
 #else /* NOMADS_ENABLE_ASYNC */
     /* Unused variables, set to null to so free is no-op */
     nThreads = 1;
     pThreads = NULL;
-    pasData = NULL;
 #endif /* NOMADS_ENABLE_ASYNC */
 
     fcst = NULL;
@@ -704,11 +986,7 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
         }
 
         /* Download one file and start over if it's not there. */
-#ifdef NOMADS_USE_VSI_READ
-        nrc = NomadsFetchVsi( papszDownloadUrls[0], papszOutputFiles[0] );
-#else /* NOMADS_USE_VSI_READ */
-        nrc = NomadsFetchHttp( papszDownloadUrls[0], papszOutputFiles[0] );
-#endif /* NOMADS_USE_VSI_READ */
+        nrc = NomadsFetchFile( papszDownloadUrls[0], papszOutputFiles[0] );
         if( nrc != NOMADS_OK )
         {
             CPLError( CE_Warning, CPLE_AppDefined,
@@ -717,12 +995,84 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
             nFcstTries++;
             CPLSleep( 1 );
             /*
-            ** Don't explicitly break here.  We'll skip the while loop because
-            ** nrc != NOMADS_OK, and we can clean up memory and shift times in
-            ** one spot to avoid duplicate code.
+            ** Don't explicitly break here.  We'll skip the downloads below
+            ** because nrc != NOMADS_OK, and we can clean up memory and shift
+            ** times in one spot to avoid duplicate code.
             */
         }
         /* Get the rest */
+#ifdef NOMADS_ENABLE_ASYNC
+        if( nrc == NOMADS_OK && nFilesToGet > 1 )
+        {
+            sQueue.papszUrls = papszDownloadUrls + 1;
+            sQueue.papszFiles = papszOutputFiles + 1;
+            sQueue.nFiles = nFilesToGet - 1;
+            sQueue.nNext = 0;
+            sQueue.nDone = 0;
+            sQueue.nErr = NOMADS_OK;
+            sQueue.bCancel = FALSE;
+            sQueue.hMutex = CPLCreateMutex();
+            CPLReleaseMutex( sQueue.hMutex );
+            k = nThreads < sQueue.nFiles ? nThreads : sQueue.nFiles;
+            for( t = 0; t < k; t++ )
+            {
+                pThreads[t] = CPLCreateJoinableThread( NomadsFetchAsync, &sQueue );
+            }
+            /*
+            ** Each worker takes the next file as soon as it is done with one,
+            ** so a slow file doesn't hold up the others.  Report progress and
+            ** watch for cancellation until they are done.
+            */
+            j = -1;
+            for( ;; )
+            {
+                CPLAcquireMutex( sQueue.hMutex, 1000.0 );
+                i = sQueue.nDone;
+                rc = sQueue.nErr;
+                CPLReleaseMutex( sQueue.hMutex );
+                if( i >= sQueue.nFiles || rc != NOMADS_OK )
+                {
+                    break;
+                }
+                if( pfnProgress && i != j )
+                {
+                    j = i;
+                    if( pfnProgress( (double)( i + 1 ) / nFilesToGet,
+                                     CPLSPrintf( "Downloading %s...",
+                                                 CPLGetFilename( sQueue.papszFiles[i] ) ),
+                                     NULL ) )
+                    {
+                        CPLError( CE_Failure, CPLE_UserInterrupt,
+                                  "Cancelled by user." );
+                        CPLAcquireMutex( sQueue.hMutex, 1000.0 );
+                        sQueue.bCancel = TRUE;
+                        CPLReleaseMutex( sQueue.hMutex );
+                        break;
+                    }
+                }
+                CPLSleep( 0.1 );
+            }
+            for( t = 0; t < k; t++ )
+            {
+                CPLJoinThread( pThreads[t] );
+            }
+            CPLDestroyMutex( sQueue.hMutex );
+            if( sQueue.bCancel )
+            {
+                nrc = NOMADS_ERR;
+                nFcstTries = nMaxFcstRewind;
+            }
+            else if( sQueue.nErr != NOMADS_OK )
+            {
+                nrc = sQueue.nErr;
+                CPLError( CE_Warning, CPLE_AppDefined,
+                          "Failed to download forecast, " \
+                          "stepping back one forecast run time step." );
+                nFcstTries++;
+                CPLSleep( 1 );
+            }
+        }
+#else /* NOMADS_ENABLE_ASYNC */
         i = 1;
         while( i < nFilesToGet && nrc == NOMADS_OK )
         {
@@ -740,54 +1090,8 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
                     break;
                 }
             }
-#ifdef NOMADS_ENABLE_ASYNC
-            k = i > nFilesToGet - nThreads ? (nFilesToGet - 1) % nThreads : nThreads;
-            for( t = 0; t < k; t++ )
-            {
-                pasData[t].pszUrl = papszDownloadUrls[i];
-                pasData[t].pszFilename = papszOutputFiles[i];
-                pThreads[t] =
-                    CPLCreateJoinableThread( NomadsFetchAsync, &pasData[t] );
-                i++;
-            }
-            for( t = 0; t < k; t++ )
-            {
-                CPLJoinThread( pThreads[t] );
-            }
-            for( t = 0; t < k; t++ )
-            {
-                if( pasData[t].nErr )
-                {
-                    CPLError( CE_Warning, CPLE_AppDefined,
-                              "Threaded download failed, attempting " \
-                              "serial download for %s",
-                              CPLGetFilename( pasData[t].pszFilename ) );
-                    /* Try again, serially though */
-                    if( CPLCheckForFile( (char *)pasData[t].pszFilename, NULL ) )
-                    {
-                        VSIUnlink( pasData[t].pszFilename );
-                    }
-#ifdef NOMADS_USE_VSI_READ
-                    rc = NomadsFetchVsi( pasData[t].pszUrl,
-                                         pasData[t].pszFilename );
-#else /* NOMADS_USE_VSI_READ */
-                    rc = NomadsFetchHttp( pasData[t].pszUrl,
-                                          pasData[t].pszFilename );
-#endif /* NOMADS_USE_VSI_READ */
-                    if( rc != NOMADS_OK )
-                    {
-                        nrc = rc;
-                    }
-                }
-            }
-#else /* NOMADS_ENABLE_ASYNC */
-#ifdef NOMADS_USE_VSI_READ
-            nrc = NomadsFetchVsi( papszDownloadUrls[i], papszOutputFiles[i] );
-#else /* NOMADS_USE_VSI_READ */
-            nrc = NomadsFetchHttp( papszDownloadUrls[i], papszOutputFiles[i] );
-#endif /* NOMADS_USE_VSI_READ */
+            nrc = NomadsFetchFile( papszDownloadUrls[i], papszOutputFiles[i] );
             i++;
-#endif /* NOMADS_ENABLE_ASYNC */
             if( nrc != NOMADS_OK )
             {
                 CPLError( CE_Warning, CPLE_AppDefined,
@@ -798,6 +1102,7 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
                 break;
             }
         }
+#endif /* NOMADS_ENABLE_ASYNC */
         /*
         ** XXX Cleanup XXX
         ** After each loop we can get rid of the urls, but we can only get rid
@@ -848,7 +1153,6 @@ int NomadsFetch( const char *pszModelKey, const char *pszRefTime,
         CPLUnlinkTree( pszTmpDir );
         CPLFree( (void*)pszTmpDir );
     }
-    CPLFree( (void*)pasData );
     CPLFree( (void**)pThreads );
 
     NomadsUtcFree( ref );
@@ -510,12 +510,21 @@ static const char *apszNomadsKeys[][11] =
       NULL }
 };
 
-typedef struct NomadsThreadData
+/*
+** Files shared by the download threads.  The counters and flags are
+** guarded by hMutex.
+*/
+typedef struct NomadsFetchQueue
 {
-    const char *pszUrl;
-    const char *pszFilename;
+    char **papszUrls;
+    char **papszFiles;
+    int nFiles;
+    int nNext;
+    int nDone;
     int nErr;
-} NomadsThreadData;
+    int bCancel;
+    void *hMutex;
+} NomadsFetchQueue;
 
 int NomadsFetch( const char *pszModelKey,  const char *pszRefTime, 
                  int nHours, int nStride, double *padfBbox,
@@ -523,6 +532,8 @@ int NomadsFetch( const char *pszModelKey,  const char *pszRefTime,
                  GDALProgressFunc pfnProgress );
 const char ** NomadsFindModel( const char *pszKey );
 
+int NomadsFetchFile( const char *pszUrl, const char *pszFilename );
+
 char * NomadsFormName( const char *pszKey, char pszSpacer );
 
 void NomadsFree( void *p );
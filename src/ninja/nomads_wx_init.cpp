@@ -28,6 +28,7 @@
  *****************************************************************************/
 
 #include "nomads_wx_init.h"
+#include "ColumnInterpolationPlan.h"
 
 int NomadsWxModel::CheckFileName( const char *pszFile, const char *pszFormat )
 {
@@ -502,9 +503,15 @@ void NomadsWxModel::setSurfaceGrids( WindNinjaInputs &input,
                                "requested time step" );
     }
 
-    hSrcDS = GDALOpenShared( pszForecastFile, GA_ReadOnly );
+    /*
+    ** Decoded forecasts are shared between runs, each run warps its own
+    ** in-memory copy.
+    */
+    std::string osForecastFile( pszForecastFile );
     CPLFree( (void*) pszForecastFile );
     pszForecastFile = NULL;
+    wxModelReader oReader( osForecastFile );
+    hSrcDS = (GDALDatasetH)oReader.GetDataset();
     nBandCount = GDALGetRasterCount( hSrcDS );
     hBand = GDALGetRasterBand( hSrcDS, 1 );
     dfNoData = GDALGetRasterNoDataValue( hBand, &bSuccess );
@@ -598,7 +605,6 @@ void NomadsWxModel::setSurfaceGrids( WindNinjaInputs &input,
             bHaveCloud = TRUE;
         }
     }
-    GDALClose( hSrcDS );
     GDALClose( hVrtDS );
     if( !bHaveCloud )
     {
@@ -609,8 +615,8 @@ void NomadsWxModel::setSurfaceGrids( WindNinjaInputs &input,
         ** and copy the cloud cover from the 1st time.  Issue a warning.
         **
         ** Note that GDAL handles thread safety *in* the GRIB driver by
-        ** acquiring a mutex in the driver.  We should be fine here, as long as
-        ** we use GDALOpenShared().
+        ** acquiring a mutex in the driver, and wxModelReader hands each
+        ** thread its own dataset.
         */
         if( bNeedNextCloud == TRUE )
         {
@@ -621,11 +627,12 @@ void NomadsWxModel::setSurfaceGrids( WindNinjaInputs &input,
             t = (timeList[1].utc_time() - epoch).total_seconds();
             pszNextFcst =
                 NomadsFindForecast( input.forecastFilename.c_str(), (time_t)t );
-            hSrcDS = GDALOpenShared( pszNextFcst, GA_ReadOnly );
-            if( hSrcDS == NULL )
+            if( pszNextFcst == NULL )
             {
                 throw badForecastFile( "Could not load cloud data." );
             }
+            wxModelReader oNextReader( pszNextFcst );
+            hSrcDS = (GDALDatasetH)oNextReader.GetDataset();
             pszSrcWkt = GDALGetProjectionRef( hSrcDS );
             hVrtDS = GDALAutoCreateWarpedVRT( hSrcDS, pszSrcWkt, pszDstWkt,
                                               GRA_NearestNeighbour, 1.0,
@@ -661,7 +668,6 @@ void NomadsWxModel::setSurfaceGrids( WindNinjaInputs &input,
                 cloudGrid.replaceNan( -9999.0 );
             }
             CPLFree( (void*)pszNextFcst );
-            GDALClose( hSrcDS );
             GDALClose( hVrtDS );
             CPLError( CE_Warning, CPLE_AppDefined, "Could not load cloud data "
                       "from 0th time step, using time step 1." );
@@ -963,11 +969,17 @@ void NomadsWxModel::set3dGrids( WindNinjaInputs &input, Mesh const& mesh )
     GDALClose( hDS );
     GDALClose( hVrtDS );
 
+    /* All four fields share wxMesh, so locate the WindNinja nodes once */
+    std::vector<wn_3dScalarField const *> srcFields;
+    std::vector<wn_3dScalarField *> dstFields;
     for( i = 0; i < 4; i++ )
     {
         fields[i]->allocate( &mesh );
-        wxFields[i]->interpolateScalarData((*(fields[i])), mesh, input);
+        srcFields.push_back( wxFields[i] );
+        dstFields.push_back( fields[i] );
     }
+    ColumnInterpolationPlan oPlan( wxMesh, mesh );
+    oPlan.apply( srcFields, dstFields );
 #endif /* NOMADS_ENABLE_3D */
     return;
 }
@@ -134,8 +134,8 @@ void pointInitialization::setInitializationGrids(WindNinjaInputs& input)
     input.inputWindHeight = maxStationHeight;  //for use later during vertical fill of 3D grid
     input.surface.Z = input.inputWindHeight;
 
-    airTempGrid.interpolateFromPoints(T, X, Y, influenceRadius, input.stationsScratch.size(), dfInvDistWeight);
-    cloudCoverGrid.interpolateFromPoints(cc, X, Y, influenceRadius, input.stationsScratch.size(), dfInvDistWeight);
+    interpolateFromStations(input, NinjaIncremental::airTempField, T, X, Y, influenceRadius, airTempGrid);
+    interpolateFromStations(input, NinjaIncremental::cloudCoverField, cc, X, Y, influenceRadius, cloudCoverGrid);
 
     //Check one grid to be sure that the interpolation completely filled the grid
     if(cloudCoverGrid.checkForNoDataValues())
@@ -302,8 +302,8 @@ void pointInitialization::setInitializationGrids(WindNinjaInputs& input)
         }
     }
 
-    uInitializationGrid.interpolateFromPoints(u, X, Y, influenceRadius, input.stationsScratch.size(), dfInvDistWeight);
-    vInitializationGrid.interpolateFromPoints(v, X, Y, influenceRadius, input.stationsScratch.size(), dfInvDistWeight);
+    interpolateFromStations(input, NinjaIncremental::uField, u, X, Y, influenceRadius, uInitializationGrid);
+    interpolateFromStations(input, NinjaIncremental::vField, v, X, Y, influenceRadius, vInitializationGrid);
 
     input.surface.windSpeedGrid.set_headerData(uInitializationGrid);
     input.surface.windGridExists = true;
@@ -356,3 +356,19 @@ void pointInitialization::setInitializationGrids(WindNinjaInputs& input)
     }
 }
 
+/**
+ * Interpolates station values onto a grid.  An incremental run reuses the
+ * weights of the previous run and only recomputes the cells reached by
+ * stations whose value changed.
+ */
+void pointInitialization::interpolateFromStations(WindNinjaInputs& input,
+        NinjaIncremental::eStationField field, double *values, double *X,
+        double *Y, double *influenceRadius, AsciiGrid<double>& grid)
+{
+    if(input.incremental != NULL)
+        input.incremental->Interpolate(field, values, X, Y, influenceRadius,
+                input.stationsScratch.size(), dfInvDistWeight, grid);
+    else
+        grid.interpolateFromPoints(values, X, Y, influenceRadius,
+                input.stationsScratch.size(), dfInvDistWeight);
+}
@@ -33,6 +33,7 @@
 
 #include "initialize.h"
 #include "cellDiurnal.h"
+#include "ninja_incremental.h"
 
 #include <limits>	//for large number
 
@@ -56,6 +57,10 @@ class pointInitialization : public initialize
     private:
 
         void setInitializationGrids(WindNinjaInputs& input);
+        void interpolateFromStations(WindNinjaInputs& input,
+                NinjaIncremental::eStationField field, double *values,
+                double *X, double *Y, double *influenceRadius,
+                AsciiGrid<double>& grid);
         double dfInvDistWeight;
 
 };
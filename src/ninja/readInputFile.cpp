@@ -29,6 +29,75 @@
 
 #include "ninja.h"
 
+/*
+** Reading a floating point source window with nearest neighbour decimation
+** requires GDALRasterIOExtraArg, added in GDAL 2.0.
+*/
+#ifdef GDAL_COMPUTE_VERSION
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(2,0,0)
+#define NINJA_DECIMATED_DEM_READ
+#endif /* GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(2,0,0) */
+#endif /* GDAL_COMPUTE_VERSION */
+
+#ifdef NINJA_DECIMATED_DEM_READ
+/*
+** Number of decimated rows read per RasterIO() call, about one source block
+** row, so every block is fetched once and buffers stay small.
+*/
+static int GetDecimatedStripRows( GDALDataset *poDataset, double dfRatio )
+{
+    int nBlockXSize, nBlockYSize;
+    poDataset->GetRasterBand( 1 )->GetBlockSize( &nBlockXSize, &nBlockYSize );
+    int nRows = (int)( nBlockYSize / dfRatio );
+    return nRows < 1 ? 1 : nRows;
+}
+
+/*
+** Read nStripRows rows, starting nStripOff rows from the top, of a grid with
+** cells dfRatio source cells wide from each band in panBandMap.  The grid is
+** anchored at the lower left corner of the source, like
+** AsciiGrid::resample_Grid_in_place(), and each cell takes the source cell
+** under its center, which is what order0 resampling does.  GDAL reads from
+** overviews when the source has them.
+*/
+static CPLErr ReadDecimatedStrip( GDALDataset *poDataset, double dfRatio,
+                                  int nBufXSize, int nBufYSize,
+                                  int nStripOff, int nStripRows,
+                                  int nBandCount, int *panBandMap,
+                                  GDALDataType eType, void *pData )
+{
+    int nSrcXSize = poDataset->GetRasterXSize();
+    int nSrcYSize = poDataset->GetRasterYSize();
+
+    GDALRasterIOExtraArg sExtraArg;
+    INIT_RASTERIO_EXTRA_ARG( sExtraArg );
+    sExtraArg.eResampleAlg = GRIORA_NearestNeighbour;
+    sExtraArg.bFloatingPointWindowValidity = TRUE;
+    sExtraArg.dfXOff = 0.0;
+    sExtraArg.dfYOff = nSrcYSize - ( nBufYSize - nStripOff ) * dfRatio;
+    if( sExtraArg.dfYOff < 0.0 )
+        sExtraArg.dfYOff = 0.0;
+    sExtraArg.dfXSize = nBufXSize * dfRatio;
+    sExtraArg.dfYSize = nStripRows * dfRatio;
+
+    int nYOff = (int)sExtraArg.dfYOff;
+    int nXSize = (int)ceil( sExtraArg.dfXSize );
+    int nYSize = (int)ceil( sExtraArg.dfYOff + sExtraArg.dfYSize ) - nYOff;
+    if( nXSize > nSrcXSize )
+        nXSize = nSrcXSize;
+    if( nYOff + nYSize > nSrcYSize )
+        nYSize = nSrcYSize - nYOff;
+    if( sExtraArg.dfXSize > nXSize )
+        sExtraArg.dfXSize = nXSize;
+    if( sExtraArg.dfYOff + sExtraArg.dfYSize > nSrcYSize )
+        sExtraArg.dfYSize = nSrcYSize - sExtraArg.dfYOff;
+
+    return poDataset->RasterIO( GF_Read, 0, nYOff, nXSize, nYSize, pData,
+                                nBufXSize, nStripRows, eType,
+                                nBandCount, panBandMap, 0, 0, 0, &sExtraArg );
+}
+#endif /* NINJA_DECIMATED_DEM_READ */
+
 /**
  * Read in the input file.  DEM files are read in and one band is imported.
  * LCP files use elevation and fuel model information or canopy height
@@ -50,6 +119,33 @@ void ninja::readInputFile(std::string file)
  *
  */
 void ninja::readInputFile()
+{
+    importInputFile(false);
+}
+
+/**
+ * Read in the input file directly at the horizontal mesh resolution.
+ *
+ * When the mesh is coarser than the DEM, the elevation (and LCP surface
+ * bands) are decimated while reading instead of being read at full
+ * resolution and coarsened in Mesh::buildStandardMesh().  The result is the
+ * same order0 resampled, buffered grid the mesh would build.  Finer meshes,
+ * and GDAL versions without floating point RasterIO() windows, fall back to
+ * readInputFile().
+ *
+ */
+void ninja::readInputFileAtMeshResolution()
+{
+    importInputFile(true);
+}
+
+/**
+ * Open the input file and import it, optionally at the mesh resolution.
+ *
+ * @param atMeshResolution decimate the input to the mesh resolution if it is
+ *                         coarser than the input.
+ */
+void ninja::importInputFile(bool atMeshResolution)
 {
     GDALDataset *poDataset;
 
@@ -74,14 +170,34 @@ void ninja::readInputFile()
         input.dem.set_prjString(GDALProjRef);
     }
 
-    if(GDALDriverName == "LCP")
-        importLCP(poDataset);
-    else
-        importSingleBand(poDataset);
+    double targetCellSize = -1.0;
+    if(atMeshResolution)
+        targetCellSize = get_importCellSize(poDataset);
+
+    try
+    {
+        if(GDALDriverName == "LCP")
+            importLCP(poDataset, targetCellSize);
+        else
+            importSingleBand(poDataset, targetCellSize);
+    }
+    catch(...)
+    {
+        GDALClose((GDALDatasetH)poDataset);
+        throw;
+    }
 
     if(poDataset)
         GDALClose((GDALDatasetH)poDataset);
 
+    //make sure grid at least covers the original domain, as the mesh does
+    if(targetCellSize > 0.0)
+    {
+        input.dem.BufferGridInPlace();
+        if(GDALDriverName == "LCP")
+            input.surface.BufferGridInPlace();
+    }
+
     if( input.dem.checkForNoDataValues() )
         throw std::runtime_error("NO_DATA values found in elevation file.");
     if(GDALDriverName == "LCP") {
@@ -91,12 +207,54 @@ void ninja::readInputFile()
     }
 }
 
+/**
+ * Cell size to import the input file at.  The mesh resolution is computed
+ * from the input header here if it has not been set.
+ *
+ * @param poDataset source dataset
+ * @return the mesh resolution if the input should be decimated to it while
+ *         reading, otherwise -1.
+ */
+double ninja::get_importCellSize(GDALDataset *poDataset)
+{
+#ifdef NINJA_DECIMATED_DEM_READ
+    double adfGeoTransform[6];
+    if(poDataset->GetGeoTransform(adfGeoTransform) != CE_None)
+        return -1.0;
+
+    //rectangular cells are reported by the full resolution import
+    double cS = fabs(adfGeoTransform[1]);
+    if(!areEqual(cS, fabs(adfGeoTransform[5]), 100000))
+        return -1.0;
+
+    int nC = poDataset->GetRasterXSize();
+    int nR = poDataset->GetRasterYSize();
+
+    if(mesh.meshResolution < 0.0)
+        mesh.compute_cellsize(nC, nR, cS);
+
+    //refining uses order1 on the full grid, too coarse is reported by the mesh
+    double shortSide = (nC < nR ? nC : nR) * cS;
+    if(mesh.meshResolution <= cS || mesh.meshResolution > shortSide)
+        return -1.0;
+
+    CPLDebug("NINJA", "Importing %dx%d input at %g m, ratio %g",
+             nC, nR, mesh.meshResolution, mesh.meshResolution / cS);
+
+    return mesh.meshResolution;
+#else
+    return -1.0;
+#endif /* NINJA_DECIMATED_DEM_READ */
+}
+
 /**
  * Read in an lcp file and extract elevation and fuel information
  *
  * @param poDataset source dataset
+ * @param targetCellSize if greater than the lcp cell size, decimate all
+ *                       bands to this cell size in a single pass.
  */
-void ninja::importLCP(GDALDataset *poDataset)
+void ninja::importLCP(GDALDataset *poDataset, double targetCellSize)
 {
     const char *szTemp;
     int nTemp;
@@ -186,19 +344,36 @@ void ninja::importLCP(GDALDataset *poDataset)
     else if(nTemp == 1)
         elevUnit = lengthUnits::feet;
 
+#ifdef NINJA_DECIMATED_DEM_READ
+    bool decimate = targetCellSize > cS;
+#else
+    bool decimate = false;
+#endif
+    double dfRatio = 1.0;
+    if(decimate)
+    {
+        dfRatio = targetCellSize / cS;
+        nC = int(nC * cS / targetCellSize);
+        nR = int(nR * cS / targetCellSize);
+        cS = targetCellSize;
+    }
+
     //sets poData size too.
     input.dem.set_headerData(nC, nR, xL, yL, cS, nDV, nDV, input.dem.prjString);
 
     //read in value at i, j and set dem value.
-    double *padfScanline;
-    padfScanline = new double[nC];
-    for(int i = nR - 1;i >= 0;i--) 
+    double *padfScanline = NULL;
+    if(!decimate)
     {
-        poBand->RasterIO(GF_Read, 0, i, nC, 1, padfScanline, nC, 1,
-                 GDT_Float64, 0, 0);
-        for(int j = 0;j < nC;j++)
+        padfScanline = new double[nC];
+        for(int i = nR - 1;i >= 0;i--) 
         {
-            input.dem.set_cellValue(nR - 1 - i, j, padfScanline[j]);
+            poBand->RasterIO(GF_Read, 0, i, nC, 1, padfScanline, nC, 1,
+                     GDT_Float64, 0, 0);
+            for(int j = 0;j < nC;j++)
+            {
+                input.dem.set_cellValue(nR - 1 - i, j, padfScanline[j]);
+            }
         }
     }
 
@@ -255,6 +430,54 @@ void ninja::importLCP(GDALDataset *poDataset)
     //set fuel bed depth units
     lengthUnits::eLengthUnits fDepthUnits = lengthUnits::meters;
 
+#ifdef NINJA_DECIMATED_DEM_READ
+    if(decimate)
+    {
+        /*
+         * Read elevation, fuel model, canopy cover and canopy height in one
+         * pass, a strip of decimated rows at a time.
+         */
+        int anBandMap[4] = {1, 4, 5, 6};
+        int nBandCount = hasCrownFuels ? 4 : 3;
+        int nStripRows = GetDecimatedStripRows(poDataset, dfRatio);
+        std::vector<double> adfStrip((size_t)nC * nStripRows * nBandCount);
+        for(int nStripOff = 0;nStripOff < nR;nStripOff += nStripRows)
+        {
+            int nRows = nStripRows;
+            if(nStripOff + nRows > nR)
+                nRows = nR - nStripOff;
+            size_t nBandSize = (size_t)nC * nRows;
+            if(ReadDecimatedStrip(poDataset, dfRatio, nC, nR, nStripOff, nRows,
+                                  nBandCount, anBandMap, GDT_Float64,
+                                  &(adfStrip[0])) != CE_None)
+            {
+                throw std::runtime_error("Failed to read the .lcp file in " \
+                                         "ninja::importLCP().");
+            }
+            for(int r = 0;r < nRows;r++)
+            {
+                //r counts from the top, the dem from the bottom
+                int i = nStripOff + r;
+                for(int j = 0;j < nC;j++)
+                {
+                    size_t k = (size_t)r * nC + j;
+                    input.dem.set_cellValue(nR - 1 - i, j, adfStrip[k]);
+                    int nFuel = (int)adfStrip[nBandSize + k];
+                    int nHeight = hasCrownFuels ? (int)adfStrip[3 * nBandSize + k] : 15;
+                    computeSurfPropForCell(i, j, nHeight,
+                                           cHeightUnits,
+                                           (double)(int)adfStrip[2 * nBandSize + k],
+                                           cCoverUnits,
+                                           nFuel,
+                                           getFuelBedDepth(nFuel),
+                                           fDepthUnits);
+                }
+            }
+        }
+        return;
+    }
+#endif /* NINJA_DECIMATED_DEM_READ */
+
     //read in data for the other bands, on scanline at a time, and set rough
     int *panScanlineFuelM = new int [nC];
     int *panScanlineCanopyH = new int [nC];
@@ -314,8 +537,10 @@ void ninja::importLCP(GDALDataset *poDataset)
  * Import elevation data from a single band input file
  *
  * @param poDataset source dataset
+ * @param targetCellSize if greater than the input cell size, decimate the
+ *                       elevation to this cell size while reading.
  */
-void ninja::importSingleBand(GDALDataset *poDataset)
+void ninja::importSingleBand(GDALDataset *poDataset, double targetCellSize)
 {
     int nC, nR;
     double cS, nDV;
@@ -353,6 +578,42 @@ void ninja::importSingleBand(GDALDataset *poDataset)
     if(hasNdv == FALSE)
         nDV = -9999.0;
 
+#ifdef NINJA_DECIMATED_DEM_READ
+    if(targetCellSize > cS)
+    {
+        double dfRatio = targetCellSize / cS;
+        nC = int(nC * cS / targetCellSize);
+        nR = int(nR * cS / targetCellSize);
+        input.dem.set_headerData(nC, nR, xL, yL, targetCellSize, nDV, nDV,
+                                 input.dem.prjString);
+
+        int nBand = 1;
+        int nStripRows = GetDecimatedStripRows(poDataset, dfRatio);
+        std::vector<double> adfStrip((size_t)nC * nStripRows);
+        for(int nStripOff = 0;nStripOff < nR;nStripOff += nStripRows)
+        {
+            int nRows = nStripRows;
+            if(nStripOff + nRows > nR)
+                nRows = nR - nStripOff;
+            if(ReadDecimatedStrip(poDataset, dfRatio, nC, nR, nStripOff, nRows,
+                                  1, &nBand, GDT_Float64, &(adfStrip[0])) != CE_None)
+            {
+                throw std::runtime_error("Failed to read the input file in " \
+                                         "ninja::importSingleBand().");
+            }
+            for(int r = 0;r < nRows;r++)
+            {
+                for(int j = 0;j < nC;j++)
+                {
+                    input.dem.set_cellValue(nR - 1 - (nStripOff + r), j,
+                                            adfStrip[(size_t)r * nC + j]);
+                }
+            }
+        }
+        return;
+    }
+#endif /* NINJA_DECIMATED_DEM_READ */
+
     //assign values in Elevation dem from dataset
     input.dem.set_headerData(nC, nR, xL, yL, cS, nDV, nDV, input.dem.prjString);
 
@@ -389,3 +650,50 @@ void ninja::setSurfaceGrids()
     input.surface.Anthropogenic.set_headerData(input.dem);
 }
 
+
+/**
+ * Replace the uniform vegetation roughness with the supplied surface grids.
+ * The grids are sampled at the cell centers of the elevation grid, so they
+ * may have any resolution, and no data cells keep the vegetation value.
+ *
+ */
+void ninja::importSurfaceGrids()
+{
+    GDALDataset *poDataset;
+    poDataset = (GDALDataset*)GDALOpen(input.surfaceGridsFilename.c_str(), GA_ReadOnly);
+    if(poDataset == NULL)
+        throw std::runtime_error("Cannot open surface grids for reading in ninja::importSurfaceGrids().");
+
+    AsciiGrid<double> *apoGrids[3] = { &input.surface.Roughness,
+                                       &input.surface.Rough_h,
+                                       &input.surface.Rough_d };
+    int nBands = poDataset->GetRasterCount();
+    for(int b = 0; b < 3 && b < nBands; b++)
+    {
+        AsciiGrid<double> srcGrid;
+        if(!GDAL2AsciiGrid(poDataset, b + 1, srcGrid))
+        {
+            GDALClose((GDALDatasetH)poDataset);
+            throw std::runtime_error("Failed to read surface grids in ninja::importSurfaceGrids().");
+        }
+        AsciiGrid<double> dstGrid(*apoGrids[b]);
+        dstGrid.interpolateFromGrid(srcGrid, AsciiGrid<double>::order0);
+        for(int i = 0; i < dstGrid.get_nRows(); i++)
+        {
+            for(int j = 0; j < dstGrid.get_nCols(); j++)
+            {
+                double value = dstGrid(i, j);
+                if(value == dstGrid.get_noDataValue())
+                    continue;
+                //roughness must stay positive, the heights may be zero
+                if(value < 0.0 || (b == 0 && value == 0.0))
+                {
+                    GDALClose((GDALDatasetH)poDataset);
+                    throw std::range_error("Surface roughness out of range in ninja::importSurfaceGrids().");
+                }
+                (*apoGrids[b])(i, j) = value;
+            }
+        }
+    }
+    GDALClose((GDALDatasetH)poDataset);
+}
@@ -187,9 +187,15 @@ SURF_FETCH_E ReliefFetch::FetchBoundingBox( double *bbox, double resolution,
     GDALSetProjection(hDstDS, pszDstWKT);
     GDALSetGeoTransform(hDstDS, adfDstGeoTransform);
 
+    /* warp from cached tiles of the source if the cache is enabled */
+    GDALDatasetH hCacheDS = OpenCachedSource(hSrcDS, pszDstWKT,
+                                             adfDstGeoTransform,
+                                             nPixels, nLines);
+    GDALDatasetH hWarpSrcDS = hCacheDS != NULL ? hCacheDS : hSrcDS;
+
     GDALWarpOptions *psWarpOptions = GDALCreateWarpOptions();
 
-    psWarpOptions->hSrcDS = hSrcDS;
+    psWarpOptions->hSrcDS = hWarpSrcDS;
     psWarpOptions->hDstDS = hDstDS;
 
     psWarpOptions->nBandCount = 1;
@@ -201,7 +207,7 @@ SURF_FETCH_E ReliefFetch::FetchBoundingBox( double *bbox, double resolution,
     psWarpOptions->panDstBands[0] = 1;
 
     psWarpOptions->pTransformerArg = 
-        GDALCreateGenImgProjTransformer( hSrcDS, 
+        GDALCreateGenImgProjTransformer( hWarpSrcDS, 
                                          GDALGetProjectionRef(hSrcDS), 
                                          hDstDS,
                                          GDALGetProjectionRef(hDstDS), 
@@ -220,6 +226,10 @@ SURF_FETCH_E ReliefFetch::FetchBoundingBox( double *bbox, double resolution,
 
     GDALDestroyGenImgProjTransformer( psWarpOptions->pTransformerArg );
     GDALDestroyWarpOptions( psWarpOptions );
+    if( hCacheDS != NULL )
+    {
+        GDALClose( hCacheDS );
+    }
 
     if( eErr != CE_None )
     {
@@ -27,8 +27,23 @@
  *
  *****************************************************************************/
 
+
 #include "stl_create.h"
 
+#include <vector>
+
+/* bytes in a binary facet: normal, three vertices, attribute count */
+#define STL_FACET_SIZE 50
+
+/* rows of facets generated and written at a time */
+#define STL_CHUNK_BYTES (16 * 1024 * 1024)
+
+typedef struct _StlFacet
+{
+    StlPosition n;
+    StlPosition v[3];
+} StlFacet;
+
 static StlPosition StlComputeNormal( StlPosition *v1,  StlPosition *v2 )
 {
      float norm_factor = 0;
@@ -47,6 +62,85 @@ static StlPosition StlComputeNormal( StlPosition *v1,  StlPosition *v2 )
      return norm;
 }
 
+/*
+** Triangulate one row of cells, two facets per cell.  Cell centers are the
+** vertices.  Vertices are set in one pass and the normals in a second pass
+** over the contiguous facets.
+*/
+static void StlBuildRow( const float *pafRow, const float *pafNextRow,
+                         const float *pafX, float fY, float fNextY,
+                         int nCols, double dfOffset, StlFacet *pasFacets )
+{
+    StlPosition a, b, c, d;
+    for( int j = 0; j < nCols - 1; j++ )
+    {
+        a.x = pafX[j];
+        a.y = fY;
+        a.z = pafRow[j] + dfOffset;
+
+        b.x = pafX[j + 1];
+        b.y = a.y;
+        b.z = pafRow[j + 1] + dfOffset;
+
+        c.x = a.x;
+        c.y = fNextY;
+        c.z = pafNextRow[j] + dfOffset;
+
+        d.x = b.x;
+        d.y = c.y;
+        d.z = pafNextRow[j + 1] + dfOffset;
+
+        StlFacet *psFacet = pasFacets + 2 * j;
+        psFacet[0].v[0] = b;
+        psFacet[0].v[1] = a;
+        psFacet[0].v[2] = c;
+        psFacet[1].v[0] = d;
+        psFacet[1].v[1] = b;
+        psFacet[1].v[2] = c;
+    }
+
+    StlPosition v1, v2;
+    for( int k = 0; k < 2 * ( nCols - 1 ); k++ )
+    {
+        StlPosition *pv = pasFacets[k].v;
+        /* the apex is a for the first facet of a cell and d for the second */
+        StlPosition *apex = ( k % 2 == 0 ) ? &pv[1] : &pv[0];
+        StlPosition *p = ( k % 2 == 0 ) ? &pv[2] : &pv[1];
+        StlPosition *q = ( k % 2 == 0 ) ? &pv[0] : &pv[2];
+
+        v1.x = p->x - apex->x;
+        v1.y = p->y - apex->y;
+        v1.z = p->z - apex->z;
+
+        v2.x = q->x - apex->x;
+        v2.y = q->y - apex->y;
+        v2.z = q->z - apex->z;
+
+        pasFacets[k].n = StlComputeNormal( &v1, &v2 );
+    }
+}
+
+/*
+** Pack facets into little endian binary STL records.
+*/
+static void StlPackFacets( const StlFacet *pasFacets, int nFacets,
+                           GByte *pabyOut )
+{
+    for( int k = 0; k < nFacets; k++ )
+    {
+        GByte *pabyRec = pabyOut + (size_t)k * STL_FACET_SIZE;
+        memcpy( pabyRec, pasFacets + k, 12 * sizeof( float ) );
+#ifdef CPL_MSB
+        for( int n = 0; n < 12; n++ )
+        {
+            CPL_SWAP32PTR( pabyRec + n * sizeof( float ) );
+        }
+#endif
+        pabyRec[48] = 0;
+        pabyRec[49] = 0;
+    }
+}
+
 /**
  * \brief Create an STL representation of an elevation grid.
  *
@@ -69,6 +163,40 @@ CPLErr NinjaElevationToStl( const char *pszInput,
                             NinjaStlType eType,
                             double dfOffset,
                             GDALProgressFunc pfnProgress )
+{
+    return NinjaElevationToStlSurfaces( pszInput, nBand, dfTargetCellSize,
+                                        eType, 1, &pszOutput, &dfOffset,
+                                        pfnProgress );
+}
+
+/**
+ * \brief Create STL representations of an elevation grid at several heights.
+ *
+ * The grid is read once and each surface is the terrain translated up by
+ * its offset, so a ground surface and a sampling surface at the output wind
+ * height come from one read without transforming the first afterwards.
+ * Binary facets are built in parallel a block of rows at a time and
+ * written with one write per block.
+ *
+ * \param pszInput file to read and convert
+ * \param nBand band to treat as elevation
+ * \param dfTargetCellSize the absolute resolution for dx/dy in DEM units.  Any
+ *        value <= 0.0 is native resolution.
+ * \param eType type of stl file to create, ascii or binary.
+ * \param nSurfaces number of files to write
+ * \param papszOutputs files to write (stl)
+ * \param padfOffsets the offset for the z value of each file
+ * \param pfnProgress a pointer to a progress function
+ * \return zero on success, non-zero otherwise
+ */
+CPLErr NinjaElevationToStlSurfaces( const char *pszInput,
+                                    int nBand,
+                                    double dfTargetCellSize,
+                                    NinjaStlType eType,
+                                    int nSurfaces,
+                                    const char * const *papszOutputs,
+                                    const double *padfOffsets,
+                                    GDALProgressFunc pfnProgress )
 {
     GDALDatasetH hDS;
     GDALRasterBandH hBand;
@@ -77,14 +205,16 @@ CPLErr NinjaElevationToStl( const char *pszInput,
     int nXSize, nYSize, nBandCount;
     float *pafScanline;
     unsigned int nTriCount;
-    unsigned short nAttrCount;
 
     int nOutXSize, nOutYSize;
 
-    FILE *fout;
-
-    VALIDATE_POINTER1( pszInput, "NinjaElevationToStl()", CE_Failure );
-    VALIDATE_POINTER1( pszOutput, "NinjaElevationToStl()", CE_Failure );
+    VALIDATE_POINTER1( pszInput, "NinjaElevationToStlSurfaces()", CE_Failure );
+    VALIDATE_POINTER1( papszOutputs, "NinjaElevationToStlSurfaces()", CE_Failure );
+    VALIDATE_POINTER1( padfOffsets, "NinjaElevationToStlSurfaces()", CE_Failure );
+    for( int s = 0; s < nSurfaces; s++ )
+    {
+        VALIDATE_POINTER1( papszOutputs[s], "NinjaElevationToStlSurfaces()", CE_Failure );
+    }
 
     if( nBand < 1 )
     {
@@ -129,21 +259,6 @@ CPLErr NinjaElevationToStl( const char *pszInput,
         return CE_Failure;
     }
 
-    if( eType == NinjaStlBinary )
-    {
-        fout = fopen( pszOutput, "wb" );
-    }
-    else
-    {
-        fout = fopen( pszOutput, "w" );
-    }
-    if( fout == NULL )
-    {
-        CPLError( CE_Failure, CPLE_AppDefined,
-                  "Failed to open output file" );
-        GDALClose( hDS );
-        return CE_Failure;
-    }
     if( dfTargetCellSize <= 0.0 )
     {
         nOutXSize = nXSize;
@@ -158,167 +273,165 @@ CPLErr NinjaElevationToStl( const char *pszInput,
         dfXRes = dfTargetCellSize;
         dfYRes = -dfTargetCellSize;
     }
+    if( nOutXSize < 2 || nOutYSize < 2 )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Elevation grid is too small to triangulate" );
+        GDALClose( hDS );
+        return CE_Failure;
+    }
     float fXOffset, fYOffset;
     fXOffset = adfGeoTransform[1] * 0.5;
     fYOffset = adfGeoTransform[5] * 0.5;
 
-    char nil[80];
-    memset( nil, '\0', 80 );
-
     nTriCount = (nOutXSize-1) * (nOutYSize-1) * 2; //cell centers are vertices
-    nAttrCount = 0;
-
 
-    pafScanline = (float*)VSIMalloc3( nXSize, nYSize, sizeof( float ) );
+    pafScanline = (float*)VSIMalloc3( nOutXSize, nOutYSize, sizeof( float ) );
     if( pafScanline == NULL )
     {
         CPLError( CE_Failure, CPLE_OutOfMemory,
                   "Could not allocate buffer" );
         GDALClose( hDS );
-        fclose( fout );
         return CE_Failure;
     }
 
-    CPLErr eErr = CE_None;
-    int i, j;
-    StlPosition a, b, c, d;
-    StlPosition v1, v2, norm;
-    if( eType == NinjaStlBinary )
-    {
-        fwrite( nil, 1, 80, fout );
-        fwrite( &nTriCount, sizeof( unsigned int ), 1, fout );
-    }
-    else
-    {
-        fprintf( fout, "solid NAME\n" );
-    }
     if( pfnProgress )
     {
         pfnProgress( 0.0, NULL, NULL );
     }
+    CPLErr eErr = CE_None;
     eErr = GDALRasterIO( hBand, GF_Read, 0, 0, nXSize, nYSize,
                          pafScanline, nOutXSize, nOutYSize, GDT_Float32, 0, 0 );
+    GDALClose( hDS );
     if( eErr != CE_None )
     {
         CPLFree( pafScanline );
-        GDALClose( hDS );
         return eErr;
     }
-    for( i = 0 ; i < nOutYSize - 1; i++ )
-    {
-        for( j = 0; j < nOutXSize - 1; j++ )
-        {
-            a.x = adfGeoTransform[0] + j * dfXRes + fXOffset;
-            a.y = adfGeoTransform[3] + i * dfYRes + fYOffset;
-            a.z = pafScanline[j+i*nOutXSize] + dfOffset;
-
-            b.x = adfGeoTransform[0] + ( j + 1 ) * dfXRes + fXOffset;
-            b.y = a.y;
-            b.z = pafScanline[(j+i*nOutXSize) + 1] + dfOffset;
 
-            c.x = a.x;
-            c.y = adfGeoTransform[3] + ( i + 1 ) * dfYRes + fYOffset;
-            c.z = pafScanline[(j+i*nOutXSize) + nOutXSize] + dfOffset;
-
-            d.x = b.x;
-            d.y = c.y;
-            d.z = pafScanline[(j+i*nOutXSize) + nOutXSize + 1] + dfOffset;
-
-            v1.x = c.x - a.x;
-            v1.y = c.y - a.y;
-            v1.z = c.z - a.z;
-
-            v2.x = b.x - a.x;
-            v2.y = b.y - a.y;
-            v2.z = b.z - a.z;
-
-            norm = StlComputeNormal( &v1, &v2 );
+    /* cell center coordinates of every column and row */
+    std::vector<float> afX( nOutXSize ), afY( nOutYSize );
+    for( int j = 0; j < nOutXSize; j++ )
+    {
+        afX[j] = adfGeoTransform[0] + j * dfXRes + fXOffset;
+    }
+    for( int i = 0; i < nOutYSize; i++ )
+    {
+        afY[i] = adfGeoTransform[3] + i * dfYRes + fYOffset;
+    }
 
-            if( eType == NinjaStlBinary )
-            {
-                fwrite( &norm.x, sizeof( float ), 1, fout );
-                fwrite( &norm.y, sizeof( float ), 1, fout );
-                fwrite( &norm.z, sizeof( float ), 1, fout );
-                fwrite( &b.x, sizeof( float ), 1, fout );
-                fwrite( &b.y, sizeof( float ), 1, fout );
-                fwrite( &b.z, sizeof( float ), 1, fout );
-                fwrite( &a.x, sizeof( float ), 1, fout );
-                fwrite( &a.y, sizeof( float ), 1, fout );
-                fwrite( &a.z, sizeof( float ), 1, fout );
-                fwrite( &c.x, sizeof( float ), 1, fout );
-                fwrite( &c.y, sizeof( float ), 1, fout );
-                fwrite( &c.z, sizeof( float ), 1, fout );
-                fwrite( &nAttrCount, sizeof( unsigned short ), 1, fout );
-            }
-            else
-            {
-                fprintf( fout, "facet normal %e %e %e\n",
-                             norm.x, norm.y, norm.z );
-
-                fprintf( fout, "    outer loop\n" );
-                fprintf( fout, "        vertex %e %e %e\n", b.x, b.y, b.z );
-                fprintf( fout, "        vertex %e %e %e\n", a.x, a.y, a.z );
-                fprintf( fout, "        vertex %e %e %e\n", c.x, c.y, c.z );
-                fprintf( fout, "    endloop\n" );
-                fprintf( fout, "endfacet\n" );
-            }
+    const int nRowFacets = 2 * ( nOutXSize - 1 );
+    const size_t nRowBytes = (size_t)nRowFacets * STL_FACET_SIZE;
+    int nChunkRows = (int)( STL_CHUNK_BYTES / nRowBytes );
+    nChunkRows = nChunkRows < 1 ? 1 : nChunkRows;
+    const int nRows = nOutYSize - 1;
 
-            v1.x = b.x - d.x;
-            v1.y = b.y - d.y;
-            v1.z = b.z - d.z;
+    std::vector<GByte> abyChunk;
+    std::vector<StlFacet> asFacets;
+    if( eType == NinjaStlBinary )
+    {
+        abyChunk.resize( nRowBytes * ( nChunkRows < nRows ? nChunkRows : nRows ) );
+    }
+    else
+    {
+        asFacets.resize( nRowFacets );
+    }
 
-            v2.x = c.x - d.x;
-            v2.y = c.y - d.y;
-            v2.z = c.z - d.z;
+    for( int s = 0; s < nSurfaces && eErr == CE_None; s++ )
+    {
+        const double dfOffset = padfOffsets[s];
+        VSILFILE *fout = VSIFOpenL( papszOutputs[s],
+                                    eType == NinjaStlBinary ? "wb" : "w" );
+        if( fout == NULL )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Failed to open output file" );
+            eErr = CE_Failure;
+            break;
+        }
 
-            norm = StlComputeNormal( &v1, &v2 );
-            if( eType == NinjaStlBinary )
-            {
-                fwrite( &norm.x, sizeof( float ), 1, fout );
-                fwrite( &norm.y, sizeof( float ), 1, fout );
-                fwrite( &norm.z, sizeof( float ), 1, fout );
-                fwrite( &d.x, sizeof( float ), 1, fout );
-                fwrite( &d.y, sizeof( float ), 1, fout );
-                fwrite( &d.z, sizeof( float ), 1, fout );
-                fwrite( &b.x, sizeof( float ), 1, fout );
-                fwrite( &b.y, sizeof( float ), 1, fout );
-                fwrite( &b.z, sizeof( float ), 1, fout );
-                fwrite( &c.x, sizeof( float ), 1, fout );
-                fwrite( &c.y, sizeof( float ), 1, fout );
-                fwrite( &c.z, sizeof( float ), 1, fout );
-                fwrite( &nAttrCount, sizeof( unsigned short ), 1, fout );
-            }
-            else
+        if( eType == NinjaStlBinary )
+        {
+            char nil[80];
+            memset( nil, '\0', 80 );
+            GUInt32 nLECount = nTriCount;
+            CPL_LSBPTR32( &nLECount );
+            VSIFWriteL( nil, 1, 80, fout );
+            VSIFWriteL( &nLECount, sizeof( GUInt32 ), 1, fout );
+
+            for( int iStart = 0; iStart < nRows; iStart += nChunkRows )
             {
-                fprintf( fout, "facet normal %e %e %e\n",
-                            norm.x, norm.y, norm.z );
-
-                fprintf( fout, "    outer loop\n" );
-                fprintf( fout, "        vertex %e %e %e\n", d.x, d.y, d.z );
-                fprintf( fout, "        vertex %e %e %e\n", b.x, b.y, b.z );
-                fprintf( fout, "        vertex %e %e %e\n", c.x, c.y, c.z );
-                fprintf( fout, "    endloop\n" );
-                fprintf( fout, "endfacet\n" );
+                const int nChunk = ( iStart + nChunkRows < nRows ) ? nChunkRows
+                                                                   : nRows - iStart;
+#pragma omp parallel
+                {
+                    std::vector<StlFacet> asRow( nRowFacets );
+#pragma omp for schedule(static)
+                    for( int i = iStart; i < iStart + nChunk; i++ )
+                    {
+                        StlBuildRow( pafScanline + (size_t)i * nOutXSize,
+                                     pafScanline + (size_t)( i + 1 ) * nOutXSize,
+                                     &afX[0], afY[i], afY[i + 1], nOutXSize,
+                                     dfOffset, &asRow[0] );
+                        StlPackFacets( &asRow[0], nRowFacets,
+                                       &abyChunk[0] + (size_t)( i - iStart ) * nRowBytes );
+                    }
+                }
+                size_t nBytes = (size_t)nChunk * nRowBytes;
+                if( VSIFWriteL( &abyChunk[0], 1, nBytes, fout ) != nBytes )
+                {
+                    CPLError( CE_Failure, CPLE_FileIO,
+                              "Failed to write %s", papszOutputs[s] );
+                    eErr = CE_Failure;
+                    break;
+                }
+                if( pfnProgress )
+                {
+                    pfnProgress( ( s + (double)( iStart + nChunk ) / nRows ) / nSurfaces,
+                                 NULL, NULL );
+                }
             }
         }
-        if( pfnProgress )
+        else
         {
-            pfnProgress( double(i) / (double)nYSize, NULL, NULL );
+            VSIFPrintfL( fout, "solid NAME\n" );
+            for( int i = 0; i < nRows; i++ )
+            {
+                StlBuildRow( pafScanline + (size_t)i * nOutXSize,
+                             pafScanline + (size_t)( i + 1 ) * nOutXSize,
+                             &afX[0], afY[i], afY[i + 1], nOutXSize,
+                             dfOffset, &asFacets[0] );
+                for( int k = 0; k < nRowFacets; k++ )
+                {
+                    const StlFacet &f = asFacets[k];
+                    VSIFPrintfL( fout, "facet normal %e %e %e\n",
+                                 f.n.x, f.n.y, f.n.z );
+                    VSIFPrintfL( fout, "    outer loop\n" );
+                    for( int n = 0; n < 3; n++ )
+                    {
+                        VSIFPrintfL( fout, "        vertex %e %e %e\n",
+                                     f.v[n].x, f.v[n].y, f.v[n].z );
+                    }
+                    VSIFPrintfL( fout, "    endloop\n" );
+                    VSIFPrintfL( fout, "endfacet\n" );
+                }
+                if( pfnProgress )
+                {
+                    pfnProgress( ( s + (double)( i + 1 ) / nRows ) / nSurfaces,
+                                 NULL, NULL );
+                }
+            }
+            VSIFPrintfL( fout, "endsolid %s\n", CPLGetBasename( pszInput ) );
         }
+        VSIFCloseL( fout );
     }
-    if( eType == NinjaStlAscii )
-    {
-        fprintf( fout, "endsolid %s\n", CPLGetBasename( pszInput ) );
-    }
-    if( pfnProgress )
+
+    if( pfnProgress && eErr == CE_None )
     {
         pfnProgress( 1.0, NULL, NULL );
     }
 
     VSIFree( pafScanline );
-    GDALClose( hDS );
-    fclose( fout );
 
     return eErr;
 }
-
@@ -61,5 +61,14 @@ CPLErr NinjaElevationToStl( const char *pszInput,
                             double dfOffset,
                             GDALProgressFunc pfnProgress );
 
+CPLErr NinjaElevationToStlSurfaces( const char *pszInput,
+                                    int nBand,
+                                    double dfTargetCellSize,
+                                    NinjaStlType eType,
+                                    int nSurfaces,
+                                    const char * const *papszOutputs,
+                                    const double *padfOffsets,
+                                    GDALProgressFunc pfnProgress );
+
 #endif /* NINJA_STL_CONVERT_H_ */
 
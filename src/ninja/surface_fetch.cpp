@@ -191,6 +191,100 @@ SURF_FETCH_E SurfaceFetch::WarpBoundingBox(double *bbox)
     return SURF_FETCH_E_NONE;
 }
 
+/**
+ * \brief Open the part of a source needed for a warp through the tile cache.
+ *
+ * The edges of the destination are transformed back to the source to find
+ * the source window, padded by a few pixels for resampling.
+ *
+ * @param hSrcDS source dataset.
+ * @param pszDstWKT destination projection.
+ * @param padfDstGeoTransform destination geotransform.
+ * @param nPixels destination columns.
+ * @param nLines destination rows.
+ * @return cached mosaic to warp from instead of hSrcDS, NULL if the cache is
+ *         disabled or failed.
+ */
+GDALDatasetH SurfaceFetch::OpenCachedSource(GDALDatasetH hSrcDS,
+                                            const char *pszDstWKT,
+                                            double *padfDstGeoTransform,
+                                            int nPixels, int nLines)
+{
+    if(!SurfaceTileCache::IsEnabled())
+    {
+        return NULL;
+    }
+
+    void *hTransformArg =
+        GDALCreateGenImgProjTransformer(hSrcDS, GDALGetProjectionRef(hSrcDS),
+                                        NULL, pszDstWKT, FALSE, 0, 1);
+    if(hTransformArg == NULL)
+    {
+        return NULL;
+    }
+
+    const int nSteps = 20;
+    const int nPoints = 4 * (nSteps + 1);
+    double adfX[nPoints], adfY[nPoints], adfZ[nPoints];
+    int anSuccess[nPoints];
+    double dfWidth = nPixels * padfDstGeoTransform[1];
+    double dfHeight = nLines * padfDstGeoTransform[5];
+    for(int i = 0; i <= nSteps; i++)
+    {
+        double dfStep = (double)i / nSteps;
+        /* top, bottom, left and right edges */
+        adfX[4*i] = padfDstGeoTransform[0] + dfStep * dfWidth;
+        adfY[4*i] = padfDstGeoTransform[3];
+        adfX[4*i+1] = adfX[4*i];
+        adfY[4*i+1] = padfDstGeoTransform[3] + dfHeight;
+        adfX[4*i+2] = padfDstGeoTransform[0];
+        adfY[4*i+2] = padfDstGeoTransform[3] + dfStep * dfHeight;
+        adfX[4*i+3] = padfDstGeoTransform[0] + dfWidth;
+        adfY[4*i+3] = adfY[4*i+2];
+    }
+    for(int i = 0; i < nPoints; i++)
+        adfZ[i] = 0.0;
+    GDALGenImgProjTransform(hTransformArg, TRUE, nPoints, adfX, adfY, adfZ,
+                            anSuccess);
+    GDALDestroyGenImgProjTransformer(hTransformArg);
+
+    double dfMinX = 0.0, dfMaxX = 0.0, dfMinY = 0.0, dfMaxY = 0.0;
+    bool bFound = false;
+    for(int i = 0; i < nPoints; i++)
+    {
+        if(!anSuccess[i])
+            continue;
+        if(!bFound)
+        {
+            dfMinX = dfMaxX = adfX[i];
+            dfMinY = dfMaxY = adfY[i];
+            bFound = true;
+        }
+        dfMinX = MIN(dfMinX, adfX[i]);
+        dfMaxX = MAX(dfMaxX, adfX[i]);
+        dfMinY = MIN(dfMinY, adfY[i]);
+        dfMaxY = MAX(dfMaxY, adfY[i]);
+    }
+    if(!bFound)
+    {
+        return NULL;
+    }
+
+    double dfXSize = GDALGetRasterXSize(hSrcDS);
+    double dfYSize = GDALGetRasterYSize(hSrcDS);
+    int nXOff = (int)MAX(0.0, floor(dfMinX) - 2);
+    int nYOff = (int)MAX(0.0, floor(dfMinY) - 2);
+    int nXEnd = (int)MIN(dfXSize, ceil(dfMaxX) + 2);
+    int nYEnd = (int)MIN(dfYSize, ceil(dfMaxY) + 2);
+    if(nXEnd <= nXOff || nYEnd <= nYOff)
+    {
+        return NULL;
+    }
+
+    return SurfaceTileCache::OpenWindow(hSrcDS, GetPath().c_str(), nXOff, nYOff,
+                                        nXEnd - nXOff, nYEnd - nYOff);
+}
+
 int SurfaceFetch::BoundingBoxUtm(double *bbox)
 {
     double dfX, dfY;
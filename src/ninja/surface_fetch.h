@@ -36,6 +36,7 @@
 #include "gdal_util.h"
 #include "ninjaUnits.h"
 #include "ninja_conv.h"
+#include "surface_tile_cache.h"
 
 typedef int SURF_FETCH_E;
 #define SURF_FETCH_E_NONE          0
@@ -90,6 +91,9 @@ protected:
     virtual SURF_FETCH_E CreateBoundingBox(double *point, double *buffer, 
                                            lengthUnits::eLengthUnits units,
                                            double *bbox);
+    GDALDatasetH OpenCachedSource(GDALDatasetH hSrcDS, const char *pszDstWKT,
+                                  double *padfDstGeoTransform,
+                                  int nPixels, int nLines);
     double xRes;
     double yRes;
     double northeast_x;
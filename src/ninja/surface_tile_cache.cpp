@@ -0,0 +1,403 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Local tile cache for surface fetching
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "surface_tile_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include "cpl_multiproc.h"
+
+/*
+** 64 bit FNV-1a hash of a string.
+*/
+static GUIntBig HashText( std::string const &text )
+{
+    const GUIntBig nPrime = ( (GUIntBig)0x00000100 << 32 ) | 0x000001b3;
+    GUIntBig nHash = ( (GUIntBig)0xcbf29ce4 << 32 ) | 0x84222325;
+    for( size_t i = 0; i < text.size(); i++ )
+    {
+        nHash ^= (unsigned char)text[i];
+        nHash *= nPrime;
+    }
+    return nHash;
+}
+
+static int GetTileSize()
+{
+    int nTile = atoi( CPLGetConfigOption( "SURF_FETCH_CACHE_TILE_SIZE", "512" ) );
+    return nTile < 64 ? 64 : nTile;
+}
+
+struct CachedFile
+{
+    std::string file;
+    GIntBig nSize;
+    time_t nTime;
+    bool operator<( CachedFile const &other ) const
+    {
+        return nTime < other.nTime;
+    }
+};
+
+/**
+ * Check if the surface fetch cache is enabled.
+ *
+ * @return true if SURF_FETCH_CACHE_DIR is set.
+ */
+bool SurfaceTileCache::IsEnabled()
+{
+    const char *pszDir = CPLGetConfigOption( "SURF_FETCH_CACHE_DIR", NULL );
+    return pszDir != NULL && pszDir[0] != '\0';
+}
+
+/**
+ * Form a cache key from text identifying the cached data.
+ *
+ * @param text source name and anything else the data depends on.
+ * @return key usable as a file name.
+ */
+std::string SurfaceTileCache::FormKey( std::string const &text )
+{
+    GUIntBig nHash = HashText( text );
+    return std::string( CPLSPrintf( "%08x%08x", (unsigned)( nHash >> 32 ),
+                                     (unsigned)( nHash & 0xffffffff ) ) );
+}
+
+std::string SurfaceTileCache::FormFileName( std::string const &key,
+                                            const char *pszExt )
+{
+    const char *pszDir = CPLGetConfigOption( "SURF_FETCH_CACHE_DIR", "." );
+    return std::string( CPLFormFilename( pszDir, key.c_str(), pszExt ) );
+}
+
+/*
+** Mark a file as used so it is evicted last.
+*/
+void SurfaceTileCache::Touch( std::string const &file )
+{
+    utime( file.c_str(), NULL );
+}
+
+/**
+ * Open a window of a source dataset through the cache.
+ *
+ * Blocks of the source intersecting the window that are not cached yet are
+ * read from the source and stored.  The returned dataset has the size,
+ * projection and geotransform of the source, and is backed by cached blocks
+ * over the window only, so it should not be read outside of it.
+ *
+ * @param hSrcDS source dataset.
+ * @param pszSrcName name identifying the source in the cache.
+ * @param nXOff first source column needed.
+ * @param nYOff first source row needed.
+ * @param nXSize number of columns needed.
+ * @param nYSize number of rows needed.
+ * @return a VRT mosaic of cached blocks the caller closes, NULL on failure.
+ */
+GDALDatasetH SurfaceTileCache::OpenWindow( GDALDatasetH hSrcDS,
+                                           const char *pszSrcName,
+                                           int nXOff, int nYOff,
+                                           int nXSize, int nYSize )
+{
+    int nRasterXSize = GDALGetRasterXSize( hSrcDS );
+    int nRasterYSize = GDALGetRasterYSize( hSrcDS );
+    int nBands = GDALGetRasterCount( hSrcDS );
+    if( nBands < 1 || nXSize <= 0 || nYSize <= 0 || nXOff < 0 || nYOff < 0 ||
+        nXOff + nXSize > nRasterXSize || nYOff + nYSize > nRasterYSize )
+    {
+        return NULL;
+    }
+
+    double adfGeoTransform[6];
+    if( GDALGetGeoTransform( hSrcDS, adfGeoTransform ) != CE_None )
+    {
+        return NULL;
+    }
+
+    int nTile = GetTileSize();
+    int nFirstCol = nXOff / nTile;
+    int nLastCol = ( nXOff + nXSize - 1 ) / nTile;
+    int nFirstRow = nYOff / nTile;
+    int nLastRow = ( nYOff + nYSize - 1 ) / nTile;
+
+    std::vector<std::string> aosBands( nBands );
+    std::set<std::string> keep;
+    int nHits = 0, nMisses = 0;
+    for( int iRow = nFirstRow; iRow <= nLastRow; iRow++ )
+    {
+        for( int iCol = nFirstCol; iCol <= nLastCol; iCol++ )
+        {
+            int nTileXOff = iCol * nTile;
+            int nTileYOff = iRow * nTile;
+            int nTileXSize = MIN( nTile, nRasterXSize - nTileXOff );
+            int nTileYSize = MIN( nTile, nRasterYSize - nTileYOff );
+
+            std::string file = FormFileName(
+                FormKey( CPLSPrintf( "%s|%d|%d|%d", pszSrcName, nTile,
+                                     iCol, iRow ) ), ".tif" );
+            VSIStatBufL sStat;
+            if( VSIStatL( file.c_str(), &sStat ) == 0 )
+            {
+                Touch( file );
+                nHits++;
+            }
+            else
+            {
+                if( !WriteTile( hSrcDS, nTileXOff, nTileYOff,
+                                nTileXSize, nTileYSize, file ) )
+                {
+                    return NULL;
+                }
+                nMisses++;
+            }
+            keep.insert( file );
+
+            for( int iBand = 0; iBand < nBands; iBand++ )
+            {
+                aosBands[iBand] += CPLSPrintf(
+                    "    <SimpleSource>\n"
+                    "      <SourceFilename relativeToVRT=\"0\">%s</SourceFilename>\n"
+                    "      <SourceBand>%d</SourceBand>\n"
+                    "      <SrcRect xOff=\"0\" yOff=\"0\" xSize=\"%d\" ySize=\"%d\"/>\n"
+                    "      <DstRect xOff=\"%d\" yOff=\"%d\" xSize=\"%d\" ySize=\"%d\"/>\n"
+                    "    </SimpleSource>\n",
+                    file.c_str(), iBand + 1, nTileXSize, nTileYSize,
+                    nTileXOff, nTileYOff, nTileXSize, nTileYSize );
+            }
+        }
+    }
+    CPLDebug( "SURF_FETCH_CACHE", "%s: %d cached tiles, %d fetched",
+              pszSrcName, nHits, nMisses );
+
+    Trim( keep );
+
+    char *pszSRS = CPLEscapeString( GDALGetProjectionRef( hSrcDS ), -1,
+                                    CPLES_XML );
+    std::string osVrt = CPLSPrintf(
+        "<VRTDataset rasterXSize=\"%d\" rasterYSize=\"%d\">\n"
+        "  <SRS>%s</SRS>\n"
+        "  <GeoTransform>%.17g, %.17g, %.17g, %.17g, %.17g, %.17g</GeoTransform>\n",
+        nRasterXSize, nRasterYSize, pszSRS,
+        adfGeoTransform[0], adfGeoTransform[1], adfGeoTransform[2],
+        adfGeoTransform[3], adfGeoTransform[4], adfGeoTransform[5] );
+    CPLFree( pszSRS );
+
+    GDALDataType eType = GDALGetRasterDataType( GDALGetRasterBand( hSrcDS, 1 ) );
+    for( int iBand = 0; iBand < nBands; iBand++ )
+    {
+        GDALRasterBandH hBand = GDALGetRasterBand( hSrcDS, iBand + 1 );
+        osVrt += CPLSPrintf( "  <VRTRasterBand dataType=\"%s\" band=\"%d\">\n",
+                             GDALGetDataTypeName( eType ), iBand + 1 );
+        int bHasNoData = FALSE;
+        double dfNoData = GDALGetRasterNoDataValue( hBand, &bHasNoData );
+        if( bHasNoData )
+        {
+            osVrt += CPLSPrintf( "    <NoDataValue>%.17g</NoDataValue>\n",
+                                 dfNoData );
+        }
+        osVrt += aosBands[iBand];
+        osVrt += "  </VRTRasterBand>\n";
+    }
+    osVrt += "</VRTDataset>\n";
+
+    return GDALOpen( osVrt.c_str(), GA_ReadOnly );
+}
+
+/*
+** Read a block of the source and store it as a compressed GeoTIFF in the
+** source projection.  The block is written to a temporary name first so
+** other processes never see a partial tile.
+*/
+bool SurfaceTileCache::WriteTile( GDALDatasetH hSrcDS, int nXOff, int nYOff,
+                                  int nXSize, int nYSize,
+                                  std::string const &file )
+{
+    GDALDriverH hDriver = GDALGetDriverByName( "GTiff" );
+    if( hDriver == NULL )
+    {
+        return false;
+    }
+
+    int nBands = GDALGetRasterCount( hSrcDS );
+    GDALDataType eType = GDALGetRasterDataType( GDALGetRasterBand( hSrcDS, 1 ) );
+
+    char **papszOptions = NULL;
+    papszOptions = CSLSetNameValue( papszOptions, "COMPRESS", "DEFLATE" );
+    papszOptions = CSLSetNameValue( papszOptions, "TILED", "YES" );
+
+    std::string osTmpFile = file + CPLSPrintf( ".%d.tmp", CPLGetPID() );
+    GDALDatasetH hDstDS = GDALCreate( hDriver, osTmpFile.c_str(), nXSize, nYSize,
+                                      nBands, eType, papszOptions );
+    CSLDestroy( papszOptions );
+    if( hDstDS == NULL )
+    {
+        return false;
+    }
+
+    double adfGeoTransform[6];
+    GDALGetGeoTransform( hSrcDS, adfGeoTransform );
+    adfGeoTransform[0] += nXOff * adfGeoTransform[1] + nYOff * adfGeoTransform[2];
+    adfGeoTransform[3] += nXOff * adfGeoTransform[4] + nYOff * adfGeoTransform[5];
+    GDALSetGeoTransform( hDstDS, adfGeoTransform );
+    GDALSetProjection( hDstDS, GDALGetProjectionRef( hSrcDS ) );
+
+    void *pData = VSIMalloc3( nXSize, nYSize, GDALGetDataTypeSize( eType ) / 8 );
+    bool bOk = pData != NULL;
+    for( int iBand = 1; iBand <= nBands && bOk; iBand++ )
+    {
+        GDALRasterBandH hSrcBand = GDALGetRasterBand( hSrcDS, iBand );
+        GDALRasterBandH hDstBand = GDALGetRasterBand( hDstDS, iBand );
+        int bHasNoData = FALSE;
+        double dfNoData = GDALGetRasterNoDataValue( hSrcBand, &bHasNoData );
+        if( bHasNoData )
+        {
+            GDALSetRasterNoDataValue( hDstBand, dfNoData );
+        }
+        bOk = GDALRasterIO( hSrcBand, GF_Read, nXOff, nYOff, nXSize, nYSize,
+                            pData, nXSize, nYSize, eType, 0, 0 ) == CE_None &&
+              GDALRasterIO( hDstBand, GF_Write, 0, 0, nXSize, nYSize,
+                            pData, nXSize, nYSize, eType, 0, 0 ) == CE_None;
+    }
+    CPLFree( pData );
+    GDALClose( hDstDS );
+
+    if( !bOk || VSIRename( osTmpFile.c_str(), file.c_str() ) != 0 )
+    {
+        CPLDebug( "SURF_FETCH_CACHE", "Failed to cache tile %s", file.c_str() );
+        VSIUnlink( osTmpFile.c_str() );
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Find a file stored whole in the cache.
+ *
+ * @param key key the file was stored under.
+ * @param pszExt extension of the file.
+ * @return path of the cached file, empty if it is not cached.
+ */
+std::string SurfaceTileCache::FindFile( std::string const &key,
+                                        const char *pszExt )
+{
+    std::string file = FormFileName( key, pszExt );
+    VSIStatBufL sStat;
+    if( VSIStatL( file.c_str(), &sStat ) != 0 )
+    {
+        return std::string();
+    }
+    Touch( file );
+    return file;
+}
+
+/**
+ * Store a copy of a file whole in the cache.
+ *
+ * @param key key to store the file under.
+ * @param pszExt extension of the file.
+ * @param pszFile file to copy in.
+ * @return true if the file was stored.
+ */
+bool SurfaceTileCache::StoreFile( std::string const &key, const char *pszExt,
+                                  const char *pszFile )
+{
+    std::string file = FormFileName( key, pszExt );
+    std::string osTmpFile = file + CPLSPrintf( ".%d.tmp", CPLGetPID() );
+    if( CPLCopyFile( osTmpFile.c_str(), pszFile ) != 0 ||
+        VSIRename( osTmpFile.c_str(), file.c_str() ) != 0 )
+    {
+        VSIUnlink( osTmpFile.c_str() );
+        return false;
+    }
+    std::set<std::string> keep;
+    keep.insert( file );
+    Trim( keep );
+    return true;
+}
+
+/**
+ * Remove the least recently used files until the cache is within
+ * SURF_FETCH_CACHE_MAX_MB.
+ *
+ * @param keep files in use by the current fetch, never removed.
+ */
+void SurfaceTileCache::Trim( std::set<std::string> const &keep )
+{
+    GIntBig nMaxBytes =
+        (GIntBig)atoi( CPLGetConfigOption( "SURF_FETCH_CACHE_MAX_MB", "2048" ) )
+        * 1024 * 1024;
+    const char *pszDir = CPLGetConfigOption( "SURF_FETCH_CACHE_DIR", "." );
+
+    std::vector<CachedFile> files;
+    GIntBig nTotal = 0;
+    char **papszList = VSIReadDir( pszDir );
+    for( int i = 0; i < CSLCount( papszList ); i++ )
+    {
+        const char *pszExt = CPLGetExtension( papszList[i] );
+        if( !EQUAL( pszExt, "tif" ) && !EQUAL( pszExt, "zip" ) )
+            continue;
+        CachedFile cached;
+        cached.file = CPLFormFilename( pszDir, papszList[i], NULL );
+        VSIStatBufL sStat;
+        if( VSIStatL( cached.file.c_str(), &sStat ) != 0 )
+            continue;
+        cached.nSize = sStat.st_size;
+        cached.nTime = sStat.st_mtime;
+        nTotal += cached.nSize;
+        files.push_back( cached );
+    }
+    CSLDestroy( papszList );
+
+    if( nTotal <= nMaxBytes )
+    {
+        return;
+    }
+
+    std::sort( files.begin(), files.end() );
+    int nRemoved = 0;
+    for( size_t i = 0; i < files.size() && nTotal > nMaxBytes; i++ )
+    {
+        if( keep.count( files[i].file ) )
+            continue;
+        if( VSIUnlink( files[i].file.c_str() ) == 0 )
+        {
+            nTotal -= files[i].nSize;
+            nRemoved++;
+        }
+    }
+    CPLDebug( "SURF_FETCH_CACHE", "Removed %d files, cache is %d MB",
+              nRemoved, (int)( nTotal / ( 1024 * 1024 ) ) );
+}
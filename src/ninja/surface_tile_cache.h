@@ -0,0 +1,79 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Local tile cache for surface fetching
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef SURFACE_TILE_CACHE_H
+#define SURFACE_TILE_CACHE_H
+
+#include <set>
+#include <string>
+
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+#include "gdal.h"
+
+/**
+ * Local cache of source data for surface fetching.
+ *
+ * Remote elevation and relief sources are read in fixed blocks of source
+ * pixels, and each block is stored once as a compressed GeoTIFF in the
+ * source projection.  Bounding box fetches are warped from a mosaic of the
+ * cached blocks, so overlapping requests only download blocks that have not
+ * been seen before.  Downloads that cannot be split into blocks, such as
+ * LANDFIRE archives, are stored whole by key.
+ *
+ * The cache is enabled by setting the SURF_FETCH_CACHE_DIR config option to
+ * a writable directory.  SURF_FETCH_CACHE_MAX_MB limits its size, removing
+ * the least recently used files first, and SURF_FETCH_CACHE_TILE_SIZE sets
+ * the block size in pixels.
+ */
+class SurfaceTileCache
+{
+public:
+    static bool IsEnabled();
+
+    static GDALDatasetH OpenWindow( GDALDatasetH hSrcDS, const char *pszSrcName,
+                                    int nXOff, int nYOff,
+                                    int nXSize, int nYSize );
+
+    static std::string FormKey( std::string const &text );
+    static std::string FindFile( std::string const &key, const char *pszExt );
+    static bool StoreFile( std::string const &key, const char *pszExt,
+                           const char *pszFile );
+
+    static void Trim( std::set<std::string> const &keep );
+
+private:
+    static std::string FormFileName( std::string const &key, const char *pszExt );
+    static bool WriteTile( GDALDatasetH hSrcDS, int nXOff, int nYOff,
+                           int nXSize, int nYSize, std::string const &file );
+    static void Touch( std::string const &file );
+};
+
+#endif /* SURFACE_TILE_CACHE_H */
@@ -179,6 +179,93 @@ NinjaErr WINDNINJADLL_EXPORT NinjaMakeArmy
     return retval;
 }
 
+/**
+ * \brief Generate a ninjaArmy from a surface forecast held in memory.
+ *
+ * Like NinjaMakeArmy, one run is made for each time step, but the forecast
+ * is taken from caller buffers instead of a file.  The data is copied and
+ * lives until the army is destroyed.
+ *
+ * \param ninja An opaque handle to a valid ninjaArmy.
+ * \param nTimeSteps number of time steps.
+ * \param validTimes valid time of each step, UTC.
+ * \param u u wind component (m/s), nTimeSteps grids of nXSize * nYSize.
+ * \param v v wind component (m/s), same layout.
+ * \param airTemp air temperature (K), same layout.
+ * \param cloudCover cloud cover (percent), same layout.
+ * \param geoTransform GDAL geotransform of the grids.
+ * \param prjWkt projection of the grids.
+ * \param windHeight height of the forecast wind above ground (m).
+ * \param timezone a timezone string representing a valid timezone.
+ *
+ * \return NINJA_SUCCESS on success, NINJA_E_INVALID otherwise.
+ */
+NinjaErr WINDNINJADLL_EXPORT NinjaMakeMemoryArmy
+    ( NinjaH * ninja, const int nTimeSteps, const time_t * validTimes,
+      const double * u, const double * v, const double * airTemp,
+      const double * cloudCover, const int nXSize, const int nYSize,
+      const double * geoTransform, const char * prjWkt,
+      const double windHeight, const char * timezone,
+      bool momentumFlag )
+{
+    NinjaErr retval = NINJA_E_INVALID;
+    if( NULL != ninja )
+    {
+       try
+       {
+           reinterpret_cast<ninjaArmy*>( ninja )->makeMemoryArmy
+               ( nTimeSteps, validTimes, u, v, airTemp, cloudCover,
+                 nXSize, nYSize, geoTransform, prjWkt, windHeight,
+                 std::string( timezone ), momentumFlag );
+
+           retval = NINJA_SUCCESS;
+       }
+       catch( std::exception & e )
+       {
+           retval = NINJA_E_INVALID;
+       }
+    }
+    else
+    {
+        retval = NINJA_E_NULL_PTR;
+    }
+    return retval;
+}
+
+NinjaErr WINDNINJADLL_EXPORT NinjaSetMemoryDEM
+    ( NinjaH * ninja, const int nIndex, const double * elevation,
+      const int nXSize, const int nYSize, const double * geoTransform,
+      const char * prjWkt, const double noData )
+{
+    if( NULL != ninja )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->setMemoryDEM
+            ( nIndex, elevation, nXSize, nYSize, geoTransform, prjWkt, noData );
+    }
+    else
+    {
+        return NINJA_E_NULL_PTR;
+    }
+}
+
+NinjaErr WINDNINJADLL_EXPORT NinjaSetMemorySurface
+    ( NinjaH * ninja, const int nIndex, const double * roughness,
+      const double * roughH, const double * roughD,
+      const int nXSize, const int nYSize, const double * geoTransform,
+      const char * prjWkt )
+{
+    if( NULL != ninja )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->setMemorySurface
+            ( nIndex, roughness, roughH, roughD, nXSize, nYSize,
+              geoTransform, prjWkt );
+    }
+    else
+    {
+        return NINJA_E_NULL_PTR;
+    }
+}
+
 /**
  * \brief Start the simulations.
  *
@@ -198,11 +285,13 @@ NinjaErr WINDNINJADLL_EXPORT NinjaStartRuns
     {
         try
         {
-            return reinterpret_cast<ninjaArmy*>( ninja )->startRuns( nprocessors );
+            if( reinterpret_cast<ninjaArmy*>( ninja )->startRuns( nprocessors ) )
+                return NINJA_SUCCESS;
+            return NINJA_E_OTHER;
         }
         catch( ... )
         {
-            handleException();
+            return handleException();
         }
     }
     else
@@ -843,6 +932,77 @@ const char * WINDNINJADLL_EXPORT NinjaGetOutputPath
     }
 }
 
+NinjaErr WINDNINJADLL_EXPORT NinjaSetFileOutFlag
+    ( NinjaH * ninja, const int nIndex, const int flag )
+{
+    if( NULL != ninja )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->setFileOutFlag( nIndex, flag );
+    }
+    else
+    {
+        return NINJA_E_NULL_PTR;
+    }
+}
+
+NinjaErr WINDNINJADLL_EXPORT NinjaSetOutputGridsInMemory
+    ( NinjaH * ninja, const int nIndex, const int flag, const int include3d )
+{
+    if( NULL != ninja )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->setOutputGridsInMemory
+            ( nIndex, flag, include3d );
+    }
+    else
+    {
+        return NINJA_E_NULL_PTR;
+    }
+}
+
+const double * WINDNINJADLL_EXPORT NinjaGetOutputGrid
+    ( NinjaH * ninja, const int nIndex, const char * name,
+      int * nRows, int * nCols, double * geoTransform, double * noData )
+{
+    if( NULL != ninja && NULL != name && NULL != nRows && NULL != nCols )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->getOutputGrid
+            ( nIndex, std::string( name ), nRows, nCols, geoTransform, noData );
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
+const double * WINDNINJADLL_EXPORT NinjaGetOutputField3D
+    ( NinjaH * ninja, const int nIndex, const char * name,
+      int * nRows, int * nCols, int * nLayers )
+{
+    if( NULL != ninja && NULL != name && NULL != nRows && NULL != nCols &&
+        NULL != nLayers )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->getOutputField3d
+            ( nIndex, std::string( name ), nRows, nCols, nLayers );
+    }
+    else
+    {
+        return NULL;
+    }
+}
+
+NinjaErr WINDNINJADLL_EXPORT NinjaReleaseOutputGrids
+    ( NinjaH * ninja, const int nIndex )
+{
+    if( NULL != ninja )
+    {
+        return reinterpret_cast<ninjaArmy*>( ninja )->releaseOutputGrids( nIndex );
+    }
+    else
+    {
+        return NINJA_E_NULL_PTR;
+    }
+}
+
 /*-----------------------------------------------------------------------------
  *  Termination Methods
  *-----------------------------------------------------------------------------*/
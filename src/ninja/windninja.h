@@ -64,6 +64,7 @@
 WN_C_START
 
 #include <stdlib.h>
+#include <time.h>
 //#include <stdint.h>
 
 //Use structs instead of void * for type checking by C compilier
@@ -97,6 +98,31 @@ typedef int   NinjaErr;
           const char * timezone,
           bool momentumFlag );
 
+    /*-----------------------------------------------------------------------------
+     *  In-Memory Input Methods
+     *
+     *  Grids are copied, north up with rows from the top, and described by a
+     *  GDAL geotransform and a WKT projection.
+     *-----------------------------------------------------------------------------*/
+    NinjaErr WINDNINJADLL_EXPORT NinjaMakeMemoryArmy
+        ( NinjaH * ninja, const int nTimeSteps, const time_t * validTimes,
+          const double * u, const double * v, const double * airTemp,
+          const double * cloudCover, const int nXSize, const int nYSize,
+          const double * geoTransform, const char * prjWkt,
+          const double windHeight, const char * timezone,
+          bool momentumFlag );
+
+    NinjaErr WINDNINJADLL_EXPORT NinjaSetMemoryDEM
+        ( NinjaH * ninja, const int nIndex, const double * elevation,
+          const int nXSize, const int nYSize, const double * geoTransform,
+          const char * prjWkt, const double noData );
+
+    NinjaErr WINDNINJADLL_EXPORT NinjaSetMemorySurface
+        ( NinjaH * ninja, const int nIndex, const double * roughness,
+          const double * roughH, const double * roughD,
+          const int nXSize, const int nYSize, const double * geoTransform,
+          const char * prjWkt );
+
 
     /*-----------------------------------------------------------------------------
      *  Various Simulation Parameters
@@ -253,6 +279,32 @@ typedef int   NinjaErr;
     const char * WINDNINJADLL_EXPORT NinjaGetOutputPath
         ( NinjaH * ninja, const int nIndex );
 
+    /* flag == 0 writes no output files, results are only kept in memory */
+    NinjaErr WINDNINJADLL_EXPORT NinjaSetFileOutFlag
+        ( NinjaH * ninja, const int nIndex, const int flag );
+
+    NinjaErr WINDNINJADLL_EXPORT NinjaSetOutputGridsInMemory
+        ( NinjaH * ninja, const int nIndex, const int flag,
+          const int include3d );
+
+    /*
+    ** Read-only access to results kept in memory, valid until
+    ** NinjaReleaseOutputGrids() or NinjaDestroyArmy().  Grid names are
+    ** "speed", "direction" and "cloud"; rows start at the south edge so the
+    ** geotransform is { xll, cellsize, 0, yll, 0, cellsize }.  3d field
+    ** names are "u", "v", "w" and "x", "y", "z" for the node coordinates.
+    */
+    const double * WINDNINJADLL_EXPORT NinjaGetOutputGrid
+        ( NinjaH * ninja, const int nIndex, const char * name,
+          int * nRows, int * nCols, double * geoTransform, double * noData );
+
+    const double * WINDNINJADLL_EXPORT NinjaGetOutputField3D
+        ( NinjaH * ninja, const int nIndex, const char * name,
+          int * nRows, int * nCols, int * nLayers );
+
+    NinjaErr WINDNINJADLL_EXPORT NinjaReleaseOutputGrids
+        ( NinjaH * ninja, const int nIndex );
+
 
     /*-----------------------------------------------------------------------------
      *  Termination Methods
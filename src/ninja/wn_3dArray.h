@@ -49,6 +49,9 @@ class wn_3dArray
 		double  operator() (int row, int col, int layer) const;
 		double& operator() (int num);
 		double  operator() (int num) const;
+
+		const double* get_dataPointer() const { return data_; }  //layer-major, NULL if not allocated
+		double* get_dataPointer() { return data_; }
 		
 		int rows_, cols_, layers_;
 
@@ -68,6 +68,12 @@ public:
     double& operator() (int num);
     double  operator() (int num) const;
 
+    const double* get_dataPointer() const { return scalarData_.get_dataPointer(); }
+    double* get_dataPointer() { return scalarData_.get_dataPointer(); }
+    int get_nRows() const { return scalarData_.rows_; }
+    int get_nCols() const { return scalarData_.cols_; }
+    int get_nLayers() const { return scalarData_.layers_; }
+
 private:
     Mesh const* mesh_;
     wn_3dArray scalarData_;
@@ -241,22 +241,6 @@ void wrf3dInitialization::set3dGrids( WindNinjaInputs &input, Mesh const& mesh )
         GDALClose((GDALDatasetH) poDS );
     }
     
-#ifdef _OPENMP
-    omp_guard netCDF_guard(netCDF_lock);
-#endif
-
-    CPLPushErrorHandler(CPLQuietErrorHandler);
-    poDS = (GDALDataset*)GDALOpenShared( input.forecastFilename.c_str(), GA_ReadOnly );
-    CPLPopErrorHandler();
-    if( poDS == NULL ) {
-        CPLDebug( "wrf3dInitialization::set3dGrids()",
-                 "Bad forecast file");
-        throw badForecastFile("Cannot open forecast file in wrf3dInitialization::set3dGrids()");
-    }
-    else {
-        GDALClose((GDALDatasetH) poDS ); // close original wxModel file
-    }
-    
     int nLayers;
     int numStripRows = 0; //number of rows to strip from warped image
     int numStripCols = 0; // number of cols to strip from warped image
@@ -267,7 +251,6 @@ void wrf3dInitialization::set3dGrids( WindNinjaInputs &input, Mesh const& mesh )
      */
     
     GDALDataset *srcDS, *wrpDS;
-    std::string temp;
     std::vector<std::string> var3dList = get3dVariableList(); 
     GDALWarpOptions* psWarpOptions;
 
@@ -275,15 +258,9 @@ void wrf3dInitialization::set3dGrids( WindNinjaInputs &input, Mesh const& mesh )
         
         //cout<<"var3dList.size() = "<<var3dList.size()<<endl;
         
-        temp = "NETCDF:" + input.forecastFilename + ":" + var3dList[i];
-        
-        CPLPushErrorHandler(CPLQuietErrorHandler);
-        srcDS = (GDALDataset*)GDALOpenShared( temp.c_str(), GA_ReadOnly );
-        CPLPopErrorHandler();
-        if( srcDS == NULL ) {
-            CPLDebug( "wrf3dInitialization::setSurfaceGrids()",
-                    "Bad forecast file" );
-        }
+        //private dataset, so setting the geotransform below is thread safe
+        wxModelReader reader( input.forecastFilename, var3dList[i] );
+        srcDS = reader.GetDataset();
 
         //cout<<"var3dList[i] = " <<var3dList[i]<<endl;
 
@@ -673,7 +650,6 @@ void wrf3dInitialization::set3dGrids( WindNinjaInputs &input, Mesh const& mesh )
         CPLFree(srcWKT);
         delete poCT;
         GDALDestroyWarpOptions( psWarpOptions );
-        GDALClose((GDALDatasetH) srcDS );
         GDALClose((GDALDatasetH) wrpDS );
         
     } // end loop over variable
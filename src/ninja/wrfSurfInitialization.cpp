@@ -150,7 +150,6 @@ void wrfSurfInitialization::checkForValidData()
 
     // open ds variable by variable
     GDALDataset *srcDS;
-    std::string temp;
     std::string srcWkt;
     int nBands = 0;
     bool noDataValueExists;
@@ -158,21 +157,11 @@ void wrfSurfInitialization::checkForValidData()
 
     std::vector<std::string> varList = getVariableList();
 
-    //Acquire a lock to protect the non-thread safe netCDF library
-#ifdef _OPENMP
-    omp_guard netCDF_guard(netCDF_lock);
-#endif
-
     for( unsigned int i = 0;i < varList.size();i++ ) {
 
-        temp = "NETCDF:" + wxModelFileName + ":" + varList[i];
-        //cout << "temp = " <<temp<<endl;
-
-        CPLPushErrorHandler(&CPLQuietErrorHandler);
-        srcDS = (GDALDataset*)GDALOpen( temp.c_str(), GA_ReadOnly );
-        CPLPopErrorHandler();
-        if( srcDS == NULL )
-            throw badForecastFile("Cannot open forecast file.");
+        //decoded once under the netCDF lock and shared with the runs
+        wxModelReader reader( wxModelFileName, varList[i] );
+        srcDS = reader.GetDataset();
 
         //Get total bands (time steps)
         nBands = srcDS->GetRasterCount();
@@ -248,8 +237,6 @@ void wrfSurfInitialization::checkForValidData()
 
             delete [] padfScanline;
         }
-
-        GDALClose((GDALDatasetH) srcDS );
     }
 }
 
@@ -575,23 +562,15 @@ void wrfSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
         throw std::runtime_error( os.str() );
     }
 
+    //the variables below are read through wxModelReader
+#ifdef _OPENMP
+    netCDF_guard.release();
+#endif
+
 //======end get global attributes========================================
 
-    CPLPushErrorHandler(&CPLQuietErrorHandler);
-    poDS = (GDALDataset*)GDALOpenShared( input.forecastFilename.c_str(), GA_ReadOnly );
-    CPLPopErrorHandler();
-    if( poDS == NULL ) {
-        CPLDebug( "wrfInitialization::setSurfaceGrids()",
-                 "Bad forecast file");
-        throw badForecastFile("Cannot open forecast file in wrfInitialization::setSurfaceGrids()");
-    }
-    else {
-        GDALClose((GDALDatasetH) poDS ); // close original wxModel file
-    }
-        
     // open ds one by one, set projection, warp, then write to grid
     GDALDataset *srcDS, *wrpDS;
-    std::string temp;
     std::vector<std::string> varList = getVariableList();
 
     /*
@@ -601,15 +580,9 @@ void wrfSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
 
     for( unsigned int i = 0;i < varList.size();i++ ) {
 
-        temp = "NETCDF:" + input.forecastFilename + ":" + varList[i];
-        
-        CPLPushErrorHandler(&CPLQuietErrorHandler);
-        srcDS = (GDALDataset*)GDALOpenShared( temp.c_str(), GA_ReadOnly );
-        CPLPopErrorHandler();
-        if( srcDS == NULL ) {
-            CPLDebug( "wrfInitialization::setSurfaceGrids()",
-                    "Bad forecast file" );
-        }
+        //private dataset, so setting the geotransform below is thread safe
+        wxModelReader reader( input.forecastFilename, varList[i] );
+        srcDS = reader.GetDataset();
 
         //cout<<"varList[i] = " <<varList[i]<<endl;
 
@@ -823,7 +796,6 @@ void wrfSurfInitialization::setSurfaceGrids( WindNinjaInputs &input,
         CPLFree(srcWKT);
         delete poCT;
         GDALDestroyWarpOptions( psWarpOptions );
-        GDALClose((GDALDatasetH) srcDS );
         GDALClose((GDALDatasetH) wrpDS );
     }
     cloudGrid /= 100.0;
@@ -28,6 +28,7 @@
  *****************************************************************************/
 
 #include "wxModelInitialization.h"
+#include "memory_input.h"
 
 
 // #define NC_NOERR        0       /* No Error */
@@ -1173,11 +1174,40 @@ void wxModelInitialization::initializeFields(WindNinjaInputs &input,
 
 void wxModelInitialization::interpolateWxGridsToNinjaGrids(WindNinjaInputs &input)
 {
-    //Interpolate from original wxModel grids to dem coincident grids
-    airTempGrid.interpolateFromGrid(airTempGrid_wxModel, AsciiGrid<double>::order1);
-    cloudCoverGrid.interpolateFromGrid(cloudCoverGrid_wxModel, AsciiGrid<double>::order1);
-    uInitializationGrid.interpolateFromGrid(uGrid_wxModel, AsciiGrid<double>::order1);
-    vInitializationGrid.interpolateFromGrid(vGrid_wxModel, AsciiGrid<double>::order1);
+    //Interpolate from original wxModel grids to dem coincident grids.  The
+    //weights only depend on the grid geometry, so one cached plan is shared by
+    //all four variables and by every run in the army using this forecast.
+    std::vector<AsciiGrid<double> const *> wxGrids;
+    std::vector<AsciiGrid<double> *> ninjaGrids;
+    wxGrids.push_back(&airTempGrid_wxModel);
+    ninjaGrids.push_back(&airTempGrid);
+    wxGrids.push_back(&cloudCoverGrid_wxModel);
+    ninjaGrids.push_back(&cloudCoverGrid);
+    wxGrids.push_back(&uGrid_wxModel);
+    ninjaGrids.push_back(&uInitializationGrid);
+    wxGrids.push_back(&vGrid_wxModel);
+    ninjaGrids.push_back(&vInitializationGrid);
+
+    boost::shared_ptr<GridResamplePlan> plan =
+        GridResamplePlan::GetPlan(airTempGrid_wxModel, airTempGrid);
+
+    std::vector<AsciiGrid<double> const *> planSources;
+    std::vector<AsciiGrid<double> *> planDestinations;
+    for(unsigned int i = 0; i < wxGrids.size(); i++)
+    {
+        if(plan->matches(*wxGrids[i], *ninjaGrids[i]))
+        {
+            planSources.push_back(wxGrids[i]);
+            planDestinations.push_back(ninjaGrids[i]);
+        }
+        else
+        {
+            //odd geometry for this variable, interpolate it on its own
+            ninjaGrids[i]->interpolateFromGrid(*const_cast<AsciiGrid<double>*>(wxGrids[i]),
+                                               AsciiGrid<double>::order1);
+        }
+    }
+    plan->apply(planSources, planDestinations);
 
     /*
     ** Fill in speed and direction grids from interpolated U and V grids.
@@ -1436,6 +1466,9 @@ void wxModelInitialization::interpolate3dDataToPoints(WindNinjaInputs &input, co
 
 void wxModelInitialization::writeWxModelGrids(WindNinjaInputs &input)
 {
+    if(!input.fileOutFlag)
+        return;
+
     if(input.wxModelAsciiOutFlag==true || input.wxModelShpOutFlag==true || input.wxModelGoogOutFlag == true)
     {
         speedInitializationGrid_wxModel.set_headerData(uGrid_wxModel);
@@ -1458,6 +1491,8 @@ void wxModelInitialization::writeWxModelGrids(WindNinjaInputs &input)
         std::string rootname, path;
         //rootname = CPLGetBasename(input.forecastFilename.c_str());
         path = CPLGetPath(input.forecastFilename.c_str());
+        if( NinjaMemoryInput::IsMemoryPath( path ) )
+            path = ".";
 
         ostringstream wxModelTimestream;
         blt::local_time_facet* wxModelOutputFacet;
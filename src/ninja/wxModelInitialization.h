@@ -32,6 +32,8 @@
 
 #include "initialize.h"
 #include "ascii_grid.h"
+#include "GridResamplePlan.h"
+#include "wxModelReader.h"
 #include "ShapeVector.h"
 /* netcdf */
 #include "netcdf.h"
@@ -58,6 +58,13 @@ wxModelInitialization* wxModelInitializationFactory::makeWxInitialization( std::
     NomadsWxModel nomad;
 #endif
 
+    //in-memory forecasts are checked first, they are never netcdf or grib
+    memorySurfInitialization memorySurf;
+    if( memorySurf.identify(fileName) ) {
+        memorySurf.setModelFileName( fileName );
+        return new memorySurfInitialization(memorySurf);
+    }
+
     VSIStatBufL sStat;
     VSIStatL( fileName.c_str(), &sStat );
     if( strstr( fileName.c_str(), ".tar" ) )
@@ -40,6 +40,7 @@
 #include "ncepNdfdInitialization.h"
 #include "ncepRapSurfInitialization.h"
 #include "genericSurfInitialization.h"
+#include "memorySurfInitialization.h"
 #include "wrfSurfInitialization.h"
 #include "wrf3dInitialization.h"
 #ifdef WITH_NOMADS_SUPPORT
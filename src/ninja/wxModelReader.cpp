@@ -0,0 +1,245 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Thread safe, cached access to decoded forecast variables
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#include "wxModelReader.h"
+
+std::map<std::string, boost::shared_ptr<wxModelReader::decodedVariable> >
+wxModelReader::oVariableCache;
+
+wxModelReader::decodedVariable::decodedVariable()
+    : nXSize( 0 ), nYSize( 0 ), nBands( 0 ), bHaveGeoTransform( FALSE ),
+      papszMetadata( NULL )
+{
+    for( int i = 0; i < 6; i++ )
+        adfGeoTransform[i] = 0.0;
+}
+
+wxModelReader::decodedVariable::~decodedVariable()
+{
+    CSLDestroy( papszMetadata );
+    for( unsigned int i = 0; i < apapszBandMetadata.size(); i++ )
+        CSLDestroy( apapszBandMetadata[i] );
+}
+
+/**
+ * Open a forecast variable for reading.
+ *
+ * @param fileName path to the forecast file.
+ * @param variable netCDF variable name.  If empty, the file itself is opened
+ *                 (GRIB files from NOMADS).
+ * @throws badForecastFile if the variable cannot be opened.
+ */
+wxModelReader::wxModelReader( std::string const &fileName,
+                              std::string const &variable )
+    : poDS( NULL )
+{
+    std::string osName = FormDatasetName( fileName, variable );
+    std::string osKey = FormCacheKey( fileName, osName );
+
+#pragma omp critical(wxModelReaderCache)
+    {
+        std::map<std::string, boost::shared_ptr<decodedVariable> >::iterator it;
+        it = oVariableCache.find( osKey );
+        if( it != oVariableCache.end() )
+            poData = it->second;
+    }
+
+    if( !poData )
+    {
+        poData = Decode( osName, osKey );
+    }
+
+    /*
+    ** Wrap the shared buffers in a dataset owned by this thread.  The MEM
+    ** driver does not copy or free memory passed with DATAPOINTER.
+    */
+    GDALDriverH hDriver = GDALGetDriverByName( "MEM" );
+    GDALDatasetH hDS = GDALCreate( hDriver, "", poData->nXSize,
+                                   poData->nYSize, 0, GDT_Float64, NULL );
+    if( hDS == NULL )
+        throw badForecastFile( "Could not create in-memory forecast dataset." );
+
+    const size_t nBandSize = (size_t)poData->nXSize * poData->nYSize;
+    for( int b = 0; b < poData->nBands; b++ )
+    {
+        char szPtr[128];
+        int nRet = CPLPrintPointer( szPtr, &(poData->adfData[b * nBandSize]),
+                                    sizeof( szPtr ) );
+        szPtr[nRet] = '\0';
+        char **papszOptions = CSLSetNameValue( NULL, "DATAPOINTER", szPtr );
+        GDALAddBand( hDS, GDT_Float64, papszOptions );
+        CSLDestroy( papszOptions );
+
+        GDALRasterBandH hBand = GDALGetRasterBand( hDS, b + 1 );
+        if( poData->abHaveNoData[b] )
+            GDALSetRasterNoDataValue( hBand, poData->adfNoData[b] );
+        GDALSetMetadata( hBand, poData->apapszBandMetadata[b], NULL );
+    }
+    if( poData->bHaveGeoTransform )
+        GDALSetGeoTransform( hDS, poData->adfGeoTransform );
+    GDALSetProjection( hDS, poData->osWkt.c_str() );
+    GDALSetMetadata( hDS, poData->papszMetadata, NULL );
+
+    poDS = (GDALDataset*)hDS;
+}
+
+wxModelReader::~wxModelReader()
+{
+    if( poDS )
+        GDALClose( (GDALDatasetH)poDS );
+}
+
+/**
+ * Fetch the dataset for this thread.  Owned by the reader.
+ */
+GDALDataset * wxModelReader::GetDataset()
+{
+    return poDS;
+}
+
+/**
+ * Form the GDAL dataset name for a forecast variable.
+ */
+std::string wxModelReader::FormDatasetName( std::string const &fileName,
+                                            std::string const &variable )
+{
+    if( variable.empty() )
+        return fileName;
+    return "NETCDF:" + fileName + ":" + variable;
+}
+
+/**
+ * Key cached variables by name, size and modification time so a forecast
+ * that is downloaded again under the same name is not served stale.
+ */
+std::string wxModelReader::FormCacheKey( std::string const &fileName,
+                                         std::string const &datasetName )
+{
+    VSIStatBufL sStat;
+    if( VSIStatL( fileName.c_str(), &sStat ) != 0 )
+        return datasetName;
+    return CPLSPrintf( "%s|" CPL_FRMT_GIB "|" CPL_FRMT_GIB, datasetName.c_str(),
+                       (GIntBig)sStat.st_size, (GIntBig)sStat.st_mtime );
+}
+
+/**
+ * The netCDF library is not thread safe.  GDAL serializes access to GRIB
+ * files inside the driver, so those are read without our lock.
+ */
+bool wxModelReader::NeedsLock( std::string const &datasetName )
+{
+    return EQUALN( datasetName.c_str(), "NETCDF:", 7 ) ||
+           EQUAL( CPLGetExtension( datasetName.c_str() ), "nc" );
+}
+
+/**
+ * Decode all bands of a variable and add them to the cache.  The cache is
+ * checked again once the lock is held, as another thread may have decoded
+ * the same variable while we waited.
+ */
+boost::shared_ptr<wxModelReader::decodedVariable>
+wxModelReader::Decode( std::string const &datasetName,
+                       std::string const &cacheKey )
+{
+    boost::shared_ptr<decodedVariable> poVar;
+
+#ifdef _OPENMP
+    omp_guard netCDF_guard( netCDF_lock );
+    if( !NeedsLock( datasetName ) )
+        netCDF_guard.release();
+#endif
+
+#pragma omp critical(wxModelReaderCache)
+    {
+        std::map<std::string, boost::shared_ptr<decodedVariable> >::iterator it;
+        it = oVariableCache.find( cacheKey );
+        if( it != oVariableCache.end() )
+            poVar = it->second;
+    }
+    if( poVar )
+        return poVar;
+
+    poVar.reset( new decodedVariable() );
+
+    CPLPushErrorHandler( CPLQuietErrorHandler );
+    GDALDatasetH hSrcDS = GDALOpen( datasetName.c_str(), GA_ReadOnly );
+    CPLPopErrorHandler();
+    if( hSrcDS == NULL )
+        throw badForecastFile( "Cannot open forecast file." );
+
+    poVar->nXSize = GDALGetRasterXSize( hSrcDS );
+    poVar->nYSize = GDALGetRasterYSize( hSrcDS );
+    poVar->nBands = GDALGetRasterCount( hSrcDS );
+    poVar->bHaveGeoTransform =
+        GDALGetGeoTransform( hSrcDS, poVar->adfGeoTransform ) == CE_None;
+    poVar->osWkt = GDALGetProjectionRef( hSrcDS );
+    poVar->papszMetadata = CSLDuplicate( GDALGetMetadata( hSrcDS, NULL ) );
+
+    const size_t nBandSize = (size_t)poVar->nXSize * poVar->nYSize;
+    poVar->adfData.resize( nBandSize * poVar->nBands );
+    poVar->apapszBandMetadata.resize( poVar->nBands, NULL );
+    poVar->abHaveNoData.resize( poVar->nBands, FALSE );
+    poVar->adfNoData.resize( poVar->nBands, 0.0 );
+
+    CPLErr eErr = CE_None;
+    for( int b = 0; b < poVar->nBands && eErr == CE_None; b++ )
+    {
+        GDALRasterBandH hBand = GDALGetRasterBand( hSrcDS, b + 1 );
+        poVar->adfNoData[b] = GDALGetRasterNoDataValue( hBand,
+                                                        &(poVar->abHaveNoData[b]) );
+        poVar->apapszBandMetadata[b] = CSLDuplicate( GDALGetMetadata( hBand, NULL ) );
+        eErr = GDALRasterIO( hBand, GF_Read, 0, 0, poVar->nXSize, poVar->nYSize,
+                             &(poVar->adfData[b * nBandSize]),
+                             poVar->nXSize, poVar->nYSize, GDT_Float64, 0, 0 );
+    }
+    GDALClose( hSrcDS );
+    if( eErr != CE_None )
+        throw badForecastFile( "Failed to read data from the forecast file." );
+
+#pragma omp critical(wxModelReaderCache)
+    {
+        if( oVariableCache.size() >= MAX_CACHED_VARIABLES )
+            oVariableCache.clear();
+        oVariableCache[cacheKey] = poVar;
+    }
+
+    return poVar;
+}
+
+/**
+ * Release all decoded forecast data.  Datasets still held by readers stay
+ * valid until the readers are destroyed.
+ */
+void wxModelReader::ClearCache()
+{
+#pragma omp critical(wxModelReaderCache)
+    {
+        oVariableCache.clear();
+    }
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+ *
+ * $Id$
+ *
+ * Project:  WindNinja
+ * Purpose:  Thread safe, cached access to decoded forecast variables
+ * Author:   
+ *
+ ******************************************************************************
+ *
+ * THIS SOFTWARE WAS DEVELOPED AT THE ROCKY MOUNTAIN RESEARCH STATION (RMRS)
+ * MISSOULA FIRE SCIENCES LABORATORY BY EMPLOYEES OF THE FEDERAL GOVERNMENT
+ * IN THE COURSE OF THEIR OFFICIAL DUTIES. PURSUANT TO TITLE 17 SECTION 105
+ * OF THE UNITED STATES CODE, THIS SOFTWARE IS NOT SUBJECT TO COPYRIGHT
+ * PROTECTION AND IS IN THE PUBLIC DOMAIN. RMRS MISSOULA FIRE SCIENCES
+ * LABORATORY ASSUMES NO RESPONSIBILITY WHATSOEVER FOR ITS USE BY OTHER
+ * PARTIES,  AND MAKES NO GUARANTEES, EXPRESSED OR IMPLIED, ABOUT ITS QUALITY,
+ * RELIABILITY, OR ANY OTHER CHARACTERISTIC.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef WX_MODEL_READER_H
+#define WX_MODEL_READER_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "gdal_priv.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include <omp.h>
+#include "omp_guard.h"
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "ninjaException.h"
+
+extern omp_lock_t netCDF_lock;
+
+/**
+ * Reader layer between the wx model initializations and GDAL.
+ *
+ * Each forecast variable (a NETCDF subdataset or a GRIB file) is decoded once
+ * into memory, all bands at once, and shared by every thread in the process.
+ * Only the decode itself is serialized, and only for backends that are not
+ * thread safe (the netCDF library).  Callers get a private MEM dataset that
+ * wraps the shared, read only buffers without copying, so projection setup,
+ * warping and interpolation for different runs proceed concurrently and can
+ * overlap with solves in other threads.
+ *
+ * The returned dataset is closed when the reader goes out of scope.  Callers
+ * may change the georeferencing of their dataset (wrf does) without affecting
+ * other threads.
+ */
+class wxModelReader
+{
+public:
+    wxModelReader( std::string const &fileName,
+                   std::string const &variable = std::string() );
+    ~wxModelReader();
+
+    GDALDataset * GetDataset();
+
+    static std::string FormDatasetName( std::string const &fileName,
+                                        std::string const &variable );
+    static void ClearCache();
+
+    /* Number of decoded variables kept before the cache is flushed */
+    static const unsigned int MAX_CACHED_VARIABLES = 64;
+
+private:
+    /*
+    ** All bands of one forecast variable, decoded to doubles in band
+    ** sequential order along with the information needed to rebuild a
+    ** dataset around them.
+    */
+    class decodedVariable
+    {
+    public:
+        decodedVariable();
+        ~decodedVariable();
+
+        int nXSize;
+        int nYSize;
+        int nBands;
+        int bHaveGeoTransform;
+        double adfGeoTransform[6];
+        std::string osWkt;
+        char **papszMetadata;
+        std::vector<char **> apapszBandMetadata;
+        std::vector<int> abHaveNoData;
+        std::vector<double> adfNoData;
+        std::vector<double> adfData;
+
+    private:
+        decodedVariable( decodedVariable const & );
+        decodedVariable &operator=( decodedVariable const & );
+    };
+
+    static boost::shared_ptr<decodedVariable> Decode( std::string const &datasetName,
+                                                      std::string const &cacheKey );
+    static bool NeedsLock( std::string const &datasetName );
+    static std::string FormCacheKey( std::string const &fileName,
+                                     std::string const &datasetName );
+
+    boost::shared_ptr<decodedVariable> poData;
+    GDALDataset *poDS;
+
+    static std::map<std::string, boost::shared_ptr<decodedVariable> > oVariableCache;
+
+    wxModelReader( wxModelReader const & );
+    wxModelReader &operator=( wxModelReader const & );
+};
+
+#endif /* WX_MODEL_READER_H */
@@ -32,6 +32,9 @@
  * @author Kyle Shannon <ksshannon@gmail.com>
  */
 #include "wxStation.h"
+
+#include <algorithm>
+#include <map>
 /**
  * Default constructor for wxStation class populated with default values
  * @see wxStation::initialize
@@ -68,6 +71,7 @@ wxStation::wxStation( wxStation const& m )
     influenceRadiusUnits = m.influenceRadiusUnits;
     datumType = m.datumType;
     coordType = m.coordType;
+    datetime = m.datetime;
 }
 
 /**
@@ -100,6 +104,7 @@ wxStation& wxStation::operator= ( wxStation const& m )
     influenceRadiusUnits = m.influenceRadiusUnits;
     datumType = m.datumType;
     coordType = m.coordType;
+    datetime = m.datetime;
     }
     return *this;
 }
@@ -134,6 +139,7 @@ void wxStation::initialize()
     influenceRadiusUnits = lengthUnits::meters;
     datumType = WGS84;
     coordType = GEOGCS;
+    datetime = boost::posix_time::not_a_date_time;
 }
 
 /** Checks wxStation for valid parameters.
@@ -386,6 +392,22 @@ void wxStation::set_location_LatLong( double Lat, double Lon,
     GDALClose( (GDALDatasetH)poDS );
 }
 
+/**
+ * Copy the location of another station, without transforming it again.
+ * @param m station to copy the location from
+ */
+void wxStation::copyLocation( wxStation const& m )
+{
+    lat = m.lat;
+    lon = m.lon;
+    projXord = m.projXord;
+    projYord = m.projYord;
+    xord = m.xord;
+    yord = m.yord;
+    datumType = m.datumType;
+    coordType = m.coordType;
+}
+
 /**
  * Set the height of the station
  * @param Height height of the station
@@ -489,7 +511,10 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
     poFeatureDefn = poLayer->GetLayerDefn();
     //check for correct number of fields, and proper header
     int nFields = poFeatureDefn->GetFieldCount();
-    if( nFields != CSLCount( papszHeader ) ) {
+    //an optional last column holds the observation time of each row
+    bool bHasTime = nFields == CSLCount( papszHeader ) + 1 &&
+        EQUAL( poFeatureDefn->GetFieldDefn( nFields - 1 )->GetNameRef(), "Date_Time" );
+    if( nFields != CSLCount( papszHeader ) && !bHasTime ) {
         OGR_DS_Destroy( hDS );
         oErrorString = "Incorrect number of definitions in csv file. ";
         oErrorString += "There are ";
@@ -503,7 +528,7 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
     while( ( poFeature = poLayer->GetNextFeature() ) != NULL ) {
         poFeatureDefn = poLayer->GetLayerDefn();
         int iField;
-        for( iField = 0; iField < poFeatureDefn->GetFieldCount(); iField++) {
+        for( iField = 0; iField < CSLCount( papszHeader ); iField++) {
             poFieldDefn = poFeatureDefn->GetFieldDefn( iField );
             if( !EQUAL( poFieldDefn->GetNameRef(),
                 papszHeader[iField] ) ) {
@@ -519,6 +544,9 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
 
     const char *pszKey;
     std::string oStationName;
+    //rows of a time series repeat locations, transform each one once
+    std::map<std::string, wxStation> oLocated;
+    std::string oLocationKey;
 
     poLayer->ResetReading();
     while( ( poFeature = poLayer->GetNextFeature() ) != NULL ) {
@@ -530,8 +558,15 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
 
     // get location
     pszKey = poFeature->GetFieldAsString( 1 );
+    oLocationKey = CPLSPrintf( "%s|%s|%s|%s", pszKey,
+                               poFeature->GetFieldAsString( 2 ),
+                               poFeature->GetFieldAsString( 3 ),
+                               poFeature->GetFieldAsString( 4 ) );
 
-    if( EQUAL( pszKey, "geogcs" ) ){
+    if( oLocated.find( oLocationKey ) != oLocated.end() ) {
+        oStation.copyLocation( oLocated[oLocationKey] );
+    }
+    else if( EQUAL( pszKey, "geogcs" ) ){
         //check for valid latitude in degrees
         dfTempValue = poFeature->GetFieldAsDouble( 3 );
         if( dfTempValue > 90.0 || dfTempValue < -90.0 ) {
@@ -578,6 +613,7 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
 
         throw( std::domain_error( oErrorString ) );
     }
+    oLocated[oLocationKey] = oStation;
 
     //get height and units
 
@@ -697,6 +733,20 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
         throw( std::domain_error( oErrorString ) );
     }
 
+    //set observation time
+    if( bHasTime ) {
+        boost::posix_time::ptime oTime =
+            parseObservationTime( poFeature->GetFieldAsString( nFields - 1 ) );
+        if( oTime.is_not_a_date_time() ) {
+            oErrorString = "Invalid date and time: ";
+            oErrorString += poFeature->GetFieldAsString( nFields - 1 );
+            oErrorString += " at station: ";
+            oErrorString += oStationName;
+            throw( std::domain_error( oErrorString ) );
+        }
+        oStation.set_datetime( oTime );
+    }
+
     oStations.push_back( oStation );
     oStation.initialize();
     }
@@ -707,6 +757,99 @@ std::vector<wxStation> wxStation::readStationFile( std::string csvFile,
 
     return oStations;
 }
+/**
+ * Parse an observation time such as 2016-08-12T14:00:00Z.  Times are UTC,
+ * the trailing Z is optional.
+ * @param pszTime time string from a station file
+ * @return the time, or not_a_date_time if it cannot be parsed
+ */
+boost::posix_time::ptime wxStation::parseObservationTime( const char *pszTime )
+{
+    std::string oTime( pszTime );
+    if( !oTime.empty() && ( oTime[oTime.size() - 1] == 'Z' ||
+                            oTime[oTime.size() - 1] == 'z' ) )
+        oTime.erase( oTime.size() - 1 );
+    std::replace( oTime.begin(), oTime.end(), 'T', ' ' );
+    if( oTime.find( ' ' ) == std::string::npos )
+        return boost::posix_time::ptime( boost::posix_time::not_a_date_time );
+    try {
+        return boost::posix_time::time_from_string( oTime );
+    }
+    catch( std::exception & ) {
+        return boost::posix_time::ptime( boost::posix_time::not_a_date_time );
+    }
+}
+
+/** Read the observations of a station file, or of every csv file in a
+ * directory, and group them by time.
+ * Rows carry their time in the Date_Time column, files in a directory must
+ * have it.  The stations of each time are kept in the order they first
+ * appear, so runs of the series list them in the same order.
+ * @param stationPath station file or directory of station files
+ * @param demFile georeferenced dem file for converting lat/lon to projcs
+ * @return stations of each observation time, in time order
+ */
+std::vector<std::vector<wxStation> > wxStation::readStationTimeSeries( std::string stationPath,
+                                                     std::string demFile )
+{
+    std::vector<wxStation> oStations;
+    VSIStatBufL sStat;
+    if( VSIStatL( stationPath.c_str(), &sStat ) == 0 && VSI_ISDIR( sStat.st_mode ) ) {
+        std::vector<std::string> oFiles;
+        char **papszFiles = VSIReadDir( stationPath.c_str() );
+        for( int i = 0; i < CSLCount( papszFiles ); i++ ) {
+            if( EQUAL( CPLGetExtension( papszFiles[i] ), "csv" ) )
+                oFiles.push_back( CPLFormFilename( stationPath.c_str(),
+                                                   papszFiles[i], NULL ) );
+        }
+        CSLDestroy( papszFiles );
+        if( oFiles.empty() )
+            throw( std::runtime_error( "No station files in directory: " + stationPath ) );
+        std::sort( oFiles.begin(), oFiles.end() );
+        for( unsigned int i = 0; i < oFiles.size(); i++ ) {
+            std::vector<wxStation> oFileStations = readStationFile( oFiles[i], demFile );
+            for( unsigned int j = 0; j < oFileStations.size(); j++ ) {
+                if( oFileStations[j].get_datetime().is_not_a_date_time() )
+                    throw( std::domain_error( "Station files in a directory need a " \
+                                              "Date_Time column: " + oFiles[i] ) );
+            }
+            oStations.insert( oStations.end(), oFileStations.begin(), oFileStations.end() );
+        }
+    }
+    else
+        oStations = readStationFile( stationPath, demFile );
+
+    std::map<std::string, int> oOrder;
+    for( unsigned int i = 0; i < oStations.size(); i++ ) {
+        if( oOrder.find( oStations[i].get_stationName() ) == oOrder.end() ) {
+            int n = oOrder.size();
+            oOrder[oStations[i].get_stationName()] = n;
+        }
+    }
+
+    //observations of each time, keyed by their first appearance
+    std::map<boost::posix_time::ptime, std::map<int, wxStation> > oTimes;
+    for( unsigned int i = 0; i < oStations.size(); i++ ) {
+        std::map<int, wxStation> &oStep = oTimes[oStations[i].get_datetime()];
+        int n = oOrder[oStations[i].get_stationName()];
+        if( oStep.find( n ) != oStep.end() )
+            throw( std::domain_error( "More than one observation at one time " \
+                                      "for station: " + oStations[i].get_stationName() ) );
+        oStep[n] = oStations[i];
+    }
+
+    std::vector<std::vector<wxStation> > oSeries;
+    std::map<boost::posix_time::ptime, std::map<int, wxStation> >::iterator it;
+    for( it = oTimes.begin(); it != oTimes.end(); it++ ) {
+        std::vector<wxStation> oStep;
+        std::map<int, wxStation>::iterator jt;
+        for( jt = it->second.begin(); jt != it->second.end(); jt++ )
+            oStep.push_back( jt->second );
+        oSeries.push_back( oStep );
+    }
+    return oSeries;
+}
+
 /**Write a csv file with no data, just a header
  * @param outFileName file to write
  */
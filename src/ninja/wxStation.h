@@ -33,6 +33,8 @@
 #include <stdio.h>
 #include <vector>
 #include <string>
+
+#include "boost/date_time/posix_time/posix_time.hpp"
 	
 #include "gdal_util.h"
 #include "gdal_priv.h"
@@ -87,6 +89,8 @@ class wxStation
     double get_cloudCover( coverUnits::eCoverUnits units = coverUnits::fraction );
     void set_influenceRadius( double InfluenceRadius, lengthUnits::eLengthUnits units );
     double get_influenceRadius( lengthUnits::eLengthUnits units = lengthUnits::meters );
+    inline void set_datetime( boost::posix_time::ptime t ) { datetime = t; }
+    inline boost::posix_time::ptime get_datetime() { return datetime; }
 
     inline eCoordType get_coordType() { return coordType; }
     inline void set_coordType( eCoordType c ){ coordType = c; }
@@ -105,6 +109,9 @@ class wxStation
     static char** getValidHeader();
     static std::vector<wxStation> readStationFile( std::string csvFile, 
 					      std::string demFile );
+    static std::vector<std::vector<wxStation> > readStationTimeSeries( std::string stationPath,
+                                                  std::string demFile );
+    static boost::posix_time::ptime parseObservationTime( const char *pszTime );
     static void writeKmlFile( std::vector<wxStation> stations, 
 			      std::string outFileName );
 
@@ -114,6 +121,8 @@ class wxStation
 
  private:
 
+    void copyLocation( wxStation const& m );
+
     std::string stationName;
     double lat, lon;           //latitude and longitude
     double projXord;           //x-coordinate of station (in projected coordinate system)
@@ -128,6 +137,7 @@ class wxStation
     double cloudCover;	       //in fractions of cloud cover (0-1) (value < 0 indicates no value available)
     double influenceRadius;    //maximum radius that the station is used for during interpolation (m)
     // *Note: Value < 0 is a flag indicating influence radius is infinity (ie. influences everything)
+    boost::posix_time::ptime datetime;  //observation time in UTC (not_a_date_time if not given)
     //Unit enums
     lengthUnits::eLengthUnits heightUnits;
     velocityUnits::eVelocityUnits inputSpeedUnits;